@@ -4,13 +4,65 @@
  */
 #include "channel.h"
 
+#include <cstring>
+#include <random>
+#include <stdexcept>
 #include <utility>
 
+#include "logger.h"
+
 static constexpr bool kPrintChannelOutput = false;
 static constexpr bool kPrintSNRCheck = false;
 
+ChannelWorkspace::ChannelWorkspace(size_t bs_ant, size_t ue_ant,
+                                   size_t n_samps, size_t fft_size,
+                                   uint64_t seed)
+    : rng_(seed) {
+  packed_h_ = static_cast<float*>(
+      Agora_memory::PaddedAlignedAlloc(Agora_memory::Alignment_t::kAlign64,
+                                       PackedChannelSize(bs_ant, ue_ant) *
+                                           sizeof(float)));
+  noise_ = static_cast<float*>(Agora_memory::PaddedAlignedAlloc(
+      Agora_memory::Alignment_t::kAlign64, 2 * n_samps * sizeof(float)));
+  if (fft_size == 0) {
+    return;
+  }
+
+  for (size_t is_downlink = 0; is_downlink < 2; is_downlink++) {
+    const size_t n_in = is_downlink ? bs_ant : ue_ant;
+    const size_t n_out = is_downlink ? ue_ant : bs_ant;
+    // From the OFDM symbol of each antenna column to contiguous subcarriers
+    FftLayout fft_layout(fft_size);
+    fft_layout.num_transforms_ = n_in;
+    fft_layout.in_distance_ = n_samps;
+    fft_layout.in_place_ = false;
+    fft_[is_downlink] = FftPlan::Create(FftDirection::kForward, fft_layout);
+
+    FftLayout ifft_layout(fft_size);
+    ifft_layout.num_transforms_ = n_out;
+    ifft_layout.out_distance_ = n_samps;
+    ifft_layout.in_place_ = false;
+    ifft_[is_downlink] =
+        FftPlan::Create(FftDirection::kBackward, ifft_layout);
+  }
+  const size_t freq_bytes =
+      fft_size * std::max(bs_ant, ue_ant) * sizeof(complex_float);
+  freq_in_ = static_cast<complex_float*>(Agora_memory::PaddedAlignedAlloc(
+      Agora_memory::Alignment_t::kAlign64, freq_bytes));
+  freq_out_ = static_cast<complex_float*>(Agora_memory::PaddedAlignedAlloc(
+      Agora_memory::Alignment_t::kAlign64, freq_bytes));
+}
+
+ChannelWorkspace::~ChannelWorkspace() {
+  std::free(packed_h_);
+  std::free(noise_);
+  std::free(freq_in_);
+  std::free(freq_out_);
+}
+
 Channel::Channel(const Config* const config, std::string& in_channel_type,
-                 double in_channel_snr)
+                 double in_channel_snr, double delay_spread_ns,
+                 double doppler_hz)
     : cfg_(config),
       sim_chan_model_(std::move(in_channel_type)),
       channel_snr_db_(in_channel_snr) {
@@ -18,6 +70,7 @@ Channel::Channel(const Config* const config, std::string& in_channel_type,
   ue_ant_ = cfg_->UeAntNum();
   n_samps_ = cfg_->SampsPerSymbol();
 
+  TdlChannel::Profile tdl_profile;
   if (sim_chan_model_ == "AWGN") {
     chan_model_ = kAwgn;
   } else if (sim_chan_model_ == "RAYLEIGH") {
@@ -26,6 +79,16 @@ Channel::Channel(const Config* const config, std::string& in_channel_type,
     chan_model_ = kRan3Gpp;
     printf("3GPP Model in progress, setting to RAYLEIGH channel \n");
     chan_model_ = kRayleigh;
+  } else if (TdlChannel::ParseProfile(sim_chan_model_, tdl_profile)) {
+    chan_model_ = kTdl;
+    tdl_ = std::make_unique<TdlChannel>(
+        tdl_profile, ue_ant_, bs_ant_, cfg_->OfdmCaNum(), cfg_->Rate(),
+        delay_spread_ns, doppler_hz, cfg_->GetFrameDurationSec(),
+        std::random_device{}());
+    MLPD_INFO(
+        "Channel: %s model, delay spread %.0f ns, maximum Doppler shift %.1f "
+        "Hz\n",
+        sim_chan_model_.c_str(), delay_spread_ns, doppler_hz);
   } else {
     chan_model_ = kAwgn;
   }
@@ -39,27 +102,17 @@ void Channel::ApplyChan(const arma::cx_fmat& fmat_src, arma::cx_fmat& fmat_dst,
 
   if (is_newChan) {
     switch (chan_model_) {
-      case kAwgn: {
-        arma::fmat rmat(ue_ant_, bs_ant_, arma::fill::ones);
-        arma::fmat imat(ue_ant_, bs_ant_, arma::fill::zeros);
-        h_ = arma::cx_fmat(rmat, imat);
-        // H = H / abs(H).max();
-      } break;
-
+      case kAwgn:
       case kRayleigh:
-        // Simple Uncorrelated Rayleigh Channel - Flat fading (single tap)
-        {
-          arma::fmat rmat(ue_ant_, bs_ant_, arma::fill::randn);
-          arma::fmat imat(ue_ant_, bs_ant_, arma::fill::randn);
-          h_ = arma::cx_fmat(rmat, imat);
-          h_ = (1 / sqrt(2)) * h_;
-          // H = H / abs(H).max();
-        }
+        UpdateChannel();
         break;
 
       case kRan3Gpp:
         Lte3gpp(fmat_src, fmat_dst);
         break;
+
+      case kTdl:
+        throw std::runtime_error("Channel: TDL models need ApplyChanSimd()");
     }
   }
   if (is_downlink) {
@@ -76,6 +129,106 @@ void Channel::ApplyChan(const arma::cx_fmat& fmat_src, arma::cx_fmat& fmat_dst,
   }
 }
 
+void Channel::ApplyChanSimd(const arma::cx_fmat& fmat_src,
+                            arma::cx_fmat& fmat_dst, const bool is_downlink,
+                            const bool is_newChan,
+                            ChannelWorkspace& workspace) {
+  const size_t n_in = is_downlink ? bs_ant_ : ue_ant_;
+  const size_t n_out = is_downlink ? ue_ant_ : bs_ant_;
+  const size_t n_samps = fmat_src.n_rows;
+  auto* dst = reinterpret_cast<float*>(fmat_dst.memptr());
+  if (chan_model_ == kTdl) {
+    if (is_newChan) {
+      tdl_->NewFrame();
+    }
+    ApplyTdl(fmat_src, fmat_dst, is_downlink, workspace);
+  } else {
+    {
+      std::lock_guard<std::mutex> lock(h_mutex_);
+      if (is_newChan) {
+        UpdateChannel();
+      }
+      // h_ is UE x BS, so the downlink applies its transpose
+      const float scale =
+          is_downlink ? 1.0f / std::sqrt(static_cast<float>(bs_ant_)) : 1.0f;
+      PackChannelMatrix(reinterpret_cast<const float*>(h_.memptr()), n_in,
+                        n_out, is_downlink, scale, workspace.packed_h_);
+    }
+    ApplyChannelMatrix(reinterpret_cast<const float*>(fmat_src.memptr()),
+                       n_samps, n_in, workspace.packed_h_, n_out, dst);
+  }
+
+  if (channel_snr_db_ < 120.0f) {
+    const float snr_lin = std::pow(10, channel_snr_db_ / 10);
+    AddAwgn(dst, n_samps, n_out, snr_lin, workspace.rng_, workspace.noise_);
+  }
+
+  if (kPrintChannelOutput) {
+    Utils::PrintMat(h_, "H");
+  }
+}
+
+void Channel::UpdateChannel() {
+  switch (chan_model_) {
+    case kAwgn: {
+      arma::fmat rmat(ue_ant_, bs_ant_, arma::fill::ones);
+      arma::fmat imat(ue_ant_, bs_ant_, arma::fill::zeros);
+      h_ = arma::cx_fmat(rmat, imat);
+      // H = H / abs(H).max();
+    } break;
+
+    // Simple Uncorrelated Rayleigh Channel - Flat fading (single tap). The
+    // 3GPP model is in progress and falls back to it here.
+    case kRayleigh:
+    case kRan3Gpp: {
+      arma::fmat rmat(ue_ant_, bs_ant_, arma::fill::randn);
+      arma::fmat imat(ue_ant_, bs_ant_, arma::fill::randn);
+      h_ = arma::cx_fmat(rmat, imat);
+      h_ = (1 / sqrt(2)) * h_;
+      // H = H / abs(H).max();
+    } break;
+
+    // The TDL channel is updated by TdlChannel
+    case kTdl:
+      break;
+  }
+}
+
+void Channel::ApplyTdl(const arma::cx_fmat& fmat_src, arma::cx_fmat& fmat_dst,
+                       const bool is_downlink, ChannelWorkspace& workspace) {
+  const size_t n_out = is_downlink ? ue_ant_ : bs_ant_;
+  const size_t fft_size = cfg_->OfdmCaNum();
+  const size_t cp_len = cfg_->CpLen();
+  // Start of the OFDM symbol after the zero prefix and the cyclic prefix
+  const size_t body_start = cfg_->OfdmTxZeroPrefix() + cp_len;
+  const std::shared_ptr<const std::vector<float>> response = tdl_->Response();
+
+  // The FFT plan only reads its input
+  auto* src = const_cast<complex_float*>(
+      reinterpret_cast<const complex_float*>(fmat_src.memptr()));
+  auto* dst = reinterpret_cast<complex_float*>(fmat_dst.memptr());
+  workspace.fft_[is_downlink]->Execute(src + body_start, workspace.freq_in_);
+  // Response of UE antenna u to BS antenna b is at pair u + b * ue_ant_
+  const float scale =
+      is_downlink ? 1.0f / std::sqrt(static_cast<float>(bs_ant_)) : 1.0f;
+  ApplySubcarrierMatrices(reinterpret_cast<const float*>(workspace.freq_in_),
+                          fft_size, is_downlink ? bs_ant_ : ue_ant_,
+                          response->data(), is_downlink ? ue_ant_ : 1,
+                          is_downlink ? 1 : ue_ant_, n_out, scale,
+                          reinterpret_cast<float*>(workspace.freq_out_));
+  workspace.ifft_[is_downlink]->Execute(workspace.freq_out_, dst + body_start);
+
+  for (size_t j = 0; j < n_out; j++) {
+    complex_float* col = dst + j * n_samps_;
+    std::memset(col, 0, cfg_->OfdmTxZeroPrefix() * sizeof(complex_float));
+    std::memcpy(col + cfg_->OfdmTxZeroPrefix(),
+                col + body_start + fft_size - cp_len,
+                cp_len * sizeof(complex_float));
+    std::memset(col + body_start + fft_size, 0,
+                cfg_->OfdmTxZeroPostfix() * sizeof(complex_float));
+  }
+}
+
 void Channel::Awgn(const arma::cx_fmat& src, arma::cx_fmat& dst) const {
   if (channel_snr_db_ < 120.0f) {
     const int n_row = src.n_rows;
@@ -11,26 +11,64 @@
 #include <cmath>
 #include <ctime>
 #include <iomanip>
+#include <mutex>
 #include <numeric>
 
 #include "buffer.h"
+#include "channel_kernels.h"
 #include "config.h"
+#include "fft_backend.h"
 #include "gettime.h"
 #include "memory_manage.h"
 #include "signal_handler.h"
 #include "symbols.h"
+#include "tdl_channel.h"
 #include "utils.h"
 
+/// Per-thread random number generator, FFT plans and buffers for
+/// Channel::ApplyChanSimd()
+struct ChannelWorkspace {
+  /// [fft_size] is the OFDM FFT size for frequency-selective channels, or 0
+  /// for flat ones
+  ChannelWorkspace(size_t bs_ant, size_t ue_ant, size_t n_samps,
+                   size_t fft_size, uint64_t seed);
+  ~ChannelWorkspace();
+
+  GaussianRng rng_;
+  // Channel matrix packed for ApplyChannelMatrix()
+  float* packed_h_;
+  // Gaussian samples for one antenna
+  float* noise_;
+
+  // FFTs of all input antennas and IFFTs of all output antennas, indexed by
+  // is_downlink
+  std::unique_ptr<FftPlan> fft_[2];
+  std::unique_ptr<FftPlan> ifft_[2];
+  // Subcarriers of all input and output antennas
+  complex_float* freq_in_ = nullptr;
+  complex_float* freq_out_ = nullptr;
+};
+
 class Channel {
  public:
   Channel(const Config* const config, std::string& channel_type,
-          double channel_snr);
+          double channel_snr, double delay_spread_ns = 100.0,
+          double doppler_hz = 10.0);
   ~Channel();
 
+  /// True for the TDL models, which only ApplyChanSimd() supports
+  inline bool IsFrequencySelective() const { return chan_model_ == kTdl; }
+
   // Dimensions of fmat_src: ( bscfg->sampsPerSymbol, uecfg->UE_ANT_NUM )
   void ApplyChan(const arma::cx_fmat& fmat_src, arma::cx_fmat& mat_dst,
                  const bool is_downlink, const bool is_newChan);
 
+  // Same as ApplyChan(), using the AVX2 channel kernels and the calling
+  // thread's [workspace]. Safe to call from several threads at once.
+  void ApplyChanSimd(const arma::cx_fmat& fmat_src, arma::cx_fmat& fmat_dst,
+                     const bool is_downlink, const bool is_newChan,
+                     ChannelWorkspace& workspace);
+
   // Additive White Gaussian Noise. Dimensions of src: ( bscfg->sampsPerSymbol,
   // uecfg->UE_ANT_NUM )
   void Awgn(const arma::cx_fmat& fmat_src, arma::cx_fmat& fmat_dst) const;
@@ -49,6 +87,15 @@ class Channel {
   void Lte3gpp(const arma::cx_fmat& fmat_src, arma::cx_fmat& fmat_dst);
 
  private:
+  // Draw a new channel matrix h_ for the AWGN and Rayleigh models
+  void UpdateChannel();
+
+  // Apply the TDL channel on the subcarriers of the OFDM symbol. The cyclic
+  // prefix is rebuilt from the output, which models a cyclic prefix longer
+  // than the delay spread.
+  void ApplyTdl(const arma::cx_fmat& fmat_src, arma::cx_fmat& fmat_dst,
+                const bool is_downlink, ChannelWorkspace& workspace);
+
   const Config* const cfg_;
 
   Channel* channel_;
@@ -58,9 +105,12 @@ class Channel {
 
   std::string sim_chan_model_;
   double channel_snr_db_;
-  enum ChanModel { kAwgn, kRayleigh, kRan3Gpp } chan_model_;
+  enum ChanModel { kAwgn, kRayleigh, kRan3Gpp, kTdl } chan_model_;
 
   arma::cx_fmat h_;
+  // Serializes updates of h_ with its reads by ApplyChanSimd()
+  std::mutex h_mutex_;
+  std::unique_ptr<TdlChannel> tdl_;
 };
 
 #endif  // CHANNEL_H_
@@ -0,0 +1,367 @@
+/**
+ * @file channel_kernels.cc
+ * @brief Implementation file for the AVX2 kernels of the channel simulator
+ */
+#include "channel_kernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// Output columns accumulated together by ApplyChannelMatrix()
+static constexpr size_t kChanColBlock = 4;
+// Complex samples per AVX2 register
+static constexpr size_t kCplxPerVec = 4;
+// Subcarriers per block of ApplySubcarrierMatrices(), sized so that the
+// block of every input antenna stays in the L1/L2 cache
+static constexpr size_t kScBlock = 64;
+
+static uint64_t SplitMix64(uint64_t& x) {
+  uint64_t z = (x += 0x9e3779b97f4a7c15ull);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+  return z ^ (z >> 31);
+}
+
+static inline __m256i Rotl32(__m256i x, int k) {
+  return _mm256_or_si256(_mm256_slli_epi32(x, k), _mm256_srli_epi32(x, 32 - k));
+}
+
+// Natural logarithm of positive normal floats. Splits x into 2^e * m with m
+// in [sqrt(1/2), sqrt(2)) and evaluates ln(m) = 2 atanh((m - 1) / (m + 1))
+// with its odd series, accurate to about 1e-7.
+static inline __m256 LogPs(__m256 x) {
+  const __m256i bits = _mm256_castps_si256(x);
+  __m256i e = _mm256_sub_epi32(_mm256_srli_epi32(bits, 23),
+                               _mm256_set1_epi32(127));
+  __m256 m = _mm256_castsi256_ps(
+      _mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32(0x7fffff)),
+                      _mm256_set1_epi32(0x3f800000)));
+  const __m256 big = _mm256_cmp_ps(m, _mm256_set1_ps(M_SQRT2), _CMP_GT_OQ);
+  m = _mm256_blendv_ps(m, _mm256_mul_ps(m, _mm256_set1_ps(0.5f)), big);
+  e = _mm256_sub_epi32(e, _mm256_castps_si256(big));  // e += 1 where big
+
+  const __m256 one = _mm256_set1_ps(1.0f);
+  const __m256 t =
+      _mm256_div_ps(_mm256_sub_ps(m, one), _mm256_add_ps(m, one));
+  const __m256 t2 = _mm256_mul_ps(t, t);
+  __m256 p = _mm256_set1_ps(1.0f / 9);
+  p = _mm256_add_ps(_mm256_mul_ps(p, t2), _mm256_set1_ps(1.0f / 7));
+  p = _mm256_add_ps(_mm256_mul_ps(p, t2), _mm256_set1_ps(1.0f / 5));
+  p = _mm256_add_ps(_mm256_mul_ps(p, t2), _mm256_set1_ps(1.0f / 3));
+  p = _mm256_add_ps(_mm256_mul_ps(p, t2), one);
+  const __m256 log_m = _mm256_mul_ps(_mm256_set1_ps(2.0f), _mm256_mul_ps(p, t));
+  return _mm256_add_ps(
+      _mm256_mul_ps(_mm256_cvtepi32_ps(e), _mm256_set1_ps(M_LN2)), log_m);
+}
+
+// cos(2 pi u) and sin(2 pi u) for u in [0, 1). The quadrant is taken from
+// the integer part of 4u, and the angle within it is evaluated as
+// pi / 4 + y with |y| <= pi / 4, where short Taylor series are accurate to
+// about 3e-7.
+static inline void SinCos2PiPs(__m256 u, __m256& cos_out, __m256& sin_out) {
+  const __m256 u4 = _mm256_mul_ps(u, _mm256_set1_ps(4.0f));
+  const __m256i q = _mm256_cvttps_epi32(u4);
+  const __m256 frac = _mm256_sub_ps(u4, _mm256_cvtepi32_ps(q));
+  const __m256 y = _mm256_mul_ps(_mm256_sub_ps(frac, _mm256_set1_ps(0.5f)),
+                                 _mm256_set1_ps(M_PI_2));
+  const __m256 y2 = _mm256_mul_ps(y, y);
+
+  __m256 sin_y = _mm256_set1_ps(-1.0f / 5040);
+  sin_y = _mm256_add_ps(_mm256_mul_ps(sin_y, y2), _mm256_set1_ps(1.0f / 120));
+  sin_y = _mm256_add_ps(_mm256_mul_ps(sin_y, y2), _mm256_set1_ps(-1.0f / 6));
+  sin_y = _mm256_add_ps(_mm256_mul_ps(sin_y, y2), _mm256_set1_ps(1.0f));
+  sin_y = _mm256_mul_ps(sin_y, y);
+  __m256 cos_y = _mm256_set1_ps(1.0f / 40320);
+  cos_y = _mm256_add_ps(_mm256_mul_ps(cos_y, y2), _mm256_set1_ps(-1.0f / 720));
+  cos_y = _mm256_add_ps(_mm256_mul_ps(cos_y, y2), _mm256_set1_ps(1.0f / 24));
+  cos_y = _mm256_add_ps(_mm256_mul_ps(cos_y, y2), _mm256_set1_ps(-0.5f));
+  cos_y = _mm256_add_ps(_mm256_mul_ps(cos_y, y2), _mm256_set1_ps(1.0f));
+
+  // Angle x = y + pi / 4 within the quadrant
+  const __m256 inv_sqrt2 = _mm256_set1_ps(M_SQRT1_2);
+  const __m256 cos_x = _mm256_mul_ps(_mm256_sub_ps(cos_y, sin_y), inv_sqrt2);
+  const __m256 sin_x = _mm256_mul_ps(_mm256_add_ps(cos_y, sin_y), inv_sqrt2);
+
+  // Rotate by q quadrants: (c, s) -> (-s, c) -> (-c, -s) -> (s, -c)
+  const __m256 swap = _mm256_castsi256_ps(_mm256_cmpeq_epi32(
+      _mm256_and_si256(q, _mm256_set1_epi32(1)), _mm256_set1_epi32(1)));
+  const __m256 c = _mm256_blendv_ps(cos_x, sin_x, swap);
+  const __m256 s = _mm256_blendv_ps(sin_x, cos_x, swap);
+  const __m256i sign_bit = _mm256_set1_epi32(0x80000000);
+  const __m256i two = _mm256_set1_epi32(2);
+  const __m256i neg_cos = _mm256_slli_epi32(
+      _mm256_and_si256(_mm256_add_epi32(q, _mm256_set1_epi32(1)), two), 30);
+  const __m256i neg_sin = _mm256_slli_epi32(_mm256_and_si256(q, two), 30);
+  cos_out = _mm256_xor_ps(
+      c, _mm256_castsi256_ps(_mm256_and_si256(neg_cos, sign_bit)));
+  sin_out = _mm256_xor_ps(
+      s, _mm256_castsi256_ps(_mm256_and_si256(neg_sin, sign_bit)));
+}
+
+GaussianRng::GaussianRng(uint64_t seed) {
+  alignas(32) uint32_t words[4][kLanes];
+  for (auto& lane_words : words) {
+    for (auto& word : lane_words) {
+      word = static_cast<uint32_t>(SplitMix64(seed) >> 32);
+    }
+  }
+  for (size_t i = 0; i < 4; i++) {
+    state_[i] = _mm256_load_si256(reinterpret_cast<const __m256i*>(words[i]));
+  }
+}
+
+// xoshiro128+ step in each lane
+__m256i GaussianRng::NextUint32() {
+  const __m256i result = _mm256_add_epi32(state_[0], state_[3]);
+  const __m256i t = _mm256_slli_epi32(state_[1], 9);
+  state_[2] = _mm256_xor_si256(state_[2], state_[0]);
+  state_[3] = _mm256_xor_si256(state_[3], state_[1]);
+  state_[1] = _mm256_xor_si256(state_[1], state_[2]);
+  state_[0] = _mm256_xor_si256(state_[0], state_[3]);
+  state_[2] = _mm256_xor_si256(state_[2], t);
+  state_[3] = Rotl32(state_[3], 11);
+  return result;
+}
+
+void GaussianRng::NextBlock(float* out) {
+  // The upper 23 bits of each output as the mantissa of a float in [1, 2)
+  const __m256i one_bits = _mm256_set1_epi32(0x3f800000);
+  const __m256 f1 = _mm256_castsi256_ps(
+      _mm256_or_si256(_mm256_srli_epi32(NextUint32(), 9), one_bits));
+  const __m256 f2 = _mm256_castsi256_ps(
+      _mm256_or_si256(_mm256_srli_epi32(NextUint32(), 9), one_bits));
+  // u1 in (0, 1] so that its logarithm is finite, u2 in [0, 1)
+  const __m256 u1 = _mm256_sub_ps(_mm256_set1_ps(2.0f), f1);
+  const __m256 u2 = _mm256_sub_ps(f2, _mm256_set1_ps(1.0f));
+
+  const __m256 r =
+      _mm256_sqrt_ps(_mm256_mul_ps(_mm256_set1_ps(-2.0f), LogPs(u1)));
+  __m256 cos_v;
+  __m256 sin_v;
+  SinCos2PiPs(u2, cos_v, sin_v);
+  _mm256_storeu_ps(out, _mm256_mul_ps(r, cos_v));
+  _mm256_storeu_ps(out + kLanes, _mm256_mul_ps(r, sin_v));
+}
+
+void GaussianRng::Generate(float* out, size_t n) {
+  size_t i = 0;
+  for (; i + kBlockSize <= n; i += kBlockSize) {
+    NextBlock(out + i);
+  }
+  if (i < n) {
+    float tail[kBlockSize];
+    NextBlock(tail);
+    std::memcpy(out + i, tail, (n - i) * sizeof(float));
+  }
+}
+
+void PackChannelMatrix(const float* h, size_t n_in, size_t n_out,
+                       bool transpose, float scale, float* packed) {
+  for (size_t k = 0; k < n_in; k++) {
+    for (size_t j = 0; j < n_out; j++) {
+      const size_t h_idx = transpose ? (j + k * n_out) : (k + j * n_in);
+      const float re = scale * h[2 * h_idx];
+      const float im = scale * h[2 * h_idx + 1];
+      // {re, re} and {-im, im}, each broadcast to all complex samples
+      float* dst = &packed[4 * (k * n_out + j)];
+      dst[0] = re;
+      dst[1] = re;
+      dst[2] = -im;
+      dst[3] = im;
+    }
+  }
+}
+
+// Complex multiply-accumulate of four interleaved complex samples [a] (and
+// [a_swap], its real and imaginary parts swapped) by the packed coefficient
+// at [coeff]
+static inline __m256 ComplexMulAdd(__m256 acc, __m256 a, __m256 a_swap,
+                                   const float* coeff) {
+  const __m256 h_re = _mm256_castpd_ps(
+      _mm256_broadcast_sd(reinterpret_cast<const double*>(coeff)));
+  const __m256 h_im = _mm256_castpd_ps(
+      _mm256_broadcast_sd(reinterpret_cast<const double*>(coeff + 2)));
+  acc = _mm256_add_ps(acc, _mm256_mul_ps(a, h_re));
+  return _mm256_add_ps(acc, _mm256_mul_ps(a_swap, h_im));
+}
+
+// ApplyChannelMatrix() for the [kCols] output columns starting at [j0] and
+// the first [n_vec_samps] samples, two AVX2 registers at a time
+template <size_t kCols>
+static void ApplyColumns(const float* in, size_t n_samps, size_t n_vec_samps,
+                         size_t n_in, const float* packed, size_t n_out,
+                         size_t j0, float* out) {
+  for (size_t s = 0; s < n_vec_samps; s += 2 * kCplxPerVec) {
+    __m256 acc[kCols][2];
+    for (size_t c = 0; c < kCols; c++) {
+      acc[c][0] = _mm256_setzero_ps();
+      acc[c][1] = _mm256_setzero_ps();
+    }
+    for (size_t k = 0; k < n_in; k++) {
+      const float* in_col = in + 2 * (k * n_samps + s);
+      const __m256 a0 = _mm256_loadu_ps(in_col);
+      const __m256 a1 = _mm256_loadu_ps(in_col + 2 * kCplxPerVec);
+      const __m256 a0_swap = _mm256_permute_ps(a0, 0xb1);
+      const __m256 a1_swap = _mm256_permute_ps(a1, 0xb1);
+      const float* coeff = &packed[4 * (k * n_out + j0)];
+      for (size_t c = 0; c < kCols; c++) {
+        acc[c][0] = ComplexMulAdd(acc[c][0], a0, a0_swap, coeff + 4 * c);
+        acc[c][1] = ComplexMulAdd(acc[c][1], a1, a1_swap, coeff + 4 * c);
+      }
+    }
+    for (size_t c = 0; c < kCols; c++) {
+      float* out_col = out + 2 * ((j0 + c) * n_samps + s);
+      _mm256_storeu_ps(out_col, acc[c][0]);
+      _mm256_storeu_ps(out_col + 2 * kCplxPerVec, acc[c][1]);
+    }
+  }
+}
+
+void ApplyChannelMatrix(const float* in, size_t n_samps, size_t n_in,
+                        const float* packed, size_t n_out, float* out) {
+  const size_t n_vec_samps = n_samps - (n_samps % (2 * kCplxPerVec));
+  size_t j = 0;
+  for (; j + kChanColBlock <= n_out; j += kChanColBlock) {
+    ApplyColumns<kChanColBlock>(in, n_samps, n_vec_samps, n_in, packed, n_out,
+                                j, out);
+  }
+  for (; j < n_out; j++) {
+    ApplyColumns<1>(in, n_samps, n_vec_samps, n_in, packed, n_out, j, out);
+  }
+
+  // Remaining samples
+  for (size_t s = n_vec_samps; s < n_samps; s++) {
+    for (size_t jj = 0; jj < n_out; jj++) {
+      float re = 0;
+      float im = 0;
+      for (size_t k = 0; k < n_in; k++) {
+        const float a_re = in[2 * (k * n_samps + s)];
+        const float a_im = in[2 * (k * n_samps + s) + 1];
+        const float* coeff = &packed[4 * (k * n_out + jj)];
+        re += a_re * coeff[0] + a_im * coeff[2];
+        im += a_im * coeff[1] + a_re * coeff[3];
+      }
+      out[2 * (jj * n_samps + s)] = re;
+      out[2 * (jj * n_samps + s) + 1] = im;
+    }
+  }
+}
+
+// Product of the four interleaved complex samples in [a] and [b]
+static inline __m256 ComplexMul(__m256 a, __m256 b) {
+  const __m256 re_part = _mm256_mul_ps(a, _mm256_moveldup_ps(b));
+  const __m256 im_part =
+      _mm256_mul_ps(_mm256_permute_ps(a, 0xb1), _mm256_movehdup_ps(b));
+  return _mm256_addsub_ps(re_part, im_part);
+}
+
+void ApplySubcarrierMatrices(const float* in, size_t n_sc, size_t n_in,
+                             const float* hf, size_t hf_in_stride,
+                             size_t hf_out_stride, size_t n_out, float scale,
+                             float* out) {
+  const __m256 scale_v = _mm256_set1_ps(scale);
+  for (size_t b0 = 0; b0 < n_sc; b0 += kScBlock) {
+    const size_t b1 = std::min(n_sc, b0 + kScBlock);
+    const size_t b_vec = b1 - ((b1 - b0) % (2 * kCplxPerVec));
+    for (size_t j = 0; j < n_out; j++) {
+      const float* hf_out = hf + 2 * n_sc * j * hf_out_stride;
+      float* out_col = out + 2 * j * n_sc;
+      for (size_t k = b0; k < b_vec; k += 2 * kCplxPerVec) {
+        __m256 acc0 = _mm256_setzero_ps();
+        __m256 acc1 = _mm256_setzero_ps();
+        for (size_t i = 0; i < n_in; i++) {
+          const float* x = in + 2 * (i * n_sc + k);
+          const float* h = hf_out + 2 * (i * hf_in_stride * n_sc + k);
+          acc0 = _mm256_add_ps(
+              acc0, ComplexMul(_mm256_loadu_ps(x), _mm256_loadu_ps(h)));
+          acc1 = _mm256_add_ps(
+              acc1, ComplexMul(_mm256_loadu_ps(x + 2 * kCplxPerVec),
+                               _mm256_loadu_ps(h + 2 * kCplxPerVec)));
+        }
+        _mm256_storeu_ps(out_col + 2 * k, _mm256_mul_ps(acc0, scale_v));
+        _mm256_storeu_ps(out_col + 2 * (k + kCplxPerVec),
+                         _mm256_mul_ps(acc1, scale_v));
+      }
+      // Remaining subcarriers of the block
+      for (size_t k = b_vec; k < b1; k++) {
+        float re = 0;
+        float im = 0;
+        for (size_t i = 0; i < n_in; i++) {
+          const float* x = in + 2 * (i * n_sc + k);
+          const float* h = hf_out + 2 * (i * hf_in_stride * n_sc + k);
+          re += x[0] * h[0] - x[1] * h[1];
+          im += x[0] * h[1] + x[1] * h[0];
+        }
+        out_col[2 * k] = scale * re;
+        out_col[2 * k + 1] = scale * im;
+      }
+    }
+  }
+}
+
+// Sum of the [n] floats at [x] squared
+static float SumSquares(const float* x, size_t n) {
+  __m256 acc = _mm256_setzero_ps();
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const __m256 v = _mm256_loadu_ps(x + i);
+    acc = _mm256_add_ps(acc, _mm256_mul_ps(v, v));
+  }
+  alignas(32) float lanes[8];
+  _mm256_store_ps(lanes, acc);
+  float sum = 0;
+  for (float lane : lanes) {
+    sum += lane;
+  }
+  for (; i < n; i++) {
+    sum += x[i] * x[i];
+  }
+  return sum;
+}
+
+void AddAwgn(float* data, size_t n_samps, size_t n_cols, float snr_lin,
+             GaussianRng& rng, float* noise) {
+  const size_t n_floats = 2 * n_samps;
+  for (size_t j = 0; j < n_cols; j++) {
+    float* col = data + j * n_floats;
+    // Noise power per real dimension: (mean sample power / SNR) / 2
+    const float pwr = SumSquares(col, n_floats) / n_samps;
+    const float noise_std = std::sqrt(pwr / snr_lin / 2);
+    rng.Generate(noise, n_floats);
+
+    const __m256 std_v = _mm256_set1_ps(noise_std);
+    size_t i = 0;
+    for (; i + 8 <= n_floats; i += 8) {
+      const __m256 v = _mm256_loadu_ps(col + i);
+      const __m256 n = _mm256_loadu_ps(noise + i);
+      _mm256_storeu_ps(col + i, _mm256_add_ps(v, _mm256_mul_ps(n, std_v)));
+    }
+    for (; i < n_floats; i++) {
+      col[i] += noise_std * noise[i];
+    }
+  }
+}
+
+void ConvertFloatToShortSat(const float* in, short* out, size_t n) {
+  const __m256 scale = _mm256_set1_ps(32768.0f);
+  // Clamp before the int32 conversion, which overflows to INT32_MIN
+  const __m256 lo = _mm256_set1_ps(-32768.0f);
+  const __m256 hi = _mm256_set1_ps(32767.0f);
+  auto to_int32 = [&](const float* x) {
+    const __m256 scaled = _mm256_mul_ps(_mm256_loadu_ps(x), scale);
+    return _mm256_cvtps_epi32(_mm256_min_ps(_mm256_max_ps(scaled, lo), hi));
+  };
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    const __m256i int1 = to_int32(in + i);
+    const __m256i int2 = to_int32(in + i + 8);
+    const __m256i packed =
+        _mm256_permute4x64_epi64(_mm256_packs_epi32(int1, int2), 0xd8);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), packed);
+  }
+  for (; i < n; i++) {
+    const float scaled = std::nearbyint(in[i] * 32768.0f);
+    out[i] = static_cast<short>(std::clamp(scaled, -32768.0f, 32767.0f));
+  }
+}
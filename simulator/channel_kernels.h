@@ -0,0 +1,96 @@
+/**
+ * @file channel_kernels.h
+ * @brief Declaration file for the AVX2 kernels of the channel simulator:
+ * flat and per-subcarrier MIMO channel application, Gaussian noise
+ * generation, and float to int16 sample conversion
+ */
+#ifndef CHANNEL_KERNELS_H_
+#define CHANNEL_KERNELS_H_
+
+#include <immintrin.h>
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Vectorized standard normal random number generator. Runs eight
+ * xoshiro128+ generators side by side in the AVX2 lanes and turns their
+ * uniform outputs into Gaussian samples with the Box-Muller transform.
+ *
+ * Samples are limited to about 5.6 standard deviations by the 23-bit
+ * uniforms. Not thread-safe; use one generator per thread.
+ */
+class GaussianRng {
+ public:
+  static constexpr size_t kLanes = 8;
+  // Number of samples produced per Box-Muller step
+  static constexpr size_t kBlockSize = 2 * kLanes;
+
+  explicit GaussianRng(uint64_t seed);
+
+  /// Write [n] independent standard normal samples to [out]
+  void Generate(float* out, size_t n);
+
+ private:
+  /// Write kBlockSize samples to [out]
+  void NextBlock(float* out);
+  __m256i NextUint32();
+
+  __m256i state_[4];
+};
+
+/// Number of floats in the packed form of an [n_in] x [n_out] channel matrix
+static inline size_t PackedChannelSize(size_t n_in, size_t n_out) {
+  return 4 * n_in * n_out;
+}
+
+/**
+ * @brief Pack the [n_in] x [n_out] channel matrix H for
+ * ApplyChannelMatrix(), multiplying it by [scale].
+ *
+ * [h] is a column-major complex matrix. If [transpose] is false, it is H
+ * itself ([n_in] rows). Otherwise it is the non-conjugate transpose of H
+ * ([n_out] rows). [packed] must hold PackedChannelSize(n_in, n_out) floats.
+ */
+void PackChannelMatrix(const float* h, size_t n_in, size_t n_out,
+                       bool transpose, float scale, float* packed);
+
+/**
+ * @brief Compute out = in * H for complex column-major matrices, where [in]
+ * is [n_samps] x [n_in], [out] is [n_samps] x [n_out], and H was packed by
+ * PackChannelMatrix(). No alignment is required.
+ */
+void ApplyChannelMatrix(const float* in, size_t n_samps, size_t n_in,
+                        const float* packed, size_t n_out, float* out);
+
+/**
+ * @brief Apply a different channel matrix on every subcarrier: for each
+ * subcarrier k < [n_sc], out(k, j) = [scale] * sum_i in(k, i) * H_k(i, j).
+ *
+ * [in] is [n_sc] x [n_in] and [out] is [n_sc] x [n_out], both complex
+ * column-major. The response of input i to output j over all subcarriers is
+ * the [n_sc] complex values at hf + 2 * n_sc * (i * [hf_in_stride] + j *
+ * [hf_out_stride]). No alignment is required.
+ */
+void ApplySubcarrierMatrices(const float* in, size_t n_sc, size_t n_in,
+                             const float* hf, size_t hf_in_stride,
+                             size_t hf_out_stride, size_t n_out, float scale,
+                             float* out);
+
+/**
+ * @brief Add complex white Gaussian noise to each column of the
+ * [n_samps] x [n_cols] complex column-major matrix [data], with the noise
+ * power of each column set so that its SNR is [snr_lin].
+ *
+ * [noise] is scratch space of at least 2 * [n_samps] floats.
+ */
+void AddAwgn(float* data, size_t n_samps, size_t n_cols, float snr_lin,
+             GaussianRng& rng, float* noise);
+
+/**
+ * @brief Convert [n] floats to int16 samples scaled by 32768, rounding to
+ * the nearest integer and saturating. No alignment is required.
+ */
+void ConvertFloatToShortSat(const float* in, short* out, size_t n);
+
+#endif  // CHANNEL_KERNELS_H_
@@ -4,6 +4,7 @@
  */
 #include "channel_sim.h"
 
+#include <random>
 #include <utility>
 
 #include "datatype_conversion.h"
@@ -19,28 +20,6 @@ static constexpr size_t kUdpMTU = 2048;
 
 //#define CHSIM_DEBUG_MEMORY
 
-static void ConvertFloatToShort(const float* in_buf, short* out_buf,
-                                size_t length) {
-  /*
-  for (size_t i = 0; i < length; i += 16) {
-      __m256 data1 = _mm256_load_ps(in_buf + i);
-      __m256 data2 = _mm256_load_ps(in_buf + i + 8);
-      __m256i integer1 = _mm256_cvtps_epi32(data1);
-      __m256i integer2 = _mm256_cvtps_epi32(data2);
-      integer1 = _mm256_packs_epi32(integer1, integer2);
-      integer1 = _mm256_permute4x64_epi64(integer1, 0xD8);
-      _mm256_stream_si256(
-          (__m256i*)&out_buf[i], integer1);
-  }
-  for (size_t i = length / 16; i < length; i++) {
-      out_buf[i] = (short)(in_buf[i] * 32768.f);
-  }
-  */
-  for (size_t i = 0; i < length; i++) {
-    out_buf[i] = static_cast<short>(in_buf[i] * 32768.0f);
-  }
-}
-
 /* Helper classes */
 struct SocketRxBuffer {
   size_t data_size_ = 0;
@@ -50,7 +29,9 @@ struct SocketRxBuffer {
 ChannelSim::ChannelSim(const Config* const config, size_t bs_thread_num,
                        size_t user_thread_num, size_t worker_thread_num,
                        size_t in_core_offset, std::string in_chan_type,
-                       double in_chan_snr)
+                       double in_chan_snr, bool in_simd_chan,
+                       double in_chan_delay_spread_ns,
+                       double in_chan_doppler_hz)
     : cfg_(config),
       bs_thread_num_(bs_thread_num),
       user_thread_num_(user_thread_num),
@@ -59,7 +40,8 @@ ChannelSim::ChannelSim(const Config* const config, size_t bs_thread_num,
       worker_thread_num_(worker_thread_num),
       core_offset_(in_core_offset),
       channel_type_(std::move(in_chan_type)),
-      channel_snr_(in_chan_snr) {
+      channel_snr_(in_chan_snr),
+      simd_chan_(in_simd_chan) {
   // initialize parameters from config
   srand(time(nullptr));
   dl_data_plus_beacon_symbols_ =
@@ -107,7 +89,14 @@ ChannelSim::ChannelSim(const Config* const config, size_t bs_thread_num,
   user_tx_counter_.fill(0);
 
   // Initialize channel
-  channel_ = std::make_unique<Channel>(cfg_, channel_type_, channel_snr_);
+  channel_ = std::make_unique<Channel>(cfg_, channel_type_, channel_snr_,
+                                       in_chan_delay_spread_ns,
+                                       in_chan_doppler_hz);
+  if (channel_->IsFrequencySelective() && !simd_chan_) {
+    MLPD_WARN("ChannelSim: %s needs the AVX2 channel path, enabling it\n",
+              channel_type_.c_str());
+    simd_chan_ = true;
+  }
 
   for (size_t i = 0; i < worker_thread_num; i++) {
     task_ptok_[i] = new moodycamel::ProducerToken(message_queue_);
@@ -352,6 +341,12 @@ void* ChannelSim::TaskThread(size_t tid) {
 
   thread_store.udp_tx_buffer_ = &udp_tx_buffer;
 
+  ChannelWorkspace channel_workspace(
+      cfg_->BsAntNum(), cfg_->UeAntNum(), cfg_->SampsPerSymbol(),
+      channel_->IsFrequencySelective() ? cfg_->OfdmCaNum() : 0,
+      std::random_device{}() + tid);
+  thread_store.channel_workspace_ = &channel_workspace;
+
   EventData event;
   while (running) {
     if (task_queue_bs_.try_dequeue(bs_consumer_token, event)) {
@@ -381,8 +376,8 @@ void* ChannelSim::BsRxLoop(size_t tid) {
   for (size_t socket_id = socket_lo; socket_id < socket_hi; ++socket_id) {
     const size_t local_port_id = cfg_->BsRruPort() + socket_id;
     server_bs_.at(socket_id) =
-        std::make_unique<UDPServer>(local_port_id, kSockBufSize);
-    client_bs_.at(socket_id) = std::make_unique<UDPClient>();
+        std::make_unique<PacketServer>(local_port_id, kSockBufSize);
+    client_bs_.at(socket_id) = std::make_unique<PacketClient>();
     std::printf(
         "ChannelSim::BsRxLoop[%zu]: set up UDP socket server listening to port "
         "%zu with remote address %s:%zu\n",
@@ -498,8 +493,8 @@ void* ChannelSim::UeRxLoop(size_t tid) {
   for (size_t socket_id = socket_lo; socket_id < socket_hi; ++socket_id) {
     size_t local_port_id = cfg_->UeRruPort() + socket_id;
     server_ue_.at(socket_id) =
-        std::make_unique<UDPServer>(local_port_id, kSockBufSize);
-    client_ue_.at(socket_id) = std::make_unique<UDPClient>();
+        std::make_unique<PacketServer>(local_port_id, kSockBufSize);
+    client_ue_.at(socket_id) = std::make_unique<PacketClient>();
 
     std::printf(
         "ChannelSim::UeRxLoop[%zu]: set up UDP socket server listening to port "
@@ -615,7 +610,7 @@ void* ChannelSim::UeRxLoop(size_t tid) {
 void ChannelSim::DoTx(size_t frame_id, size_t symbol_id, size_t max_ant,
                       uint8_t* tx_buffer, const arma::cx_float* source_data,
                       AlignedByteVector* udp_pkt_buf,
-                      std::vector<std::unique_ptr<UDPClient>>& udp_clients,
+                      std::vector<std::unique_ptr<PacketClient>>& udp_clients,
                       const std::string& dest_address, size_t dest_port) {
   // The 2 is from complex float -> float
   const size_t convert_length = (2 * cfg_->SampsPerSymbol() * max_ant);
@@ -628,10 +623,8 @@ void ChannelSim::DoTx(size_t frame_id, size_t symbol_id, size_t max_ant,
            "Data Alignment not correct before calling into AVX optimizations");
 #endif
 
-  ConvertFloatToShort(reinterpret_cast<const float*>(source_data), dst_ptr,
-                      convert_length);
-  // SimdConvertFloatToShort(reinterpret_cast<const float*>(source_data),
-  // dst_ptr, convert_length, 0, 1);
+  ConvertFloatToShortSat(reinterpret_cast<const float*>(source_data), dst_ptr,
+                         convert_length);
 
   auto* pkt = reinterpret_cast<Packet*>(&udp_pkt_buf->at(0));
   for (size_t ant_id = 0u; ant_id < max_ant; ant_id++) {
@@ -718,7 +711,12 @@ void ChannelSim::DoTxBs(WorkerThreadStorage& local, size_t tag) {
     is_new_frame = false;
   }
   // Apply Channel
-  channel_->ApplyChan(fmat_src, fmat_noisy, is_downlink, is_new_frame);
+  if (simd_chan_) {
+    channel_->ApplyChanSimd(fmat_src, fmat_noisy, is_downlink, is_new_frame,
+                            *local.channel_workspace_);
+  } else {
+    channel_->ApplyChan(fmat_src, fmat_noisy, is_downlink, is_new_frame);
+  }
 
   MLPD_TRACE("Noisy dimensions %lld x %lld : %lld\n", fmat_noisy.n_rows,
              fmat_noisy.n_cols, fmat_noisy.n_elem);
@@ -801,7 +799,12 @@ void ChannelSim::DoTxUser(WorkerThreadStorage& local, size_t tag) {
   } else {
     is_new_frame = false;
   }
-  channel_->ApplyChan(fmat_src, fmat_noisy, is_downlink, is_new_frame);
+  if (simd_chan_) {
+    channel_->ApplyChanSimd(fmat_src, fmat_noisy, is_downlink, is_new_frame,
+                            *local.channel_workspace_);
+  } else {
+    channel_->ApplyChan(fmat_src, fmat_noisy, is_downlink, is_new_frame);
+  }
 
   MLPD_TRACE("Noisy dimensions %lld x %lld : %lld\n", fmat_noisy.n_rows,
              fmat_noisy.n_cols, fmat_noisy.n_elem);
@@ -18,11 +18,10 @@
 #include "concurrent_queue_wrapper.h"
 #include "config.h"
 #include "gettime.h"
+#include "packet_transport.h"
 #include "memory_manage.h"
 #include "signal_handler.h"
 #include "symbols.h"
-#include "udp_client.h"
-#include "udp_server.h"
 
 using AlignedByteVector =
     std::vector<unsigned char,
@@ -41,6 +40,8 @@ struct WorkerThreadStorage {
   arma::cx_fmat* bs_output_matrix_;
 
   AlignedByteVector* udp_tx_buffer_;
+
+  ChannelWorkspace* channel_workspace_;
 };
 
 /**
@@ -56,7 +57,9 @@ class ChannelSim {
              size_t user_thread_num, size_t worker_thread_num,
              size_t in_core_offset = 30,
              std::string in_chan_type = std::string("RAYLEIGH"),
-             double in_chan_snr = 20);
+             double in_chan_snr = 20, bool in_simd_chan = true,
+             double in_chan_delay_spread_ns = 100,
+             double in_chan_doppler_hz = 10);
   ~ChannelSim();
 
   void Start();
@@ -82,18 +85,18 @@ class ChannelSim {
   void DoTx(size_t frame_id, size_t symbol_id, size_t max_ant,
             uint8_t* tx_buffer, const arma::cx_float* source_data,
             AlignedByteVector* udp_pkt_buf,
-            std::vector<std::unique_ptr<UDPClient>>& udp_clients,
+            std::vector<std::unique_ptr<PacketClient>>& udp_clients,
             const std::string& dest_address, size_t dest_port);
 
   // BS-facing sending clients
-  std::vector<std::unique_ptr<UDPClient>> client_bs_;
+  std::vector<std::unique_ptr<PacketClient>> client_bs_;
   // BS-facing sockets
-  std::vector<std::unique_ptr<UDPServer>> server_bs_;
+  std::vector<std::unique_ptr<PacketServer>> server_bs_;
 
   // UE-facing sending clients
-  std::vector<std::unique_ptr<UDPClient>> client_ue_;
+  std::vector<std::unique_ptr<PacketClient>> client_ue_;
   // UE-facing sockets
-  std::vector<std::unique_ptr<UDPServer>> server_ue_;
+  std::vector<std::unique_ptr<PacketServer>> server_ue_;
 
   const Config* const cfg_;
   std::unique_ptr<Channel> channel_;
@@ -129,6 +132,8 @@ class ChannelSim {
 
   std::string channel_type_;
   double channel_snr_;
+  // Apply the channel with the AVX2 kernels instead of Armadillo
+  bool simd_chan_;
 
   size_t* bs_rx_counter_;
   size_t* user_rx_counter_;
@@ -18,8 +18,15 @@ DEFINE_uint64(
 DEFINE_uint64(core_offset, 0, "Core ID of the first channel_sim thread");
 DEFINE_string(conf_file, TOSTRING(PROJECT_DIRECTORY) "/data/tddconfig-sim.json",
               "Config filename");
-DEFINE_string(chan_model, "RAYLEIGH", "Simulator Channel Type: RAYLEIGH/AWGN");
+DEFINE_string(chan_model, "RAYLEIGH",
+              "Simulator Channel Type: RAYLEIGH/AWGN/TDL-A/TDL-B/TDL-C");
 DEFINE_double(chan_snr, 20.0, "Signal-to-Noise Ratio");
+DEFINE_bool(chan_simd, true,
+            "Apply the channel with the AVX2 kernels instead of Armadillo");
+DEFINE_double(chan_delay_spread_ns, 100.0,
+              "RMS delay spread of the TDL channel models in nanoseconds");
+DEFINE_double(chan_doppler_hz, 10.0,
+              "Maximum Doppler shift of the TDL channel models in Hz");
 
 int main(int argc, char* argv[]) {
   int ret = EXIT_FAILURE;
@@ -36,7 +43,8 @@ int main(int argc, char* argv[]) {
       auto sim = std::make_unique<ChannelSim>(
           config.get(), FLAGS_bs_threads, FLAGS_ue_threads,
           FLAGS_worker_threads, FLAGS_core_offset, FLAGS_chan_model,
-          FLAGS_chan_snr);
+          FLAGS_chan_snr, FLAGS_chan_simd, FLAGS_chan_delay_spread_ns,
+          FLAGS_chan_doppler_hz);
       sim->Start();
       ret = EXIT_SUCCESS;
     } catch (SignalException& e) {
@@ -4,18 +4,25 @@
  */
 #include "sender.h"
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
 #include <algorithm>
 #include <thread>
 
 #include "datatype_conversion.h"
 #include "logger.h"
-#include "udp_client.h"
+#include "packet_transport.h"
 
 #if defined(USE_DPDK)
 #include <arpa/inet.h>
 #endif
 
 static constexpr bool kDebugPrintSender = false;
+// In closed loop mode, the time to wait for the completion report of a
+// frame before the frame is counted as missed and the next one released
+static constexpr double kFrameDoneTimeoutUs = 1e6;
 
 static std::atomic<bool> keep_running = true;
 // A spinning barrier to synchronize the start of worker threads
@@ -35,7 +42,8 @@ void DelayTicks(uint64_t start, uint64_t ticks) {
 Sender::Sender(Config* cfg, size_t socket_thread_num, size_t core_offset,
                size_t frame_duration, size_t inter_frame_delay,
                size_t enable_slow_start, const std::string& server_mac_addr_str,
-               bool create_thread_for_master)
+               bool create_thread_for_master, size_t replay_frames,
+               size_t symbol_jitter)
     : cfg_(cfg),
       freq_ghz_(GetTime::MeasureRdtscFreq()),
       ticks_per_usec_(freq_ghz_ * 1e3),
@@ -43,7 +51,10 @@ Sender::Sender(Config* cfg, size_t socket_thread_num, size_t core_offset,
       enable_slow_start_(enable_slow_start),
       core_offset_(core_offset),
       inter_frame_delay_(inter_frame_delay),
-      ticks_inter_frame_(inter_frame_delay_ * ticks_per_usec_) {
+      ticks_inter_frame_((cfg->ClosedLoopPort() != 0)
+                             ? 0
+                             : inter_frame_delay_ * ticks_per_usec_),
+      ticks_jitter_(symbol_jitter * ticks_per_usec_) {
   if (frame_duration == 0) {
     frame_duration_ =
         (cfg->Frame().NumTotalSyms() * cfg->SampsPerSymbol() * 1000000ul) /
@@ -65,6 +76,15 @@ Sender::Sender(Config* cfg, size_t socket_thread_num, size_t core_offset,
       cfg->BsServerAddr().c_str(), frame_duration_ / 1000.0,
       enable_slow_start == 1 ? "yes" : "no");
 
+  if (cfg->ClosedLoopPort() != 0) {
+    // Frames are released by Agora's completion reports, not by the clock
+    frame_done_server_ = std::make_unique<UDPServer>(cfg->ClosedLoopPort());
+    MLPD_INFO(
+        "Sender: closed loop mode, up to %zu frames in flight, completion "
+        "reports on port %d\n",
+        cfg->ClosedLoopWindow(), cfg->ClosedLoopPort());
+  }
+
   unused(server_mac_addr_str);
   for (auto& i : packet_count_per_symbol_) {
     i = new size_t[cfg->Frame().NumTotalSyms()]();
@@ -72,7 +92,8 @@ Sender::Sender(Config* cfg, size_t socket_thread_num, size_t core_offset,
 
   InitIqFromFile(std::string(TOSTRING(PROJECT_DIRECTORY)) +
                  "/data/LDPC_rx_data_" + std::to_string(cfg->OfdmCaNum()) +
-                 "_ant" + std::to_string(cfg->BsAntNum()) + ".bin");
+                 "_ant" + std::to_string(cfg->BsAntNum()) + ".bin",
+                 replay_frames);
 
   task_ptok_ =
       static_cast<moodycamel::ProducerToken**>(Agora_memory::PaddedAlignedAlloc(
@@ -214,6 +235,7 @@ void* Sender::MasterThread(int /*unused*/) {
   double frame_start_us = GetTime::GetTimeUs();
   double frame_end_us = 0;
   this->frame_start_[0] = frame_start_us;
+  const double tx_start_us = frame_start_us;
 
   size_t start_symbol = FindNextSymbol(0);
   // Delay until the start of the first symbol
@@ -224,6 +246,7 @@ void* Sender::MasterThread(int /*unused*/) {
   }
   RtAssert(start_symbol != cfg_->Frame().NumTotalSyms(),
            "Sender: No valid symbols to transmit");
+  DelayForJitter();
   ScheduleSymbol(0, start_symbol);
 
   while (keep_running.load() == true) {
@@ -280,12 +303,20 @@ void* Sender::MasterThread(int /*unused*/) {
           this->frame_end_[(ctag.frame_id_ % kNumStatsFrames)] = frame_end_us;
 
           if (next_frame_id == cfg_->FramesToTest()) {
+            if (frame_done_server_ != nullptr) {
+              WaitForFrameRelease(next_frame_id + cfg_->ClosedLoopWindow() -
+                                  1);
+            }
             keep_running.store(false);
             break; /* Finished */
           } else {
             // Wait for the inter-frame delay
             DelayTicks(tick_start, ticks_inter_frame_);
             tick_start += ticks_inter_frame_;
+            if (frame_done_server_ != nullptr) {
+              WaitForFrameRelease(next_frame_id);
+              tick_start = GetTime::Rdtsc();
+            }
             frame_start_us = GetTime::GetTimeUs();
 
             // Set the frame start time to the start time of the frame
@@ -299,10 +330,23 @@ void* Sender::MasterThread(int /*unused*/) {
             tick_start += (GetTicksForFrame(ctag.frame_id_) * next_symbol_id);
           }
         }  // if (next_symbol_id == cfg_->Frame().NumTotalSyms()) {
+        // The jitter delays this symbol only; tick_start stays on the grid
+        DelayForJitter();
         ScheduleSymbol(next_frame_id, next_symbol_id);
       }
     }  // end (ret > 0)
   }
+  if ((frame_done_server_ != nullptr) && (frame_reports_ > 0)) {
+    const double elapsed_us = last_frame_done_us_ - tx_start_us;
+    std::printf(
+        "Sender: closed loop with %zu frames in flight: %zu frames in %.3f "
+        "s, %.1f frames/s, frame latency mean %.1f us, max %.1f us, %zu "
+        "reports missed, %zu late\n",
+        cfg_->ClosedLoopWindow(), frame_reports_, elapsed_us / 1e6,
+        frame_reports_ * 1e6 / elapsed_us,
+        frame_latency_sum_us_ / frame_reports_, frame_latency_max_us_,
+        frame_reports_missed_, frame_reports_late_);
+  }
   std::printf("Sender main thread exit\n");
   WriteStatsToFile(cfg_->FramesToTest());
   return nullptr;
@@ -319,11 +363,6 @@ void* Sender::WorkerThread(int tid) {
   }
   MLPD_FRAME("Sender: worker thread %d running\n", tid);
 
-  DFTI_DESCRIPTOR_HANDLE mkl_handle;
-  DftiCreateDescriptor(&mkl_handle, DFTI_SINGLE, DFTI_COMPLEX, 1,
-                       cfg_->OfdmCaNum());
-  DftiCommitDescriptor(mkl_handle);
-
   const size_t max_symbol_id =
       cfg_->Frame().NumPilotSyms() +
       cfg_->Frame().NumULSyms();  // TEMP not sure if this is ok
@@ -340,13 +379,9 @@ void* Sender::WorkerThread(int tid) {
               queue_id);
   rte_mbuf* tx_mbufs[kDequeueBulkSize];
 #else
-  UDPClient udp_client;
+  PacketClient udp_client;
 #endif
 
-  auto* fft_inout =
-      static_cast<complex_float*>(Agora_memory::PaddedAlignedAlloc(
-          Agora_memory::Alignment_t::kAlign64,
-          cfg_->OfdmCaNum() * sizeof(complex_float)));
   auto* socks_pkt_buf = static_cast<Packet*>(PaddedAlignedAlloc(
       Agora_memory::Alignment_t::kAlign32, cfg_->PacketLength()));
 
@@ -399,13 +434,14 @@ void* Sender::WorkerThread(int tid) {
         pkt->symbol_id_ = tag.symbol_id_;
         pkt->cell_id_ = tag.ant_id_ / ant_num_per_cell;
         pkt->ant_id_ = tag.ant_id_ - ant_num_per_cell * (pkt->cell_id_);
+        const size_t replay_frame = tag.frame_id_ % replay_frames_;
         std::memcpy(
             pkt->data_,
-            iq_data_short_[(pkt->symbol_id_ * cfg_->BsAntNum()) + tag.ant_id_],
+            iq_data_short_[((replay_frame * cfg_->Frame().NumTotalSyms() +
+                             pkt->symbol_id_) *
+                            cfg_->BsAntNum()) +
+                           tag.ant_id_],
             (cfg_->CpLen() + cfg_->OfdmCaNum()) * (kUse12BitIQ ? 3 : 4));
-        if (cfg_->FftInRru() == true) {
-          RunFft(pkt, fft_inout, mkl_handle);
-        }
 
 #ifndef USE_DPDK
         udp_client.Send(cfg_->BsServerAddr(), cfg_->BsServerPort() + cur_radio,
@@ -461,17 +497,17 @@ void* Sender::WorkerThread(int tid) {
     }  // if (num_tags > 0)
   }    // while (keep_running.load() == true)
 
-  DftiFreeDescriptor(&mkl_handle);
-
   std::free(static_cast<void*>(socks_pkt_buf));
-  std::free(static_cast<void*>(fft_inout));
   MLPD_FRAME("Sender: worker thread %d exit\n", tid);
   std::printf("Sender: worker thread %d exit\n", tid);
   return nullptr;
 }
 
 uint64_t Sender::GetTicksForFrame(size_t frame_id) const {
-  if (enable_slow_start_ == 0) {
+  if (frame_done_server_ != nullptr) {
+    // Symbols go out back to back in closed loop mode
+    return 0;
+  } else if (enable_slow_start_ == 0) {
     return ticks_all_;
   } else if (frame_id < kFrameWnd) {
     return ticks_wnd1_;
@@ -482,47 +518,80 @@ uint64_t Sender::GetTicksForFrame(size_t frame_id) const {
   }
 }
 
-void Sender::InitIqFromFile(const std::string& filename) {
+void Sender::InitIqFromFile(const std::string& filename,
+                            size_t max_frames) {
   const size_t packets_per_frame =
       cfg_->Frame().NumTotalSyms() * cfg_->BsAntNum();
-  iq_data_short_.Calloc(packets_per_frame,
-                        (cfg_->CpLen() + cfg_->OfdmCaNum()) * 2,
+  const size_t samples_per_packet = (cfg_->CpLen() + cfg_->OfdmCaNum()) * 2;
+  const size_t frame_bytes = packets_per_frame * samples_per_packet *
+                             sizeof(float);
+
+  const int fd = open(filename.c_str(), O_RDONLY);
+  if (fd == -1) {
+    std::fprintf(stderr, "Sender: Failed to open IQ data file %s. Errno %s\n",
+                 filename.c_str(), strerror(errno));
+    throw std::runtime_error("Sender: Failed to open IQ data file");
+  }
+  struct stat file_stat;
+  RtAssert(fstat(fd, &file_stat) == 0, "Failed to stat IQ data file");
+  const auto file_bytes = static_cast<size_t>(file_stat.st_size);
+  if ((file_bytes < frame_bytes) || (file_bytes % frame_bytes != 0)) {
+    std::fprintf(stderr,
+                 "Sender: IQ data file %s has %zu bytes, not a multiple of "
+                 "the %zu bytes of one frame\n",
+                 filename.c_str(), file_bytes, frame_bytes);
+    close(fd);
+    throw std::runtime_error("Sender: Failed to read IQ data file");
+  }
+  const size_t file_frames = file_bytes / frame_bytes;
+  replay_frames_ =
+      (max_frames == 0) ? file_frames : std::min(max_frames, file_frames);
+  const size_t map_bytes = replay_frames_ * frame_bytes;
+  void* map = mmap(nullptr, map_bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  RtAssert(map != MAP_FAILED, "Failed to map IQ data file");
+  madvise(map, map_bytes, MADV_SEQUENTIAL);
+  const auto* iq_data_float = static_cast<const float*>(map);
+
+  iq_data_short_.Calloc(replay_frames_ * packets_per_frame, samples_per_packet,
                         Agora_memory::Alignment_t::kAlign64);
-
-  Table<float> iq_data_float;
-  iq_data_float.Calloc(packets_per_frame,
-                       (cfg_->CpLen() + cfg_->OfdmCaNum()) * 2,
-                       Agora_memory::Alignment_t::kAlign64);
-
-  FILE* fp = std::fopen(filename.c_str(), "rb");
-  RtAssert(fp != nullptr, "Failed to open IQ data file");
-
-  for (size_t i = 0; i < packets_per_frame; i++) {
-    const size_t expected_count = (cfg_->CpLen() + cfg_->OfdmCaNum()) * 2;
-    const size_t actual_count =
-        std::fread(iq_data_float[i], sizeof(float), expected_count, fp);
-    if (expected_count != actual_count) {
-      std::fprintf(
-          stderr,
-          "Sender: Failed to read IQ data file %s. Packet %zu: expected "
-          "%zu I/Q samples but read %zu. Errno %s\n",
-          filename.c_str(), i, expected_count, actual_count, strerror(errno));
-      throw std::runtime_error("Sender: Failed to read IQ data file");
-    }
+  for (size_t i = 0; i < replay_frames_ * packets_per_frame; i++) {
+    const float* samples = iq_data_float + i * samples_per_packet;
     if (kUse12BitIQ) {
       // Adapt 32-bit IQ samples to 24-bit to reduce network throughput
-      ConvertFloatTo12bitIq(iq_data_float[i],
+      ConvertFloatTo12bitIq(samples,
                             reinterpret_cast<uint8_t*>(iq_data_short_[i]),
-                            expected_count);
+                            samples_per_packet);
     } else {
-      for (size_t j = 0; j < expected_count; j++) {
-        iq_data_short_[i][j] =
-            static_cast<unsigned short>(iq_data_float[i][j] * 32768);
+      for (size_t j = 0; j < samples_per_packet; j++) {
+        iq_data_short_[i][j] = static_cast<unsigned short>(samples[j] * 32768);
+      }
+    }
+  }
+  munmap(map, map_bytes);
+
+  if (cfg_->FftInRru() == true) {
+    // The payloads never change, so transform them once here instead of per
+    // packet in the workers
+    auto fft_plan = FftPlan::Create(FftDirection::kForward, cfg_->OfdmCaNum(),
+                                    true, cfg_->FftBackend());
+    auto* fft_inout =
+        static_cast<complex_float*>(Agora_memory::PaddedAlignedAlloc(
+            Agora_memory::Alignment_t::kAlign64,
+            cfg_->OfdmCaNum() * sizeof(complex_float)));
+    for (size_t i = 0; i < replay_frames_ * packets_per_frame; i++) {
+      const size_t symbol_id = (i / cfg_->BsAntNum()) %
+                               cfg_->Frame().NumTotalSyms();
+      const SymbolType symbol_type = cfg_->GetSymbolType(symbol_id);
+      if ((symbol_type == SymbolType::kPilot) ||
+          (symbol_type == SymbolType::kUL)) {
+        RunFft(iq_data_short_[i], fft_inout, fft_plan.get());
       }
     }
+    std::free(static_cast<void*>(fft_inout));
   }
-  std::fclose(fp);
-  iq_data_float.Free();
+  MLPD_INFO("Sender: Replaying %zu of %zu frames of IQ data from %s\n",
+            replay_frames_, file_frames, filename.c_str());
 }
 
 void Sender::CreateWorkerThreads(size_t num_workers) {
@@ -542,17 +611,66 @@ void Sender::WriteStatsToFile(size_t tx_frame_count) const {
   }
 }
 
-void Sender::RunFft(Packet* pkt, complex_float* fft_inout,
-                    DFTI_DESCRIPTOR_HANDLE mkl_handle) const {
-  // pkt->data has (cp_len + ofdm_ca_num) unsigned short samples. After FFT,
+size_t Sender::PollFrameDone() {
+  size_t num_reports = 0;
+  uint32_t done_frame_id;
+  while (frame_done_server_->Recv(reinterpret_cast<uint8_t*>(&done_frame_id),
+                                  sizeof(done_frame_id)) ==
+         sizeof(done_frame_id)) {
+    num_reports++;
+    if (done_frame_id < frames_done_) {
+      // The frame was already released by a timeout
+      frame_reports_late_++;
+      continue;
+    }
+    frame_reports_++;
+    last_frame_done_us_ = GetTime::GetTimeUs();
+    const double latency_us =
+        last_frame_done_us_ - frame_start_[done_frame_id % kNumStatsFrames];
+    frame_latency_sum_us_ += latency_us;
+    frame_latency_max_us_ = std::max(frame_latency_max_us_, latency_us);
+    frames_done_ = done_frame_id + 1ul;
+  }
+  return num_reports;
+}
+
+void Sender::WaitForFrameRelease(size_t frame_id) {
+  // Frame frame_id - window must be complete
+  double wait_start_us = GetTime::GetTimeUs();
+  while ((frames_done_ + cfg_->ClosedLoopWindow() <= frame_id) &&
+         (keep_running.load() == true)) {
+    if (PollFrameDone() > 0) {
+      wait_start_us = GetTime::GetTimeUs();
+    } else if (GetTime::GetTimeUs() - wait_start_us > kFrameDoneTimeoutUs) {
+      // The report was lost or Agora dropped the frame
+      MLPD_WARN(
+          "Sender: no completion report for frame %zu within %.0f ms, "
+          "releasing the next frame\n",
+          frames_done_, kFrameDoneTimeoutUs / 1e3);
+      frames_done_++;
+      frame_reports_missed_++;
+      wait_start_us = GetTime::GetTimeUs();
+    }
+  }
+}
+
+void Sender::DelayForJitter() {
+  if (ticks_jitter_ > 0) {
+    DelayTicks(GetTime::Rdtsc(), jitter_rand_.NextU32() % (ticks_jitter_ + 1));
+  }
+}
+
+void Sender::RunFft(unsigned short* payload, complex_float* fft_inout,
+                    FftPlan* fft_plan) const {
+  // payload has (cp_len + ofdm_ca_num) unsigned short samples. After FFT,
   // we'll remove the cyclic prefix and have ofdm_ca_num() short samples left.
-  SimdConvertShortToFloat(&pkt->data_[2 * cfg_->CpLen()],
+  SimdConvertShortToFloat(reinterpret_cast<short*>(&payload[2 * cfg_->CpLen()]),
                           reinterpret_cast<float*>(fft_inout),
                           cfg_->OfdmCaNum() * 2);
 
-  DftiComputeForward(mkl_handle, reinterpret_cast<float*>(fft_inout));
+  fft_plan->Execute(fft_inout);
 
-  SimdConvertFloat32ToFloat16(reinterpret_cast<float*>(pkt->data_),
+  SimdConvertFloat32ToFloat16(reinterpret_cast<float*>(payload),
                               reinterpret_cast<float*>(fft_inout),
                               cfg_->OfdmCaNum() * 2);
 }
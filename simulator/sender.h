@@ -15,6 +15,7 @@
 #include <boost/align/aligned_allocator.hpp>
 #include <chrono>
 #include <iostream>
+#include <memory>
 #include <numeric>
 #include <thread>
 #include <vector>
@@ -22,10 +23,11 @@
 #include "concurrentqueue.h"
 #include "config.h"
 #include "datatype_conversion.h"
+#include "fft_backend.h"
 #include "gettime.h"
 #include "memory_manage.h"
-#include "mkl_dfti.h"
 #include "symbols.h"
+#include "udp_server.h"
 #include "utils.h"
 
 #if defined(USE_DPDK)
@@ -53,12 +55,19 @@ class Sender {
    * duration larger than the TTI
    *
    * @param server_mac_addr_str The MAC address of the server's NIC
+   *
+   * @param replay_frames Number of frames of the IQ data file to replay in
+   * turn. If 0, replay every frame in the file.
+   *
+   * @param symbol_jitter Largest random delay in microseconds added to the
+   * start of each symbol, without shifting the start of later symbols
    */
   Sender(Config* cfg, size_t socket_thread_num, size_t core_offset = 30,
          size_t frame_duration = 1000, size_t inter_frame_delay = 0,
          size_t enable_slow_start = 1,
          const std::string& server_mac_addr_str = "ff:ff:ff:ff:ff:ff",
-         bool create_thread_for_master = false);
+         bool create_thread_for_master = false, size_t replay_frames = 0,
+         size_t symbol_jitter = 0);
 
   ~Sender();
 
@@ -73,13 +82,17 @@ class Sender {
   void* WorkerThread(int tid);
 
   /**
-   * @brief Read time-domain 32-bit floating-point IQ samples from [filename]
-   * and populate iq_data_short_ by converting to 16-bit fixed-point samples
+   * @brief Map time-domain 32-bit floating-point IQ samples from [filename]
+   * and populate iq_data_short_ with the packet payloads of up to
+   * [max_frames] frames (all frames if 0). The samples are converted to
+   * 16-bit fixed-point, and transformed to the frequency domain in
+   * FFT-in-RRU mode, so that workers only copy payloads.
    *
-   * [filename] must contain data for one frame. For every symbol and antenna,
-   * the file must provide (CP_LEN + OFDM_CA_NUM) IQ samples.
+   * [filename] must contain data for one or more frames. For every frame,
+   * symbol and antenna, the file must provide (CP_LEN + OFDM_CA_NUM) IQ
+   * samples.
    */
-  void InitIqFromFile(const std::string& filename);
+  void InitIqFromFile(const std::string& filename, size_t max_frames);
 
   // Get number of CPU ticks for a symbol given a frame index
   uint64_t GetTicksForFrame(size_t frame_id) const;
@@ -89,17 +102,27 @@ class Sender {
   void CreateWorkerThreads(size_t num_workers);
 
   void DelayForSymbol(size_t tx_frame_count, uint64_t tick_start);
+  // Wait a random number of ticks up to ticks_jitter_
+  void DelayForJitter();
   void DelayForFrame(size_t tx_frame_count, uint64_t tick_start);
 
+  // Closed loop mode: receive all pending frame completion reports of Agora,
+  // and return the number received
+  size_t PollFrameDone();
+  // Closed loop mode: wait until Agora has completed enough frames to
+  // release [frame_id]. A frame whose report does not arrive in time is
+  // counted as missed and the next frame is released.
+  void WaitForFrameRelease(size_t frame_id);
+
   void WriteStatsToFile(size_t tx_frame_count) const;
 
   size_t FindNextSymbol(size_t start_symbol);
   void ScheduleSymbol(size_t frame, size_t symbol_id);
 
-  // Run FFT on the data field in pkt, output to fft_inout
-  // Recombine pkt header data and fft output data into payload
-  void RunFft(Packet* pkt, complex_float* fft_inout,
-              DFTI_DESCRIPTOR_HANDLE mkl_handle) const;
+  // Run FFT on the time-domain samples of one packet payload, output to
+  // fft_inout, and write the float16 result back to the start of the payload
+  void RunFft(unsigned short* payload, complex_float* fft_inout,
+              FftPlan* fft_plan) const;
 
   Config* cfg_;
   const double freq_ghz_;           // RDTSC frequency in GHz
@@ -126,15 +149,22 @@ class Sender {
   // frame
   const uint64_t ticks_inter_frame_;
 
+  // Largest random delay in RDTSC clock ticks added to the start of a symbol
+  const uint64_t ticks_jitter_;
+  FastRand jitter_rand_;
+
   moodycamel::ConcurrentQueue<size_t> send_queue_ =
       moodycamel::ConcurrentQueue<size_t>(1024);
   moodycamel::ConcurrentQueue<size_t> completion_queue_ =
       moodycamel::ConcurrentQueue<size_t>(1024);
   moodycamel::ProducerToken** task_ptok_;
 
-  // First dimension: symbol_num_perframe * BS_ANT_NUM
+  // Packet payloads, ready to send
+  // First dimension: replay_frames_ * symbol_num_perframe * BS_ANT_NUM
   // Second dimension: (CP_LEN + OFDM_CA_NUM) * 2
   Table<unsigned short> iq_data_short_;
+  // Frame frame_id is sent with the payloads of frame frame_id % this
+  size_t replay_frames_;
 
   // Number of packets transmitted for each symbol in a frame
   size_t* packet_count_per_symbol_[kFrameWnd];
@@ -144,6 +174,18 @@ class Sender {
 
   std::vector<std::thread> threads_;
 
+  // Receives the IDs of frames completed by Agora in closed loop mode, or
+  // nullptr if frames are paced by the frame duration
+  std::unique_ptr<UDPServer> frame_done_server_;
+  size_t frames_done_ = 0;  // Number of frames Agora has completed
+  double last_frame_done_us_ = 0;
+  size_t frame_reports_ = 0;         // Reports received in time
+  size_t frame_reports_missed_ = 0;  // Frames released after a timeout
+  size_t frame_reports_late_ = 0;    // Reports received after the timeout
+  // Latency from the release of a frame to its completion report
+  double frame_latency_sum_us_ = 0;
+  double frame_latency_max_us_ = 0;
+
 #if defined(USE_DPDK)
   std::vector<uint16_t> port_ids_;
   struct rte_mempool* mbuf_pool_;
@@ -19,6 +19,12 @@ DEFINE_string(conf_file,
 DEFINE_uint64(
     enable_slow_start, 1,
     "Send frames slower than the specified frame duration during warmup");
+DEFINE_uint64(replay_frames, 0,
+              "Number of frames of the IQ data file to replay in turn (0 for "
+              "all frames in the file)");
+DEFINE_uint64(symbol_jitter, 0,
+              "Largest random delay in microseconds added to the start of "
+              "each symbol");
 
 int main(int argc, char* argv[]) {
   gflags::ParseCommandLineFlags(&argc, &argv, true);
@@ -33,7 +39,8 @@ int main(int argc, char* argv[]) {
       auto sender = std::make_unique<Sender>(
           cfg.get(), FLAGS_num_threads, FLAGS_core_offset, FLAGS_frame_duration,
           FLAGS_inter_frame_delay, FLAGS_enable_slow_start,
-          FLAGS_server_mac_addr);
+          FLAGS_server_mac_addr, false, FLAGS_replay_frames,
+          FLAGS_symbol_jitter);
       sender->StartTx();
     }  // end context sender
   }    // end context Config
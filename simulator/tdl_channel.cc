@@ -0,0 +1,200 @@
+/**
+ * @file tdl_channel.cc
+ * @brief Implementation file for the TDL multipath channel model
+ */
+#include "tdl_channel.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+struct TdlTap {
+  // Delay normalized to the RMS delay spread
+  double delay_;
+  double power_db_;
+};
+
+// 3GPP TR 38.901 Table 7.7.2-1
+const std::vector<TdlTap> kTdlA = {
+    {0.0000, -13.4}, {0.3819, 0.0},   {0.4025, -2.2},  {0.5868, -4.0},
+    {0.4610, -6.0},  {0.5375, -8.2},  {0.6708, -9.9},  {0.5750, -10.5},
+    {0.7618, -7.5},  {1.5375, -15.9}, {1.8978, -6.6},  {2.2242, -16.7},
+    {2.1717, -12.4}, {2.4942, -15.2}, {2.5119, -10.8}, {3.0582, -11.3},
+    {4.0810, -12.7}, {4.4579, -16.2}, {4.5695, -18.3}, {4.7966, -18.9},
+    {5.0066, -16.6}, {5.3043, -19.9}, {9.6586, -29.7}};
+
+// 3GPP TR 38.901 Table 7.7.2-2
+const std::vector<TdlTap> kTdlB = {
+    {0.0000, 0.0},   {0.1072, -2.2},  {0.2155, -4.0},  {0.2095, -3.2},
+    {0.2870, -9.8},  {0.2986, -1.2},  {0.3752, -3.4},  {0.5055, -5.2},
+    {0.3681, -7.6},  {0.3697, -3.0},  {0.5700, -8.9},  {0.5283, -9.0},
+    {1.1021, -4.8},  {1.2756, -5.7},  {1.5474, -7.5},  {1.7842, -1.9},
+    {2.0169, -7.6},  {2.8294, -12.2}, {3.0219, -9.8},  {3.6187, -11.4},
+    {4.1067, -14.9}, {4.2790, -9.2},  {4.7834, -11.3}};
+
+// 3GPP TR 38.901 Table 7.7.2-3
+const std::vector<TdlTap> kTdlC = {
+    {0.0000, -4.4},  {0.2099, -1.2},  {0.2219, -3.5},  {0.2329, -5.2},
+    {0.2176, -2.5},  {0.6366, 0.0},   {0.6448, -2.2},  {0.6560, -3.9},
+    {0.6584, -7.4},  {0.7935, -7.1},  {0.8213, -10.7}, {0.9336, -11.1},
+    {1.2285, -5.1},  {1.3083, -6.8},  {2.1704, -8.7},  {2.7105, -13.2},
+    {4.2589, -13.9}, {4.6003, -13.9}, {5.4902, -15.8}, {5.6077, -17.1},
+    {6.3065, -16.0}, {6.6374, -15.7}, {7.0427, -21.6}, {8.6523, -22.8}};
+
+const std::vector<TdlTap>& ProfileTaps(TdlChannel::Profile profile) {
+  switch (profile) {
+    case TdlChannel::Profile::kTdlA:
+      return kTdlA;
+    case TdlChannel::Profile::kTdlB:
+      return kTdlB;
+    case TdlChannel::Profile::kTdlC:
+      return kTdlC;
+  }
+  return kTdlA;
+}
+}  // namespace
+
+bool TdlChannel::ParseProfile(const std::string& name, Profile& profile) {
+  if (name == "TDL-A") {
+    profile = Profile::kTdlA;
+  } else if (name == "TDL-B") {
+    profile = Profile::kTdlB;
+  } else if (name == "TDL-C") {
+    profile = Profile::kTdlC;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+TdlChannel::TdlChannel(Profile profile, size_t ue_ant, size_t bs_ant,
+                       size_t fft_size, double sample_rate,
+                       double delay_spread_ns, double doppler_hz,
+                       double frame_duration_sec, uint64_t seed)
+    : ue_ant_(ue_ant),
+      bs_ant_(bs_ant),
+      fft_size_(fft_size),
+      doppler_hz_(doppler_hz),
+      frame_duration_sec_(frame_duration_sec),
+      rng_(seed) {
+  const std::vector<TdlTap>& profile_taps = ProfileTaps(profile);
+  const size_t num_taps = profile_taps.size();
+
+  // Normalize the total power of each antenna pair to 1
+  double total_power = 0;
+  for (const TdlTap& tap : profile_taps) {
+    total_power += std::pow(10.0, tap.power_db_ / 10.0);
+  }
+  for (const TdlTap& tap : profile_taps) {
+    tap_std_.push_back(static_cast<float>(
+        std::sqrt(std::pow(10.0, tap.power_db_ / 10.0) / total_power)));
+    tap_delay_sec_.push_back(tap.delay_ * delay_spread_ns * 1e-9);
+  }
+
+  // Fractional delays are exact in the frequency domain, so the taps are not
+  // rounded to the sample grid
+  steering_.resize(2 * fft_size_ * num_taps);
+  for (size_t l = 0; l < num_taps; l++) {
+    for (size_t k = 0; k < fft_size_; k++) {
+      // Subcarrier frequency, with the upper half of the FFT negative
+      const double sc = static_cast<double>(k) -
+                        ((k < fft_size_ / 2) ? 0.0 : fft_size_ * 1.0);
+      const double phase =
+          -2.0 * M_PI * sc * sample_rate / fft_size_ * tap_delay_sec_[l];
+      steering_[2 * (l * fft_size_ + k)] = std::cos(phase);
+      steering_[2 * (l * fft_size_ + k) + 1] = std::sin(phase);
+    }
+  }
+
+  const size_t num_pairs = ue_ant_ * bs_ant_;
+  taps_.resize(2 * num_taps * num_pairs);
+  noise_.resize(taps_.size());
+  packed_taps_.resize(PackedChannelSize(num_taps, num_pairs));
+  // Independent Rayleigh fading taps, with the power split over I and Q
+  rng_.Generate(taps_.data(), taps_.size());
+  for (size_t i = 0; i < taps_.size(); i++) {
+    taps_[i] *= tap_std_[(i / 2) % num_taps] * static_cast<float>(M_SQRT1_2);
+  }
+  response_ = ComputeResponse();
+
+  if (doppler_hz_ > 0) {
+    update_thread_ = std::thread(&TdlChannel::UpdateLoop, this);
+  }
+}
+
+TdlChannel::~TdlChannel() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    running_ = false;
+  }
+  update_cond_.notify_one();
+  if (update_thread_.joinable()) {
+    update_thread_.join();
+  }
+}
+
+std::shared_ptr<const std::vector<float>> TdlChannel::Response() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return response_;
+}
+
+void TdlChannel::NewFrame() {
+  if (doppler_hz_ <= 0) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    frame_count_++;
+  }
+  update_cond_.notify_one();
+}
+
+void TdlChannel::EvolveTaps(double elapsed_sec) {
+  // h(t + dt) = rho h(t) + sqrt(1 - rho^2) w, which keeps the tap power
+  // and correlates taps dt apart by rho
+  const float rho = static_cast<float>(
+      std::cyl_bessel_j(0.0, 2.0 * M_PI * doppler_hz_ * elapsed_sec));
+  const float innovation = std::sqrt(std::max(0.0f, 1.0f - rho * rho)) *
+                           static_cast<float>(M_SQRT1_2);
+  const size_t num_taps = tap_std_.size();
+  rng_.Generate(noise_.data(), noise_.size());
+  for (size_t i = 0; i < taps_.size(); i++) {
+    taps_[i] = rho * taps_[i] +
+               innovation * tap_std_[(i / 2) % num_taps] * noise_[i];
+  }
+}
+
+std::shared_ptr<const std::vector<float>> TdlChannel::ComputeResponse() {
+  // H(k) = sum_l h_l exp(-j 2 pi f_k tau_l) for all antenna pairs is the
+  // product of the steering matrix with the taps
+  const size_t num_taps = tap_std_.size();
+  const size_t num_pairs = ue_ant_ * bs_ant_;
+  PackChannelMatrix(taps_.data(), num_taps, num_pairs, false,
+                    1.0f / fft_size_, packed_taps_.data());
+  auto response = std::make_shared<std::vector<float>>(2 * fft_size_ *
+                                                       num_pairs);
+  ApplyChannelMatrix(steering_.data(), fft_size_, num_taps,
+                     packed_taps_.data(), num_pairs, response->data());
+  return response;
+}
+
+void TdlChannel::UpdateLoop() {
+  size_t last_frame = 0;
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    update_cond_.wait(
+        lock, [&] { return !running_ || (frame_count_ != last_frame); });
+    if (!running_) {
+      break;
+    }
+    const size_t num_frames = frame_count_ - last_frame;
+    last_frame = frame_count_;
+    lock.unlock();
+
+    EvolveTaps(num_frames * frame_duration_sec_);
+    auto response = ComputeResponse();
+
+    lock.lock();
+    response_ = std::move(response);
+  }
+}
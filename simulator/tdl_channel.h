@@ -0,0 +1,94 @@
+/**
+ * @file tdl_channel.h
+ * @brief Declaration file for the tapped delay line (TDL) multipath channel
+ * model of the channel simulator
+ */
+#ifndef TDL_CHANNEL_H_
+#define TDL_CHANNEL_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "channel_kernels.h"
+
+/**
+ * @brief Frequency-selective Rayleigh fading channel between every UE and BS
+ * antenna pair, using the TDL-A, TDL-B and TDL-C power delay profiles of
+ * 3GPP TR 38.901 (Section 7.7.2).
+ *
+ * The taps of every antenna pair fade independently. Between frames they
+ * evolve as a first-order Gauss-Markov process. Each update over a time t
+ * correlates the taps by the Jakes autocorrelation J0(2 pi fd t) for the
+ * maximum Doppler shift fd. With fd = 0 the channel is static.
+ *
+ * The channel is kept as its frequency response on the [fft_size] OFDM
+ * subcarriers, so that it is applied by one complex multiplication per
+ * subcarrier. A background thread computes the response of the next frame
+ * while the current one is in use. When this takes longer than a frame, the
+ * channel advances over all the frames elapsed since the last update.
+ */
+class TdlChannel {
+ public:
+  enum class Profile { kTdlA, kTdlB, kTdlC };
+
+  /// Parse "TDL-A", "TDL-B" or "TDL-C". Return false for other names.
+  static bool ParseProfile(const std::string& name, Profile& profile);
+
+  TdlChannel(Profile profile, size_t ue_ant, size_t bs_ant, size_t fft_size,
+             double sample_rate, double delay_spread_ns, double doppler_hz,
+             double frame_duration_sec, uint64_t seed);
+  ~TdlChannel();
+
+  /**
+   * @brief Frequency response of the current channel realization, scaled by
+   * 1 / [fft_size] to undo the gain of an unnormalized FFT / IFFT pair. The
+   * response from UE antenna u to BS antenna b is the [fft_size] complex
+   * values in FFT order starting at 2 * fft_size * (u + b * ue_ant).
+   */
+  std::shared_ptr<const std::vector<float>> Response();
+
+  /// Advance the channel by one frame
+  void NewFrame();
+
+ private:
+  /// Move the taps forward by [elapsed_sec]
+  void EvolveTaps(double elapsed_sec);
+  /// Compute the frequency response of the current taps
+  std::shared_ptr<const std::vector<float>> ComputeResponse();
+  void UpdateLoop();
+
+  const size_t ue_ant_;
+  const size_t bs_ant_;
+  const size_t fft_size_;
+  const double doppler_hz_;
+  const double frame_duration_sec_;
+  // Standard deviation of each tap
+  std::vector<float> tap_std_;
+  // Tap delays in seconds
+  std::vector<double> tap_delay_sec_;
+
+  GaussianRng rng_;
+  // Complex taps of every antenna pair: tap l of pair p at 2 * (l + p * L)
+  std::vector<float> taps_;
+  // Gaussian samples for EvolveTaps()
+  std::vector<float> noise_;
+  // Complex exponential of each tap delay on every subcarrier, fft_size_ x L
+  std::vector<float> steering_;
+  // taps_ packed by PackChannelMatrix()
+  std::vector<float> packed_taps_;
+
+  // Guards response_ and frame_count_
+  std::mutex mutex_;
+  std::condition_variable update_cond_;
+  std::shared_ptr<const std::vector<float>> response_;
+  size_t frame_count_ = 0;
+  bool running_ = true;
+  std::thread update_thread_;
+};
+
+#endif  // TDL_CHANNEL_H_
@@ -48,20 +48,40 @@ Agora::Agora(Config* const cfg)
   InitializeUplinkBuffers();
   InitializeDownlinkBuffers();
 
+  if (cfg->DecoderDeadlineUs() > 0) {
+    decode_budget_ = std::make_unique<DecodeBudget>(cfg, stats_.get());
+    MLPD_INFO(
+        "Agora: LDPC iterations budgeted between %zu and %zu to decode "
+        "within %.1f us of the first packet of a frame\n",
+        cfg->DecoderMinIter(), decode_budget_->MaxIter(),
+        cfg->DecoderDeadlineUs());
+  }
+
+  if (cfg->ClosedLoopPort() != 0) {
+    frame_done_client_ = std::make_unique<UDPClient>();
+    MLPD_INFO("Agora: reporting completed frames to %s:%d\n",
+              cfg->BsRruAddr().c_str(), cfg->ClosedLoopPort());
+  }
+
   /* Initialize TXRX threads */
   packet_tx_rx_ = std::make_unique<PacketTXRX>(
       cfg, cfg->CoreOffset() + 1, &message_queue_,
       GetConq(EventType::kPacketTX, 0), rx_ptoks_ptr_, tx_ptoks_ptr_);
 
   if (kEnableMac == true) {
+    // MAC thread i runs on core mac_cpu_core + i
     const size_t mac_cpu_core =
         cfg->CoreOffset() + cfg->SocketThreadNum() + cfg->WorkerThreadNum() + 1;
-    mac_thread_ = std::make_unique<MacThreadBaseStation>(
-        cfg, mac_cpu_core, decoded_buffer_, &dl_bits_buffer_,
-        &dl_bits_buffer_status_, &mac_request_queue_, &mac_response_queue_);
-
-    mac_std_thread_ =
-        std::thread(&MacThreadBaseStation::RunEventLoop, mac_thread_.get());
+    for (size_t i = 0; i < cfg->MacThreadNum(); i++) {
+      mac_threads_.emplace_back(std::make_unique<MacThreadBaseStation>(
+          cfg, mac_cpu_core, i, decoded_buffer_, &dl_bits_buffer_,
+          &dl_bits_buffer_status_, &mac_request_queue_[i],
+          &mac_response_queue_));
+    }
+    for (auto& mac_thread : mac_threads_) {
+      mac_std_threads_.emplace_back(&MacThreadBaseStation::RunEventLoop,
+                                    mac_thread.get());
+    }
   }
 
   // Create worker threads
@@ -77,8 +97,8 @@ Agora::Agora(Config* const cfg)
 }
 
 Agora::~Agora() {
-  if (kEnableMac == true) {
-    mac_std_thread_.join();
+  for (auto& mac_std_thread : mac_std_threads_) {
+    mac_std_thread.join();
   }
 
   for (auto& worker_thread : workers_) {
@@ -110,7 +130,8 @@ void Agora::SendSnrReport(EventType event_type, size_t frame_id,
     snr_report.num_tags_ = 2;
     float snr = this->phy_stats_->GetEvmSnr(frame_id, i);
     std::memcpy(&snr_report.tags_[1], &snr, sizeof(float));
-    TryEnqueueFallback(&mac_request_queue_, snr_report);
+    TryEnqueueFallback(&mac_request_queue_[config_->MacThreadForUe(i)],
+                       snr_report);
     base_tag.ue_id_++;
   }
 }
@@ -258,6 +279,10 @@ void Agora::ScheduleCodeblocks(EventType event_type, size_t frame_id,
   if (num_remainder > 0) {
     num_blocks++;
   }
+  if ((event_type == EventType::kDecode) && (decode_budget_ != nullptr)) {
+    // Count the code blocks before a decoder can report any of them done
+    decode_budget_->AddPending(num_tasks);
+  }
   EventData event;
   event.num_tags_ = config_->EncodeBlockSize();
   event.event_type_ = event_type;
@@ -281,8 +306,9 @@ void Agora::ScheduleUsers(EventType event_type, size_t frame_id,
   unused(event_type);
   auto base_tag = gen_tag_t::FrmSymUe(frame_id, symbol_id, 0);
 
+  // Each UE's packets go to the MAC thread that owns the UE
   for (size_t i = 0; i < config_->UeAntNum(); i++) {
-    TryEnqueueFallback(&mac_request_queue_,
+    TryEnqueueFallback(&mac_request_queue_[config_->MacThreadForUe(i)],
                        EventData(EventType::kPacketToMac, base_tag.tag_));
     base_tag.ue_id_++;
   }
@@ -492,6 +518,7 @@ void Agora::Start() {
 
           bool last_ue = this->mac_to_phy_counters_.CompleteTask(frame_id, 0);
           if (last_ue == true) {
+            this->stats_->MasterSetTsc(TsType::kMacRXDone, frame_id);
             // schedule this frame's encoding
             // Defer the schedule.  If frames are already deferred or the
             // current received frame is too far off
@@ -717,6 +744,9 @@ finish:
   if ((kEnableMac == false) && (kPrintPhyStats == true)) {
     this->phy_stats_->PrintPhyStats();
   }
+  if (kPrintPhyStats == true) {
+    this->phy_stats_->PrintDecoderIterStats();
+  }
   this->Stop();
 }
 
@@ -810,19 +840,22 @@ void Agora::Worker(int tid) {
       std::make_unique<DoIFFT>(this->config_, tid, this->dl_ifft_buffer_,
                                this->dl_socket_buffer_, this->stats_.get());
 
+  Table<complex_float>* dl_modulated_buffer =
+      config_->FusedDlModulation() ? &this->dl_modulated_buffer_ : nullptr;
   auto compute_precode = std::make_unique<DoPrecode>(
       this->config_, tid, this->dl_zf_matrices_, this->dl_ifft_buffer_,
-      this->dl_encoded_buffer_, this->stats_.get());
+      this->dl_encoded_buffer_, this->stats_.get(), dl_modulated_buffer);
 
   auto compute_encoding = std::make_unique<DoEncode>(
       config_, tid, Direction::kDownlink,
       (kEnableMac == true) ? dl_bits_buffer_ : config_->DlBits(),
       (kEnableMac == true) ? kFrameWnd : 1, dl_encoded_buffer_,
-      this->stats_.get());
+      this->stats_.get(), dl_modulated_buffer);
 
   // Uplink workers
   auto compute_decoding = std::make_unique<DoDecode>(
       this->config_, tid, this->demod_buffers_, this->decoded_buffer_,
+      this->harq_buffer_.get(), this->decode_budget_.get(),
       this->phy_stats_.get(), this->stats_.get());
 
   auto compute_demul = std::make_unique<DoDemul>(
@@ -960,9 +993,10 @@ void Agora::WorkerDemul(int tid) {
                   this->phy_stats_.get(), this->stats_.get()));
 
   /* Initialize Precode operator */
-  std::unique_ptr<DoPrecode> compute_precode(
-      new DoPrecode(config_, tid, dl_zf_matrices_, dl_ifft_buffer_,
-                    dl_encoded_buffer_, this->stats_.get()));
+  std::unique_ptr<DoPrecode> compute_precode(new DoPrecode(
+      config_, tid, dl_zf_matrices_, dl_ifft_buffer_, dl_encoded_buffer_,
+      this->stats_.get(),
+      config_->FusedDlModulation() ? &dl_modulated_buffer_ : nullptr));
 
   assert(false);
 
@@ -982,14 +1016,16 @@ void Agora::WorkerDemul(int tid) {
 void Agora::WorkerDecode(int tid) {
   PinToCoreWithOffset(ThreadType::kWorkerDecode, base_worker_core_offset_, tid);
 
-  std::unique_ptr<DoEncode> compute_encoding(
-      new DoEncode(config_, tid, Direction::kDownlink,
-                   (kEnableMac == true) ? dl_bits_buffer_ : config_->DlBits(),
-                   (kEnableMac == true) ? kFrameWnd : 1, dl_encoded_buffer_,
-                   this->stats_.get()));
+  std::unique_ptr<DoEncode> compute_encoding(new DoEncode(
+      config_, tid, Direction::kDownlink,
+      (kEnableMac == true) ? dl_bits_buffer_ : config_->DlBits(),
+      (kEnableMac == true) ? kFrameWnd : 1, dl_encoded_buffer_,
+      this->stats_.get(),
+      config_->FusedDlModulation() ? &dl_modulated_buffer_ : nullptr));
 
   std::unique_ptr<DoDecode> compute_decoding(
       new DoDecode(config_, tid, demod_buffers_, decoded_buffer_,
+                   harq_buffer_.get(), decode_budget_.get(),
                    this->phy_stats_.get(), this->stats_.get()));
 
   while (this->config_->Running() == true) {
@@ -1424,6 +1460,17 @@ void Agora::InitializeUplinkBuffers() {
       cfg->LdpcConfig().NumBlocksInSymbol() * cfg->UeAntNum());
 
   tomac_counters_.Init(cfg->Frame().NumULSyms(), cfg->UeAntNum());
+
+  if (cfg->HarqMaxTx() > 1) {
+    harq_buffer_ = std::make_unique<HarqSoftBuffer>(
+        cfg->UeAntNum(), cfg->Frame().NumULSyms(),
+        cfg->LdpcConfig().NumBlocksInSymbol(),
+        cfg->LdpcConfig().NumCbCodewLen(), cfg->HarqMaxTx());
+    MLPD_INFO(
+        "Agora: HARQ soft buffer of %.2f MB, up to %zu transmissions per code "
+        "block\n",
+        harq_buffer_->MemoryBytes() / (1024.0 * 1024.0), cfg->HarqMaxTx());
+  }
 }
 
 void Agora::InitializeDownlinkBuffers() {
@@ -1468,10 +1515,32 @@ void Agora::InitializeDownlinkBuffers() {
       calib_dl_buffer_[kFrameWnd - 1][i] = {1, 0};
       calib_ul_buffer_[kFrameWnd - 1][i] = {1, 0};
     }
-    dl_encoded_buffer_.Calloc(
-        task_buffer_symbol_num,
-        Roundup<64>(config_->OfdmDataNum()) * config_->UeAntNum(),
-        Agora_memory::Alignment_t::kAlign64);
+    if (config_->FusedDlModulation()) {
+      dl_modulated_buffer_.Calloc(
+          task_buffer_symbol_num,
+          Roundup<64>(config_->OfdmDataNum()) * config_->UeAntNum(),
+          Agora_memory::Alignment_t::kAlign64);
+      // Encoders never write pilots, so fill them in once here: all
+      // subcarriers of DL pilot symbols, and the pilot subcarriers of DL data
+      // symbols
+      for (size_t i = 0; i < task_buffer_symbol_num; i++) {
+        const bool pilot_symbol = (i % config_->Frame().NumDLSyms()) <
+                                  config_->Frame().ClientDlPilotSymbols();
+        for (size_t sc_id = 0; sc_id < config_->OfdmDataNum(); sc_id++) {
+          if (pilot_symbol || (sc_id % config_->OfdmPilotSpacing()) == 0) {
+            for (size_t ue_id = 0; ue_id < config_->UeAntNum(); ue_id++) {
+              dl_modulated_buffer_[i][sc_id * config_->UeAntNum() + ue_id] =
+                  config_->UeSpecificPilot()[ue_id][sc_id];
+            }
+          }
+        }
+      }
+    } else {
+      dl_encoded_buffer_.Calloc(
+          task_buffer_symbol_num,
+          Roundup<64>(config_->OfdmDataNum()) * config_->UeAntNum(),
+          Agora_memory::Alignment_t::kAlign64);
+    }
 
     encode_counters_.Init(
         config_->Frame().NumDlDataSyms(),
@@ -1492,6 +1561,10 @@ void Agora::InitializeDownlinkBuffers() {
 }
 
 void Agora::FreeUplinkBuffers() {
+  if (harq_buffer_ != nullptr) {
+    harq_buffer_->PrintSummary();
+    harq_buffer_.reset();
+  }
   socket_buffer_.Free();
   data_buffer_.Free();
   equal_buffer_.Free();
@@ -1509,6 +1582,7 @@ void Agora::FreeDownlinkBuffers() {
     calib_dl_msum_buffer_.Free();
     calib_ul_msum_buffer_.Free();
     dl_encoded_buffer_.Free();
+    dl_modulated_buffer_.Free();
     dl_bits_buffer_.Free();
     dl_bits_buffer_status_.Free();
   }
@@ -1614,6 +1688,15 @@ bool Agora::CheckFrameComplete(size_t frame_id) {
     }
     this->cur_proc_frame_id_++;
 
+    if (frame_done_client_ != nullptr) {
+      // Let the sender release the next frame
+      const auto done_frame_id = static_cast<uint32_t>(frame_id);
+      frame_done_client_->Send(
+          config_->BsRruAddr(), config_->ClosedLoopPort(),
+          reinterpret_cast<const uint8_t*>(&done_frame_id),
+          sizeof(done_frame_id));
+    }
+
     if (this->encode_deferral_.empty() == false) {
       for (size_t encode = 0; encode < kScheduleQueues; encode++) {
         const size_t deferred_frame = this->encode_deferral_.front();
@@ -19,11 +19,13 @@
 #include "concurrent_queue_wrapper.h"
 #include "concurrentqueue.h"
 #include "config.h"
+#include "decode_budget.h"
 #include "dodecode.h"
 #include "dodemul.h"
 #include "doencode.h"
 #include "dofft.h"
 #include "doifft.h"
+#include "harq_buffer.h"
 #include "doprecode.h"
 #include "dozf.h"
 #include "mac_thread_basestation.h"
@@ -32,6 +34,7 @@
 #include "signal_handler.h"
 #include "stats.h"
 #include "txrx.h"
+#include "udp_client.h"
 #include "utils.h"
 
 class Agora {
@@ -163,10 +166,10 @@ class Agora {
   size_t max_equaled_frame_ = SIZE_MAX;
   std::unique_ptr<PacketTXRX> packet_tx_rx_;
 
-  // The thread running MAC layer functions
-  std::unique_ptr<MacThreadBaseStation> mac_thread_;
-  // Handle for the MAC thread
-  std::thread mac_std_thread_;
+  // The threads running MAC layer functions, one per UE shard
+  std::vector<std::unique_ptr<MacThreadBaseStation>> mac_threads_;
+  // Handles for the MAC threads
+  std::vector<std::thread> mac_std_threads_;
   std::vector<std::thread> workers_;
 
   std::unique_ptr<Stats> stats_;
@@ -214,6 +217,17 @@ class Agora {
   // Data after LDPC decoding. Each buffer [decoded bytes per UE] bytes.
   PtrCube<kFrameWnd, kMaxSymbols, kMaxUEs, int8_t> decoded_buffer_;
 
+  // LLRs of uplink code blocks that failed decoding, combined with their
+  // retransmissions. nullptr if HARQ is disabled.
+  std::unique_ptr<HarqSoftBuffer> harq_buffer_;
+
+  // Deadline-aware LDPC iteration budget of the decoders, or nullptr if
+  // decoderDeadlineUs is 0
+  std::unique_ptr<DecodeBudget> decode_budget_;
+
+  // Reports the ID of each completed frame to the sender in closed loop mode
+  std::unique_ptr<UDPClient> frame_done_client_;
+
   Table<complex_float> ue_spec_pilot_buffer_;
 
   // Counters related to various modules
@@ -277,6 +291,13 @@ class Agora {
   // 2nd dimension: number of OFDM data subcarriers * number of UEs
   Table<int8_t> dl_encoded_buffer_;
 
+  // Modulated downlink symbols, used instead of dl_encoded_buffer_ if
+  // downlink encoding and modulation are fused.
+  // 1st dimension: kFrameWnd * number of data symbols per frame
+  // 2nd dimension: number of OFDM data subcarriers * number of UEs, with the
+  // symbols of all UEs for one subcarrier stored contiguously
+  Table<complex_float> dl_modulated_buffer_;
+
   // 1st dimension: kFrameWnd * number of DL data symbols per frame
   // 2nd dimension: number of OFDM data subcarriers * number of UEs
   Table<int8_t> dl_bits_buffer_;
@@ -308,10 +329,11 @@ class Agora {
   // Master thread's message queue for receiving packets
   moodycamel::ConcurrentQueue<EventData> message_queue_;
 
-  // Master-to-worker queue for MAC
-  moodycamel::ConcurrentQueue<EventData> mac_request_queue_;
+  // Master-to-worker queues for MAC. mac_request_queue_[i] carries the
+  // events of the UEs served by MAC thread #i.
+  moodycamel::ConcurrentQueue<EventData> mac_request_queue_[kMaxMacThreads];
 
-  // Worker-to-master queue for MAC
+  // Worker-to-master queue for MAC, shared by all MAC threads
   moodycamel::ConcurrentQueue<EventData> mac_response_queue_;
 
   // Master thread's message queue for event completion from Doers;
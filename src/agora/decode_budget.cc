@@ -0,0 +1,46 @@
+/**
+ * @file decode_budget.cc
+ * @brief Implementation file for the DecodeBudget class
+ */
+#include "decode_budget.h"
+
+#include <algorithm>
+
+#include "gettime.h"
+
+DecodeBudget::DecodeBudget(const Config* const cfg, const Stats* const stats)
+    : stats_(stats),
+      deadline_cycles_(
+          static_cast<size_t>(cfg->DecoderDeadlineUs() * cfg->FreqGhz() * 1e3)),
+      min_iter_(cfg->DecoderMinIter()),
+      max_iter_(cfg->LdpcConfig().MaxDecoderIter()),
+      num_workers_(cfg->WorkerThreadNum()),
+      pending_cbs_(0) {}
+
+size_t DecodeBudget::MaxIterations(size_t frame_id,
+                                   double cycles_per_iter) const {
+  if (cycles_per_iter <= 0) {
+    return max_iter_;
+  }
+  const size_t deadline_tsc =
+      stats_->MasterGetTsc(TsType::kFirstSymbolRX, frame_id) +
+      deadline_cycles_;
+  const size_t now_tsc = GetTime::Rdtsc();
+  if (now_tsc >= deadline_tsc) {
+    return min_iter_;
+  }
+
+  // Code blocks that each decoder has to finish before the deadline,
+  // including this one. Code blocks of later frames are counted too, which
+  // errs on the side of fewer iterations.
+  const size_t pending = pending_cbs_.load(std::memory_order_relaxed);
+  const size_t cbs_per_worker =
+      std::max<size_t>(1, (pending + num_workers_ - 1) / num_workers_);
+  const double affordable_iters =
+      static_cast<double>(deadline_tsc - now_tsc) /
+      (cycles_per_iter * static_cast<double>(cbs_per_worker));
+  if (affordable_iters >= static_cast<double>(max_iter_)) {
+    return max_iter_;
+  }
+  return std::max(min_iter_, static_cast<size_t>(affordable_iters));
+}
@@ -0,0 +1,57 @@
+/**
+ * @file decode_budget.h
+ * @brief Declaration file for the DecodeBudget class, the deadline-aware
+ * LDPC iteration policy shared by the uplink decoders.
+ *
+ * Each code block gets as many decoder iterations as the decoders can afford
+ * if every code block still waiting in the decode queue is to finish before
+ * the frame deadline. The budget shrinks toward decoderMinIter when the queue
+ * is deep or the deadline is near, and grows back to decoderIter when there
+ * is slack.
+ */
+#ifndef DECODE_BUDGET_H_
+#define DECODE_BUDGET_H_
+
+#include <atomic>
+#include <cstddef>
+
+#include "config.h"
+#include "stats.h"
+
+class DecodeBudget {
+ public:
+  DecodeBudget(const Config* const cfg, const Stats* const stats);
+
+  /// Called by the master when it schedules [num_cbs] code blocks for
+  /// decoding
+  inline void AddPending(size_t num_cbs) {
+    pending_cbs_.fetch_add(num_cbs, std::memory_order_relaxed);
+  }
+
+  /// Called by a decoder when it has decoded a code block
+  inline void Done() { pending_cbs_.fetch_sub(1, std::memory_order_relaxed); }
+
+  /**
+   * @brief Return the maximum number of iterations for the next code block
+   * of frame [frame_id]
+   *
+   * @param cycles_per_iter The calling decoder's measured cost of one
+   * iteration in RDTSC cycles, or 0 if it has not been measured yet
+   */
+  size_t MaxIterations(size_t frame_id, double cycles_per_iter) const;
+
+  inline size_t MaxIter() const { return this->max_iter_; }
+
+ private:
+  const Stats* const stats_;
+  // Cycles from the first packet of a frame to its decode deadline
+  const size_t deadline_cycles_;
+  const size_t min_iter_;
+  const size_t max_iter_;
+  const size_t num_workers_;
+
+  // Code blocks scheduled for decoding and not decoded yet
+  std::atomic<size_t> pending_cbs_;
+};
+
+#endif  // DECODE_BUDGET_H_
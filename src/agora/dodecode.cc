@@ -5,6 +5,8 @@
  */
 #include "dodecode.h"
 
+#include <algorithm>
+
 #include "concurrent_queue_wrapper.h"
 #include "phy_ldpc_decoder_5gnr.h"
 
@@ -12,15 +14,21 @@ static constexpr bool kPrintLLRData = false;
 static constexpr bool kPrintDecodedData = false;
 
 static constexpr size_t kVarNodesSize = 1024 * 1024 * sizeof(int16_t);
+// Weight of the latest code block in the average cycles per iteration
+static constexpr double kIterCyclesAlpha = 0.1;
 
 DoDecode::DoDecode(
     Config* in_config, int in_tid,
     PtrCube<kFrameWnd, kMaxSymbols, kMaxUEs, int8_t>& demod_buffers,
     PtrCube<kFrameWnd, kMaxSymbols, kMaxUEs, int8_t>& decoded_buffers,
+    HarqSoftBuffer* harq_buffer, DecodeBudget* decode_budget,
     PhyStats* in_phy_stats, Stats* in_stats_manager)
     : Doer(in_config, in_tid),
       demod_buffers_(demod_buffers),
       decoded_buffers_(decoded_buffers),
+      harq_buffer_(harq_buffer),
+      decode_budget_(decode_budget),
+      iter_cycles_(0),
       phy_stats_(in_phy_stats),
       scrambler_(std::make_unique<AgoraScrambler::Scrambler>()) {
   duration_stat_ = in_stats_manager->GetDurationStat(DoerType::kDecode, in_tid);
@@ -59,9 +67,16 @@ EventData DoDecode::Launch(size_t tag) {
 
   ldpc_decoder_5gnr_request.numChannelLlrs = num_channel_llrs;
   ldpc_decoder_5gnr_request.numFillerBits = num_filler_bits;
-  ldpc_decoder_5gnr_request.maxIterations = ldpc_config.MaxDecoderIter();
+  size_t max_iter = ldpc_config.MaxDecoderIter();
+  if (decode_budget_ != nullptr) {
+    max_iter = decode_budget_->MaxIterations(frame_id, iter_cycles_);
+  }
+  const bool budget_limited =
+      max_iter < static_cast<size_t>(ldpc_config.MaxDecoderIter());
+  ldpc_decoder_5gnr_request.maxIterations = max_iter;
+  // Stop as soon as the parity checks pass when short on time
   ldpc_decoder_5gnr_request.enableEarlyTermination =
-      ldpc_config.EarlyTermination();
+      ldpc_config.EarlyTermination() || budget_limited;
   ldpc_decoder_5gnr_request.Zc = ldpc_config.ExpansionFactor();
   ldpc_decoder_5gnr_request.baseGraph = ldpc_config.BaseGraph();
   ldpc_decoder_5gnr_request.nRows = ldpc_config.NumRows();
@@ -81,11 +96,45 @@ EventData DoDecode::Launch(size_t tag) {
   ldpc_decoder_5gnr_request.varNodes = llr_buffer_ptr;
   ldpc_decoder_5gnr_response.compactedMessageBytes = decoded_buffer_ptr;
 
+  // Combine the LLRs with those of failed earlier transmissions in place.
+  // Frames carry no new data indicator. HARQ requires the MAC to be disabled
+  // (see Config), and the sender then repeats the same payload every frame,
+  // so each frame is a retransmission.
+  size_t num_harq_tx = 1;
+  if (harq_buffer_ != nullptr) {
+    num_harq_tx = harq_buffer_->Combine(ue_id, symbol_idx_ul, cur_cb_id,
+                                        frame_id, false, llr_buffer_ptr);
+  }
+
   size_t start_tsc1 = GetTime::WorkerRdtsc();
   duration_stat_->task_duration_[1] += start_tsc1 - start_tsc;
 
-  bblib_ldpc_decoder_5gnr(&ldpc_decoder_5gnr_request,
-                          &ldpc_decoder_5gnr_response);
+  const size_t decode_start_tsc =
+      (decode_budget_ != nullptr) ? GetTime::Rdtsc() : 0;
+  LdpcDecodeHelper(&ldpc_decoder_5gnr_request, &ldpc_decoder_5gnr_response);
+  const size_t num_iters = std::max<size_t>(
+      1, ldpc_decoder_5gnr_response.iterationAtTermination);
+  if (decode_budget_ != nullptr) {
+    const double cycles_per_iter =
+        static_cast<double>(GetTime::Rdtsc() - decode_start_tsc) / num_iters;
+    iter_cycles_ = (iter_cycles_ == 0)
+                       ? cycles_per_iter
+                       : (kIterCyclesAlpha * cycles_per_iter) +
+                             ((1 - kIterCyclesAlpha) * iter_cycles_);
+    decode_budget_->Done();
+  }
+
+  if (harq_buffer_ != nullptr) {
+    // Without the MAC there is no CRC, so use the LDPC parity check
+    if (ldpc_decoder_5gnr_response.parityPassedAtTermination) {
+      harq_buffer_->Release(ue_id, symbol_idx_ul, cur_cb_id);
+    } else {
+      harq_buffer_->Store(ue_id, symbol_idx_ul, cur_cb_id, frame_id,
+                          llr_buffer_ptr, num_harq_tx);
+      harq_buffer_->Feedback(ue_id, symbol_idx_ul, cur_cb_id, frame_id,
+                             false);
+    }
+  }
 
   if (cfg_->ScrambleEnabled()) {
     scrambler_->Descramble(decoded_buffer_ptr, cfg_->NumBytesPerCb());
@@ -127,6 +176,9 @@ EventData DoDecode::Launch(size_t tag) {
     }
     phy_stats_->UpdateBlockErrors(ue_id, symbol_offset, block_error);
   }
+  if (kPrintPhyStats == true) {
+    phy_stats_->UpdateDecoderIterations(ue_id, num_iters, budget_limited);
+  }
 
   size_t duration = GetTime::WorkerRdtsc() - start_tsc;
   duration_stat_->task_duration_[0] += duration;
@@ -10,7 +10,9 @@
 
 #include "buffer.h"
 #include "config.h"
+#include "decode_budget.h"
 #include "doer.h"
+#include "harq_buffer.h"
 #include "memory_manage.h"
 #include "phy_stats.h"
 #include "scrambler.h"
@@ -21,6 +23,7 @@ class DoDecode : public Doer {
   DoDecode(Config* in_config, int in_tid,
            PtrCube<kFrameWnd, kMaxSymbols, kMaxUEs, int8_t>& demod_buffers,
            PtrCube<kFrameWnd, kMaxSymbols, kMaxUEs, int8_t>& decoded_buffers,
+           HarqSoftBuffer* harq_buffer, DecodeBudget* decode_budget,
            PhyStats* in_phy_stats, Stats* in_stats_manager);
   ~DoDecode() override;
 
@@ -30,6 +33,13 @@ class DoDecode : public Doer {
   int16_t* resp_var_nodes_;
   PtrCube<kFrameWnd, kMaxSymbols, kMaxUEs, int8_t>& demod_buffers_;
   PtrCube<kFrameWnd, kMaxSymbols, kMaxUEs, int8_t>& decoded_buffers_;
+  // Soft buffer for HARQ combining, or nullptr if HARQ is disabled
+  HarqSoftBuffer* harq_buffer_;
+  // Deadline-aware iteration budget, or nullptr to always run up to
+  // decoderIter iterations
+  DecodeBudget* decode_budget_;
+  // Moving average of this decoder's RDTSC cycles per LDPC iteration
+  double iter_cycles_;
   PhyStats* phy_stats_;
   DurationStat* duration_stat_;
   std::unique_ptr<AgoraScrambler::Scrambler> scrambler_;
@@ -4,9 +4,16 @@
  */
 #include "dodemul.h"
 
+#include <algorithm>
+#include <cmath>
+
 #include "concurrent_queue_wrapper.h"
 
 static constexpr bool kUseSIMDGather = true;
+// Range of the per-UE LLR scale factor. The int8 LDPC decoders saturate
+// their messages sooner with larger LLRs, so scaling never raises them.
+static constexpr float kMinLlrScaleFactor = 0.25f;
+static constexpr float kMaxLlrScaleFactor = 1.0f;
 
 DoDemul::DoDemul(
     Config* config, int tid, Table<complex_float>& data_buffer,
@@ -77,6 +84,15 @@ DoDemul::~DoDemul() {
 }
 
 EventData DoDemul::Launch(size_t tag) {
+  auto launch = launch_.Get(cfg_, [](auto geometry) {
+    return &DoDemul::LaunchImpl<typename decltype(geometry)::Type>;
+  });
+  return (this->*launch)(tag);
+}
+
+template <typename Geometry>
+EventData DoDemul::LaunchImpl(size_t tag) {
+  const Geometry geo(cfg_);
   const size_t frame_id = gen_tag_t(tag).frame_id_;
   const size_t symbol_id = gen_tag_t(tag).symbol_id_;
   const size_t base_sc_id = gen_tag_t(tag).sc_id_;
@@ -112,7 +128,7 @@ EventData DoDemul::Launch(size_t tag) {
     // same partial transpose block.
     const size_t partial_transpose_block_base =
         ((base_sc_id + i) / kTransposeBlockSize) *
-        (kTransposeBlockSize * cfg_->BsAntNum());
+        (kTransposeBlockSize * geo.BsAntNum());
 
 #ifdef __AVX512F__
     static constexpr size_t kAntNumPerSimd = 8;
@@ -122,7 +138,7 @@ EventData DoDemul::Launch(size_t tag) {
 
     size_t ant_start = 0;
     if (kUseSIMDGather && kUsePartialTrans &&
-        (cfg_->BsAntNum() % kAntNumPerSimd) == 0) {
+        (geo.BsAntNum() % kAntNumPerSimd) == 0) {
       // Gather data for all antennas and 8 subcarriers in the same cache
       // line, 1 subcarrier and 4 (AVX2) or 8 (AVX512) ants per iteration
       size_t cur_sc_offset =
@@ -139,18 +155,18 @@ EventData DoDemul::Launch(size_t tag) {
           kTransposeBlockSize * 10, kTransposeBlockSize * 10 + 1,
           kTransposeBlockSize * 12, kTransposeBlockSize * 12 + 1,
           kTransposeBlockSize * 14, kTransposeBlockSize * 14 + 1);
-      for (size_t ant_i = 0; ant_i < cfg_->BsAntNum();
+      for (size_t ant_i = 0; ant_i < geo.BsAntNum();
            ant_i += kAntNumPerSimd) {
         for (size_t j = 0; j < kSCsPerCacheline; j++) {
           __m512 data_rx = kTransposeBlockSize == 1
-                               ? _mm512_load_ps(&src[j * cfg_->BsAntNum() * 2])
+                               ? _mm512_load_ps(&src[j * geo.BsAntNum() * 2])
                                : _mm512_i32gather_ps(index, &src[j * 2], 4);
 
-          assert((reinterpret_cast<size_t>(&dst[j * cfg_->BsAntNum() * 2]) %
+          assert((reinterpret_cast<size_t>(&dst[j * geo.BsAntNum() * 2]) %
                   (kAntNumPerSimd * sizeof(float) * 2)) == 0);
-          assert((reinterpret_cast<size_t>(&src[j * cfg_->BsAntNum() * 2]) %
+          assert((reinterpret_cast<size_t>(&src[j * geo.BsAntNum() * 2]) %
                   (kAntNumPerSimd * sizeof(float) * 2)) == 0);
-          _mm512_store_ps(&dst[j * cfg_->BsAntNum() * 2], data_rx);
+          _mm512_store_ps(&dst[j * geo.BsAntNum() * 2], data_rx);
         }
         src += kAntNumPerSimd * kTransposeBlockSize * 2;
         dst += kAntNumPerSimd * 2;
@@ -160,27 +176,27 @@ EventData DoDemul::Launch(size_t tag) {
           0, 1, kTransposeBlockSize * 2, kTransposeBlockSize * 2 + 1,
           kTransposeBlockSize * 4, kTransposeBlockSize * 4 + 1,
           kTransposeBlockSize * 6, kTransposeBlockSize * 6 + 1);
-      for (size_t ant_i = 0; ant_i < cfg_->BsAntNum();
+      for (size_t ant_i = 0; ant_i < geo.BsAntNum();
            ant_i += kAntNumPerSimd) {
         for (size_t j = 0; j < kSCsPerCacheline; j++) {
           assert((reinterpret_cast<size_t>(&src[j * 2]) %
                   (kAntNumPerSimd * sizeof(float) * 2)) == 0);
-          assert((reinterpret_cast<size_t>(&dst[j * cfg_->BsAntNum() * 2]) %
+          assert((reinterpret_cast<size_t>(&dst[j * geo.BsAntNum() * 2]) %
                   (kAntNumPerSimd * sizeof(float) * 2)) == 0);
           __m256 data_rx = _mm256_i32gather_ps(&src[j * 2], index, 4);
-          _mm256_store_ps(&dst[j * cfg_->BsAntNum() * 2], data_rx);
+          _mm256_store_ps(&dst[j * geo.BsAntNum() * 2], data_rx);
         }
         src += kAntNumPerSimd * kTransposeBlockSize * 2;
         dst += kAntNumPerSimd * 2;
       }
 #endif
       // Set the remaining number of antennas for non-SIMD gather
-      ant_start = cfg_->BsAntNum() - (cfg_->BsAntNum() % kAntNumPerSimd);
+      ant_start = geo.BsAntNum() - (geo.BsAntNum() % kAntNumPerSimd);
     }
-    if (ant_start < cfg_->BsAntNum()) {
+    if (ant_start < geo.BsAntNum()) {
       complex_float* dst = data_gather_buffer_ + ant_start;
       for (size_t j = 0; j < kSCsPerCacheline; j++) {
-        for (size_t ant_i = ant_start; ant_i < cfg_->BsAntNum(); ant_i++) {
+        for (size_t ant_i = ant_start; ant_i < geo.BsAntNum(); ant_i++) {
           *dst++ =
               kUsePartialTrans
                   ? data_buf[partial_transpose_block_base +
@@ -201,31 +217,38 @@ EventData DoDemul::Launch(size_t tag) {
       if (kExportConstellation) {
         equal_ptr =
             (arma::cx_float*)(&equal_buffer_[total_data_symbol_idx_ul]
-                                            [cur_sc_id * cfg_->UeAntNum()]);
+                                            [cur_sc_id * geo.UeAntNum()]);
       } else {
         equal_ptr =
             (arma::cx_float*)(&equaled_buffer_temp_[(cur_sc_id - base_sc_id) *
-                                                    cfg_->UeAntNum()]);
+                                                    geo.UeAntNum()]);
       }
-      arma::cx_fmat mat_equaled(equal_ptr, cfg_->UeAntNum(), 1, false);
+      arma::cx_fmat mat_equaled(equal_ptr, geo.UeAntNum(), 1, false);
 
       auto* data_ptr = reinterpret_cast<arma::cx_float*>(
-          &data_gather_buffer_[j * cfg_->BsAntNum()]);
+          &data_gather_buffer_[j * geo.BsAntNum()]);
       // size_t start_tsc2 = worker_rdtsc();
       auto* ul_zf_ptr = reinterpret_cast<arma::cx_float*>(
           ul_zf_matrices_[frame_slot][cfg_->GetZfScId(cur_sc_id)]);
 
       size_t start_tsc2 = GetTime::WorkerRdtsc();
+      if constexpr (Geometry::kFixed) {
+        CxMatVecFixed<Geometry::UeAntNum(), Geometry::BsAntNum()>(
+            reinterpret_cast<const complex_float*>(ul_zf_ptr),
+            reinterpret_cast<const complex_float*>(data_ptr),
+            reinterpret_cast<complex_float*>(equal_ptr));
+      } else {
 #if USE_MKL_JIT
-      mkl_jit_cgemm_(jitter_, (MKL_Complex8*)ul_zf_ptr, (MKL_Complex8*)data_ptr,
-                     (MKL_Complex8*)equal_ptr);
+        mkl_jit_cgemm_(jitter_, (MKL_Complex8*)ul_zf_ptr,
+                       (MKL_Complex8*)data_ptr, (MKL_Complex8*)equal_ptr);
 #else
-      arma::cx_fmat mat_data(data_ptr, cfg_->BsAntNum(), 1, false);
+        arma::cx_fmat mat_data(data_ptr, geo.BsAntNum(), 1, false);
 
-      arma::cx_fmat mat_ul_zf(ul_zf_ptr, cfg_->UeAntNum(), cfg_->BsAntNum(),
-                              false);
-      mat_equaled = mat_ul_zf * mat_data;
+        arma::cx_fmat mat_ul_zf(ul_zf_ptr, geo.UeAntNum(), geo.BsAntNum(),
+                                false);
+        mat_equaled = mat_ul_zf * mat_data;
 #endif
+      }
 
       if (symbol_idx_ul <
           cfg_->Frame().ClientUlPilotSymbols()) {  // Calc new phase shift
@@ -233,15 +256,15 @@ EventData DoDemul::Launch(size_t tag) {
           // Reset previous frame
           auto* phase_shift_ptr = reinterpret_cast<arma::cx_float*>(
               ue_spec_pilot_buffer_[(frame_id - 1) % kFrameWnd]);
-          arma::cx_fmat mat_phase_shift(phase_shift_ptr, cfg_->UeAntNum(),
+          arma::cx_fmat mat_phase_shift(phase_shift_ptr, geo.UeAntNum(),
                                         cfg_->Frame().ClientUlPilotSymbols(),
                                         false);
           mat_phase_shift.fill(0);
         }
         auto* phase_shift_ptr = reinterpret_cast<arma::cx_float*>(
             &ue_spec_pilot_buffer_[frame_id % kFrameWnd]
-                                  [symbol_idx_ul * cfg_->UeAntNum()]);
-        arma::cx_fmat mat_phase_shift(phase_shift_ptr, cfg_->UeAntNum(), 1,
+                                  [symbol_idx_ul * geo.UeAntNum()]);
+        arma::cx_fmat mat_phase_shift(phase_shift_ptr, geo.UeAntNum(), 1,
                                       false);
         arma::cx_fmat shift_sc =
             sign(mat_equaled % conj(ue_pilot_data_.col(cur_sc_id)));
@@ -251,11 +274,11 @@ EventData DoDemul::Launch(size_t tag) {
       else if (cfg_->Frame().ClientUlPilotSymbols() > 0) {
         auto* pilot_corr_ptr = reinterpret_cast<arma::cx_float*>(
             ue_spec_pilot_buffer_[frame_id % kFrameWnd]);
-        arma::cx_fmat pilot_corr_mat(pilot_corr_ptr, cfg_->UeAntNum(),
+        arma::cx_fmat pilot_corr_mat(pilot_corr_ptr, geo.UeAntNum(),
                                      cfg_->Frame().ClientUlPilotSymbols(),
                                      false);
         arma::fmat theta_mat = arg(pilot_corr_mat);
-        arma::fmat theta_inc = arma::zeros<arma::fmat>(cfg_->UeAntNum(), 1);
+        arma::fmat theta_inc = arma::zeros<arma::fmat>(geo.UeAntNum(), 1);
         for (size_t s = 1; s < cfg_->Frame().ClientUlPilotSymbols(); s++) {
           arma::fmat theta_diff = theta_mat.col(s) - theta_mat.col(s - 1);
           theta_inc += theta_diff;
@@ -285,16 +308,16 @@ EventData DoDemul::Launch(size_t tag) {
 
   size_t start_tsc3 = GetTime::WorkerRdtsc();
   __m256i index2 =
-      _mm256_setr_epi32(0, 1, cfg_->UeAntNum() * 2, cfg_->UeAntNum() * 2 + 1,
-                        cfg_->UeAntNum() * 4, cfg_->UeAntNum() * 4 + 1,
-                        cfg_->UeAntNum() * 6, cfg_->UeAntNum() * 6 + 1);
+      _mm256_setr_epi32(0, 1, geo.UeAntNum() * 2, geo.UeAntNum() * 2 + 1,
+                        geo.UeAntNum() * 4, geo.UeAntNum() * 4 + 1,
+                        geo.UeAntNum() * 6, geo.UeAntNum() * 6 + 1);
   auto* equal_t_ptr = reinterpret_cast<float*>(equaled_buffer_temp_transposed_);
-  for (size_t i = 0; i < cfg_->UeAntNum(); i++) {
+  for (size_t i = 0; i < geo.UeAntNum(); i++) {
     float* equal_ptr = nullptr;
     if (kExportConstellation) {
       equal_ptr = reinterpret_cast<float*>(
           &equal_buffer_[total_data_symbol_idx_ul]
-                        [base_sc_id * cfg_->UeAntNum() + i]);
+                        [base_sc_id * geo.UeAntNum() + i]);
     } else {
       equal_ptr = reinterpret_cast<float*>(equaled_buffer_temp_ + i);
     }
@@ -303,25 +326,17 @@ EventData DoDemul::Launch(size_t tag) {
       __m256 equal_t_temp = _mm256_i32gather_ps(equal_ptr, index2, 4);
       _mm256_store_ps(equal_t_ptr, equal_t_temp);
       equal_t_ptr += 8;
-      equal_ptr += cfg_->UeAntNum() * k_num_double_in_sim_d256 * 2;
+      equal_ptr += geo.UeAntNum() * k_num_double_in_sim_d256 * 2;
     }
     equal_t_ptr = (float*)(equaled_buffer_temp_transposed_);
     int8_t* demod_ptr = demod_buffers_[frame_slot][symbol_idx_ul][i] +
                         (cfg_->ModOrderBits() * base_sc_id);
 
-    switch (cfg_->ModOrderBits()) {
-      case (CommsLib::kQpsk):
-        DemodQpskSoftSse(equal_t_ptr, demod_ptr, max_sc_ite);
-        break;
-      case (CommsLib::kQaM16):
-        Demod16qamSoftAvx2(equal_t_ptr, demod_ptr, max_sc_ite);
-        break;
-      case (CommsLib::kQaM64):
-        Demod64qamSoftAvx2(equal_t_ptr, demod_ptr, max_sc_ite);
-        break;
-      default:
-        std::printf("Demodulation: modulation type %s not supported!\n",
-                    cfg_->Modulation().c_str());
+    const float llr_scale = LlrScaleFactor(frame_id, i);
+    if (DemodSoftAvx2(equal_t_ptr, demod_ptr, max_sc_ite, cfg_->ModOrderBits(),
+                      llr_scale) == false) {
+      std::printf("Demodulation: modulation type %s not supported!\n",
+                  cfg_->Modulation().c_str());
     }
     // std::printf("In doDemul thread %d: frame: %d, symbol: %d, sc_id: %d \n",
     //     tid, frame_id, symbol_idx_ul, base_sc_id);
@@ -336,3 +351,21 @@ EventData DoDemul::Launch(size_t tag) {
   duration_stat_->task_duration_[0] += GetTime::WorkerRdtsc() - start_tsc;
   return EventData(EventType::kDemul, tag);
 }
+
+float DoDemul::LlrScaleFactor(size_t frame_id, size_t ue_id) const {
+  if (!kCollectPhyStats || !cfg_->LlrScaling()) {
+    return 1.0f;
+  }
+  // Post-equalization SNR, assuming the array gain of zero-forcing over the
+  // mean pilot SNR at the BS antennas
+  const float snr_db =
+      phy_stats_->GetPilotSnr(frame_id, ue_id) +
+      10 * std::log10(cfg_->BsAntNum() - cfg_->UeAntNum() + 1.0f);
+  if (!std::isfinite(snr_db)) {
+    return 1.0f;
+  }
+  // Shrink the LLRs with the noise amplitude below the reference SNR
+  const float factor =
+      std::pow(10.0f, (snr_db - cfg_->LlrScaleRefSnrDb()) / 20.0f);
+  return std::clamp(factor, kMinLlrScaleFactor, kMaxLlrScaleFactor);
+}
@@ -13,12 +13,17 @@
 #include "concurrentqueue.h"
 #include "config.h"
 #include "doer.h"
+#include "doer_geometry.h"
 #include "gettime.h"
 #include "modulation.h"
 #include "phy_stats.h"
 #include "stats.h"
 #include "symbols.h"
 
+#if USE_MKL_JIT
+#include <mkl.h>
+#endif
+
 class DoDemul : public Doer {
  public:
   DoDemul(Config* config, int tid, Table<complex_float>& data_buffer,
@@ -58,6 +63,15 @@ class DoDemul : public Doer {
   EventData Launch(size_t tag) override;
 
  private:
+  /// Launch() for the antenna geometry [Geometry]
+  template <typename Geometry>
+  EventData LaunchImpl(size_t tag);
+
+  /// Multiple of the default LLR scale for the demapped bits of [ue_id] in
+  /// frame [frame_id]. 1 unless LLR scaling is enabled.
+  float LlrScaleFactor(size_t frame_id, size_t ue_id) const;
+
+  GeometrySpecialized<EventData (DoDemul::*)(size_t)> launch_;
   Table<complex_float>& data_buffer_;
   PtrGrid<kFrameWnd, kMaxDataSCs, complex_float>& ul_zf_matrices_;
   Table<complex_float>& ue_spec_pilot_buffer_;
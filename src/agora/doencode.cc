@@ -6,6 +6,8 @@
 
 #include "doencode.h"
 
+#include <algorithm>
+
 #include "concurrent_queue_wrapper.h"
 #include "encoder.h"
 #include "phy_ldpc_decoder_5gnr.h"
@@ -15,48 +17,185 @@ static constexpr bool kPrintRawMacData = false;
 
 DoEncode::DoEncode(Config* in_config, int in_tid, Direction dir,
                    Table<int8_t>& in_raw_data_buffer, size_t in_buffer_rollover,
-                   Table<int8_t>& in_encoded_buffer, Stats* in_stats_manager)
+                   Table<int8_t>& in_encoded_buffer, Stats* in_stats_manager,
+                   Table<complex_float>* in_modulated_buffer)
     : Doer(in_config, in_tid),
       dir_(dir),
       raw_data_buffer_(in_raw_data_buffer),
       raw_buffer_rollover_(in_buffer_rollover),
       encoded_buffer_(in_encoded_buffer),
+      modulated_buffer_(in_modulated_buffer),
+      num_buffered_cbs_(std::max<size_t>(cfg_->EncodeBlockSize(), 1)),
+      parity_buffers_(),
+      encoded_buffers_temp_(),
+      scrambler_buffers_(),
+      mod_bits_buffer_(nullptr),
       scrambler_(std::make_unique<AgoraScrambler::Scrambler>()) {
   duration_stat_ = in_stats_manager->GetDurationStat(DoerType::kEncode, in_tid);
-  parity_buffer_ = static_cast<int8_t*>(Agora_memory::PaddedAlignedAlloc(
-      Agora_memory::Alignment_t::kAlign64,
-      LdpcEncodingParityBufSize(cfg_->LdpcConfig().BaseGraph(),
-                                cfg_->LdpcConfig().ExpansionFactor())));
-  assert(parity_buffer_ != nullptr);
-  encoded_buffer_temp_ = static_cast<int8_t*>(Agora_memory::PaddedAlignedAlloc(
-      Agora_memory::Alignment_t::kAlign64,
-      LdpcEncodingEncodedBufSize(cfg_->LdpcConfig().BaseGraph(),
-                                 cfg_->LdpcConfig().ExpansionFactor())));
-  assert(encoded_buffer_temp_ != nullptr);
-
-  scrambler_buffer_ = static_cast<int8_t*>(Agora_memory::PaddedAlignedAlloc(
-      Agora_memory::Alignment_t::kAlign64,
-      cfg_->NumBytesPerCb() + kLdpcHelperFunctionInputBufferSizePaddingBytes));
-
-  assert(scrambler_buffer_ != nullptr);
+  for (size_t i = 0; i < num_buffered_cbs_; i++) {
+    parity_buffers_[i] = static_cast<int8_t*>(Agora_memory::PaddedAlignedAlloc(
+        Agora_memory::Alignment_t::kAlign64,
+        LdpcEncodingParityBufSize(cfg_->LdpcConfig().BaseGraph(),
+                                  cfg_->LdpcConfig().ExpansionFactor())));
+    assert(parity_buffers_[i] != nullptr);
+    encoded_buffers_temp_[i] =
+        static_cast<int8_t*>(Agora_memory::PaddedAlignedAlloc(
+            Agora_memory::Alignment_t::kAlign64,
+            LdpcEncodingEncodedBufSize(cfg_->LdpcConfig().BaseGraph(),
+                                       cfg_->LdpcConfig().ExpansionFactor())));
+    assert(encoded_buffers_temp_[i] != nullptr);
+
+    scrambler_buffers_[i] =
+        static_cast<int8_t*>(Agora_memory::PaddedAlignedAlloc(
+            Agora_memory::Alignment_t::kAlign64,
+            cfg_->NumBytesPerCb() +
+                kLdpcHelperFunctionInputBufferSizePaddingBytes));
+    assert(scrambler_buffers_[i] != nullptr);
+  }
+
+  if (modulated_buffer_ != nullptr) {
+    RtAssert(dir_ == Direction::kDownlink,
+             "DoEncode: fused modulation is only supported in the downlink");
+    // AdaptBitsForMod rounds the codeword up to whole bytes
+    mod_bits_buffer_ = static_cast<uint8_t*>(Agora_memory::PaddedAlignedAlloc(
+        Agora_memory::Alignment_t::kAlign64,
+        BitsToBytes(cfg_->LdpcConfig().NumCbCodewLen()) * 8 /
+                cfg_->ModOrderBits() +
+            1));
+    assert(mod_bits_buffer_ != nullptr);
+  }
 }
 
 DoEncode::~DoEncode() {
-  std::free(parity_buffer_);
-  std::free(encoded_buffer_temp_);
-  std::free(scrambler_buffer_);
+  for (size_t i = 0; i < num_buffered_cbs_; i++) {
+    std::free(parity_buffers_[i]);
+    std::free(encoded_buffers_temp_[i]);
+    std::free(scrambler_buffers_[i]);
+  }
+  std::free(mod_bits_buffer_);
 }
 
 EventData DoEncode::Launch(size_t tag) {
+  EncodeCodeblocks(&tag, 1);
+  return EventData(EventType::kEncode, tag);
+}
+
+bool DoEncode::TryLaunch(
+    moodycamel::ConcurrentQueue<EventData>& task_queue,
+    moodycamel::ConcurrentQueue<EventData>& complete_task_queue,
+    moodycamel::ProducerToken* worker_ptok) {
+  if (num_buffered_cbs_ == 1) {
+    return Doer::TryLaunch(task_queue, complete_task_queue, worker_ptok);
+  }
+  EventData req_event;
+  if (task_queue.try_dequeue(req_event)) {
+    EventData resp_event = LaunchBatch(req_event);
+    TryEnqueueFallback(&complete_task_queue, worker_ptok, resp_event);
+    return true;
+  }
+  return false;
+}
+
+EventData DoEncode::LaunchBatch(const EventData& req_event) {
+  RtAssert(req_event.num_tags_ <= num_buffered_cbs_,
+           "DoEncode: encode event has more tags than the encode block size");
+  EncodeCodeblocks(req_event.tags_.data(), req_event.num_tags_);
+
+  EventData resp_event;
+  resp_event.num_tags_ = req_event.num_tags_;
+  resp_event.event_type_ = EventType::kEncode;
+  for (size_t i = 0; i < req_event.num_tags_; i++) {
+    resp_event.tags_[i] = req_event.tags_[i];
+  }
+  return resp_event;
+}
+
+void DoEncode::EncodeCodeblocks(const size_t* tags, size_t num_tags) {
   const LDPCconfig& ldpc_config = cfg_->LdpcConfig();
+  size_t start_tsc = GetTime::WorkerRdtsc();
+
+  std::array<const int8_t*, EventData::kMaxTags> ldpc_inputs;
+  std::array<int8_t*, EventData::kMaxTags> final_output_ptrs;
+  for (size_t i = 0; i < num_tags; i++) {
+    ldpc_inputs[i] = GetLdpcInput(tags[i], i, final_output_ptrs[i]);
+  }
+
+  LdpcEncodeBatchHelper(ldpc_config.BaseGraph(),
+                        ldpc_config.ExpansionFactor(), ldpc_config.NumRows(),
+                        num_tags, encoded_buffers_temp_.data(),
+                        parity_buffers_.data(), ldpc_inputs.data());
+
+  for (size_t i = 0; i < num_tags; i++) {
+    // With fused modulation, the modulation bits only pass through a small
+    // cache-resident buffer on their way to the modulated buffer
+    auto* final_output_ptr = (modulated_buffer_ != nullptr)
+                                 ? mod_bits_buffer_
+                                 : reinterpret_cast<uint8_t*>(
+                                       final_output_ptrs[i]);
+    AdaptBitsForMod(reinterpret_cast<uint8_t*>(encoded_buffers_temp_[i]),
+                    final_output_ptr,
+                    BitsToBytes(ldpc_config.NumCbCodewLen()),
+                    cfg_->ModOrderBits());
+
+    if (kPrintEncodedData == true) {
+      std::printf("Encoded data\n");
+      size_t num_mod = ldpc_config.NumCbCodewLen() / cfg_->ModOrderBits();
+      for (size_t j = 0; j < num_mod; j++) {
+        std::printf("%u ", *(final_output_ptr + j));
+      }
+      std::printf("\n");
+    }
+
+    if (modulated_buffer_ != nullptr) {
+      ModulateCodeblock(tags[i], final_output_ptr);
+    }
+  }
+
+  size_t duration = GetTime::WorkerRdtsc() - start_tsc;
+  duration_stat_->task_duration_[0] += duration;
+  duration_stat_->task_count_ += num_tags;
+  if (GetTime::CyclesToUs(duration, cfg_->FreqGhz()) > 500) {
+    std::printf("Thread %d Encode takes %.2f\n", tid_,
+                GetTime::CyclesToUs(duration, cfg_->FreqGhz()));
+  }
+}
+
+void DoEncode::ModulateCodeblock(size_t tag, const uint8_t* mod_bits) {
+  const size_t frame_id = gen_tag_t(tag).frame_id_;
+  const size_t symbol_id = gen_tag_t(tag).symbol_id_;
+  const size_t cb_id = gen_tag_t(tag).cb_id_;
+  const size_t cur_cb_id = cb_id % cfg_->LdpcConfig().NumBlocksInSymbol();
+  const size_t ue_id = cb_id / cfg_->LdpcConfig().NumBlocksInSymbol();
+  const size_t ue_num = cfg_->UeAntNum();
+  const size_t num_syms_per_cb =
+      cfg_->LdpcConfig().NumCbCodewLen() / cfg_->ModOrderBits();
+
+  // Same subcarriers that the code block occupies in the encoded buffer (see
+  // Config::GetEncodedBuf)
+  const size_t sc_start = num_syms_per_cb * cur_cb_id;
+  const size_t sc_end =
+      std::min(sc_start + num_syms_per_cb, cfg_->OfdmDataNum());
+  complex_float* modulated_ptr =
+      (*modulated_buffer_)[cfg_->GetTotalDataSymbolIdxDl(
+          frame_id, cfg_->Frame().GetDLSymbolIdx(symbol_id))] +
+      ue_id;
+  const complex_float* mod_table = cfg_->ModTable()[0];
+  for (size_t sc_id = sc_start; sc_id < sc_end; sc_id++) {
+    // DoPrecode replaces the data on pilot subcarriers with pilots
+    if ((sc_id % cfg_->OfdmPilotSpacing()) != 0) {
+      modulated_ptr[sc_id * ue_num] = mod_table[mod_bits[sc_id - sc_start]];
+    }
+  }
+}
+
+const int8_t* DoEncode::GetLdpcInput(size_t tag, size_t buffer_id,
+                                     int8_t*& final_output_ptr) {
   size_t frame_id = gen_tag_t(tag).frame_id_;
   size_t symbol_id = gen_tag_t(tag).symbol_id_;
   size_t cb_id = gen_tag_t(tag).cb_id_;
   size_t cur_cb_id = cb_id % cfg_->LdpcConfig().NumBlocksInSymbol();
   size_t ue_id = cb_id / cfg_->LdpcConfig().NumBlocksInSymbol();
 
-  size_t start_tsc = GetTime::WorkerRdtsc();
-
   size_t symbol_idx;
   size_t symbol_idx_data;
   if (dir_ == Direction::kDownlink) {
@@ -105,46 +244,25 @@ EventData DoEncode::Launch(size_t tag) {
         cfg_->GetInfoBits(raw_data_buffer_, symbol_idx, ue_id, cur_cb_id);
   }
 
-  int8_t* ldpc_input = nullptr;
+  const int8_t* ldpc_input = nullptr;
 
   if (this->cfg_->ScrambleEnabled()) {
-    std::memcpy(scrambler_buffer_, tx_data_ptr, cfg_->NumBytesPerCb());
-    scrambler_->Scramble(scrambler_buffer_, cfg_->NumBytesPerCb());
-    ldpc_input = scrambler_buffer_;
+    int8_t* scrambler_buffer = scrambler_buffers_[buffer_id];
+    std::memcpy(scrambler_buffer, tx_data_ptr, cfg_->NumBytesPerCb());
+    scrambler_->Scramble(scrambler_buffer, cfg_->NumBytesPerCb());
+    ldpc_input = scrambler_buffer;
   } else {
     ldpc_input = tx_data_ptr;
   }
 
-  LdpcEncodeHelper(ldpc_config.BaseGraph(), ldpc_config.ExpansionFactor(),
-                   ldpc_config.NumRows(), encoded_buffer_temp_, parity_buffer_,
-                   ldpc_input);
-  int8_t* final_output_ptr = cfg_->GetEncodedBuf(
-      encoded_buffer_, dir_, frame_id, symbol_idx, ue_id, cur_cb_id);
+  final_output_ptr = (modulated_buffer_ != nullptr)
+                         ? nullptr
+                         : cfg_->GetEncodedBuf(encoded_buffer_, dir_, frame_id,
+                                               symbol_idx, ue_id, cur_cb_id);
 
   if (kPrintRawMacData && dir_ == Direction::kUplink) {
     std::printf("Encoded data - placed at location (%zu %zu %zu) %zu\n",
                 frame_id, symbol_idx, ue_id, (size_t)final_output_ptr);
   }
-  AdaptBitsForMod(reinterpret_cast<uint8_t*>(encoded_buffer_temp_),
-                  reinterpret_cast<uint8_t*>(final_output_ptr),
-                  BitsToBytes(ldpc_config.NumCbCodewLen()),
-                  cfg_->ModOrderBits());
-
-  if (kPrintEncodedData == true) {
-    std::printf("Encoded data\n");
-    size_t num_mod = cfg_->LdpcConfig().NumCbCodewLen() / cfg_->ModOrderBits();
-    for (size_t i = 0; i < num_mod; i++) {
-      std::printf("%u ", *(final_output_ptr + i));
-    }
-    std::printf("\n");
-  }
-
-  size_t duration = GetTime::WorkerRdtsc() - start_tsc;
-  duration_stat_->task_duration_[0] += duration;
-  duration_stat_->task_count_++;
-  if (GetTime::CyclesToUs(duration, cfg_->FreqGhz()) > 500) {
-    std::printf("Thread %d Encode takes %.2f\n", tid_,
-                GetTime::CyclesToUs(duration, cfg_->FreqGhz()));
-  }
-  return EventData(EventType::kEncode, tag);
+  return ldpc_input;
 }
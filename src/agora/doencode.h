@@ -7,6 +7,7 @@
 #ifndef DOENCODE_H_
 #define DOENCODE_H_
 
+#include <array>
 #include <memory>
 
 #include "buffer.h"
@@ -20,27 +21,68 @@ class DoEncode : public Doer {
  public:
   DoEncode(Config* in_config, int in_tid, Direction dir,
            Table<int8_t>& in_raw_data_buffer, size_t in_buffer_rollover,
-           Table<int8_t>& in_encoded_buffer, Stats* in_stats_manager);
+           Table<int8_t>& in_encoded_buffer, Stats* in_stats_manager,
+           Table<complex_float>* in_modulated_buffer = nullptr);
   ~DoEncode() override;
 
   EventData Launch(size_t tag) override;
 
+  /**
+   * If the encode block size is larger than one, dequeue one encode event and
+   * encode all of its code blocks with a single batched encoder call (see
+   * LaunchBatch). Otherwise, fall back to launching each code block
+   * individually.
+   */
+  bool TryLaunch(moodycamel::ConcurrentQueue<EventData>& task_queue,
+                 moodycamel::ConcurrentQueue<EventData>& complete_task_queue,
+                 moodycamel::ProducerToken* worker_ptok) override;
+
+  /**
+   * Encode all code blocks (up to EncodeBlockSize) of one encode event. The
+   * LDPC encoder interleaves code blocks with small Zc across SIMD lanes, so
+   * encoding them together is cheaper than encoding them one at a time.
+   */
+  EventData LaunchBatch(const EventData& req_event);
+
  private:
+  // Encode the code blocks of [tags] into the encoded buffer
+  void EncodeCodeblocks(const size_t* tags, size_t num_tags);
+
+  // Map the modulation bits of the code block of [tag] to constellation
+  // points, and write them to the modulated buffer in precoding order
+  void ModulateCodeblock(size_t tag, const uint8_t* mod_bits);
+
+  // Return the (scrambled) information bits of the code block of [tag],
+  // using intermediate buffer [buffer_id], and set [final_output_ptr] to its
+  // location in the encoded buffer
+  const int8_t* GetLdpcInput(size_t tag, size_t buffer_id,
+                             int8_t*& final_output_ptr);
+
   Direction dir_;
 
   // References to buffers allocated pre-construction
   Table<int8_t>& raw_data_buffer_;
   size_t raw_buffer_rollover_;
   Table<int8_t>& encoded_buffer_;
+  // If not null, downlink code blocks are modulated straight into this
+  // buffer instead of being written to encoded_buffer_
+  Table<complex_float>* modulated_buffer_;
+
+  // Number of code blocks that the intermediate buffers below hold
+  size_t num_buffered_cbs_;
+
+  // Intermediate buffers to hold LDPC encoding parity
+  std::array<int8_t*, EventData::kMaxTags> parity_buffers_;
 
-  // Intermediate buffer to hold LDPC encoding parity
-  int8_t* parity_buffer_;
+  // Intermediate buffers to hold LDPC encoding output
+  std::array<int8_t*, EventData::kMaxTags> encoded_buffers_temp_;
 
-  // Intermediate buffer to hold LDPC encoding output
-  int8_t* encoded_buffer_temp_;
+  // Intermediate buffers to hold pre/post scrambled data
+  std::array<int8_t*, EventData::kMaxTags> scrambler_buffers_;
 
-  // Intermediate buffer to hold pre/post scrambled data
-  int8_t* scrambler_buffer_;
+  // Intermediate buffer to hold the modulation bits of one code block if
+  // encoding is fused with modulation
+  uint8_t* mod_bits_buffer_;
 
   DurationStat* duration_stat_;
   std::unique_ptr<AgoraScrambler::Scrambler> scrambler_;
@@ -0,0 +1,147 @@
+/**
+ * @file doer_geometry.h
+ * @brief Compile-time antenna geometries used to specialize the hot loops of
+ * DoFFT, DoZF, DoDemul and DoPrecode. Each doer keeps one instantiation of
+ * its kernels per geometry in SpecializedGeometries plus a generic one that
+ * reads the antenna counts from Config, and selects between them through
+ * GeometrySpecialized.
+ */
+#ifndef DOER_GEOMETRY_H_
+#define DOER_GEOMETRY_H_
+
+#include <cstddef>
+#include <tuple>
+#include <utility>
+
+#include "config.h"
+#include "symbols.h"
+#include "utils.h"
+
+// If false, doers always use the generic instantiation
+static constexpr bool kUseFixedGeometryDoers = true;
+
+/// Antenna counts known at compile time
+template <size_t kBsAntNum, size_t kUeAntNum>
+struct FixedGeometry {
+  static constexpr bool kFixed = true;
+  explicit FixedGeometry(const Config* cfg) { unused(cfg); }
+  static constexpr size_t BsAntNum() { return kBsAntNum; }
+  static constexpr size_t UeAntNum() { return kUeAntNum; }
+};
+
+/// Antenna counts read from Config when the doer is launched
+struct DynamicGeometry {
+  static constexpr bool kFixed = false;
+  explicit DynamicGeometry(const Config* cfg)
+      : bs_ant_num_(cfg->BsAntNum()), ue_ant_num_(cfg->UeAntNum()) {}
+  inline size_t BsAntNum() const { return this->bs_ant_num_; }
+  inline size_t UeAntNum() const { return this->ue_ant_num_; }
+
+ private:
+  const size_t bs_ant_num_;
+  const size_t ue_ant_num_;
+};
+
+/// Deployed BS antenna x UE antenna geometries that get their own
+/// instantiation. Every entry adds one copy of each specialized kernel.
+using SpecializedGeometries =
+    std::tuple<FixedGeometry<8, 4>, FixedGeometry<16, 8>,
+               FixedGeometry<32, 8>, FixedGeometry<64, 16>>;
+
+template <typename Geometry>
+struct GeometryTag {
+  using Type = Geometry;
+};
+
+template <typename Select, size_t... I>
+static inline auto DispatchGeometryImpl(size_t bs_ant_num, size_t ue_ant_num,
+                                        Select&& select,
+                                        std::index_sequence<I...>) {
+  auto result = select(GeometryTag<DynamicGeometry>());
+  if (kUseFixedGeometryDoers) {
+    // Stops at the first matching geometry
+    unused(((bs_ant_num ==
+                 std::tuple_element_t<I, SpecializedGeometries>::BsAntNum() &&
+             ue_ant_num ==
+                 std::tuple_element_t<I, SpecializedGeometries>::UeAntNum() &&
+             (result = select(GeometryTag<
+                           std::tuple_element_t<I, SpecializedGeometries>>()),
+              true)) ||
+            ...));
+  }
+  return result;
+}
+
+/// Return select(GeometryTag<G>()) for the geometry G in
+/// SpecializedGeometries that matches the antenna counts, or for
+/// DynamicGeometry if none does
+template <typename Select>
+static inline auto DispatchGeometry(size_t bs_ant_num, size_t ue_ant_num,
+                                    Select&& select) {
+  return DispatchGeometryImpl(
+      bs_ant_num, ue_ant_num, std::forward<Select>(select),
+      std::make_index_sequence<std::tuple_size_v<SpecializedGeometries>>());
+}
+
+/**
+ * A doer member function instantiated for the current geometry. The
+ * instantiation is picked on first use and picked again whenever the antenna
+ * counts in Config change, so a doer stays correct if they are updated at
+ * runtime.
+ */
+template <typename Fn>
+class GeometrySpecialized {
+ public:
+  /// [select] maps a GeometryTag to the member function for that geometry
+  template <typename Select>
+  inline Fn Get(const Config* cfg, Select&& select) {
+    if (unlikely(fn_ == nullptr || bs_ant_num_ != cfg->BsAntNum() ||
+                 ue_ant_num_ != cfg->UeAntNum())) {
+      bs_ant_num_ = cfg->BsAntNum();
+      ue_ant_num_ = cfg->UeAntNum();
+      fn_ = DispatchGeometry(bs_ant_num_, ue_ant_num_,
+                             std::forward<Select>(select));
+    }
+    return fn_;
+  }
+
+ private:
+  Fn fn_ = nullptr;
+  size_t bs_ant_num_ = 0;
+  size_t ue_ant_num_ = 0;
+};
+
+/// out = mat * vec for a column-major kRows x kCols complex matrix. With
+/// both dimensions known at compile time the loops are fully unrolled.
+template <size_t kRows, size_t kCols>
+static inline void CxMatVecFixed(const complex_float* __restrict mat,
+                                 const complex_float* __restrict vec,
+                                 complex_float* __restrict out) {
+  // Wide matrices (e.g. the UL ZF detector) have too few rows to hide the
+  // FMA latency of one accumulator chain per row, so sum groups of columns
+  // into independent partial accumulators
+  static constexpr size_t kNumPartial =
+      (kRows < kCols && kCols % 4 == 0) ? 4 : 1;
+  float acc_re[kNumPartial][kRows] = {};
+  float acc_im[kNumPartial][kRows] = {};
+  for (size_t c = 0; c < kCols; c += kNumPartial) {
+    for (size_t p = 0; p < kNumPartial; p++) {
+      const float v_re = vec[c + p].re;
+      const float v_im = vec[c + p].im;
+      const complex_float* col = mat + (c + p) * kRows;
+      for (size_t r = 0; r < kRows; r++) {
+        acc_re[p][r] += col[r].re * v_re - col[r].im * v_im;
+        acc_im[p][r] += col[r].re * v_im + col[r].im * v_re;
+      }
+    }
+  }
+  for (size_t r = 0; r < kRows; r++) {
+    out[r] = {acc_re[0][r], acc_im[0][r]};
+    for (size_t p = 1; p < kNumPartial; p++) {
+      out[r].re += acc_re[p][r];
+      out[r].im += acc_im[p][r];
+    }
+  }
+}
+
+#endif  // DOER_GEOMETRY_H_
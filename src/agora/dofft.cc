@@ -4,6 +4,8 @@
  */
 #include "dofft.h"
 
+#include <array>
+
 #include "concurrent_queue_wrapper.h"
 #include "datatype_conversion.h"
 
@@ -24,14 +26,36 @@ DoFFT::DoFFT(Config* config, size_t tid, Table<complex_float>& data_buffer,
       phy_stats_(in_phy_stats) {
   duration_stat_fft_ = stats_manager->GetDurationStat(DoerType::kFFT, tid);
   duration_stat_csi_ = stats_manager->GetDurationStat(DoerType::kCSI, tid);
-  DftiCreateDescriptor(&mkl_handle_, DFTI_SINGLE, DFTI_COMPLEX, 1,
-                       cfg_->OfdmCaNum());
-  DftiCommitDescriptor(mkl_handle_);
+  fft_plan_ = FftPlan::Create(FftDirection::kForward, cfg_->OfdmCaNum(),
+                              true, cfg_->FftBackend());
+
+  if (cfg_->FftPruning()) {
+    pruned_fft_ = std::make_unique<PrunedFft>(
+        PrunedFft::FftDirection::kForward, cfg_->OfdmCaNum(),
+        cfg_->OfdmDataStart(), cfg_->OfdmDataNum(),
+        cfg_->FftPruningDecimation(), cfg_->FftBackend());
+  }
 
   // Aligned for SIMD
   fft_inout_ = static_cast<complex_float*>(Agora_memory::PaddedAlignedAlloc(
       Agora_memory::Alignment_t::kAlign64,
       cfg_->OfdmCaNum() * sizeof(complex_float)));
+
+  if (cfg_->FftBatched()) {
+    // One in-place multi-transform plan per possible number of antennas in
+    // an FFT event
+    for (size_t i = 1; i <= cfg_->FftBlockSize(); i++) {
+      FftLayout layout(cfg_->OfdmCaNum());
+      layout.num_transforms_ = i;
+      batch_fft_plans_.push_back(FftPlan::Create(FftDirection::kForward,
+                                                 layout, cfg_->FftBackend()));
+    }
+    fft_batch_buffer_ =
+        static_cast<complex_float*>(Agora_memory::PaddedAlignedAlloc(
+            Agora_memory::Alignment_t::kAlign64,
+            cfg_->FftBlockSize() * cfg_->OfdmCaNum() * sizeof(complex_float)));
+  }
+
   temp_16bits_iq_ = static_cast<uint16_t*>(Agora_memory::PaddedAlignedAlloc(
       Agora_memory::Alignment_t::kAlign64, 32 * sizeof(uint16_t)));
   rx_samps_tmp_ =
@@ -41,8 +65,8 @@ DoFFT::DoFFT(Config* config, size_t tid, Table<complex_float>& data_buffer,
 }
 
 DoFFT::~DoFFT() {
-  DftiFreeDescriptor(&mkl_handle_);
   std::free(fft_inout_);
+  std::free(fft_batch_buffer_);
   std::free(rx_samps_tmp_);
   std::free(temp_16bits_iq_);
 }
@@ -80,26 +104,31 @@ static inline void CalibRegressionEstimate(const arma::cx_fvec& in_vec,
   out_vec *= arma::mean(in_mag);
 }
 
-EventData DoFFT::Launch(size_t tag) {
-  size_t start_tsc = GetTime::WorkerRdtsc();
-  Packet* pkt = fft_req_tag_t(tag).rx_packet_->RawPacket();
+DurationStat* DoFFT::GetDurationStat(SymbolType sym_type) {
+  if (sym_type == SymbolType::kUL) {
+    return duration_stat_fft_;
+  } else if (sym_type == SymbolType::kPilot) {
+    return duration_stat_csi_;
+  }
+  return &dummy_duration_stat_;  // TODO: timing for calibration symbols
+}
+
+void DoFFT::ConvertInput(Packet* pkt, SymbolType sym_type,
+                         complex_float* fft_in) {
   size_t frame_id = pkt->frame_id_;
-  size_t frame_slot = frame_id % kFrameWnd;
   size_t symbol_id = pkt->symbol_id_;
   size_t ant_id = pkt->ant_id_;
-  size_t cell_id = pkt->cell_id_;
-  SymbolType sym_type = cfg_->GetSymbolType(symbol_id);
 
   if (cfg_->FftInRru() == true) {
     SimdConvertFloat16ToFloat32(
-        reinterpret_cast<float*>(fft_inout_),
+        reinterpret_cast<float*>(fft_in),
         reinterpret_cast<float*>(&pkt->data_[2 * cfg_->OfdmRxZeroPrefixBs()]),
         cfg_->OfdmCaNum() * 2);
   } else {
     if (kUse12BitIQ) {
       SimdConvert12bitIqToFloat(
           (uint8_t*)pkt->data_ + 3 * cfg_->OfdmRxZeroPrefixBs(),
-          reinterpret_cast<float*>(fft_inout_), temp_16bits_iq_,
+          reinterpret_cast<float*>(fft_in), temp_16bits_iq_,
           cfg_->OfdmCaNum() * 3);
     } else {
       size_t sample_offset = cfg_->OfdmRxZeroPrefixBs();
@@ -109,7 +138,7 @@ EventData DoFFT::Launch(size_t tag) {
         sample_offset = cfg_->OfdmRxZeroPrefixCalUl();
       }
       SimdConvertShortToFloat(&pkt->data_[2 * sample_offset],
-                              reinterpret_cast<float*>(fft_inout_),
+                              reinterpret_cast<float*>(fft_in),
                               cfg_->OfdmCaNum() * 2);
     }
     if (kDebugPrintInTask) {
@@ -152,45 +181,33 @@ EventData DoFFT::Launch(size_t tag) {
       ss << "FFT_input_" << symbol_id << "_" << ant_id << "=[";
       for (size_t i = 0; i < cfg_->OfdmCaNum(); i++) {
         ss << std::fixed << std::setw(5) << std::setprecision(3)
-           << fft_inout_[i].re << "+1j*" << fft_inout_[i].im << " ";
+           << fft_in[i].re << "+1j*" << fft_in[i].im << " ";
       }
       ss << "];" << std::endl;
       std::cout << ss.str();
     }
   }
+}
 
-  DurationStat dummy_duration_stat;  // TODO: timing for calibration symbols
-  DurationStat* duration_stat = nullptr;
-  if (sym_type == SymbolType::kUL) {
-    duration_stat = duration_stat_fft_;
-  } else if (sym_type == SymbolType::kPilot) {
-    duration_stat = duration_stat_csi_;
-  } else {
-    duration_stat = &dummy_duration_stat;  // For calibration symbols
-  }
-
-  size_t start_tsc1 = GetTime::WorkerRdtsc();
-  duration_stat->task_duration_[1] += start_tsc1 - start_tsc;
-
-  if (!cfg_->FftInRru() == true) {
-    DftiComputeForward(
-        mkl_handle_,
-        reinterpret_cast<float*>(fft_inout_));  // Compute FFT in-place
-  }
-
-  size_t start_tsc2 = GetTime::WorkerRdtsc();
-  duration_stat->task_duration_[2] += start_tsc2 - start_tsc1;
+void DoFFT::ProcessOutput(Packet* pkt, SymbolType sym_type,
+                          complex_float* fft_out) {
+  size_t frame_id = pkt->frame_id_;
+  size_t frame_slot = frame_id % kFrameWnd;
+  size_t symbol_id = pkt->symbol_id_;
+  size_t ant_id = pkt->ant_id_;
+  size_t cell_id = pkt->cell_id_;
 
   if (sym_type == SymbolType::kPilot) {
     size_t pilot_symbol_id = cfg_->Frame().GetPilotSymbolIdx(symbol_id);
     if (kCollectPhyStats) {
-      phy_stats_->UpdatePilotSnr(frame_id, pilot_symbol_id, ant_id, fft_inout_);
+      phy_stats_->UpdatePilotSnr(frame_id, pilot_symbol_id, ant_id, fft_out);
     }
     const size_t ue_id = pilot_symbol_id;
-    PartialTranspose(csi_buffers_[frame_slot][ue_id], ant_id,
+    PartialTranspose(fft_out, csi_buffers_[frame_slot][ue_id], ant_id,
                      SymbolType::kPilot);
   } else if (sym_type == SymbolType::kUL) {
-    PartialTranspose(cfg_->GetDataBuf(data_buffer_, frame_id, symbol_id),
+    PartialTranspose(fft_out,
+                     cfg_->GetDataBuf(data_buffer_, frame_id, symbol_id),
                      ant_id, SymbolType::kUL);
   } else if (sym_type == SymbolType::kCalUL &&
              ant_id != cfg_->RefAnt(cell_id)) {
@@ -202,9 +219,10 @@ EventData DoFFT::Launch(size_t tag) {
       size_t frame_grp_id = (frame_id - TX_FRAME_DELTA) / cfg_->AntGroupNum();
       size_t frame_grp_slot = frame_grp_id % kFrameWnd;
       PartialTranspose(
+          fft_out,
           &calib_ul_buffer_[frame_grp_slot][ant_id * cfg_->OfdmDataNum()],
           ant_id, sym_type);
-      phy_stats_->UpdateCalibPilotSnr(frame_grp_id, 1, ant_id, fft_inout_);
+      phy_stats_->UpdateCalibPilotSnr(frame_grp_id, 1, ant_id, fft_out);
     }
   } else if (sym_type == SymbolType::kCalDL &&
              ant_id == cfg_->RefAnt(cell_id)) {
@@ -217,8 +235,8 @@ EventData DoFFT::Launch(size_t tag) {
                        cal_dl_symbol_id;
       complex_float* calib_dl_ptr =
           &calib_dl_buffer_[frame_grp_slot][cur_ant * cfg_->OfdmDataNum()];
-      PartialTranspose(calib_dl_ptr, ant_id, sym_type);
-      phy_stats_->UpdateCalibPilotSnr(frame_grp_id, 0, cur_ant, fft_inout_);
+      PartialTranspose(fft_out, calib_dl_ptr, ant_id, sym_type);
+      phy_stats_->UpdateCalibPilotSnr(frame_grp_id, 0, cur_ant, fft_out);
     }
   } else {
     std::string error_message =
@@ -229,6 +247,32 @@ EventData DoFFT::Launch(size_t tag) {
         std::to_string(ant_id) + "\n";
     RtAssert(false, error_message);
   }
+}
+
+EventData DoFFT::Launch(size_t tag) {
+  size_t start_tsc = GetTime::WorkerRdtsc();
+  Packet* pkt = fft_req_tag_t(tag).rx_packet_->RawPacket();
+  SymbolType sym_type = cfg_->GetSymbolType(pkt->symbol_id_);
+
+  ConvertInput(pkt, sym_type, fft_inout_);
+  DurationStat* duration_stat = GetDurationStat(sym_type);
+
+  size_t start_tsc1 = GetTime::WorkerRdtsc();
+  duration_stat->task_duration_[1] += start_tsc1 - start_tsc;
+
+  if (!cfg_->FftInRru() == true) {
+    if ((pruned_fft_ != nullptr) && (sym_type == SymbolType::kUL)) {
+      // Only the data subcarriers are computed, at their usual offset
+      pruned_fft_->Forward(fft_inout_, fft_inout_ + cfg_->OfdmDataStart());
+    } else {
+      fft_plan_->Execute(fft_inout_);  // Compute FFT in-place
+    }
+  }
+
+  size_t start_tsc2 = GetTime::WorkerRdtsc();
+  duration_stat->task_duration_[2] += start_tsc2 - start_tsc1;
+
+  ProcessOutput(pkt, sym_type, fft_inout_);
 
   duration_stat->task_duration_[3] += GetTime::WorkerRdtsc() - start_tsc2;
 
@@ -239,19 +283,100 @@ EventData DoFFT::Launch(size_t tag) {
                    gen_tag_t::FrmSym(pkt->frame_id_, pkt->symbol_id_).tag_);
 }
 
-void DoFFT::PartialTranspose(complex_float* out_buf, size_t ant_id,
+bool DoFFT::TryLaunch(
+    moodycamel::ConcurrentQueue<EventData>& task_queue,
+    moodycamel::ConcurrentQueue<EventData>& complete_task_queue,
+    moodycamel::ProducerToken* worker_ptok) {
+  if (cfg_->FftBatched() == false) {
+    return Doer::TryLaunch(task_queue, complete_task_queue, worker_ptok);
+  }
+  EventData req_event;
+  if (task_queue.try_dequeue(req_event)) {
+    EventData resp_event = LaunchBatch(req_event);
+    TryEnqueueFallback(&complete_task_queue, worker_ptok, resp_event);
+    return true;
+  }
+  return false;
+}
+
+EventData DoFFT::LaunchBatch(const EventData& req_event) {
+  const size_t num_pkts = req_event.num_tags_;
+  RtAssert(num_pkts <= batch_fft_plans_.size(),
+           "DoFFT: FFT event has more tags than the FFT block size");
+  std::array<Packet*, EventData::kMaxTags> pkts;
+  std::array<SymbolType, EventData::kMaxTags> sym_types;
+  std::array<size_t, EventData::kMaxTags> pkt_tsc;
+
+  // Convert all packets of the event into consecutive rows of the batch
+  // buffer, so that a single MKL call transforms all of them
+  for (size_t i = 0; i < num_pkts; i++) {
+    size_t start_tsc = GetTime::WorkerRdtsc();
+    pkts[i] = fft_req_tag_t(req_event.tags_[i]).rx_packet_->RawPacket();
+    sym_types[i] = cfg_->GetSymbolType(pkts[i]->symbol_id_);
+    ConvertInput(pkts[i], sym_types[i],
+                 fft_batch_buffer_ + (i * cfg_->OfdmCaNum()));
+    pkt_tsc[i] = GetTime::WorkerRdtsc() - start_tsc;
+    GetDurationStat(sym_types[i])->task_duration_[1] += pkt_tsc[i];
+  }
+
+  size_t start_tsc1 = GetTime::WorkerRdtsc();
+  if (!cfg_->FftInRru() == true) {
+    batch_fft_plans_.at(num_pkts - 1)->Execute(fft_batch_buffer_);
+  }
+  // Charge each antenna an equal share of the batched FFT
+  const size_t fft_tsc_per_pkt =
+      (GetTime::WorkerRdtsc() - start_tsc1) / num_pkts;
+
+  EventData resp_event;
+  resp_event.num_tags_ = num_pkts;
+  resp_event.event_type_ = EventType::kFFT;
+  for (size_t i = 0; i < num_pkts; i++) {
+    size_t start_tsc2 = GetTime::WorkerRdtsc();
+    ProcessOutput(pkts[i], sym_types[i],
+                  fft_batch_buffer_ + (i * cfg_->OfdmCaNum()));
+    resp_event.tags_[i] =
+        gen_tag_t::FrmSym(pkts[i]->frame_id_, pkts[i]->symbol_id_).tag_;
+    fft_req_tag_t(req_event.tags_[i]).rx_packet_->Free();
+
+    const size_t post_tsc = GetTime::WorkerRdtsc() - start_tsc2;
+    DurationStat* duration_stat = GetDurationStat(sym_types[i]);
+    duration_stat->task_duration_[2] += fft_tsc_per_pkt;
+    duration_stat->task_duration_[3] += post_tsc;
+    duration_stat->task_count_++;
+    duration_stat->task_duration_[0] +=
+        pkt_tsc[i] + fft_tsc_per_pkt + post_tsc;
+  }
+  return resp_event;
+}
+
+void DoFFT::PartialTranspose(const complex_float* fft_out,
+                             complex_float* out_buf, size_t ant_id,
                              SymbolType symbol_type) const {
+  auto partial_transpose = partial_transpose_.Get(cfg_, [](auto geometry) {
+    return &DoFFT::PartialTransposeImpl<typename decltype(geometry)::Type>;
+  });
+  (this->*partial_transpose)(fft_out, out_buf, ant_id, symbol_type);
+}
+
+template <typename Geometry>
+void DoFFT::PartialTransposeImpl(const complex_float* fft_out,
+                                 complex_float* out_buf, size_t ant_id,
+                                 SymbolType symbol_type) const {
+  const Geometry geo(cfg_);
+  // Pilot signs are stored as interleaved re/im floats, so a cacheline of
+  // them is loaded directly into the SIMD register
+  const auto* pilots_sgn = reinterpret_cast<const float*>(cfg_->PilotsSgn());
   // We have OfdmDataNum() % kTransposeBlockSize == 0
   const size_t num_blocks = cfg_->OfdmDataNum() / kTransposeBlockSize;
 
   for (size_t block_idx = 0; block_idx < num_blocks; block_idx++) {
     const size_t block_base_offset =
-        block_idx * (kTransposeBlockSize * cfg_->BsAntNum());
+        block_idx * (kTransposeBlockSize * geo.BsAntNum());
     // We have kTransposeBlockSize % kSCsPerCacheline == 0
     for (size_t sc_j = 0; sc_j < kTransposeBlockSize;
          sc_j += kSCsPerCacheline) {
       const size_t sc_idx = (block_idx * kTransposeBlockSize) + sc_j;
-      const complex_float* src = &fft_inout_[sc_idx + cfg_->OfdmDataStart()];
+      const complex_float* src = &fft_out[sc_idx + cfg_->OfdmDataStart()];
 
       complex_float* dst = nullptr;
       if ((symbol_type == SymbolType::kCalDL) ||
@@ -272,15 +397,7 @@ void DoFFT::PartialTranspose(complex_float* out_buf, size_t ant_id,
       // AVX-512.
       __m512 fft_result = _mm512_load_ps(reinterpret_cast<const float*>(src));
       if (symbol_type == SymbolType::kPilot) {
-        __m512 pilot_tx = _mm512_set_ps(
-            cfg_->PilotsSgn()[sc_idx + 7].im, cfg_->PilotsSgn()[sc_idx + 7].re,
-            cfg_->PilotsSgn()[sc_idx + 6].im, cfg_->PilotsSgn()[sc_idx + 6].re,
-            cfg_->PilotsSgn()[sc_idx + 5].im, cfg_->PilotsSgn()[sc_idx + 5].re,
-            cfg_->PilotsSgn()[sc_idx + 4].im, cfg_->PilotsSgn()[sc_idx + 4].re,
-            cfg_->PilotsSgn()[sc_idx + 3].im, cfg_->PilotsSgn()[sc_idx + 3].re,
-            cfg_->PilotsSgn()[sc_idx + 2].im, cfg_->PilotsSgn()[sc_idx + 2].re,
-            cfg_->PilotsSgn()[sc_idx + 1].im, cfg_->PilotsSgn()[sc_idx + 1].re,
-            cfg_->PilotsSgn()[sc_idx].im, cfg_->PilotsSgn()[sc_idx].re);
+        __m512 pilot_tx = _mm512_loadu_ps(pilots_sgn + sc_idx * 2);
         fft_result = CommsLib::M512ComplexCf32Mult(fft_result, pilot_tx, true);
       }
       _mm512_stream_ps(reinterpret_cast<float*>(dst), fft_result);
@@ -289,19 +406,11 @@ void DoFFT::PartialTranspose(complex_float* out_buf, size_t ant_id,
       __m256 fft_result1 =
           _mm256_load_ps(reinterpret_cast<const float*>(src + 4));
       if (symbol_type == SymbolType::kPilot) {
-        __m256 pilot_tx0 = _mm256_set_ps(
-            cfg_->PilotsSgn()[sc_idx + 3].im, cfg_->PilotsSgn()[sc_idx + 3].re,
-            cfg_->PilotsSgn()[sc_idx + 2].im, cfg_->PilotsSgn()[sc_idx + 2].re,
-            cfg_->PilotsSgn()[sc_idx + 1].im, cfg_->PilotsSgn()[sc_idx + 1].re,
-            cfg_->PilotsSgn()[sc_idx].im, cfg_->PilotsSgn()[sc_idx].re);
+        __m256 pilot_tx0 = _mm256_loadu_ps(pilots_sgn + sc_idx * 2);
         fft_result0 =
             CommsLib::M256ComplexCf32Mult(fft_result0, pilot_tx0, true);
 
-        __m256 pilot_tx1 = _mm256_set_ps(
-            cfg_->PilotsSgn()[sc_idx + 7].im, cfg_->PilotsSgn()[sc_idx + 7].re,
-            cfg_->PilotsSgn()[sc_idx + 6].im, cfg_->PilotsSgn()[sc_idx + 6].re,
-            cfg_->PilotsSgn()[sc_idx + 5].im, cfg_->PilotsSgn()[sc_idx + 5].re,
-            cfg_->PilotsSgn()[sc_idx + 4].im, cfg_->PilotsSgn()[sc_idx + 4].re);
+        __m256 pilot_tx1 = _mm256_loadu_ps(pilots_sgn + (sc_idx + 4) * 2);
         fft_result1 =
             CommsLib::M256ComplexCf32Mult(fft_result1, pilot_tx1, true);
       }
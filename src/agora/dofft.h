@@ -7,15 +7,18 @@
 
 #include <armadillo>
 #include <iostream>
+#include <memory>
 #include <vector>
 
 #include "buffer.h"
 #include "concurrentqueue.h"
 #include "config.h"
 #include "doer.h"
+#include "doer_geometry.h"
+#include "fft_backend.h"
 #include "gettime.h"
-#include "mkl_dfti.h"
 #include "phy_stats.h"
+#include "pruned_fft.h"
 #include "stats.h"
 #include "symbols.h"
 
@@ -63,8 +66,27 @@ class DoFFT : public Doer {
   EventData Launch(size_t tag) override;
 
   /**
-   * Fill-in the partial transpose of the computed FFT for this antenna into
-   * out_buf.
+   * If batched FFT is enabled, dequeue one FFT event and transform all of its
+   * packets with a single multi-transform FFT call (see LaunchBatch).
+   * Otherwise, fall back to launching each packet individually.
+   */
+  bool TryLaunch(moodycamel::ConcurrentQueue<EventData>& task_queue,
+                 moodycamel::ConcurrentQueue<EventData>& complete_task_queue,
+                 moodycamel::ProducerToken* worker_ptok) override;
+
+  /**
+   * Do FFT tasks for all packets (up to FftBlockSize antennas) of one FFT
+   * event. The packets are converted into consecutive rows of a batch
+   * buffer, transformed in place with one FFT call, and then post-processed
+   * exactly like Launch() does. The batched FFT time is charged equally to
+   * each packet in the duration stats, so the per-task FFT time reports the
+   * per-antenna FFT cost for the configured block size.
+   */
+  EventData LaunchBatch(const EventData& req_event);
+
+  /**
+   * Fill-in the partial transpose of the computed FFT (fft_out) for this
+   * antenna into out_buf.
    *
    * The fully-transposed matrix after FFT is a subcarriers x antennas matrix
    * that should look like so (using the notation subcarrier/antenna, and
@@ -92,23 +114,54 @@ class DoFFT : public Doer {
    * of the fully-transposed matrix, but laid out in memory in column-major
    * order.
    */
-  void PartialTranspose(complex_float* out_buf, size_t ant_id,
-                        SymbolType symbol_type) const;
+  void PartialTranspose(const complex_float* fft_out, complex_float* out_buf,
+                        size_t ant_id, SymbolType symbol_type) const;
 
  private:
+  /// PartialTranspose() for the antenna geometry [Geometry]
+  template <typename Geometry>
+  void PartialTransposeImpl(const complex_float* fft_out,
+                            complex_float* out_buf, size_t ant_id,
+                            SymbolType symbol_type) const;
+
+  /// Convert the received samples of [pkt] to floats in [fft_in]
+  void ConvertInput(Packet* pkt, SymbolType sym_type, complex_float* fft_in);
+
+  /// Consume the FFT output of [pkt]: channel estimation for pilots, partial
+  /// transpose into the data or calibration buffers otherwise
+  void ProcessOutput(Packet* pkt, SymbolType sym_type, complex_float* fft_out);
+
+  DurationStat* GetDurationStat(SymbolType sym_type);
+
+  // Only caches which instantiation matches the geometry
+  mutable GeometrySpecialized<void (DoFFT::*)(
+      const complex_float*, complex_float*, size_t, SymbolType) const>
+      partial_transpose_;
   Table<complex_float>& data_buffer_;
   PtrGrid<kFrameWnd, kMaxUEs, complex_float>& csi_buffers_;
   Table<complex_float>& calib_dl_buffer_;
   Table<complex_float>& calib_ul_buffer_;
-  DFTI_DESCRIPTOR_HANDLE mkl_handle_;
+  std::unique_ptr<FftPlan> fft_plan_;
   complex_float* fft_inout_;  // Buffer for both FFT input and output
 
+  // Data-subcarrier-only FFT for uplink data symbols. Null if FFT pruning is
+  // disabled. Pilot and calibration symbols always use the full FFT because
+  // their SNR estimates read the guard subcarriers.
+  std::unique_ptr<PrunedFft> pruned_fft_;
+
+  // Batched FFT plans, where batch_fft_plans_[i] transforms i + 1 antennas,
+  // and the matching FftBlockSize x OfdmCaNum buffer. Empty and null if
+  // batched FFT is disabled.
+  std::vector<std::unique_ptr<FftPlan>> batch_fft_plans_;
+  complex_float* fft_batch_buffer_ = nullptr;
+
   // Buffer for store 16-bit IQ converted from 12-bit IQ
   uint16_t* temp_16bits_iq_;
   std::complex<float>* rx_samps_tmp_;  // Temp buffer for received samples
 
   DurationStat* duration_stat_fft_;
   DurationStat* duration_stat_csi_;
+  DurationStat dummy_duration_stat_;  // For calibration symbols
   PhyStats* phy_stats_;
 };
 
@@ -19,12 +19,15 @@ DoIFFT::DoIFFT(Config* in_config, int in_tid,
       dl_ifft_buffer_(in_dl_ifft_buffer),
       dl_socket_buffer_(in_dl_socket_buffer) {
   duration_stat_ = in_stats_manager->GetDurationStat(DoerType::kIFFT, in_tid);
-  DftiCreateDescriptor(&mkl_handle_, DFTI_SINGLE, DFTI_COMPLEX, 1,
-                       cfg_->OfdmCaNum());
-  if (kUseOutOfPlaceIFFT) {
-    DftiSetValue(mkl_handle_, DFTI_PLACEMENT, DFTI_NOT_INPLACE);
+  fft_plan_ = FftPlan::Create(FftDirection::kBackward, cfg_->OfdmCaNum(),
+                              !kUseOutOfPlaceIFFT, cfg_->FftBackend());
+
+  if (cfg_->FftPruning()) {
+    pruned_ifft_ = std::make_unique<PrunedFft>(
+        PrunedFft::FftDirection::kBackward, cfg_->OfdmCaNum(),
+        cfg_->OfdmDataStart(), cfg_->OfdmDataNum(),
+        cfg_->FftPruningDecimation(), cfg_->FftBackend());
   }
-  DftiCommitDescriptor(mkl_handle_);
 
   // Aligned for SIMD
   ifft_out_ = static_cast<float*>(
@@ -33,10 +36,7 @@ DoIFFT::DoIFFT(Config* in_config, int in_tid,
   ifft_scale_factor_ = cfg_->OfdmCaNum() / std::sqrt(cfg_->BfAntNum() * 1.f);
 }
 
-DoIFFT::~DoIFFT() {
-  DftiFreeDescriptor(&mkl_handle_);
-  std::free(ifft_out_);
-}
+DoIFFT::~DoIFFT() { std::free(ifft_out_); }
 
 EventData DoIFFT::Launch(size_t tag) {
   size_t start_tsc = GetTime::WorkerRdtsc();
@@ -61,27 +61,35 @@ EventData DoIFFT::Launch(size_t tag) {
 
   auto* ifft_in_ptr = reinterpret_cast<float*>(dl_ifft_buffer_[offset]);
   auto* ifft_out_ptr =
-      (kUseOutOfPlaceIFFT || kMemcpyBeforeIFFT) ? ifft_out_ : ifft_in_ptr;
-
-  if (kMemcpyBeforeIFFT) {
+      (pruned_ifft_ != nullptr || kUseOutOfPlaceIFFT || kMemcpyBeforeIFFT)
+          ? ifft_out_
+          : ifft_in_ptr;
+
+  if (pruned_ifft_ != nullptr) {
+    // Guard subcarriers are never read, so they need not be zeroed
+    pruned_ifft_->Backward(
+        dl_ifft_buffer_[offset] + cfg_->OfdmDataStart(),
+        reinterpret_cast<complex_float*>(ifft_out_ptr));
+  } else if (kMemcpyBeforeIFFT) {
     std::memset(ifft_out_ptr, 0, sizeof(float) * cfg_->OfdmDataStart() * 2);
     std::memset(ifft_out_ptr + (cfg_->OfdmDataStop() * 2), 0,
                 sizeof(float) * cfg_->OfdmDataStart() * 2);
     std::memcpy(ifft_out_ptr + (cfg_->OfdmDataStart() * 2),
                 ifft_in_ptr + (cfg_->OfdmDataStart() * 2),
                 sizeof(float) * cfg_->OfdmDataNum() * 2);
-    DftiComputeBackward(mkl_handle_, ifft_out_ptr);
+    fft_plan_->Execute(reinterpret_cast<complex_float*>(ifft_out_ptr));
   } else {
     if (kUseOutOfPlaceIFFT) {
       // Use out-of-place IFFT here is faster than in place IFFT
       // There is no need to reset non-data subcarriers in ifft input
       // to 0 since their values are not changed after IFFT
-      DftiComputeBackward(mkl_handle_, ifft_in_ptr, ifft_out_ptr);
+      fft_plan_->Execute(reinterpret_cast<complex_float*>(ifft_in_ptr),
+                         reinterpret_cast<complex_float*>(ifft_out_ptr));
     } else {
       std::memset(ifft_in_ptr, 0, sizeof(float) * cfg_->OfdmDataStart() * 2);
       std::memset(ifft_in_ptr + (cfg_->OfdmDataStop()) * 2, 0,
                   sizeof(float) * cfg_->OfdmDataStart() * 2);
-      DftiComputeBackward(mkl_handle_, ifft_in_ptr);
+      fft_plan_->Execute(reinterpret_cast<complex_float*>(ifft_in_ptr));
     }
   }
 
@@ -7,15 +7,17 @@
 
 #include <armadillo>
 #include <iostream>
+#include <memory>
 #include <vector>
 
 #include "buffer.h"
 #include "concurrentqueue.h"
 #include "config.h"
 #include "doer.h"
+#include "fft_backend.h"
 #include "gettime.h"
-#include "mkl_dfti.h"
 #include "phy_stats.h"
+#include "pruned_fft.h"
 #include "stats.h"
 #include "symbols.h"
 
@@ -54,8 +56,12 @@ class DoIFFT : public Doer {
   Table<complex_float>& dl_ifft_buffer_;
   char* dl_socket_buffer_;
   DurationStat* duration_stat_;
-  DFTI_DESCRIPTOR_HANDLE mkl_handle_;
+  std::unique_ptr<FftPlan> fft_plan_;
   float* ifft_out_;  // Buffer for IFFT output
+
+  // IFFT that only reads the data subcarriers. Null if FFT pruning is
+  // disabled.
+  std::unique_ptr<PrunedFft> pruned_ifft_;
   float ifft_scale_factor_;
 };
 
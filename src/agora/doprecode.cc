@@ -7,24 +7,33 @@
 #include "concurrent_queue_wrapper.h"
 
 static constexpr bool kUseSpatialLocality = true;
+// If true, each cacheline of precoded subcarriers is block-transposed in
+// registers and streamed straight into dl_ifft_buffer_ right after it is
+// computed, instead of gathering the whole block from precoded_buffer_temp_
+// in a separate pass. Requires kUseSpatialLocality.
+static constexpr bool kUseFusedScatter = true;
+static constexpr bool kFusedScatter = kUseSpatialLocality && kUseFusedScatter;
 
 DoPrecode::DoPrecode(
     Config* in_config, int in_tid,
     PtrGrid<kFrameWnd, kMaxDataSCs, complex_float>& dl_zf_matrices,
     Table<complex_float>& in_dl_ifft_buffer,
     Table<int8_t>& dl_encoded_or_raw_data /* Encoded if LDPC is enabled */,
-    Stats* in_stats_manager)
+    Stats* in_stats_manager, Table<complex_float>* dl_modulated_buffer)
     : Doer(in_config, in_tid),
       dl_zf_matrices_(dl_zf_matrices),
       dl_ifft_buffer_(in_dl_ifft_buffer),
-      dl_raw_data_(dl_encoded_or_raw_data) {
+      dl_raw_data_(dl_encoded_or_raw_data),
+      dl_modulated_buffer_(dl_modulated_buffer) {
   duration_stat_ =
       in_stats_manager->GetDurationStat(DoerType::kPrecode, in_tid);
 
   AllocBuffer1d(&modulated_buffer_temp_, kSCsPerCacheline * cfg_->UeAntNum(),
                 Agora_memory::Alignment_t::kAlign64, 0);
+  // The fused path only keeps one cacheline of subcarriers in flight
   AllocBuffer1d(&precoded_buffer_temp_,
-                cfg_->DemulBlockSize() * cfg_->BsAntNum(),
+                (kFusedScatter ? kSCsPerCacheline : cfg_->DemulBlockSize()) *
+                    cfg_->BsAntNum(),
                 Agora_memory::Alignment_t::kAlign64, 0);
 
 #if USE_MKL_JIT
@@ -62,6 +71,15 @@ DoPrecode::~DoPrecode() {
 }
 
 EventData DoPrecode::Launch(size_t tag) {
+  auto launch = launch_.Get(cfg_, [](auto geometry) {
+    return &DoPrecode::LaunchImpl<typename decltype(geometry)::Type>;
+  });
+  return (this->*launch)(tag);
+}
+
+template <typename Geometry>
+EventData DoPrecode::LaunchImpl(size_t tag) {
+  const Geometry geo(cfg_);
   size_t start_tsc = GetTime::WorkerRdtsc();
   const size_t frame_id = gen_tag_t(tag).frame_id_;
   const size_t base_sc_id = gen_tag_t(tag).sc_id_;
@@ -101,52 +119,78 @@ EventData DoPrecode::Launch(size_t tag) {
   if (kUseSpatialLocality) {
     for (size_t i = 0; i < max_sc_ite; i = i + kSCsPerCacheline) {
       size_t start_tsc1 = GetTime::WorkerRdtsc();
-      for (size_t user_id = 0; user_id < cfg_->UeAntNum(); user_id++) {
-        for (size_t j = 0; j < kSCsPerCacheline; j++) {
-          LoadInputData(symbol_idx_dl, total_data_symbol_idx, user_id,
-                        base_sc_id + i + j, j);
+      if (dl_modulated_buffer_ == nullptr) {
+        for (size_t user_id = 0; user_id < geo.UeAntNum(); user_id++) {
+          for (size_t j = 0; j < kSCsPerCacheline; j++) {
+            LoadInputData(symbol_idx_dl, total_data_symbol_idx, user_id,
+                          base_sc_id + i + j, j);
+          }
         }
       }
 
       size_t start_tsc2 = GetTime::WorkerRdtsc();
       duration_stat_->task_duration_[1] += start_tsc2 - start_tsc1;
       for (size_t j = 0; j < kSCsPerCacheline; j++) {
-        PrecodingPerSc(frame_slot, base_sc_id + i + j, i + j);
+        const size_t cur_sc_id = base_sc_id + i + j;
+        PrecodingPerSc(frame_slot, cur_sc_id, i + j,
+                       InputData(total_data_symbol_idx, cur_sc_id, i + j),
+                       geo);
       }
       duration_stat_->task_count_ =
           duration_stat_->task_count_ + kSCsPerCacheline;
-      duration_stat_->task_duration_[2] += GetTime::WorkerRdtsc() - start_tsc2;
+      size_t start_tsc3 = GetTime::WorkerRdtsc();
+      duration_stat_->task_duration_[2] += start_tsc3 - start_tsc2;
+
+      if (kFusedScatter) {
+        ScatterCachelineToIfft(total_data_symbol_idx, base_sc_id + i, geo);
+        duration_stat_->task_duration_[3] +=
+            GetTime::WorkerRdtsc() - start_tsc3;
+      }
     }
   } else {
     for (size_t i = 0; i < max_sc_ite; i++) {
       size_t start_tsc1 = GetTime::WorkerRdtsc();
       int cur_sc_id = base_sc_id + i;
-      for (size_t user_id = 0; user_id < cfg_->UeAntNum(); user_id++) {
-        LoadInputData(symbol_idx_dl, total_data_symbol_idx, user_id, cur_sc_id,
-                      0);
+      if (dl_modulated_buffer_ == nullptr) {
+        for (size_t user_id = 0; user_id < geo.UeAntNum(); user_id++) {
+          LoadInputData(symbol_idx_dl, total_data_symbol_idx, user_id,
+                        cur_sc_id, 0);
+        }
       }
       size_t start_tsc2 = GetTime::WorkerRdtsc();
       duration_stat_->task_duration_[1] += start_tsc2 - start_tsc1;
 
-      PrecodingPerSc(frame_slot, cur_sc_id, i);
+      PrecodingPerSc(frame_slot, cur_sc_id, i,
+                     InputData(total_data_symbol_idx, cur_sc_id, i), geo);
       duration_stat_->task_count_++;
       duration_stat_->task_duration_[2] += GetTime::WorkerRdtsc() - start_tsc2;
     }
   }
 
+  if (kFusedScatter) {
+    duration_stat_->task_duration_[0] += GetTime::WorkerRdtsc() - start_tsc;
+    if (kDebugPrintInTask) {
+      std::printf(
+          "In doPrecode thread %d: finished frame: %zu, symbol: %zu, "
+          "subcarrier: %zu\n",
+          tid_, frame_id, symbol_id, base_sc_id);
+    }
+    return EventData(EventType::kPrecode, tag);
+  }
+
   size_t start_tsc3 = GetTime::WorkerRdtsc();
 
-  __m256i index = _mm256_setr_epi64x(0, cfg_->BsAntNum(), cfg_->BsAntNum() * 2,
-                                     cfg_->BsAntNum() * 3);
+  __m256i index = _mm256_setr_epi64x(0, geo.BsAntNum(), geo.BsAntNum() * 2,
+                                     geo.BsAntNum() * 3);
   auto* precoded_ptr = reinterpret_cast<float*>(precoded_buffer_temp_);
-  for (size_t ant_id = 0; ant_id < cfg_->BsAntNum(); ant_id++) {
-    int ifft_buffer_offset = ant_id + cfg_->BsAntNum() * total_data_symbol_idx;
+  for (size_t ant_id = 0; ant_id < geo.BsAntNum(); ant_id++) {
+    int ifft_buffer_offset = ant_id + geo.BsAntNum() * total_data_symbol_idx;
     auto* ifft_ptr = reinterpret_cast<float*>(
         &dl_ifft_buffer_[ifft_buffer_offset]
                         [base_sc_id + cfg_->OfdmDataStart()]);
     for (size_t i = 0; i < cfg_->DemulBlockSize() / 4; i++) {
       float* input_shifted_ptr =
-          precoded_ptr + 4 * i * 2 * cfg_->BsAntNum() + ant_id * 2;
+          precoded_ptr + 4 * i * 2 * geo.BsAntNum() + ant_id * 2;
       __m256d t_data = _mm256_i64gather_pd(
           reinterpret_cast<double*>(input_shifted_ptr), index, 8);
       _mm256_stream_pd(reinterpret_cast<double*>(ifft_ptr + i * 8), t_data);
@@ -180,28 +224,93 @@ void DoPrecode::LoadInputData(size_t symbol_idx_dl,
   }
 }
 
+const complex_float* DoPrecode::InputData(size_t total_data_symbol_idx,
+                                          size_t sc_id, size_t sc_id_in_block) {
+  if (dl_modulated_buffer_ != nullptr) {
+    return (*dl_modulated_buffer_)[total_data_symbol_idx] +
+           sc_id * cfg_->UeAntNum();
+  }
+  return modulated_buffer_temp_ +
+         (kUseSpatialLocality
+              ? (sc_id_in_block % kSCsPerCacheline * cfg_->UeAntNum())
+              : 0);
+}
+
+template <typename Geometry>
 void DoPrecode::PrecodingPerSc(size_t frame_slot, size_t sc_id,
-                               size_t sc_id_in_block) {
+                               size_t sc_id_in_block,
+                               const complex_float* data_ptr_in,
+                               const Geometry& geo) {
   auto* precoder_ptr = reinterpret_cast<arma::cx_float*>(
       dl_zf_matrices_[frame_slot][cfg_->GetZfScId(sc_id)]);
   auto* data_ptr = reinterpret_cast<arma::cx_float*>(
-      modulated_buffer_temp_ +
-      (kUseSpatialLocality
-           ? (sc_id_in_block % kSCsPerCacheline * cfg_->UeAntNum())
-           : 0));
+      const_cast<complex_float*>(data_ptr_in));
   auto* precoded_ptr = reinterpret_cast<arma::cx_float*>(
-      precoded_buffer_temp_ + sc_id_in_block * cfg_->BsAntNum());
+      precoded_buffer_temp_ +
+      (kFusedScatter ? (sc_id_in_block % kSCsPerCacheline) : sc_id_in_block) *
+          geo.BsAntNum());
+  if constexpr (Geometry::kFixed) {
+    CxMatVecFixed<Geometry::BsAntNum(), Geometry::UeAntNum()>(
+        reinterpret_cast<const complex_float*>(precoder_ptr),
+        reinterpret_cast<const complex_float*>(data_ptr),
+        reinterpret_cast<complex_float*>(precoded_ptr));
+  } else {
 #if USE_MKL_JIT
-  my_cgemm_(jitter_, (MKL_Complex8*)precoder_ptr, (MKL_Complex8*)data_ptr,
-            (MKL_Complex8*)precoded_ptr);
+    my_cgemm_(jitter_, (MKL_Complex8*)precoder_ptr, (MKL_Complex8*)data_ptr,
+              (MKL_Complex8*)precoded_ptr);
 #else
-  arma::cx_fmat mat_precoder(precoder_ptr, cfg_->BsAntNum(), cfg_->UeAntNum(),
-                             false);
-  arma::cx_fmat mat_data(data_ptr, cfg_->UeAntNum(), 1, false);
-  arma::cx_fmat mat_precoded(precoded_ptr, cfg_->BsAntNum(), 1, false);
-  mat_precoded = mat_precoder * mat_data;
-  // cout << "Precoder: \n" << mat_precoder << endl;
-  // cout << "Data: \n" << mat_data << endl;
-  // cout << "Precoded data: \n" << mat_precoded << endl;
+    arma::cx_fmat mat_precoder(precoder_ptr, geo.BsAntNum(), geo.UeAntNum(),
+                               false);
+    arma::cx_fmat mat_data(data_ptr, geo.UeAntNum(), 1, false);
+    arma::cx_fmat mat_precoded(precoded_ptr, geo.BsAntNum(), 1, false);
+    mat_precoded = mat_precoder * mat_data;
 #endif
+  }
+}
+
+template <typename Geometry>
+void DoPrecode::ScatterCachelineToIfft(size_t total_data_symbol_idx,
+                                       size_t sc_id, const Geometry& geo) {
+  const size_t bs_ant_num = geo.BsAntNum();
+  const size_t ifft_sc_offset = sc_id + cfg_->OfdmDataStart();
+  const size_t ifft_row_base = bs_ant_num * total_data_symbol_idx;
+  // One complex float is moved as one double lane
+  const auto* precoded_ptr = reinterpret_cast<double*>(precoded_buffer_temp_);
+
+  // Transpose 4 subcarriers x 4 antennas at a time. Rows of the input are
+  // subcarriers (antenna-contiguous), rows of the output are antennas.
+  size_t ant_id = 0;
+  for (; ant_id + 4 <= bs_ant_num; ant_id += 4) {
+    double* ifft_ptr[4];
+    for (size_t k = 0; k < 4; k++) {
+      ifft_ptr[k] = reinterpret_cast<double*>(
+          &dl_ifft_buffer_[ifft_row_base + ant_id + k][ifft_sc_offset]);
+    }
+    for (size_t j = 0; j < kSCsPerCacheline; j += 4) {
+      const double* src = precoded_ptr + j * bs_ant_num + ant_id;
+      __m256d r0 = _mm256_loadu_pd(src);
+      __m256d r1 = _mm256_loadu_pd(src + bs_ant_num);
+      __m256d r2 = _mm256_loadu_pd(src + 2 * bs_ant_num);
+      __m256d r3 = _mm256_loadu_pd(src + 3 * bs_ant_num);
+
+      __m256d t0 = _mm256_unpacklo_pd(r0, r1);
+      __m256d t1 = _mm256_unpackhi_pd(r0, r1);
+      __m256d t2 = _mm256_unpacklo_pd(r2, r3);
+      __m256d t3 = _mm256_unpackhi_pd(r2, r3);
+
+      _mm256_stream_pd(ifft_ptr[0] + j, _mm256_permute2f128_pd(t0, t2, 0x20));
+      _mm256_stream_pd(ifft_ptr[1] + j, _mm256_permute2f128_pd(t1, t3, 0x20));
+      _mm256_stream_pd(ifft_ptr[2] + j, _mm256_permute2f128_pd(t0, t2, 0x31));
+      _mm256_stream_pd(ifft_ptr[3] + j, _mm256_permute2f128_pd(t1, t3, 0x31));
+    }
+  }
+
+  // Remaining antennas when BsAntNum() is not a multiple of 4
+  for (; ant_id < bs_ant_num; ant_id++) {
+    complex_float* ifft_ptr =
+        &dl_ifft_buffer_[ifft_row_base + ant_id][ifft_sc_offset];
+    for (size_t j = 0; j < kSCsPerCacheline; j++) {
+      ifft_ptr[j] = precoded_buffer_temp_[j * bs_ant_num + ant_id];
+    }
+  }
 }
@@ -13,18 +13,24 @@
 #include "concurrentqueue.h"
 #include "config.h"
 #include "doer.h"
+#include "doer_geometry.h"
 #include "gettime.h"
 #include "memory_manage.h"
 #include "modulation.h"
 #include "stats.h"
 #include "symbols.h"
 
+#if USE_MKL_JIT
+#include <mkl.h>
+#endif
+
 class DoPrecode : public Doer {
  public:
   DoPrecode(Config* in_config, int in_tid,
             PtrGrid<kFrameWnd, kMaxDataSCs, complex_float>& dl_zf_matrices_,
             Table<complex_float>& in_dl_ifft_buffer,
-            Table<int8_t>& dl_encoded_or_raw_data, Stats* in_stats_manager);
+            Table<int8_t>& dl_encoded_or_raw_data, Stats* in_stats_manager,
+            Table<complex_float>* dl_modulated_buffer = nullptr);
   ~DoPrecode() override;
 
   /**
@@ -58,12 +64,34 @@ class DoPrecode : public Doer {
   // Load input data for a single UE and a single subcarrier
   void LoadInputData(size_t symbol_idx_dl, size_t total_data_symbol_idx,
                      size_t user_id, size_t sc_id, size_t sc_id_in_block);
-  void PrecodingPerSc(size_t frame_slot, size_t sc_id, size_t sc_id_in_block);
-
  private:
+  /// Launch() for the antenna geometry [Geometry]
+  template <typename Geometry>
+  EventData LaunchImpl(size_t tag);
+
+  // Return the modulated symbols of all UEs for subcarrier [sc_id]: in place
+  // in dl_modulated_buffer_ if modulation is fused with encoding, else in
+  // modulated_buffer_temp_ as filled in by LoadInputData()
+  const complex_float* InputData(size_t total_data_symbol_idx, size_t sc_id,
+                                 size_t sc_id_in_block);
+
+  template <typename Geometry>
+  void PrecodingPerSc(size_t frame_slot, size_t sc_id, size_t sc_id_in_block,
+                      const complex_float* data_ptr, const Geometry& geo);
+
+  // Block-transpose one cacheline of precoded subcarriers (starting at sc_id)
+  // from precoded_buffer_temp_ into the per-antenna rows of dl_ifft_buffer_
+  template <typename Geometry>
+  void ScatterCachelineToIfft(size_t total_data_symbol_idx, size_t sc_id,
+                              const Geometry& geo);
+
+  GeometrySpecialized<EventData (DoPrecode::*)(size_t)> launch_;
   PtrGrid<kFrameWnd, kMaxDataSCs, complex_float>& dl_zf_matrices_;
   Table<complex_float>& dl_ifft_buffer_;
   Table<int8_t>& dl_raw_data_;
+  // Modulated symbols written by DoEncode, or null if modulation is not
+  // fused with encoding
+  Table<complex_float>* dl_modulated_buffer_;
   Table<float> qam_table_;
   DurationStat* duration_stat_;
   complex_float* modulated_buffer_temp_;
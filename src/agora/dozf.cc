@@ -73,10 +73,19 @@ DoZF::~DoZF() {
 }
 
 EventData DoZF::Launch(size_t tag) {
+  auto launch = launch_.Get(cfg_, [](auto geometry) {
+    return &DoZF::LaunchImpl<typename decltype(geometry)::Type>;
+  });
+  return (this->*launch)(tag);
+}
+
+template <typename Geometry>
+EventData DoZF::LaunchImpl(size_t tag) {
+  const Geometry geo(cfg_);
   if (cfg_->FreqOrthogonalPilot()) {
-    ZfFreqOrthogonal(tag);
+    ZfFreqOrthogonal(tag, geo);
   } else {
-    ZfTimeOrthogonal(tag);
+    ZfTimeOrthogonal(tag, geo);
   }
 
   return EventData(EventType::kZF, tag);
@@ -224,9 +233,11 @@ void DoZF::ComputeCalib(size_t frame_id, size_t sc_id) {
 
 // Gather data of one symbol from partially-transposed buffer
 // produced by dofft
+template <typename Geometry>
 static inline void PartialTransposeGather(size_t cur_sc_id, float* src,
-                                          float*& dst, size_t bs_ant_num) {
+                                          float*& dst, const Geometry& geo) {
   // The SIMD and non-SIMD methods are equivalent.
+  const size_t bs_ant_num = geo.BsAntNum();
 
 #ifdef __AVX512F__
   static constexpr size_t kAntNumPerSimd = 8;
@@ -301,7 +312,8 @@ static inline void TransposeGather(size_t cur_sc_id, float* src, float*& dst,
   }
 }
 
-void DoZF::ZfTimeOrthogonal(size_t tag) {
+template <typename Geometry>
+void DoZF::ZfTimeOrthogonal(size_t tag, const Geometry& geo) {
   const size_t frame_id = gen_tag_t(tag).frame_id_;
   const size_t base_sc_id = gen_tag_t(tag).sc_id_;
   const size_t frame_slot = frame_id % kFrameWnd;
@@ -318,24 +330,24 @@ void DoZF::ZfTimeOrthogonal(size_t tag) {
     const size_t cur_sc_id = base_sc_id + i;
 
     // Gather CSI matrices of each pilot from partially-transposed CSIs.
-    for (size_t ue_idx = 0; ue_idx < cfg_->UeAntNum(); ue_idx++) {
+    for (size_t ue_idx = 0; ue_idx < geo.UeAntNum(); ue_idx++) {
       auto* dst_csi_ptr = reinterpret_cast<float*>(csi_gather_buffer_ +
-                                                   cfg_->BsAntNum() * ue_idx);
+                                                   geo.BsAntNum() * ue_idx);
       if (kUsePartialTrans) {
         PartialTransposeGather(cur_sc_id,
                                (float*)csi_buffers_[frame_slot][ue_idx],
-                               dst_csi_ptr, cfg_->BsAntNum());
+                               dst_csi_ptr, geo);
       } else {
         TransposeGather(cur_sc_id, (float*)csi_buffers_[frame_slot][ue_idx],
-                        dst_csi_ptr, cfg_->BsAntNum(), cfg_->OfdmDataNum());
+                        dst_csi_ptr, geo.BsAntNum(), cfg_->OfdmDataNum());
       }
     }
 
     size_t start_tsc2 = GetTime::WorkerRdtsc();
     duration_stat_->task_duration_[1] += start_tsc2 - start_tsc1;
 
-    arma::cx_fmat mat_csi((arma::cx_float*)csi_gather_buffer_, cfg_->BsAntNum(),
-                          cfg_->UeAntNum(), false);
+    arma::cx_fmat mat_csi((arma::cx_float*)csi_gather_buffer_, geo.BsAntNum(),
+                          geo.UeAntNum(), false);
 
     if (cfg_->Frame().NumDLSyms() > 0) {
       ComputeCalib(frame_id, cur_sc_id);
@@ -363,7 +375,8 @@ void DoZF::ZfTimeOrthogonal(size_t tag) {
   }
 }
 
-void DoZF::ZfFreqOrthogonal(size_t tag) {
+template <typename Geometry>
+void DoZF::ZfFreqOrthogonal(size_t tag, const Geometry& geo) {
   const size_t frame_id = gen_tag_t(tag).frame_id_;
   const size_t base_sc_id = gen_tag_t(tag).sc_id_;
   const size_t frame_slot = frame_id % kFrameWnd;
@@ -371,19 +384,19 @@ void DoZF::ZfFreqOrthogonal(size_t tag) {
     std::printf(
         "In doZF thread %d: frame: %zu, subcarrier: %zu, block: %zu, "
         "Basestation ant number: %zu\n",
-        tid_, frame_id, base_sc_id, base_sc_id / cfg_->UeAntNum(),
-        cfg_->BsAntNum());
+        tid_, frame_id, base_sc_id, base_sc_id / geo.UeAntNum(),
+        geo.BsAntNum());
   }
 
   double start_tsc1 = GetTime::WorkerRdtsc();
 
   // Gather CSIs from partially-transposed CSIs
-  for (size_t i = 0; i < cfg_->UeAntNum(); i++) {
+  for (size_t i = 0; i < geo.UeAntNum(); i++) {
     const size_t cur_sc_id = base_sc_id + i;
     auto* dst_csi_ptr =
-        reinterpret_cast<float*>(csi_gather_buffer_ + cfg_->BsAntNum() * i);
+        reinterpret_cast<float*>(csi_gather_buffer_ + geo.BsAntNum() * i);
     PartialTransposeGather(cur_sc_id, (float*)csi_buffers_[frame_slot][0],
-                           dst_csi_ptr, cfg_->BsAntNum());
+                           dst_csi_ptr, geo);
   }
 
   size_t start_tsc2 = GetTime::WorkerRdtsc();
@@ -429,7 +442,7 @@ void DoZF::ZfFreqOrthogonal(size_t tag) {
   duration_stat_->task_duration_[2] += start_tsc3 - start_tsc2;
 
   arma::cx_fmat mat_csi(reinterpret_cast<arma::cx_float*>(csi_gather_buffer_),
-                        cfg_->BsAntNum(), cfg_->UeAntNum(), false);
+                        geo.BsAntNum(), geo.UeAntNum(), false);
 
   ComputePrecoder(mat_csi, calib_gather_buffer_,
                   ul_zf_matrices_[frame_slot][cfg_->GetZfScId(base_sc_id)],
@@ -12,6 +12,7 @@
 #include "concurrentqueue.h"
 #include "config.h"
 #include "doer.h"
+#include "doer_geometry.h"
 #include "gettime.h"
 #include "phy_stats.h"
 #include "stats.h"
@@ -50,14 +51,20 @@ class DoZF : public Doer {
   EventData Launch(size_t tag) override;
 
  private:
-  void ZfTimeOrthogonal(size_t tag);
+  /// Launch() for the antenna geometry [Geometry]
+  template <typename Geometry>
+  EventData LaunchImpl(size_t tag);
+
+  template <typename Geometry>
+  void ZfTimeOrthogonal(size_t tag, const Geometry& geo);
 
   /// Compute the uplink zeroforcing detector matrix and/or the downlink
   /// zeroforcing precoder using this CSI matrix and calibration buffer
   float ComputePrecoder(const arma::cx_fmat& mat_csi, complex_float* calib_ptr,
                         complex_float* mat_ul_zf, complex_float* mat_dl_zf);
   void ComputeCalib(size_t frame_id, size_t sc_id);
-  void ZfFreqOrthogonal(size_t tag);
+  template <typename Geometry>
+  void ZfFreqOrthogonal(size_t tag, const Geometry& geo);
 
   /**
    * Do prediction task for one subcarrier
@@ -83,6 +90,7 @@ class DoZF : public Doer {
    */
   void Predict(size_t offset);
 
+  GeometrySpecialized<EventData (DoZF::*)(size_t)> launch_;
   PtrGrid<kFrameWnd, kMaxUEs, complex_float>& csi_buffers_;
   complex_float* pred_csi_buffer_;
   Table<complex_float> calib_dl_buffer_;
@@ -4,6 +4,7 @@
  */
 #include "phy_stats.h"
 
+#include <algorithm>
 #include <cfloat>
 #include <cmath>
 
@@ -55,6 +56,18 @@ PhyStats::PhyStats(Config* const cfg, Direction dir) : config_(cfg), dir_(dir) {
                           Agora_memory::Alignment_t::kAlign64);
   csi_cond_.Calloc(kFrameWnd, cfg->OfdmDataNum(),
                    Agora_memory::Alignment_t::kAlign64);
+
+  num_iter_bins_ = cfg->LdpcConfig().MaxDecoderIter() + 1;
+  decoder_iter_hist_ = std::make_unique<std::atomic<size_t>[]>(
+      cfg->UeAntNum() * num_iter_bins_);
+  budget_limited_count_ =
+      std::make_unique<std::atomic<size_t>[]>(cfg->UeAntNum());
+  for (size_t i = 0; i < cfg->UeAntNum() * num_iter_bins_; i++) {
+    decoder_iter_hist_[i] = 0;
+  }
+  for (size_t i = 0; i < cfg->UeAntNum(); i++) {
+    budget_limited_count_[i] = 0;
+  }
 }
 
 PhyStats::~PhyStats() {
@@ -106,6 +119,31 @@ void PhyStats::PrintPhyStats() {
   }
 }
 
+void PhyStats::PrintDecoderIterStats() {
+  for (size_t ue_id = 0; ue_id < this->config_->UeAntNum(); ue_id++) {
+    const std::atomic<size_t>* hist =
+        &decoder_iter_hist_[ue_id * num_iter_bins_];
+    size_t total_blocks = 0;
+    size_t total_iters = 0;
+    for (size_t i = 0; i < num_iter_bins_; i++) {
+      total_blocks += hist[i].load();
+      total_iters += i * hist[i].load();
+    }
+    if (total_blocks == 0) {
+      continue;
+    }
+    std::stringstream ss;
+    ss << "UE " << ue_id << ": LDPC iterations (avg "
+       << 1.0 * total_iters / total_blocks << ", "
+       << budget_limited_count_[ue_id].load() << "/" << total_blocks
+       << " code blocks budget-limited):";
+    for (size_t i = 1; i < num_iter_bins_; i++) {
+      ss << " " << i << ":" << hist[i].load();
+    }
+    std::cout << ss.str() << std::endl;
+  }
+}
+
 void PhyStats::PrintEvmStats(size_t frame_id) {
   arma::fmat evm_mat(evm_buffer_[frame_id % kFrameWnd], config_->UeAntNum(), 1,
                      false);
@@ -122,6 +160,24 @@ float PhyStats::GetEvmSnr(size_t frame_id, size_t ue_id) {
   return -10 * std::log10(evm);
 }
 
+float PhyStats::GetPilotSnr(size_t frame_id, size_t ue_id) {
+  const float* frame_snr =
+      &pilot_snr_[frame_id % kFrameWnd][ue_id * config_->BsAntNum()];
+  float snr_sum = 0;
+  size_t num_ants = 0;
+  for (size_t j = 0; j < config_->BsAntNum(); j++) {
+    size_t radio_id = j / config_->NumChannels();
+    size_t cell_id = config_->CellId().at(radio_id);
+    if (config_->ExternalRefNode(cell_id) == true &&
+        radio_id == config_->RefRadio(cell_id)) {
+      continue;
+    }
+    snr_sum += std::pow(10.0f, frame_snr[j] / 10);
+    num_ants++;
+  }
+  return 10 * std::log10(snr_sum / num_ants);
+}
+
 void PhyStats::PrintSnrStats(size_t frame_id) {
   std::stringstream ss;
   ss << "Frame " << frame_id
@@ -300,6 +356,16 @@ void PhyStats::IncrementDecodedBlocks(size_t ue_id, size_t offset) {
   decoded_blocks_count_[ue_id][offset]++;
 }
 
+void PhyStats::UpdateDecoderIterations(size_t ue_id, size_t iterations,
+                                       bool budget_limited) {
+  const size_t bin = std::min(iterations, num_iter_bins_ - 1);
+  decoder_iter_hist_[ue_id * num_iter_bins_ + bin].fetch_add(
+      1, std::memory_order_relaxed);
+  if (budget_limited) {
+    budget_limited_count_[ue_id].fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
 void PhyStats::UpdateUncodedBitErrors(size_t ue_id, size_t offset,
                                       size_t mod_bit_size, uint8_t tx_byte,
                                       uint8_t rx_byte) {
@@ -6,6 +6,8 @@
 #define PHY_STATS_H_
 
 #include <armadillo>
+#include <atomic>
+#include <memory>
 
 #include "config.h"
 #include "memory_manage.h"
@@ -34,6 +36,10 @@ class PhyStats {
   float GetEvmSnr(size_t frame_id, size_t ue_id);
   void UpdatePilotSnr(size_t /*frame_id*/, size_t /*ue_id*/, size_t /*ant_id*/,
                       complex_float* /*fft_data*/);
+  /// Mean pilot SNR of [ue_id] over the BS antennas in dB, excluding
+  /// reference nodes. Only updated if kCollectPhyStats is set; not finite if
+  /// the measured noise floor is zero, as in noiseless simulations.
+  float GetPilotSnr(size_t frame_id, size_t ue_id);
   void PrintSnrStats(size_t /*frame_id*/);
   void UpdateCalibPilotSnr(size_t /*frame_id*/, size_t /*ue_id*/,
                            size_t /*ant_id*/, complex_float* /*fft_data*/);
@@ -41,6 +47,12 @@ class PhyStats {
   void UpdateCsiCond(size_t /*frame_id*/, size_t /*subcarrier_id*/,
                      float /*condition number*/);
   void PrintZfStats(size_t /*frame_id*/);
+  /// Count a code block of [ue_id] decoded in [iterations] LDPC iterations.
+  /// [budget_limited] is true if its iteration budget was cut below
+  /// decoderIter to meet the frame deadline.
+  void UpdateDecoderIterations(size_t ue_id, size_t iterations,
+                               bool budget_limited);
+  void PrintDecoderIterStats();
 
  private:
   Config const* const config_;
@@ -55,6 +67,11 @@ class PhyStats {
   Table<float> pilot_snr_;
   Table<float> calib_pilot_snr_;
   Table<float> csi_cond_;
+  // Histogram of LDPC iterations per code block, (max_iter + 1) bins per UE.
+  // Updated by all decoders concurrently.
+  size_t num_iter_bins_;
+  std::unique_ptr<std::atomic<size_t>[]> decoder_iter_hist_;
+  std::unique_ptr<std::atomic<size_t>[]> budget_limited_count_;
 
   arma::cx_fmat gt_mat_;
   size_t num_rx_symbols_;
@@ -14,7 +14,8 @@ Stats::Stats(const Config* const cfg)
       demul_thread_num_(cfg->DemulThreadNum()),
       decode_thread_num_(cfg->DecodeThreadNum()),
       freq_ghz_(cfg->FreqGhz()),
-      creation_tsc_(GetTime::Rdtsc()) {
+      creation_tsc_(GetTime::Rdtsc()),
+      master_timestamps_() {
   frame_start_.Calloc(config_->SocketThreadNum(), kNumStatsFrames,
                       Agora_memory::Alignment_t::kAlign64);
 }
@@ -330,8 +331,39 @@ size_t Stats::GetTotalTaskCount(DoerType doer_type, size_t thread_num) {
   return total_count;
 }
 
+void Stats::PrintDownlinkLatency() {
+  const size_t total_stat_frames =
+      std::min(this->last_frame_id_, kNumStatsFrames);
+  double total_us = 0;
+  double max_us = 0;
+  size_t num_frames = 0;
+  for (size_t i = 0; i < total_stat_frames; i++) {
+    const size_t mac_tsc = MasterGetTsc(TsType::kMacRXDone, i);
+    const size_t precode_tsc = MasterGetTsc(TsType::kPrecodeDone, i);
+    // Skip frames without downlink data or not yet precoded
+    if ((mac_tsc == 0) || (precode_tsc <= mac_tsc)) {
+      continue;
+    }
+    const double latency_us =
+        GetTime::CyclesToUs(precode_tsc - mac_tsc, this->freq_ghz_);
+    total_us += latency_us;
+    max_us = std::max(max_us, latency_us);
+    num_frames++;
+  }
+  if (num_frames > 0) {
+    std::printf(
+        "Stats: downlink MAC RX to precoding done (fused modulation %s): "
+        "mean %.1f us, max %.1f us over %zu frames\n",
+        config_->FusedDlModulation() ? "on" : "off", total_us / num_frames,
+        max_us, num_frames);
+  }
+}
+
 void Stats::PrintSummary() {
   std::printf("Stats: total processed frames %zu\n", this->last_frame_id_ + 1);
+  if ((kEnableMac == true) && (config_->Frame().NumDLSyms() > 0)) {
+    PrintDownlinkLatency();
+  }
   if (kIsWorkerTimingEnabled == false) {
     std::printf("Stats: Worker timing is disabled. Not printing summary\n");
   } else {
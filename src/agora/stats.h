@@ -52,6 +52,7 @@ enum class TsType : size_t {
   kTXDone,
   kModulDone,
   kFFTDone,
+  kMacRXDone,  // All MAC packets of a downlink frame received
   kTsTypeEnd
 };
 static constexpr size_t kNumTimestampTypes =
@@ -73,6 +74,10 @@ class Stats {
   /// If worker stats collection is enabled, prsize_t a summary of stats
   void PrintSummary();
 
+  /// Print the mean and maximum downlink latency from the arrival of a
+  /// frame's last MAC packet to the completion of its precoding
+  void PrintDownlinkLatency();
+
   /// From the master, set the RDTSC timestamp for a frame ID and timestamp
   /// type
   void MasterSetTsc(TsType timestamp_type, size_t frame_id) {
@@ -184,8 +184,8 @@ void PacketTXRX::LoopTxRx(size_t tid) {
     size_t local_port_id = cfg_->BsServerPort() + radio_id;
 
     udp_servers_.at(radio_id) =
-        std::make_unique<UDPServer>(local_port_id, kSockBufSize);
-    udp_clients_.at(radio_id) = std::make_unique<UDPClient>();
+        std::make_unique<PacketServer>(local_port_id, kSockBufSize);
+    udp_clients_.at(radio_id) = std::make_unique<PacketClient>();
     MLPD_FRAME(
         "TXRX thread %d: set up UDP socket server listening to port %d"
         " with remote address %s:%d \n",
@@ -20,10 +20,9 @@
 #include "concurrentqueue.h"
 #include "config.h"
 #include "gettime.h"
+#include "packet_transport.h"
 #include "radio_lib.h"
 #include "symbols.h"
-#include "udp_client.h"
-#include "udp_server.h"
 
 #if defined(USE_DPDK)
 #include "dpdk_transport.h"
@@ -142,8 +141,8 @@ class PacketTXRX {
   moodycamel::ProducerToken** rx_ptoks_;
   moodycamel::ProducerToken** tx_ptoks_;
 
-  std::vector<std::unique_ptr<UDPServer>> udp_servers_;
-  std::vector<std::unique_ptr<UDPClient>> udp_clients_;
+  std::vector<std::unique_ptr<PacketServer>> udp_servers_;
+  std::vector<std::unique_ptr<PacketClient>> udp_clients_;
 
   std::atomic<size_t> threads_started_;
 
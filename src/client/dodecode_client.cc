@@ -85,8 +85,7 @@ EventData DoDecodeClient::Launch(size_t tag) {
   size_t start_tsc1 = GetTime::WorkerRdtsc();
   duration_stat_->task_duration_[1] += start_tsc1 - start_tsc;
 
-  bblib_ldpc_decoder_5gnr(&ldpc_decoder_5gnr_request,
-                          &ldpc_decoder_5gnr_response);
+  LdpcDecodeHelper(&ldpc_decoder_5gnr_request, &ldpc_decoder_5gnr_response);
 
   if (cfg_->ScrambleEnabled()) {
     scrambler_->Descramble(decoded_buffer_ptr, cfg_->NumBytesPerCb());
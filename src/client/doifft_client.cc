@@ -22,12 +22,8 @@ DoIFFTClient::DoIFFTClient(Config* in_config, int in_tid,
       ifft_buffer_(in_ifft_buffer),
       socket_buffer_(in_socket_buffer) {
   duration_stat_ = in_stats_manager->GetDurationStat(DoerType::kIFFT, in_tid);
-  DftiCreateDescriptor(&mkl_handle_, DFTI_SINGLE, DFTI_COMPLEX, 1,
-                       cfg_->OfdmCaNum());
-  if (kUseOutOfPlaceIFFT) {
-    DftiSetValue(mkl_handle_, DFTI_PLACEMENT, DFTI_NOT_INPLACE);
-  }
-  DftiCommitDescriptor(mkl_handle_);
+  fft_plan_ = FftPlan::Create(FftDirection::kBackward, cfg_->OfdmCaNum(),
+                              !kUseOutOfPlaceIFFT, cfg_->FftBackend());
 
   // Aligned for SIMD
   ifft_out_ = static_cast<float*>(
@@ -37,10 +33,7 @@ DoIFFTClient::DoIFFTClient(Config* in_config, int in_tid,
   ifft_scale_factor_ = cfg_->OfdmCaNum() / std::sqrt(cfg_->BfAntNum() * 1.f);
 }
 
-DoIFFTClient::~DoIFFTClient() {
-  DftiFreeDescriptor(&mkl_handle_);
-  std::free(ifft_out_);
-}
+DoIFFTClient::~DoIFFTClient() { std::free(ifft_out_); }
 
 EventData DoIFFTClient::Launch(size_t tag) {
   size_t start_tsc = GetTime::WorkerRdtsc();
@@ -74,18 +67,19 @@ EventData DoIFFTClient::Launch(size_t tag) {
     std::memcpy(ifft_out_ptr + (cfg_->OfdmDataStart() * 2),
                 ifft_in_ptr + (cfg_->OfdmDataStart() * 2),
                 sizeof(float) * cfg_->OfdmDataNum() * 2);
-    DftiComputeBackward(mkl_handle_, ifft_out_ptr);
+    fft_plan_->Execute(reinterpret_cast<complex_float*>(ifft_out_ptr));
   } else {
     if (kUseOutOfPlaceIFFT) {
       // Use out-of-place IFFT here is faster than in place IFFT
       // There is no need to reset non-data subcarriers in ifft input
       // to 0 since their values are not changed after IFFT
-      DftiComputeBackward(mkl_handle_, ifft_in_ptr, ifft_out_ptr);
+      fft_plan_->Execute(reinterpret_cast<complex_float*>(ifft_in_ptr),
+                         reinterpret_cast<complex_float*>(ifft_out_ptr));
     } else {
       std::memset(ifft_in_ptr, 0, sizeof(float) * cfg_->OfdmDataStart() * 2);
       std::memset(ifft_in_ptr + (cfg_->OfdmDataStop()) * 2, 0,
                   sizeof(float) * cfg_->OfdmDataStart() * 2);
-      DftiComputeBackward(mkl_handle_, ifft_in_ptr);
+      fft_plan_->Execute(reinterpret_cast<complex_float*>(ifft_in_ptr));
     }
   }
 
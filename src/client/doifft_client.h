@@ -7,8 +7,8 @@
 
 #include "config.h"
 #include "doer.h"
+#include "fft_backend.h"
 #include "memory_manage.h"
-#include "mkl_dfti.h"
 #include "stats.h"
 #include "symbols.h"
 
@@ -48,7 +48,7 @@ class DoIFFTClient : public Doer {
   Table<complex_float>& ifft_buffer_;
   char* socket_buffer_;
   DurationStat* duration_stat_;
-  DFTI_DESCRIPTOR_HANDLE mkl_handle_;
+  std::unique_ptr<FftPlan> fft_plan_;
   float* ifft_out_;  // Buffer for IFFT output
   float ifft_scale_factor_;
 };
@@ -57,9 +57,23 @@ PhyUe::PhyUe(Config* config)
   complete_queue_ = moodycamel::ConcurrentQueue<EventData>(
       kFrameWnd * config_->Frame().NumTotalSyms() * config_->UeAntNum() *
       kDefaultQueueSize);
-  work_queue_ = moodycamel::ConcurrentQueue<EventData>(
-      kFrameWnd * config_->Frame().NumTotalSyms() * config_->UeAntNum() *
-      kDefaultQueueSize);
+  for (size_t i = 0; i < kNumUeEventTypes; i++) {
+    work_queues_.at(i) = moodycamel::ConcurrentQueue<EventData>(
+        kFrameWnd * config_->Frame().NumTotalSyms() * config_->UeAntNum() *
+        kDefaultQueueSize);
+    work_producer_tokens_.at(i) =
+        std::make_unique<moodycamel::ProducerToken>(work_queues_.at(i));
+    pending_work_.at(i) = EventData(static_cast<EventType>(i));
+    work_block_size_.at(i) = 1;
+  }
+  work_block_size_.at(static_cast<size_t>(EventType::kFFT)) =
+      config_->UeFftBlockSize();
+  work_block_size_.at(static_cast<size_t>(EventType::kFFTPilot)) =
+      config_->UeFftBlockSize();
+  work_block_size_.at(static_cast<size_t>(EventType::kDemul)) =
+      config_->UeDemulBlockSize();
+  work_block_size_.at(static_cast<size_t>(EventType::kDecode)) =
+      config_->UeDecodeBlockSize();
   tx_queue_ = moodycamel::ConcurrentQueue<EventData>(
       kFrameWnd * config_->UeAntNum() * kDefaultQueueSize);
   to_mac_queue_ = moodycamel::ConcurrentQueue<EventData>(
@@ -72,9 +86,6 @@ PhyUe::PhyUe(Config* config)
     mac_tx_ptoks_ptr_[i] = new moodycamel::ProducerToken(to_mac_queue_);
   }
 
-  work_producer_token_ =
-      std::make_unique<moodycamel::ProducerToken>(work_queue_);
-
   ru_ = std::make_unique<RadioTxRx>(
       config_, rx_thread_num_, config_->UeCoreOffset() + 1, &complete_queue_,
       &tx_queue_, rx_ptoks_ptr_, tx_ptoks_ptr_);
@@ -97,11 +108,10 @@ PhyUe::PhyUe(Config* config)
 
   for (size_t i = 0; i < config_->UeWorkerThreadNum(); i++) {
     auto new_worker = std::make_unique<UeWorker>(
-        i, *config_, *stats_, *phy_stats_, complete_queue_, work_queue_,
-        *work_producer_token_.get(), ul_bits_buffer_, ul_syms_buffer_,
-        modul_buffer_, ifft_buffer_, tx_buffer_, rx_buffer_, csi_buffer_,
-        equal_buffer_, non_null_sc_ind_, fft_buffer_, demod_buffer_,
-        decoded_buffer_, ue_pilot_vec_);
+        i, *config_, *stats_, *phy_stats_, complete_queue_, work_queues_,
+        ul_bits_buffer_, ul_syms_buffer_, modul_buffer_, ifft_buffer_,
+        tx_buffer_, rx_buffer_, csi_buffer_, equal_buffer_, non_null_sc_ind_,
+        fft_buffer_, demod_buffer_, decoded_buffer_, ue_pilot_vec_);
 
     new_worker->Start(core_offset_worker);
     workers_.push_back(std::move(new_worker));
@@ -112,7 +122,9 @@ PhyUe::PhyUe(Config* config)
   for (size_t frame = 0; frame < this->frame_tasks_.size(); frame++) {
     FrameInit(frame);
   }
-  decode_counters_.Init(dl_data_symbol_perframe_, config_->UeAntNum());
+  decode_counters_.Init(
+      dl_data_symbol_perframe_,
+      config_->UeAntNum() * config_->LdpcConfig().NumBlocksInSymbol());
   demul_counters_.Init(dl_data_symbol_perframe_, config_->UeAntNum());
   fft_dlpilot_counters_.Init(config->Frame().ClientDlPilotSymbols(),
                              config_->UeAntNum());
@@ -181,11 +193,32 @@ void PhyUe::ScheduleTask(EventData do_task,
   }
 }
 
-void PhyUe::ScheduleWork(EventData do_task) {
-  if (work_queue_.try_enqueue(*(work_producer_token_.get()), do_task) ==
-      false) {
+void PhyUe::ScheduleWork(EventType event_type, size_t tag) {
+  const size_t type_id = static_cast<size_t>(event_type);
+  EventData& pending = pending_work_.at(type_id);
+  pending.tags_.at(pending.num_tags_) = tag;
+  pending.num_tags_++;
+  if (pending.num_tags_ == work_block_size_.at(type_id)) {
+    EnqueueWork(pending);
+    pending.num_tags_ = 0;
+  }
+}
+
+void PhyUe::FlushWork() {
+  for (auto& pending : pending_work_) {
+    if (pending.num_tags_ > 0) {
+      EnqueueWork(pending);
+      pending.num_tags_ = 0;
+    }
+  }
+}
+
+void PhyUe::EnqueueWork(const EventData& do_task) {
+  const size_t type_id = static_cast<size_t>(do_task.event_type_);
+  moodycamel::ProducerToken& ptok = *work_producer_tokens_.at(type_id);
+  if (work_queues_.at(type_id).try_enqueue(ptok, do_task) == false) {
     std::printf("PhyUe: Cannot enqueue work task, need more memory");
-    if (work_queue_.enqueue(*(work_producer_token_.get()), do_task) == false) {
+    if (work_queues_.at(type_id).enqueue(ptok, do_task) == false) {
       std::printf("PhyUe: work task enqueue failed\n");
       throw std::runtime_error("PhyUe: work task enqueue failed");
     }
@@ -200,9 +233,9 @@ void PhyUe::ReceiveDownlinkSymbol(struct Packet* rx_packet, size_t tag) {
   // if symbol is a pilot or we are finished with all pilot ffts for the given
   // frame
   if (dl_symbol_idx < config_->Frame().ClientDlPilotSymbols()) {
-    ScheduleWork(EventData(EventType::kFFTPilot, tag));
+    ScheduleWork(EventType::kFFTPilot, tag);
   } else if (fft_dlpilot_counters_.IsLastSymbol(rx_packet->frame_id_)) {
-    ScheduleWork(EventData(EventType::kFFT, tag));
+    ScheduleWork(EventType::kFFT, tag);
   } else {
     std::queue<EventData>* defferal_queue =
         &rx_downlink_deferral_.at(frame_slot);
@@ -230,7 +263,8 @@ void PhyUe::ScheduleDefferedDownlinkSymbols(size_t frame_id) {
   std::queue<EventData>* defferal_queue = &rx_downlink_deferral_.at(frame_slot);
 
   while (defferal_queue->empty() == false) {
-    ScheduleWork(defferal_queue->front());
+    ScheduleWork(defferal_queue->front().event_type_,
+                 defferal_queue->front().tags_.at(0));
     defferal_queue->pop();
   }
 }
@@ -288,6 +322,7 @@ void PhyUe::Start() {
   size_t ret = 0;
   max_equaled_frame_ = 0;
   size_t cur_frame_id = 0;
+  const size_t start_tsc = GetTime::Rdtsc();
 
   while ((config_->Running() == true) &&
          (SignalHandler::GotExitSignal() == false)) {
@@ -307,475 +342,517 @@ void PhyUe::Start() {
     for (size_t bulk_count = 0; bulk_count < ret; bulk_count++) {
       EventData& event = events_list.at(bulk_count);
 
-      switch (event.event_type_) {
-        case EventType::kPacketRX: {
-          RxPacket* rx = rx_tag_t(event.tags_[0]).rx_packet_;
-          Packet* pkt = rx->RawPacket();
-
-          size_t frame_id = pkt->frame_id_;
-          size_t symbol_id = pkt->symbol_id_;
-          size_t ant_id = pkt->ant_id_;
-          size_t ue_id = ant_id / config_->NumUeChannels();
-          size_t frame_slot = frame_id % kFrameWnd;
-          RtAssert(pkt->frame_id_ < (cur_frame_id + kFrameWnd),
-                   "Error: Received packet for future frame beyond frame "
-                   "window. This can happen if PHY is running "
-                   "slowly, e.g., in debug mode");
-
-          PrintPerTaskDone(PrintType::kPacketRX, frame_id, symbol_id, ant_id);
-
-          if (rx_counters_.num_pkts_.at(frame_slot) == 0) {
-            this->stats_->MasterSetTsc(TsType::kFirstSymbolRX, frame_id);
-            if (kDebugPrintPerFrameStart) {
-              const size_t prev_frame_slot =
-                  (frame_slot + kFrameWnd - 1) % kFrameWnd;
-              std::printf(
-                  "PhyUe [frame %zu + %.2f ms since last frame]: Received "
-                  "first packet. Remaining packets in prev frame: %zu\n",
-                  frame_id,
-                  this->stats_->MasterGetDeltaMs(TsType::kFirstSymbolRX,
-                                                 frame_id, frame_id - 1),
-                  rx_counters_.num_pkts_.at(prev_frame_slot));
-            }
-          }
-
-          if (config_->IsDlPilot(frame_id, symbol_id)) {
-            rx_counters_.num_pilot_pkts_.at(frame_slot)++;
-            if (rx_counters_.num_pilot_pkts_.at(frame_slot) ==
-                rx_counters_.num_pilot_pkts_per_frame_) {
-              rx_counters_.num_pilot_pkts_.at(frame_slot) = 0;
-              this->stats_->MasterSetTsc(TsType::kPilotAllRX, frame_id);
-              PrintPerFrameDone(PrintType::kPacketRXPilots, frame_id);
+      // Worker completions carry the tags of several tasks
+      for (size_t tag_id = 0;
+           tag_id < std::max<size_t>(event.num_tags_, 1); tag_id++) {
+        const size_t tag = event.tags_.at(tag_id);
+        switch (event.event_type_) {
+          case EventType::kPacketRX: {
+            RxPacket* rx = rx_tag_t(tag).rx_packet_;
+            Packet* pkt = rx->RawPacket();
+
+            size_t frame_id = pkt->frame_id_;
+            size_t symbol_id = pkt->symbol_id_;
+            size_t ant_id = pkt->ant_id_;
+            size_t ue_id = ant_id / config_->NumUeChannels();
+            size_t frame_slot = frame_id % kFrameWnd;
+            RtAssert(pkt->frame_id_ < (cur_frame_id + kFrameWnd),
+                     "Error: Received packet for future frame beyond frame "
+                     "window. This can happen if PHY is running "
+                     "slowly, e.g., in debug mode");
+
+            PrintPerTaskDone(PrintType::kPacketRX, frame_id, symbol_id, ant_id);
+
+            if (rx_counters_.num_pkts_.at(frame_slot) == 0) {
+              this->stats_->MasterSetTsc(TsType::kFirstSymbolRX, frame_id);
+              if (kDebugPrintPerFrameStart) {
+                const size_t prev_frame_slot =
+                    (frame_slot + kFrameWnd - 1) % kFrameWnd;
+                std::printf(
+                    "PhyUe [frame %zu + %.2f ms since last frame]: Received "
+                    "first packet. Remaining packets in prev frame: %zu\n",
+                    frame_id,
+                    this->stats_->MasterGetDeltaMs(TsType::kFirstSymbolRX,
+                                                   frame_id, frame_id - 1),
+                    rx_counters_.num_pkts_.at(prev_frame_slot));
+              }
             }
-          }
-          rx_counters_.num_pkts_.at(frame_slot)++;
-          if (rx_counters_.num_pkts_.at(frame_slot) ==
-              rx_counters_.num_pkts_per_frame_) {
-            this->stats_->MasterSetTsc(TsType::kRXDone, frame_id);
-            PrintPerFrameDone(PrintType::kPacketRX, frame_id);
-            rx_counters_.num_pkts_.at(frame_slot) = 0;
-          }
-
-          // Schedule uplink pilots transmission and uplink processing
-          if (symbol_id == config_->Frame().GetBeaconSymbolLast()) {
-            if (ul_data_symbol_perframe_ == 0) {
-              // Schedule Pilot after receiving last beacon
-              // (Only when in Downlink Only mode, otherwise the pilots
-              // will be transmitted with the uplink data)
-              if (ant_id % config_->NumUeChannels() == 0) {
-                EventData do_tx_pilot_task(
-                    EventType::kPacketPilotTX,
-                    gen_tag_t::FrmSymUe(
-                        frame_id, config_->Frame().GetPilotSymbol(ue_id), ue_id)
-                        .tag_);
-                ScheduleTask(do_tx_pilot_task, &tx_queue_,
-                             *tx_ptoks_ptr_[ue_id % rx_thread_num_]);
+
+            if (config_->IsDlPilot(frame_id, symbol_id)) {
+              rx_counters_.num_pilot_pkts_.at(frame_slot)++;
+              if (rx_counters_.num_pilot_pkts_.at(frame_slot) ==
+                  rx_counters_.num_pilot_pkts_per_frame_) {
+                rx_counters_.num_pilot_pkts_.at(frame_slot) = 0;
+                this->stats_->MasterSetTsc(TsType::kPilotAllRX, frame_id);
+                PrintPerFrameDone(PrintType::kPacketRXPilots, frame_id);
               }
-            } else {
-              if ((ant_id % config_->NumUeChannels()) == 0) {
-                // Schedule the Uplink tasks
-                for (size_t symbol_idx = 0;
-                     symbol_idx < config_->Frame().NumULSyms(); symbol_idx++) {
-                  if (symbol_idx < config_->Frame().ClientUlPilotSymbols()) {
-                    EventData do_ifft_task(
-                        EventType::kIFFT,
-                        gen_tag_t::FrmSymUe(
-                            frame_id, config_->Frame().GetULSymbol(symbol_idx),
-                            ue_id)
-                            .tag_);
-                    ScheduleWork(do_ifft_task);
-                  } else {
-                    EventData do_encode_task(
-                        EventType::kEncode,
+            }
+            rx_counters_.num_pkts_.at(frame_slot)++;
+            if (rx_counters_.num_pkts_.at(frame_slot) ==
+                rx_counters_.num_pkts_per_frame_) {
+              this->stats_->MasterSetTsc(TsType::kRXDone, frame_id);
+              PrintPerFrameDone(PrintType::kPacketRX, frame_id);
+              rx_counters_.num_pkts_.at(frame_slot) = 0;
+            }
+
+            // Schedule uplink pilots transmission and uplink processing
+            if (symbol_id == config_->Frame().GetBeaconSymbolLast()) {
+              if (ul_data_symbol_perframe_ == 0) {
+                // Schedule Pilot after receiving last beacon
+                // (Only when in Downlink Only mode, otherwise the pilots
+                // will be transmitted with the uplink data)
+                if (ant_id % config_->NumUeChannels() == 0) {
+                  EventData do_tx_pilot_task(
+                      EventType::kPacketPilotTX,
+                      gen_tag_t::FrmSymUe(
+                          frame_id, config_->Frame().GetPilotSymbol(ue_id),
+                          ue_id)
+                          .tag_);
+                  ScheduleTask(do_tx_pilot_task, &tx_queue_,
+                               *tx_ptoks_ptr_[ue_id % rx_thread_num_]);
+                }
+              } else {
+                if ((ant_id % config_->NumUeChannels()) == 0) {
+                  // Schedule the Uplink tasks
+                  for (size_t symbol_idx = 0;
+                       symbol_idx < config_->Frame().NumULSyms();
+                       symbol_idx++) {
+                    const size_t ul_tag =
                         gen_tag_t::FrmSymUe(
                             frame_id, config_->Frame().GetULSymbol(symbol_idx),
                             ue_id)
-                            .tag_);
-                    ScheduleWork(do_encode_task);
+                            .tag_;
+                    if (symbol_idx < config_->Frame().ClientUlPilotSymbols()) {
+                      ScheduleWork(EventType::kIFFT, ul_tag);
+                    } else {
+                      ScheduleWork(EventType::kEncode, ul_tag);
+                    }
                   }
                 }
               }
             }
-          }
-
-          SymbolType symbol_type = config_->GetSymbolType(symbol_id);
-          if (symbol_type == SymbolType::kDL) {
-            // Defer downlink processing (all pilot symbols must be fft'd
-            // first)
-            ReceiveDownlinkSymbol(pkt, event.tags_[0]);
-          } else {
-            rx->Free();
-          }
-        } break;
-
-        case EventType::kFFTPilot: {
-          size_t frame_id = gen_tag_t(event.tags_[0]).frame_id_;
-          size_t symbol_id = gen_tag_t(event.tags_[0]).symbol_id_;
-          size_t ant_id = gen_tag_t(event.tags_[0]).ant_id_;
-
-          PrintPerTaskDone(PrintType::kFFTPilots, frame_id, symbol_id, ant_id);
-          bool tasks_complete =
-              fft_dlpilot_counters_.CompleteTask(frame_id, symbol_id);
-          if (tasks_complete == true) {
-            PrintPerSymbolDone(PrintType::kFFTPilots, frame_id, symbol_id);
-            bool pilot_fft_complete =
-                fft_dlpilot_counters_.CompleteSymbol(frame_id);
-            if (pilot_fft_complete == true) {
-              this->stats_->MasterSetTsc(TsType::kFFTPilotsDone, frame_id);
-              PrintPerFrameDone(PrintType::kFFTPilots, frame_id);
-              ScheduleDefferedDownlinkSymbols(frame_id);
+
+            SymbolType symbol_type = config_->GetSymbolType(symbol_id);
+            if (symbol_type == SymbolType::kDL) {
+              // Defer downlink processing (all pilot symbols must be fft'd
+              // first)
+              ReceiveDownlinkSymbol(pkt, tag);
+            } else {
+              rx->Free();
             }
-          }
-        } break;
-
-        case EventType::kFFT: {
-          size_t frame_id = gen_tag_t(event.tags_[0]).frame_id_;
-          size_t symbol_id = gen_tag_t(event.tags_[0]).symbol_id_;
-          size_t ant_id = gen_tag_t(event.tags_[0]).ant_id_;
-
-          // Schedule the Demul
-          EventData do_demul_task(EventType::kDemul, event.tags_[0]);
-          ScheduleWork(do_demul_task);
-
-          PrintPerTaskDone(PrintType::kFFTData, frame_id, symbol_id, ant_id);
-          bool tasks_complete =
-              fft_dldata_counters_.CompleteTask(frame_id, symbol_id);
-          if (tasks_complete == true) {
-            PrintPerSymbolDone(PrintType::kFFTData, frame_id, symbol_id);
-            bool fft_complete = fft_dldata_counters_.CompleteSymbol(frame_id);
-            if (fft_complete == true) {
-              this->stats_->MasterSetTsc(TsType::kFFTDone, frame_id);
-              PrintPerFrameDone(PrintType::kFFTData, frame_id);
-              fft_dldata_counters_.Reset(frame_id);
-              // Clear the csi buffer for the next use
-              ClearCsi(frame_id);
+          } break;
+
+          case EventType::kFFTPilot: {
+            size_t frame_id = gen_tag_t(tag).frame_id_;
+            size_t symbol_id = gen_tag_t(tag).symbol_id_;
+            size_t ant_id = gen_tag_t(tag).ant_id_;
+
+            PrintPerTaskDone(PrintType::kFFTPilots, frame_id, symbol_id,
+                             ant_id);
+            bool tasks_complete =
+                fft_dlpilot_counters_.CompleteTask(frame_id, symbol_id);
+            if (tasks_complete == true) {
+              PrintPerSymbolDone(PrintType::kFFTPilots, frame_id, symbol_id);
+              bool pilot_fft_complete =
+                  fft_dlpilot_counters_.CompleteSymbol(frame_id);
+              if (pilot_fft_complete == true) {
+                this->stats_->MasterSetTsc(TsType::kFFTPilotsDone, frame_id);
+                PrintPerFrameDone(PrintType::kFFTPilots, frame_id);
+                ScheduleDefferedDownlinkSymbols(frame_id);
+              }
+            }
+          } break;
+
+          case EventType::kFFT: {
+            size_t frame_id = gen_tag_t(tag).frame_id_;
+            size_t symbol_id = gen_tag_t(tag).symbol_id_;
+            size_t ant_id = gen_tag_t(tag).ant_id_;
+
+            // Schedule the Demul
+            ScheduleWork(EventType::kDemul, tag);
+
+            PrintPerTaskDone(PrintType::kFFTData, frame_id, symbol_id, ant_id);
+            bool tasks_complete =
+                fft_dldata_counters_.CompleteTask(frame_id, symbol_id);
+            if (tasks_complete == true) {
+              PrintPerSymbolDone(PrintType::kFFTData, frame_id, symbol_id);
+              bool fft_complete = fft_dldata_counters_.CompleteSymbol(frame_id);
+              if (fft_complete == true) {
+                this->stats_->MasterSetTsc(TsType::kFFTDone, frame_id);
+                PrintPerFrameDone(PrintType::kFFTData, frame_id);
+                fft_dldata_counters_.Reset(frame_id);
+                // Clear the csi buffer for the next use
+                ClearCsi(frame_id);
+              }
+            }
+          } break;
+
+          case EventType::kDemul: {
+            size_t frame_id = gen_tag_t(tag).frame_id_;
+            size_t symbol_id = gen_tag_t(tag).symbol_id_;
+            size_t ant_id = gen_tag_t(tag).ant_id_;
+
+            // Schedule the decode of each code block of the antenna
+            const size_t num_blocks = config_->LdpcConfig().NumBlocksInSymbol();
+            for (size_t cb_id = 0; cb_id < num_blocks; cb_id++) {
+              ScheduleWork(EventType::kDecode,
+                           gen_tag_t::FrmSymCb(frame_id, symbol_id,
+                                               (ant_id * num_blocks) + cb_id)
+                               .tag_);
             }
-          }
-        } break;
-
-        case EventType::kDemul: {
-          size_t frame_id = gen_tag_t(event.tags_[0]).frame_id_;
-          size_t symbol_id = gen_tag_t(event.tags_[0]).symbol_id_;
-          size_t ant_id = gen_tag_t(event.tags_[0]).ant_id_;
-
-          EventData do_decode_task(EventType::kDecode, event.tags_[0]);
-          ScheduleWork(do_decode_task);
-
-          PrintPerTaskDone(PrintType::kDemul, frame_id, symbol_id, ant_id);
-          bool symbol_complete =
-              demul_counters_.CompleteTask(frame_id, symbol_id);
-          if (symbol_complete == true) {
-            PrintPerSymbolDone(PrintType::kDemul, frame_id, symbol_id);
-            max_equaled_frame_ = frame_id;
-            bool demul_complete = demul_counters_.CompleteSymbol(frame_id);
-            if (demul_complete == true) {
-              this->stats_->MasterSetTsc(TsType::kDemulDone, frame_id);
-              PrintPerFrameDone(PrintType::kDemul, frame_id);
-              demul_counters_.Reset(frame_id);
+
+            PrintPerTaskDone(PrintType::kDemul, frame_id, symbol_id, ant_id);
+            bool symbol_complete =
+                demul_counters_.CompleteTask(frame_id, symbol_id);
+            if (symbol_complete == true) {
+              PrintPerSymbolDone(PrintType::kDemul, frame_id, symbol_id);
+              max_equaled_frame_ = frame_id;
+              bool demul_complete = demul_counters_.CompleteSymbol(frame_id);
+              if (demul_complete == true) {
+                this->stats_->MasterSetTsc(TsType::kDemulDone, frame_id);
+                PrintPerFrameDone(PrintType::kDemul, frame_id);
+                demul_counters_.Reset(frame_id);
+              }
             }
-          }
-        } break;
+          } break;
 
-        case EventType::kDecode: {
-          const size_t frame_id = gen_tag_t(event.tags_[0]).frame_id_;
-          const size_t symbol_id = gen_tag_t(event.tags_[0]).symbol_id_;
-          const size_t ant_id = gen_tag_t(event.tags_[0]).ant_id_;
+          case EventType::kDecode: {
+            const size_t frame_id = gen_tag_t(tag).frame_id_;
+            const size_t symbol_id = gen_tag_t(tag).symbol_id_;
+            const size_t ant_id = gen_tag_t(tag).cb_id_ /
+                                  config_->LdpcConfig().NumBlocksInSymbol();
 
-          PrintPerTaskDone(PrintType::kDecode, frame_id, symbol_id, ant_id);
+            PrintPerTaskDone(PrintType::kDecode, frame_id, symbol_id, ant_id);
 
-          bool symbol_complete =
-              decode_counters_.CompleteTask(frame_id, symbol_id);
-          if (symbol_complete == true) {
-            if (kEnableMac) {
-              auto base_tag = gen_tag_t::FrmSymUe(frame_id, symbol_id, 0);
+            bool symbol_complete =
+                decode_counters_.CompleteTask(frame_id, symbol_id);
+            if (symbol_complete == true) {
+              if (kEnableMac) {
+                auto base_tag = gen_tag_t::FrmSymUe(frame_id, symbol_id, 0);
 
-              for (size_t i = 0; i < config_->UeAntNum(); i++) {
-                ScheduleTask(EventData(EventType::kPacketToMac, base_tag.tag_),
-                             &to_mac_queue_, ptok_mac);
+                for (size_t i = 0; i < config_->UeAntNum(); i++) {
+                  ScheduleTask(
+                      EventData(EventType::kPacketToMac, base_tag.tag_),
+                      &to_mac_queue_, ptok_mac);
 
-                base_tag.ue_id_++;
+                  base_tag.ue_id_++;
+                }
+              }
+              PrintPerSymbolDone(PrintType::kDecode, frame_id, symbol_id);
+
+              bool decode_complete = decode_counters_.CompleteSymbol(frame_id);
+              if (decode_complete == true) {
+                this->stats_->MasterSetTsc(TsType::kDecodeDone, frame_id);
+                PrintPerFrameDone(PrintType::kDecode, frame_id);
+                decode_counters_.Reset(frame_id);
+
+                bool finished =
+                    FrameComplete(frame_id, FrameTasksFlags::kDownlinkComplete);
+                if (finished == true) {
+                  if ((cur_frame_id + 1) >= config_->FramesToTest()) {
+                    config_->Running(false);
+                  } else {
+                    FrameInit(frame_id);
+                    cur_frame_id = frame_id + 1;
+                  }
+                }
               }
             }
-            PrintPerSymbolDone(PrintType::kDecode, frame_id, symbol_id);
+          } break;
 
-            bool decode_complete = decode_counters_.CompleteSymbol(frame_id);
-            if (decode_complete == true) {
-              this->stats_->MasterSetTsc(TsType::kDecodeDone, frame_id);
-              PrintPerFrameDone(PrintType::kDecode, frame_id);
-              decode_counters_.Reset(frame_id);
+          case EventType::kPacketToMac: {
+            const size_t frame_id = gen_tag_t(tag).frame_id_;
+            const size_t symbol_id = gen_tag_t(tag).symbol_id_;
+            const size_t dl_symbol_idx =
+                config_->Frame().GetDLSymbolIdx(symbol_id);
 
-              bool finished =
-                  FrameComplete(frame_id, FrameTasksFlags::kDownlinkComplete);
-              if (finished == true) {
-                if ((cur_frame_id + 1) >= config_->FramesToTest()) {
-                  config_->Running(false);
-                } else {
-                  FrameInit(frame_id);
-                  cur_frame_id = frame_id + 1;
-                }
-              }
+            if (kDebugPrintPacketsToMac) {
+              std::printf(
+                  "PhyUe: sent decoded packet for (frame %zu, symbol "
+                  "%zu:%zu) to MAC\n",
+                  frame_id, symbol_id, dl_symbol_idx);
             }
-          }
-        } break;
-
-        case EventType::kPacketToMac: {
-          const size_t frame_id = gen_tag_t(event.tags_[0]).frame_id_;
-          const size_t symbol_id = gen_tag_t(event.tags_[0]).symbol_id_;
-          const size_t dl_symbol_idx =
-              config_->Frame().GetDLSymbolIdx(symbol_id);
-
-          if (kDebugPrintPacketsToMac) {
-            std::printf(
-                "PhyUe: sent decoded packet for (frame %zu, symbol %zu:%zu) to "
-                "MAC\n",
-                frame_id, symbol_id, dl_symbol_idx);
-          }
-          bool last_tomac_task =
-              this->tomac_counters_.CompleteTask(frame_id, dl_symbol_idx);
-
-          if (last_tomac_task == true) {
-            PrintPerSymbolDone(PrintType::kPacketToMac, frame_id, symbol_id);
-
-            bool last_tomac_symbol =
-                this->tomac_counters_.CompleteSymbol(frame_id);
-
-            if (last_tomac_symbol == true) {
-              PrintPerFrameDone(PrintType::kPacketToMac, frame_id);
-
-              const bool finished =
-                  FrameComplete(frame_id, FrameTasksFlags::kMacTxComplete);
-              if (finished == true) {
-                if ((cur_frame_id + 1) >= config_->FramesToTest()) {
-                  config_->Running(false);
-                } else {
-                  FrameInit(frame_id);
-                  cur_frame_id = frame_id + 1;
+            bool last_tomac_task =
+                this->tomac_counters_.CompleteTask(frame_id, dl_symbol_idx);
+
+            if (last_tomac_task == true) {
+              PrintPerSymbolDone(PrintType::kPacketToMac, frame_id, symbol_id);
+
+              bool last_tomac_symbol =
+                  this->tomac_counters_.CompleteSymbol(frame_id);
+
+              if (last_tomac_symbol == true) {
+                PrintPerFrameDone(PrintType::kPacketToMac, frame_id);
+
+                const bool finished =
+                    FrameComplete(frame_id, FrameTasksFlags::kMacTxComplete);
+                if (finished == true) {
+                  if ((cur_frame_id + 1) >= config_->FramesToTest()) {
+                    config_->Running(false);
+                  } else {
+                    FrameInit(frame_id);
+                    cur_frame_id = frame_id + 1;
+                  }
                 }
               }
             }
-          }
-        } break;
-
-        case EventType::kPacketFromMac: {
-          // This is an entire frame (multiple mac packets)
-          const size_t ue_id = rx_mac_tag_t(event.tags_[0]).tid_;
-          const size_t radio_buf_id = rx_mac_tag_t(event.tags_[0]).offset_;
-          RtAssert(radio_buf_id == (expected_frame_id_from_mac_ % kFrameWnd),
-                   "Radio buffer id does not match expected");
-
-          const auto* pkt = reinterpret_cast<const MacPacketPacked*>(
-              &ul_bits_buffer_[ue_id][radio_buf_id *
-                                      config_->UlMacBytesNumPerframe()]);
-
-          MLPD_TRACE(
-              "PhyUe: frame %d symbol %d user %d @ offset %zu %zu @ location "
-              "%zu\n",
-              pkt->Frame(), pkt->Symbol(), pkt->Ue(), ue_id, radio_buf_id,
-              (size_t)pkt);
-          RtAssert(pkt->Frame() ==
-                       static_cast<uint16_t>(expected_frame_id_from_mac_),
-                   "PhyUe: Incorrect frame ID from MAC");
-          current_frame_user_num_ =
-              (current_frame_user_num_ + 1) % config_->UeAntNum();
-          if (current_frame_user_num_ == 0) {
-            expected_frame_id_from_mac_++;
-          }
+          } break;
+
+          case EventType::kPacketFromMac: {
+            // This is an entire frame (multiple mac packets)
+            const size_t ue_id = rx_mac_tag_t(tag).tid_;
+            const size_t radio_buf_id = rx_mac_tag_t(tag).offset_;
+            RtAssert(radio_buf_id == (expected_frame_id_from_mac_ % kFrameWnd),
+                     "Radio buffer id does not match expected");
+
+            const auto* pkt = reinterpret_cast<const MacPacketPacked*>(
+                &ul_bits_buffer_[ue_id][radio_buf_id *
+                                        config_->UlMacBytesNumPerframe()]);
+
+            MLPD_TRACE(
+                "PhyUe: frame %d symbol %d user %d @ offset %zu %zu @ location "
+                "%zu\n",
+                pkt->Frame(), pkt->Symbol(), pkt->Ue(), ue_id, radio_buf_id,
+                (size_t)pkt);
+            RtAssert(pkt->Frame() ==
+                         static_cast<uint16_t>(expected_frame_id_from_mac_),
+                     "PhyUe: Incorrect frame ID from MAC");
+            current_frame_user_num_ =
+                (current_frame_user_num_ + 1) % config_->UeAntNum();
+            if (current_frame_user_num_ == 0) {
+              expected_frame_id_from_mac_++;
+            }
 #if ENABLE_RB_IND
-          config_->UpdateModCfgs(pkt->rb_indicator_.mod_order_bits_);
+            config_->UpdateModCfgs(pkt->rb_indicator_.mod_order_bits_);
 #endif
-          if (kDebugPrintPacketsFromMac) {
+            if (kDebugPrintPacketsFromMac) {
 #if ENABLE_RB_IND
-            std::printf(
-                "PhyUe: received packet for frame %u with modulation %zu\n",
-                pkt->frame_id_, pkt->rb_indicator_.mod_order_bits_);
+              std::printf(
+                  "PhyUe: received packet for frame %u with modulation %zu\n",
+                  pkt->frame_id_, pkt->rb_indicator_.mod_order_bits_);
 #endif
-            std::stringstream ss;
-
-            for (size_t ul_data_symbol = 0;
-                 ul_data_symbol < config_->Frame().NumUlDataSyms();
-                 ul_data_symbol++) {
-              ss << "PhyUe: kPacketFromMac, frame " << pkt->Frame()
-                 << ", symbol " << std::to_string(pkt->Symbol()) << " crc "
-                 << std::to_string(pkt->Crc()) << " bytes: ";
-              for (size_t i = 0; i < pkt->PayloadLength(); i++) {
-                ss << std::to_string((pkt->Data()[i])) << ", ";
+              std::stringstream ss;
+
+              for (size_t ul_data_symbol = 0;
+                   ul_data_symbol < config_->Frame().NumUlDataSyms();
+                   ul_data_symbol++) {
+                ss << "PhyUe: kPacketFromMac, frame " << pkt->Frame()
+                   << ", symbol " << std::to_string(pkt->Symbol()) << " crc "
+                   << std::to_string(pkt->Crc()) << " bytes: ";
+                for (size_t i = 0; i < pkt->PayloadLength(); i++) {
+                  ss << std::to_string((pkt->Data()[i])) << ", ";
+                }
+                ss << std::endl;
+                pkt = reinterpret_cast<const MacPacketPacked*>(
+                    reinterpret_cast<const uint8_t*>(pkt) +
+                    config_->MacPacketLength());
               }
-              ss << std::endl;
-              pkt = reinterpret_cast<const MacPacketPacked*>(
-                  reinterpret_cast<const uint8_t*>(pkt) +
-                  config_->MacPacketLength());
+              std::printf("%s\n", ss.str().c_str());
             }
-            std::printf("%s\n", ss.str().c_str());
-          }
-        } break;
-
-        case EventType::kEncode: {
-          const size_t frame_id = gen_tag_t(event.tags_[0]).frame_id_;
-          const size_t symbol_id = gen_tag_t(event.tags_[0]).symbol_id_;
-          const size_t ue_id = gen_tag_t(event.tags_[0]).ue_id_;
-
-          PrintPerTaskDone(PrintType::kEncode, frame_id, symbol_id, ue_id);
-
-          // Schedule the modul
-          EventData do_modul_task(EventType::kModul, event.tags_[0]);
-          ScheduleWork(do_modul_task);
-
-          bool symbol_complete =
-              encode_counter_.CompleteTask(frame_id, symbol_id);
-          if (symbol_complete == true) {
-            PrintPerSymbolDone(PrintType::kEncode, frame_id, symbol_id);
-
-            bool encode_complete = encode_counter_.CompleteSymbol(frame_id);
-            if (encode_complete == true) {
-              this->stats_->MasterSetTsc(TsType::kEncodeDone, frame_id);
-              PrintPerFrameDone(PrintType::kEncode, frame_id);
-              encode_counter_.Reset(frame_id);
+          } break;
+
+          case EventType::kEncode: {
+            const size_t frame_id = gen_tag_t(tag).frame_id_;
+            const size_t symbol_id = gen_tag_t(tag).symbol_id_;
+            const size_t ue_id = gen_tag_t(tag).ue_id_;
+
+            PrintPerTaskDone(PrintType::kEncode, frame_id, symbol_id, ue_id);
+
+            // Schedule the modul
+            ScheduleWork(EventType::kModul, tag);
+
+            bool symbol_complete =
+                encode_counter_.CompleteTask(frame_id, symbol_id);
+            if (symbol_complete == true) {
+              PrintPerSymbolDone(PrintType::kEncode, frame_id, symbol_id);
+
+              bool encode_complete = encode_counter_.CompleteSymbol(frame_id);
+              if (encode_complete == true) {
+                this->stats_->MasterSetTsc(TsType::kEncodeDone, frame_id);
+                PrintPerFrameDone(PrintType::kEncode, frame_id);
+                encode_counter_.Reset(frame_id);
+              }
             }
-          }
-        } break;
-
-        case EventType::kModul: {
-          const size_t frame_id = gen_tag_t(event.tags_[0]).frame_id_;
-          const size_t symbol_id = gen_tag_t(event.tags_[0]).symbol_id_;
-          const size_t ue_id = gen_tag_t(event.tags_[0]).ue_id_;
-
-          PrintPerTaskDone(PrintType::kModul, frame_id, symbol_id, ue_id);
-
-          EventData do_ifft_task(
-              EventType::kIFFT,
-              gen_tag_t::FrmSymUe(frame_id, symbol_id, ue_id).tag_);
-          ScheduleWork(do_ifft_task);
-
-          bool symbol_complete =
-              modulation_counters_.CompleteTask(frame_id, symbol_id);
-          if (symbol_complete == true) {
-            PrintPerSymbolDone(PrintType::kModul, frame_id, symbol_id);
-
-            bool mod_complete = modulation_counters_.CompleteSymbol(frame_id);
-            if (mod_complete == true) {
-              this->stats_->MasterSetTsc(TsType::kModulDone, frame_id);
-              PrintPerFrameDone(PrintType::kModul, frame_id);
-              modulation_counters_.Reset(frame_id);
+          } break;
+
+          case EventType::kModul: {
+            const size_t frame_id = gen_tag_t(tag).frame_id_;
+            const size_t symbol_id = gen_tag_t(tag).symbol_id_;
+            const size_t ue_id = gen_tag_t(tag).ue_id_;
+
+            PrintPerTaskDone(PrintType::kModul, frame_id, symbol_id, ue_id);
+
+            ScheduleWork(EventType::kIFFT,
+                         gen_tag_t::FrmSymUe(frame_id, symbol_id, ue_id).tag_);
+
+            bool symbol_complete =
+                modulation_counters_.CompleteTask(frame_id, symbol_id);
+            if (symbol_complete == true) {
+              PrintPerSymbolDone(PrintType::kModul, frame_id, symbol_id);
+
+              bool mod_complete = modulation_counters_.CompleteSymbol(frame_id);
+              if (mod_complete == true) {
+                this->stats_->MasterSetTsc(TsType::kModulDone, frame_id);
+                PrintPerFrameDone(PrintType::kModul, frame_id);
+                modulation_counters_.Reset(frame_id);
+              }
             }
-          }
-        } break;
-
-        case EventType::kIFFT: {
-          const size_t frame_id = gen_tag_t(event.tags_[0]).frame_id_;
-          const size_t symbol_id = gen_tag_t(event.tags_[0]).symbol_id_;
-          const size_t ue_id = gen_tag_t(event.tags_[0]).ue_id_;
-
-          PrintPerTaskDone(PrintType::kIFFT, frame_id, symbol_id, ue_id);
-
-          UeTxVars& ue = ue_tracker_.at(ue_id);
-
-          bool symbol_complete =
-              ue.ifft_counters_.CompleteTask(frame_id, symbol_id);
-          if (symbol_complete == true) {
-            PrintPerSymbolDone(PrintType::kIFFT, frame_id, symbol_id);
-
-            bool ifft_complete = ue.ifft_counters_.CompleteSymbol(frame_id);
-            if (ifft_complete == true) {
-              this->stats_->MasterSetTsc(TsType::kIFFTDone, frame_id);
-              PrintPerFrameDone(PrintType::kIFFT, frame_id);
-              ue.ifft_counters_.Reset(frame_id);
-
-              // If the completed frame is the next in line, schedule the
-              // transmission
-              if (ue.tx_pending_frame_ == frame_id) {
-                size_t current_frame = frame_id;
-
-                while (ue.tx_pending_frame_ == current_frame) {
-                  EventData do_tx_task(
-                      EventType::kPacketTX,
-                      gen_tag_t::FrmSymUe(ue.tx_pending_frame_, 0, ue_id).tag_);
-                  ScheduleTask(do_tx_task, &tx_queue_,
-                               *tx_ptoks_ptr_[ue_id % rx_thread_num_]);
+          } break;
+
+          case EventType::kIFFT: {
+            const size_t frame_id = gen_tag_t(tag).frame_id_;
+            const size_t symbol_id = gen_tag_t(tag).symbol_id_;
+            const size_t ue_id = gen_tag_t(tag).ue_id_;
+
+            PrintPerTaskDone(PrintType::kIFFT, frame_id, symbol_id, ue_id);
+
+            UeTxVars& ue = ue_tracker_.at(ue_id);
+
+            bool symbol_complete =
+                ue.ifft_counters_.CompleteTask(frame_id, symbol_id);
+            if (symbol_complete == true) {
+              PrintPerSymbolDone(PrintType::kIFFT, frame_id, symbol_id);
 
-                  size_t next_frame = current_frame + 1;
-                  ue.tx_pending_frame_ = next_frame;
+              bool ifft_complete = ue.ifft_counters_.CompleteSymbol(frame_id);
+              if (ifft_complete == true) {
+                this->stats_->MasterSetTsc(TsType::kIFFTDone, frame_id);
+                PrintPerFrameDone(PrintType::kIFFT, frame_id);
+                ue.ifft_counters_.Reset(frame_id);
 
-                  auto tx_next =
-                      std::find(ue.tx_ready_frames_.begin(),
-                                ue.tx_ready_frames_.end(), next_frame);
-                  if (tx_next != ue.tx_ready_frames_.end()) {
-                    // With c++20 we could check the return value of remove
-                    ue.tx_ready_frames_.erase(tx_next);
-                    current_frame = next_frame;
+                // If the completed frame is the next in line, schedule the
+                // transmission
+                if (ue.tx_pending_frame_ == frame_id) {
+                  size_t current_frame = frame_id;
+
+                  while (ue.tx_pending_frame_ == current_frame) {
+                    EventData do_tx_task(
+                        EventType::kPacketTX,
+                        gen_tag_t::FrmSymUe(ue.tx_pending_frame_, 0, ue_id)
+                            .tag_);
+                    ScheduleTask(do_tx_task, &tx_queue_,
+                                 *tx_ptoks_ptr_[ue_id % rx_thread_num_]);
+
+                    size_t next_frame = current_frame + 1;
+                    ue.tx_pending_frame_ = next_frame;
+
+                    auto tx_next =
+                        std::find(ue.tx_ready_frames_.begin(),
+                                  ue.tx_ready_frames_.end(), next_frame);
+                    if (tx_next != ue.tx_ready_frames_.end()) {
+                      // With c++20 we could check the return value of remove
+                      ue.tx_ready_frames_.erase(tx_next);
+                      current_frame = next_frame;
+                    }
                   }
+                } else {
+                  // Otherwise defer the tx (could make this sorted insert in
+                  // future)
+                  ue.tx_ready_frames_.push_front(frame_id);
                 }
-              } else {
-                // Otherwise defer the tx (could make this sorted insert in
-                // future)
-                ue.tx_ready_frames_.push_front(frame_id);
               }
             }
-          }
-        } break;
-
-        // Currently this only happens when there are no UL symbols
-        // (pilots or otherwise)
-        case EventType::kPacketPilotTX: {
-          size_t frame_id = gen_tag_t(event.tags_[0]).frame_id_;
-          size_t symbol_id = gen_tag_t(event.tags_[0]).symbol_id_;
-          size_t ue_id = gen_tag_t(event.tags_[0]).ue_id_;
-
-          PrintPerTaskDone(PrintType::kPacketTX, frame_id, symbol_id, ue_id);
-
-          bool last_tx_task = this->tx_counters_.CompleteTask(frame_id);
-          if (last_tx_task) {
-            this->stats_->MasterSetTsc(TsType::kTXDone, frame_id);
-            PrintPerFrameDone(PrintType::kPacketTX, frame_id);
-            this->tx_counters_.Reset(frame_id);
-
-            bool finished =
-                FrameComplete(frame_id, FrameTasksFlags::kUplinkTxComplete);
-            if (finished == true) {
-              if ((cur_frame_id + 1) >= config_->FramesToTest()) {
-                config_->Running(false);
-              } else {
-                FrameInit(frame_id);
-                cur_frame_id = frame_id + 1;
+          } break;
+
+          // Currently this only happens when there are no UL symbols
+          // (pilots or otherwise)
+          case EventType::kPacketPilotTX: {
+            size_t frame_id = gen_tag_t(tag).frame_id_;
+            size_t symbol_id = gen_tag_t(tag).symbol_id_;
+            size_t ue_id = gen_tag_t(tag).ue_id_;
+
+            PrintPerTaskDone(PrintType::kPacketTX, frame_id, symbol_id, ue_id);
+
+            bool last_tx_task = this->tx_counters_.CompleteTask(frame_id);
+            if (last_tx_task) {
+              this->stats_->MasterSetTsc(TsType::kTXDone, frame_id);
+              PrintPerFrameDone(PrintType::kPacketTX, frame_id);
+              this->tx_counters_.Reset(frame_id);
+
+              bool finished =
+                  FrameComplete(frame_id, FrameTasksFlags::kUplinkTxComplete);
+              if (finished == true) {
+                if ((cur_frame_id + 1) >= config_->FramesToTest()) {
+                  config_->Running(false);
+                } else {
+                  FrameInit(frame_id);
+                  cur_frame_id = frame_id + 1;
+                }
               }
             }
-          }
-        } break;
-
-        case EventType::kPacketTX: {
-          size_t frame_id = gen_tag_t(event.tags_[0]).frame_id_;
-          size_t ue_id = gen_tag_t(event.tags_[0]).ue_id_;
-          RtAssert(frame_id == next_frame_processed_[ue_id],
-                   "PhyUe: Unexpected frame was transmitted!");
-
-          ul_bits_buffer_status_[ue_id]
-                                [next_frame_processed_[ue_id] % kFrameWnd] = 0;
-          next_frame_processed_[ue_id]++;
-
-          PrintPerTaskDone(PrintType::kPacketTX, frame_id, 0, ue_id);
-          bool last_tx_task = this->tx_counters_.CompleteTask(frame_id);
-          if (last_tx_task) {
-            this->stats_->MasterSetTsc(TsType::kTXDone, frame_id);
-            PrintPerFrameDone(PrintType::kPacketTX, frame_id);
-            this->tx_counters_.Reset(frame_id);
-
-            bool finished =
-                FrameComplete(frame_id, FrameTasksFlags::kUplinkTxComplete);
-            if (finished == true) {
-              if ((cur_frame_id + 1) >= config_->FramesToTest()) {
-                config_->Running(false);
-              } else {
-                FrameInit(frame_id);
-                cur_frame_id = frame_id + 1;
+          } break;
+
+          case EventType::kPacketTX: {
+            size_t frame_id = gen_tag_t(tag).frame_id_;
+            size_t ue_id = gen_tag_t(tag).ue_id_;
+            RtAssert(frame_id == next_frame_processed_[ue_id],
+                     "PhyUe: Unexpected frame was transmitted!");
+
+            ul_bits_buffer_status_[ue_id][next_frame_processed_[ue_id] %
+                                          kFrameWnd] = 0;
+            next_frame_processed_[ue_id]++;
+
+            PrintPerTaskDone(PrintType::kPacketTX, frame_id, 0, ue_id);
+            bool last_tx_task = this->tx_counters_.CompleteTask(frame_id);
+            if (last_tx_task) {
+              this->stats_->MasterSetTsc(TsType::kTXDone, frame_id);
+              PrintPerFrameDone(PrintType::kPacketTX, frame_id);
+              this->tx_counters_.Reset(frame_id);
+
+              bool finished =
+                  FrameComplete(frame_id, FrameTasksFlags::kUplinkTxComplete);
+              if (finished == true) {
+                if ((cur_frame_id + 1) >= config_->FramesToTest()) {
+                  config_->Running(false);
+                } else {
+                  FrameInit(frame_id);
+                  cur_frame_id = frame_id + 1;
+                }
               }
             }
-          }
-        } break;
+          } break;
 
-        default:
-          std::cout << "Invalid Event Type!" << std::endl;
-          throw std::runtime_error("PhyUe: Invalid Event Type");
+          default:
+            std::cout << "Invalid Event Type!" << std::endl;
+            throw std::runtime_error("PhyUe: Invalid Event Type");
+        }
       }
     }
+    // Hand out the tasks of partially filled work events
+    FlushWork();
+  }
+
+  // All UEs share the workers, so their busy time tells how many UEs one
+  // core keeps up with
+  size_t busy_tsc = 0;
+  for (const auto& worker : workers_) {
+    busy_tsc += worker->BusyCycles();
+  }
+  if (busy_tsc > 0) {
+    const double busy_cores =
+        static_cast<double>(busy_tsc) / (GetTime::Rdtsc() - start_tsc);
+    std::printf(
+        "PhyUe: %zu UE antennas kept %.2f worker cores busy (%.2f UE "
+        "antennas per core)\n",
+        config_->UeAntNum(), busy_cores, config_->UeAntNum() / busy_cores);
+  }
+
+  // Mean processing time of one antenna's symbol in the downlink stages
+  const double freq_ghz = GetTime::MeasureRdtscFreq();
+  for (const DoerType doer_type :
+       {DoerType::kCSI, DoerType::kFFT, DoerType::kDemul}) {
+    size_t task_tsc = 0;
+    size_t task_count = 0;
+    for (size_t i = 0; i < workers_.size(); i++) {
+      const DurationStat* stat = stats_->GetDurationStat(doer_type, i);
+      task_tsc += stat->task_duration_[0];
+      task_count += stat->task_count_;
+    }
+    if (task_count > 0) {
+      std::printf("PhyUe: %s %.2f us per symbol (%zu symbols)\n",
+                  kDoerNames.at(doer_type).c_str(),
+                  GetTime::CyclesToUs(task_tsc / task_count, freq_ghz),
+                  task_count);
+    }
   }
   if (kPrintPhyStats) {
     phy_stats_->PrintPhyStats();
@@ -78,9 +78,22 @@ class PhyUe {
   void ScheduleTask(EventData do_task,
                     moodycamel::ConcurrentQueue<EventData>* in_queue,
                     moodycamel::ProducerToken const& ptok);
-  void ScheduleWork(EventData do_task);
-
-  std::unique_ptr<moodycamel::ProducerToken> work_producer_token_;
+  /**
+   * @brief Add the task [tag] to the pending work event of [event_type] and
+   * enqueue the event once it holds the block size of its event type
+   */
+  void ScheduleWork(EventType event_type, size_t tag);
+  /// Enqueue all partially filled pending work events
+  void FlushWork();
+  /// Enqueue one work event to the work queue of its event type
+  void EnqueueWork(const EventData& do_task);
+
+  std::array<std::unique_ptr<moodycamel::ProducerToken>, kNumUeEventTypes>
+      work_producer_tokens_;
+  // Work events being batched by the master thread, per event type
+  std::array<EventData, kNumUeEventTypes> pending_work_;
+  // Number of tasks per work event, per event type
+  std::array<size_t, kNumUeEventTypes> work_block_size_;
 
   void InitializeVarsFromCfg();
 
@@ -203,7 +216,7 @@ class PhyUe {
 
   // Communication queues
   moodycamel::ConcurrentQueue<EventData> complete_queue_;
-  moodycamel::ConcurrentQueue<EventData> work_queue_;
+  UeWorkQueues work_queues_;
 
   moodycamel::ConcurrentQueue<EventData> tx_queue_;
   moodycamel::ConcurrentQueue<EventData> to_mac_queue_;
@@ -230,8 +230,8 @@ void* RadioTxRx::LoopTxRx(size_t tid) {
   for (size_t ant_id = ant_lo; ant_id < ant_hi; ++ant_id) {
     size_t local_port_id = config_->UeServerPort() + ant_id;
     udp_servers_.at(ant_id) =
-        std::make_unique<UDPServer>(local_port_id, sock_buf_size);
-    udp_clients_.at(ant_id) = std::make_unique<UDPClient>();
+        std::make_unique<PacketServer>(local_port_id, sock_buf_size);
+    udp_clients_.at(ant_id) = std::make_unique<PacketClient>();
     MLPD_FRAME(
         "TXRX thread %zu: set up UDP socket server listening to port %d"
         " with remote address %s:%d \n",
@@ -14,8 +14,7 @@
 
 #include "client_radio.h"
 #include "concurrentqueue.h"
-#include "udp_client.h"
-#include "udp_server.h"
+#include "packet_transport.h"
 #include "utils.h"
 
 /**
@@ -143,8 +142,8 @@ class RadioTxRx {
   // Used only in Argos mode
   std::unique_ptr<ClientRadioConfig> radioconfig_;
 
-  std::vector<std::unique_ptr<UDPClient>> udp_clients_;
-  std::vector<std::unique_ptr<UDPServer>> udp_servers_;
+  std::vector<std::unique_ptr<PacketClient>> udp_clients_;
+  std::vector<std::unique_ptr<PacketServer>> udp_servers_;
 
   // Dimension 1: socket_thread
   // Dimension 2: rx_packet
@@ -28,8 +28,7 @@ static constexpr size_t kRecordFrameIndex = 1000;
 UeWorker::UeWorker(
     size_t tid, Config& config, Stats& shared_stats, PhyStats& shared_phy_stats,
     moodycamel::ConcurrentQueue<EventData>& notify_queue,
-    moodycamel::ConcurrentQueue<EventData>& work_queue,
-    moodycamel::ProducerToken& work_producer, Table<int8_t>& ul_bits_buffer,
+    UeWorkQueues& work_queues, Table<int8_t>& ul_bits_buffer,
     Table<int8_t>& encoded_buffer, Table<complex_float>& modul_buffer,
     Table<complex_float>& ifft_buffer, char* const tx_buffer,
     Table<char>& rx_buffer, std::vector<myVec>& csi_buffer,
@@ -41,8 +40,7 @@ UeWorker::UeWorker(
     : tid_(tid),
 
       notify_queue_(notify_queue),
-      work_queue_(work_queue),
-      work_producer_token_(work_producer),
+      work_queues_(work_queues),
       config_(config),
       stats_(shared_stats),
       phy_stats_(shared_phy_stats),
@@ -64,13 +62,15 @@ UeWorker::UeWorker(
   AllocBuffer1d(&rx_samps_tmp_, config_.SampsPerSymbol(),
                 Agora_memory::Alignment_t::kAlign64, 1);
 
-  (void)DftiCreateDescriptor(&mkl_handle_, DFTI_SINGLE, DFTI_COMPLEX, 1,
-                             config_.OfdmCaNum());
-  (void)DftiCommitDescriptor(mkl_handle_);
+  fft_plan_ = FftPlan::Create(FftDirection::kForward, config_.OfdmCaNum(),
+                              true, config_.FftBackend());
+
+  duration_stat_fft_ = stats_.GetDurationStat(DoerType::kFFT, tid_);
+  duration_stat_csi_ = stats_.GetDurationStat(DoerType::kCSI, tid_);
+  duration_stat_demul_ = stats_.GetDurationStat(DoerType::kDemul, tid_);
 }
 
 UeWorker::~UeWorker() {
-  DftiFreeDescriptor(&mkl_handle_);
   FreeBuffer1d(&rx_samps_tmp_);
   std::printf("UeWorker[%zu] Terminated\n", tid_);
 }
@@ -93,59 +93,89 @@ void UeWorker::TaskThread(size_t core_offset) {
   std::printf("UeWorker[%zu]: started\n", tid_);
   PinToCoreWithOffset(ThreadType::kWorker, core_offset, tid_);
 
-  auto encoder = std::make_unique<DoEncode>(
+  encoder_ = std::make_unique<DoEncode>(
       &config_, (int)tid_, Direction::kUplink,
       (kEnableMac == true) ? ul_bits_buffer_ : config_.UlBits(),
       (kEnableMac == true) ? kFrameWnd : 1, encoded_buffer_, &stats_);
 
-  auto iffter = std::make_unique<DoIFFTClient>(
-      &config_, (int)tid_, ifft_buffer_, tx_buffer_, &stats_);
+  iffter_ = std::make_unique<DoIFFTClient>(&config_, (int)tid_, ifft_buffer_,
+                                           tx_buffer_, &stats_);
 
-  auto decoder =
+  decoder_ =
       std::make_unique<DoDecodeClient>(&config_, (int)tid_, demod_buffer_,
                                        decoded_buffer_, &phy_stats_, &stats_);
 
-  EventData event;
+  // Later pipeline stages first, so that symbols already in flight finish
+  // before new ones are started
+  std::vector<EventType> event_types;
+  if (config_.Frame().NumDLSyms() > 0) {
+    event_types.insert(event_types.end(),
+                       {EventType::kDecode, EventType::kDemul, EventType::kFFT,
+                        EventType::kFFTPilot});
+  }
+  if (config_.Frame().NumULSyms() > 0) {
+    event_types.insert(event_types.end(), {EventType::kIFFT, EventType::kModul,
+                                           EventType::kEncode});
+  }
+
   while (config_.Running() == true) {
-    if (work_queue_.try_dequeue_from_producer(work_producer_token_, event) ==
-        true) {
-      switch (event.event_type_) {
-        case EventType::kDecode: {
-          DoDecodeUe(decoder.get(), event.tags_[0]);
-        } break;
-        case EventType::kDemul: {
-          DoDemul(event.tags_[0]);
-        } break;
-        case EventType::kIFFT: {
-          // DoIfftUe(iffter.get(), event.tags_[0]);
-          DoIfft(event.tags_[0]);
-        } break;
-        case EventType::kEncode: {
-          DoEncodeUe(encoder.get(), event.tags_[0]);
-        } break;
-        case EventType::kModul: {
-          DoModul(event.tags_[0]);
-        } break;
-        case EventType::kFFTPilot: {
-          DoFftPilot(event.tags_[0]);
-        } break;
-        case EventType::kFFT: {
-          DoFftData(event.tags_[0]);
-        } break;
-        default: {
-          std::printf("***** Invalid Event Type [%d] in Work Queue\n",
-                      static_cast<int>(event.event_type_));
-        }
+    for (const EventType event_type : event_types) {
+      if (TryLaunch(event_type) == true) {
+        break;
       }
-    }  // end dequeue
+    }
+  }
+}
+
+bool UeWorker::TryLaunch(EventType event_type) {
+  EventData req_event;
+  if (work_queues_.at(static_cast<size_t>(event_type))
+          .try_dequeue(req_event) == false) {
+    return false;
+  }
+  const size_t start_tsc = GetTime::Rdtsc();
+  // One response event carries the completions of all tags of the request
+  EventData resp_event(event_type);
+  resp_event.num_tags_ = req_event.num_tags_;
+  for (size_t i = 0; i < req_event.num_tags_; i++) {
+    resp_event.tags_.at(i) = Launch(event_type, req_event.tags_.at(i));
+  }
+  RtAssert(notify_queue_.enqueue(*ptok_.get(), resp_event),
+           "UeWorker: completion message enqueue failed");
+  busy_tsc_.fetch_add(GetTime::Rdtsc() - start_tsc,
+                      std::memory_order_relaxed);
+  return true;
+}
+
+size_t UeWorker::Launch(EventType event_type, size_t tag) {
+  switch (event_type) {
+    case EventType::kDecode:
+      return DoDecodeUe(decoder_.get(), tag);
+    case EventType::kDemul:
+      return DoDemul(tag);
+    case EventType::kIFFT:
+      // return DoIfftUe(iffter_.get(), tag);
+      return DoIfft(tag);
+    case EventType::kEncode:
+      return DoEncodeUe(encoder_.get(), tag);
+    case EventType::kModul:
+      return DoModul(tag);
+    case EventType::kFFTPilot:
+      return DoFftPilot(tag);
+    case EventType::kFFT:
+      return DoFftData(tag);
+    default:
+      std::printf("***** Invalid Event Type [%d] in Work Queue\n",
+                  static_cast<int>(event_type));
+      throw std::runtime_error("UeWorker: Invalid Event Type");
   }
 }
 
 //////////////////////////////////////////////////////////
 //                   DOWNLINK Operations                //
 //////////////////////////////////////////////////////////
-void UeWorker::DoFftData(size_t tag) {
-  size_t start_tsc = GetTime::Rdtsc();
+size_t UeWorker::DoFftData(size_t tag) {
+  size_t start_tsc = GetTime::WorkerRdtsc();
 
   // read info of one frame
   Packet* pkt = fft_req_tag_t(tag).rx_packet_->RawPacket();
@@ -193,13 +223,15 @@ void UeWorker::DoFftData(size_t tag) {
                           config_.OfdmCaNum() * 2);
 
   // perform fft
-  DftiComputeForward(mkl_handle_, fft_buffer_[fft_buffer_target_id]);
+  fft_plan_->Execute(fft_buffer_[fft_buffer_target_id]);
+  size_t start_tsc1 = GetTime::WorkerRdtsc();
+  duration_stat_fft_->task_duration_[1] += start_tsc1 - start_tsc;
 
   size_t csi_offset = frame_slot * config_.UeAntNum() + ant_id;
-  auto* csi_buffer_ptr =
-      reinterpret_cast<arma::cx_float*>(csi_buffer_.at(csi_offset).data());
-  auto* fft_buffer_ptr =
-      reinterpret_cast<arma::cx_float*>(fft_buffer_[fft_buffer_target_id]);
+  const complex_float* csi_ptr = csi_buffer_.at(csi_offset).data();
+  // The data subcarriers are contiguous in the FFT output
+  const complex_float* rx_ptr =
+      &fft_buffer_[fft_buffer_target_id][config_.OfdmDataStart()];
 
   size_t dl_data_symbol_perframe = config_.Frame().NumDlDataSyms();
   size_t total_dl_data_symbol_id =
@@ -208,40 +240,46 @@ void UeWorker::DoFftData(size_t tag) {
   size_t eq_buffer_offset =
       total_dl_data_symbol_id * config_.UeAntNum() + ant_id;
 
-  auto* equ_buffer_ptr = reinterpret_cast<arma::cx_float*>(
-      equal_buffer_.at(eq_buffer_offset).data());
+  complex_float* equ_ptr = equal_buffer_.at(eq_buffer_offset).data();
+  auto* equ_buffer_ptr = reinterpret_cast<arma::cx_float*>(equ_ptr);
 
   // use pilot subcarriers for phase tracking and correction
   float theta = 0;
-  for (size_t j = 0; j < config_.OfdmDataNum(); j++) {
-    if (j % config_.OfdmPilotSpacing() == 0) {
-      equ_buffer_ptr[j] = 0;
-      size_t sc_id = non_null_sc_ind_[j];
-      arma::cx_float y = fft_buffer_ptr[sc_id];
-      auto pilot_eq = y / csi_buffer_ptr[j];
-      auto p = config_.UeSpecificPilot()[ant_id][j];
-      theta += arg(pilot_eq * arma::cx_float(p.re, -p.im));
-    }
+  for (size_t j = 0; j < config_.OfdmDataNum();
+       j += config_.OfdmPilotSpacing()) {
+    const arma::cx_float pilot_eq =
+        arma::cx_float(rx_ptr[j].re, rx_ptr[j].im) /
+        arma::cx_float(csi_ptr[j].re, csi_ptr[j].im);
+    auto p = config_.UeSpecificPilot()[ant_id][j];
+    theta += arg(pilot_eq * arma::cx_float(p.re, -p.im));
   }
   if (config_.GetOFDMPilotNum() > 0) {
     theta /= config_.GetOFDMPilotNum();
   }
   auto phc = exp(arma::cx_float(0, -theta));
+  CommsLib::EqualizeAvx(rx_ptr, csi_ptr, {phc.real(), phc.imag()}, equ_ptr,
+                        config_.OfdmDataNum());
+  // Pilot subcarriers carry no data
+  for (size_t j = 0; j < config_.OfdmDataNum();
+       j += config_.OfdmPilotSpacing()) {
+    equ_ptr[j] = {0, 0};
+  }
+  duration_stat_fft_->task_duration_[2] += GetTime::WorkerRdtsc() - start_tsc1;
+
   float evm = 0;
-  for (size_t j = 0; j < config_.OfdmDataNum(); j++) {
-    if (j % config_.OfdmPilotSpacing() != 0) {
-      // divide fft output by pilot data to get CSI estimation
-      size_t sc_id = non_null_sc_ind_[j];
-      arma::cx_float y = fft_buffer_ptr[sc_id];
-      equ_buffer_ptr[j] = (y / csi_buffer_ptr[j]) * phc;
-      complex_float tx =
-          config_.DlIqF()[dl_symbol_id][ant_id * config_.OfdmCaNum() +
-                                        config_.OfdmDataStart() + j];
-      evm += std::norm(equ_buffer_ptr[j] - arma::cx_float(tx.re, tx.im));
+  if (kPrintPhyStats) {
+    const complex_float* tx_ptr =
+        &config_.DlIqF()[dl_symbol_id][ant_id * config_.OfdmCaNum() +
+                                       config_.OfdmDataStart()];
+    for (size_t j = 0; j < config_.OfdmDataNum(); j++) {
+      if (j % config_.OfdmPilotSpacing() != 0) {
+        evm += std::norm(equ_buffer_ptr[j] -
+                         arma::cx_float(tx_ptr[j].re, tx_ptr[j].im));
+      }
     }
+    evm =
+        std::sqrt(evm) / (config_.OfdmDataNum() - config_.GetOFDMPilotNum());
   }
-
-  evm = std::sqrt(evm) / (config_.OfdmDataNum() - config_.GetOFDMPilotNum());
   if (kPrintEqualizedSymbols) {
     complex_float* tx =
         &config_.DlIqF()[dl_symbol_id][ant_id * config_.OfdmCaNum() +
@@ -264,8 +302,10 @@ void UeWorker::DoFftData(size_t tag) {
     std::cout << ss.str();
   }
 
+  size_t fft_duration_stat = GetTime::WorkerRdtsc() - start_tsc;
+  duration_stat_fft_->task_duration_[0] += fft_duration_stat;
+  duration_stat_fft_->task_count_++;
   if (kDebugPrintPerTaskDone || kDebugPrintFft) {
-    size_t fft_duration_stat = GetTime::Rdtsc() - start_tsc;
     std::printf(
         "UeWorker[%zu]: Fft Data(frame %zu, symbol %zu, ant %zu) Duration "
         "%2.4f ms\n",
@@ -276,14 +316,11 @@ void UeWorker::DoFftData(size_t tag) {
   // Free the rx buffer
   fft_req_tag_t(tag).rx_packet_->Free();
 
-  EventData fft_finish_event = EventData(
-      EventType::kFFT, gen_tag_t::FrmSymAnt(frame_id, symbol_id, ant_id).tag_);
-  RtAssert(notify_queue_.enqueue(*ptok_.get(), fft_finish_event),
-           "UeWorker: FFT message enqueue failed");
+  return gen_tag_t::FrmSymAnt(frame_id, symbol_id, ant_id).tag_;
 }
 
-void UeWorker::DoFftPilot(size_t tag) {
-  size_t start_tsc = GetTime::Rdtsc();
+size_t UeWorker::DoFftPilot(size_t tag) {
+  size_t start_tsc = GetTime::WorkerRdtsc();
 
   // read info of one frame
   Packet* pkt = fft_req_tag_t(tag).rx_packet_->RawPacket();
@@ -361,28 +398,29 @@ void UeWorker::DoFftPilot(size_t tag) {
                           config_.OfdmCaNum() * 2);
 
   // perform fft
-  DftiComputeForward(mkl_handle_, fft_buffer_[fft_buffer_target_id]);
+  fft_plan_->Execute(fft_buffer_[fft_buffer_target_id]);
+  size_t start_tsc1 = GetTime::WorkerRdtsc();
+  duration_stat_csi_->task_duration_[1] += start_tsc1 - start_tsc;
 
   size_t csi_offset = frame_slot * config_.UeAntNum() + ant_id;
-  auto* csi_buffer_ptr =
-      reinterpret_cast<arma::cx_float*>(csi_buffer_.at(csi_offset).data());
-  auto* fft_buffer_ptr =
-      reinterpret_cast<arma::cx_float*>(fft_buffer_[fft_buffer_target_id]);
 
   // In TDD massive MIMO, a pilot symbol needs to be sent
   // in the downlink for the user to estimate the channel
   // due to relative reciprocity calibration,
   // see Argos paper (Mobicom'12)
   if (dl_symbol_id < config_.Frame().ClientDlPilotSymbols()) {
-    for (size_t j = 0; j < config_.OfdmDataNum(); j++) {
-      complex_float p = config_.UeSpecificPilot()[ant_id][j];
-      size_t sc_id = non_null_sc_ind_[j];
-      csi_buffer_ptr[j] += (fft_buffer_ptr[sc_id] / arma::cx_float(p.re, p.im));
-    }
+    // The data subcarriers are contiguous in the FFT output
+    CommsLib::CsiAccumulateAvx(
+        &fft_buffer_[fft_buffer_target_id][config_.OfdmDataStart()],
+        config_.UeSpecificPilot()[ant_id], csi_buffer_.at(csi_offset).data(),
+        config_.OfdmDataNum());
   }
+  duration_stat_csi_->task_duration_[2] += GetTime::WorkerRdtsc() - start_tsc1;
 
+  size_t fft_duration_stat = GetTime::WorkerRdtsc() - start_tsc;
+  duration_stat_csi_->task_duration_[0] += fft_duration_stat;
+  duration_stat_csi_->task_count_++;
   if (kDebugPrintPerTaskDone || kDebugPrintFft) {
-    size_t fft_duration_stat = GetTime::Rdtsc() - start_tsc;
     std::printf(
         "UeWorker[%zu]: Fft Pilot(frame %zu, symbol %zu, ant %zu) Duration "
         "%2.4f ms\n",
@@ -392,14 +430,10 @@ void UeWorker::DoFftPilot(size_t tag) {
 
   // Free the rx buffer
   fft_req_tag_t(tag).rx_packet_->Free();
-  EventData fft_finish_event =
-      EventData(EventType::kFFTPilot,
-                gen_tag_t::FrmSymAnt(frame_id, symbol_id, ant_id).tag_);
-  RtAssert(notify_queue_.enqueue(*ptok_.get(), fft_finish_event),
-           "UeWorker: FFT Pilot message enqueue failed");
+  return gen_tag_t::FrmSymAnt(frame_id, symbol_id, ant_id).tag_;
 }
 
-void UeWorker::DoDemul(size_t tag) {
+size_t UeWorker::DoDemul(size_t tag) {
   const size_t frame_id = gen_tag_t(tag).frame_id_;
   const size_t symbol_id = gen_tag_t(tag).symbol_id_;
   const size_t ant_id = gen_tag_t(tag).ant_id_;
@@ -408,7 +442,7 @@ void UeWorker::DoDemul(size_t tag) {
     std::printf("UeWorker[%zu]: Demul  (frame %zu, symbol %zu, ant %zu)\n",
                 tid_, frame_id, symbol_id, ant_id);
   }
-  size_t start_tsc = GetTime::Rdtsc();
+  size_t start_tsc = GetTime::WorkerRdtsc();
 
   const size_t frame_slot = frame_id % kFrameWnd;
   size_t dl_symbol_id = config_.Frame().GetDLSymbolIdx(symbol_id);
@@ -424,23 +458,16 @@ void UeWorker::DoDemul(size_t tag) {
   int8_t* demod_ptr = demod_buffer_[frame_slot][dl_symbol_id][ant_id] +
                       (config_.ModOrderBits() * base_sc_id);
 
-  switch (config_.ModOrderBits()) {
-    case (CommsLib::kQpsk):
-      DemodQpskSoftSse(equal_ptr, demod_ptr, config_.OfdmDataNum());
-      break;
-    case (CommsLib::kQaM16):
-      Demod16qamSoftAvx2(equal_ptr, demod_ptr, config_.OfdmDataNum());
-      break;
-    case (CommsLib::kQaM64):
-      Demod64qamSoftAvx2(equal_ptr, demod_ptr, config_.OfdmDataNum());
-      break;
-    default:
-      std::printf("UeWorker[%zu]: Demul - modulation type %s not supported!\n",
-                  tid_, config_.Modulation().c_str());
+  if (DemodSoftAvx2(equal_ptr, demod_ptr, config_.OfdmDataNum(),
+                    config_.ModOrderBits()) == false) {
+    std::printf("UeWorker[%zu]: Demul - modulation type %s not supported!\n",
+                tid_, config_.Modulation().c_str());
   }
 
+  size_t dem_duration_stat = GetTime::WorkerRdtsc() - start_tsc;
+  duration_stat_demul_->task_duration_[0] += dem_duration_stat;
+  duration_stat_demul_->task_count_++;
   if ((kDebugPrintPerTaskDone == true) || (kDebugPrintDemul == true)) {
-    size_t dem_duration_stat = GetTime::Rdtsc() - start_tsc;
     std::printf(
         "UeWorker[%zu]: Demul  (frame %zu, symbol %zu, ant %zu) Duration "
         "%2.4f ms\n",
@@ -455,44 +482,27 @@ void UeWorker::DoDemul(size_t tag) {
     std::printf("\n");
   }
 
-  RtAssert(
-      notify_queue_.enqueue(*ptok_.get(), EventData(EventType::kDemul, tag)),
-      "Demodulation message enqueue failed");
+  return tag;
 }
 
-void UeWorker::DoDecodeUe(DoDecodeClient* decoder, size_t tag) {
-  const size_t frame_id = gen_tag_t(tag).frame_id_;
-  const size_t symbol_id = gen_tag_t(tag).symbol_id_;
-  const size_t ant_id = gen_tag_t(tag).ant_id_;
-
-  for (size_t cb_id = 0; cb_id < config_.LdpcConfig().NumBlocksInSymbol();
-       cb_id++) {
-    // For now, call for each cb
-    if (kDebugPrintDecode) {
-      std::printf(
-          "Decoding [Frame %zu, Symbol %zu, User %zu, Code Block %zu : %zu]\n",
-          frame_id, symbol_id, ant_id, cb_id,
-          config_.LdpcConfig().NumBlocksInSymbol() - 1);
-    }
-    decoder->Launch(
-        gen_tag_t::FrmSymCb(
-            frame_id, symbol_id,
-            cb_id + (ant_id * config_.LdpcConfig().NumBlocksInSymbol()))
-            .tag_);
+size_t UeWorker::DoDecodeUe(DoDecodeClient* decoder, size_t tag) {
+  if (kDebugPrintDecode) {
+    const size_t cb_id = gen_tag_t(tag).cb_id_;
+    std::printf(
+        "Decoding [Frame %u, Symbol %u, User %zu, Code Block %zu : %zu]\n",
+        gen_tag_t(tag).frame_id_, gen_tag_t(tag).symbol_id_,
+        cb_id / config_.LdpcConfig().NumBlocksInSymbol(),
+        cb_id % config_.LdpcConfig().NumBlocksInSymbol(),
+        config_.LdpcConfig().NumBlocksInSymbol() - 1);
   }
-
-  // Post the completion event (symbol)
-  size_t completion_tag = gen_tag_t::FrmSymUe(frame_id, symbol_id, ant_id).tag_;
-
-  RtAssert(notify_queue_.enqueue(*ptok_.get(),
-                                 EventData(EventType::kDecode, completion_tag)),
-           "Decode Symbol message enqueue failed");
+  decoder->Launch(tag);
+  return tag;
 }
 
 //////////////////////////////////////////////////////////
 //                   UPLINK Operations                //
 //////////////////////////////////////////////////////////
-void UeWorker::DoEncodeUe(DoEncode* encoder, size_t tag) {
+size_t UeWorker::DoEncodeUe(DoEncode* encoder, size_t tag) {
   const size_t frame_id = gen_tag_t(tag).frame_id_;
   const size_t symbol_id = gen_tag_t(tag).symbol_id_;
   const size_t ue_id = gen_tag_t(tag).ue_id_;
@@ -509,15 +519,12 @@ void UeWorker::DoEncodeUe(DoEncode* encoder, size_t tag) {
               .tag_);
     }
   }
-  // Post the completion event (symbol)
-  size_t completion_tag = gen_tag_t::FrmSymUe(frame_id, symbol_id, ue_id).tag_;
-  RtAssert(notify_queue_.enqueue(*ptok_.get(),
-                                 EventData(EventType::kEncode, completion_tag)),
-           "Encoded Symbol message enqueue failed");
+  // Completion tag (symbol)
+  return gen_tag_t::FrmSymUe(frame_id, symbol_id, ue_id).tag_;
 }
 
 // This functions accepts non pilot - UL symbols
-void UeWorker::DoModul(size_t tag) {
+size_t UeWorker::DoModul(size_t tag) {
   const size_t frame_id = gen_tag_t(tag).frame_id_;
   const size_t symbol_id = gen_tag_t(tag).symbol_id_;
   const size_t ue_id = gen_tag_t(tag).ue_id_;
@@ -568,12 +575,10 @@ void UeWorker::DoModul(size_t tag) {
         GetTime::CyclesToMs(mod_duration_stat, GetTime::MeasureRdtscFreq()));
   }
 
-  RtAssert(
-      notify_queue_.enqueue(*ptok_.get(), EventData(EventType::kModul, tag)),
-      "Modulation complete message enqueue failed");
+  return tag;
 }
 
-void UeWorker::DoIfftUe(DoIFFTClient* iffter, size_t tag) {
+size_t UeWorker::DoIfftUe(DoIFFTClient* iffter, size_t tag) {
   const size_t frame_id = gen_tag_t(tag).frame_id_;
   const size_t symbol_id = gen_tag_t(tag).symbol_id_;
   const size_t user_id = gen_tag_t(tag).ue_id_;
@@ -604,15 +609,11 @@ void UeWorker::DoIfftUe(DoIFFTClient* iffter, size_t tag) {
     iffter->Launch(gen_tag_t::FrmSymAnt(frame_id, symbol_id, ant_id).tag_);
   }
 
-  // Post the completion event (symbol)
-  size_t completion_tag =
-      gen_tag_t::FrmSymUe(frame_id, symbol_id, user_id).tag_;
-  RtAssert(notify_queue_.enqueue(*ptok_.get(),
-                                 EventData(EventType::kIFFT, completion_tag)),
-           "IFFT symbol complete message enqueue failed");
+  // Completion tag (symbol)
+  return gen_tag_t::FrmSymUe(frame_id, symbol_id, user_id).tag_;
 }
 
-void UeWorker::DoIfft(size_t tag) {
+size_t UeWorker::DoIfft(size_t tag) {
   const size_t frame_id = gen_tag_t(tag).frame_id_;
   const size_t symbol_id = gen_tag_t(tag).symbol_id_;
   const size_t user_id = gen_tag_t(tag).ue_id_;
@@ -668,10 +669,6 @@ void UeWorker::DoIfft(size_t tag) {
         GetTime::CyclesToMs(ifft_duration_stat, GetTime::MeasureRdtscFreq()));
   }
 
-  // Post the completion event (symbol)
-  size_t completion_tag =
-      gen_tag_t::FrmSymUe(frame_id, symbol_id, user_id).tag_;
-  RtAssert(notify_queue_.enqueue(*ptok_.get(),
-                                 EventData(EventType::kIFFT, completion_tag)),
-           "IFFT symbol complete message enqueue failed");
+  // Completion tag (symbol)
+  return gen_tag_t::FrmSymUe(frame_id, symbol_id, user_id).tag_;
 }
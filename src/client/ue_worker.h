@@ -6,6 +6,8 @@
 #ifndef UE_WORKER_H_
 #define UE_WORKER_H_
 
+#include <array>
+#include <atomic>
 #include <complex>
 #include <thread>
 #include <vector>
@@ -16,12 +18,18 @@
 #include "dodecode_client.h"
 #include "doencode.h"
 #include "doifft_client.h"
-#include "mkl_dfti.h"
+#include "fft_backend.h"
 #include "stats.h"
 
 static const size_t kVectorAlignment = 64;
 using myVec = std::vector<complex_float, boost::alignment::aligned_allocator<
                                              complex_float, kVectorAlignment>>;
+/// Work queues of the UE pipeline, indexed by event type. The PhyUe master
+/// thread is the only producer of each queue.
+static constexpr size_t kNumUeEventTypes =
+    static_cast<size_t>(EventType::kFFTPilot) + 1;
+using UeWorkQueues =
+    std::array<moodycamel::ConcurrentQueue<EventData>, kNumUeEventTypes>;
 
 class UeWorker {
  public:
@@ -29,8 +37,7 @@ class UeWorker {
       size_t tid, Config& config, Stats& shared_stats,
       PhyStats& shared_phy_stats,
       moodycamel::ConcurrentQueue<EventData>& notify_queue,
-      moodycamel::ConcurrentQueue<EventData>& work_queue,
-      moodycamel::ProducerToken& work_producer, Table<int8_t>& ul_bits_buffer,
+      UeWorkQueues& work_queues, Table<int8_t>& ul_bits_buffer,
       Table<int8_t>& encoded_buffer, Table<complex_float>& modul_buffer,
       Table<complex_float>& ifft_buffer, char* const tx_buffer,
       Table<char>& rx_buffer, std::vector<myVec>& csi_buffer,
@@ -44,17 +51,33 @@ class UeWorker {
   void Start(size_t core_offset);
   void Stop();
 
+  /// Cycles this worker has spent on tasks so far
+  inline size_t BusyCycles() const {
+    return busy_tsc_.load(std::memory_order_relaxed);
+  }
+
  private:
   void TaskThread(size_t core_offset);
 
+  /**
+   * @brief Run the tasks of one event from the work queue of [event_type],
+   * if there is one, and report their completion to the master thread in
+   * one event.
+   *
+   * @return Return true if an event was handled
+   */
+  bool TryLaunch(EventType event_type);
+  /// Run one task and return the tag of its completion
+  size_t Launch(EventType event_type, size_t tag);
+
   /**
    * modulate data from nUEs and does spatial multiplexing by applying
    * beamweights
    */
-  void DoEncodeUe(DoEncode* encoder, size_t tag);
-  void DoModul(size_t tag);
-  void DoIfftUe(DoIFFTClient* iffter, size_t tag);
-  void DoIfft(size_t tag);
+  size_t DoEncodeUe(DoEncode* encoder, size_t tag);
+  size_t DoModul(size_t tag);
+  size_t DoIfftUe(DoIFFTClient* iffter, size_t tag);
+  size_t DoIfft(size_t tag);
 
   /**
    * Do FFT task for one OFDM symbol
@@ -88,8 +111,8 @@ class UeWorker {
    *     4. add an event to the message queue to infrom main thread the
    * completion of this task
    */
-  void DoFftPilot(size_t tag);
-  void DoFftData(size_t tag);
+  size_t DoFftPilot(size_t tag);
+  size_t DoFftData(size_t tag);
 
   /**
    * Do demodulation task for a block of subcarriers (demul_block_size)
@@ -115,20 +138,30 @@ class UeWorker {
    *     4. add an event to the message queue to infrom main thread the
    * completion of this task
    */
-  void DoDemul(size_t tag);
-  void DoDecodeUe(DoDecodeClient* decoder, size_t tag);
+  size_t DoDemul(size_t tag);
+  /// Decode the code block of [tag], a FrmSymCb tag whose code block ID
+  /// counts the code blocks of all UE antennas in the symbol
+  size_t DoDecodeUe(DoDecodeClient* decoder, size_t tag);
 
   size_t tid_;
 
-  DFTI_DESCRIPTOR_HANDLE mkl_handle_;
+  std::unique_ptr<FftPlan> fft_plan_;
   std::unique_ptr<moodycamel::ProducerToken> ptok_;
   std::thread thread_;
   std::complex<float>* rx_samps_tmp_;  // Temp buffer for received samples
+  std::atomic<size_t> busy_tsc_{0};
+  DurationStat* duration_stat_fft_;
+  DurationStat* duration_stat_csi_;
+  DurationStat* duration_stat_demul_;
+
+  // Created by the worker thread
+  std::unique_ptr<DoEncode> encoder_;
+  std::unique_ptr<DoIFFTClient> iffter_;
+  std::unique_ptr<DoDecodeClient> decoder_;
 
   // Shared Queues
   moodycamel::ConcurrentQueue<EventData>& notify_queue_;
-  moodycamel::ConcurrentQueue<EventData>& work_queue_;
-  moodycamel::ProducerToken& work_producer_token_;
+  UeWorkQueues& work_queues_;
 
   // Shared Objects
   Config& config_;
@@ -0,0 +1,217 @@
+/**
+ * @file async_logger.cc
+ * @brief Implementation file for the AsyncLogger class
+ */
+#include "async_logger.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+static std::atomic<AsyncLogger*> async_logger_instance{nullptr};
+static std::mutex async_logger_init_mutex;
+
+AsyncLogger::LogRing::LogRing()
+    : owned_(true), logging_(false), head_(0), tail_(0) {
+  buffer_ = static_cast<uint8_t*>(std::aligned_alloc(64, kRingCapacity));
+  if (buffer_ == nullptr) {
+    throw std::runtime_error("AsyncLogger: Failed to allocate log ring");
+  }
+}
+
+AsyncLogger::LogRing::~LogRing() { std::free(buffer_); }
+
+uint8_t* AsyncLogger::LogRing::Reserve(size_t len, ConsumeFn consume,
+                                       void* sink) {
+  const size_t record_size =
+      ((sizeof(RecordHeader) + len + kRecordAlign - 1) / kRecordAlign) *
+      kRecordAlign;
+  // Larger records could never fit next to the padding for a wrap-around
+  if (record_size > kRingCapacity / 2) {
+    return nullptr;
+  }
+
+  uint64_t head = head_.load(std::memory_order_relaxed);
+  const uint64_t tail = tail_.load(std::memory_order_acquire);
+  size_t offset = head % kRingCapacity;
+  const size_t to_end = kRingCapacity - offset;
+  const size_t padding = (to_end < record_size) ? to_end : 0;
+  if (head + padding + record_size - tail > kRingCapacity) {
+    return nullptr;
+  }
+
+  if (padding > 0) {
+    auto* pad = reinterpret_cast<RecordHeader*>(buffer_ + offset);
+    pad->size_ = static_cast<uint32_t>(padding);
+    pad->len_ = 0;
+    pad->consume_ = nullptr;
+    head += padding;
+    offset = 0;
+  }
+
+  auto* hdr = reinterpret_cast<RecordHeader*>(buffer_ + offset);
+  hdr->size_ = static_cast<uint32_t>(record_size);
+  hdr->len_ = static_cast<uint32_t>(len);
+  hdr->consume_ = consume;
+  hdr->sink_ = sink;
+  pending_head_ = head + record_size;
+  return buffer_ + offset + sizeof(RecordHeader);
+}
+
+size_t AsyncLogger::LogRing::Drain() {
+  uint64_t tail = tail_.load(std::memory_order_relaxed);
+  const uint64_t head = head_.load(std::memory_order_acquire);
+  size_t num_consumed = 0;
+  while (tail != head) {
+    const auto* hdr =
+        reinterpret_cast<const RecordHeader*>(buffer_ + (tail % kRingCapacity));
+    if (hdr->consume_ != nullptr) {
+      const auto* data =
+          reinterpret_cast<const uint8_t*>(hdr) + sizeof(RecordHeader);
+      hdr->consume_(hdr->sink_, data, hdr->len_);
+      num_consumed++;
+    }
+    tail += hdr->size_;
+    // Free the space record by record so a busy producer is not held back by
+    // a slow sink
+    tail_.store(tail, std::memory_order_release);
+  }
+  return num_consumed;
+}
+
+AsyncLogger::ThreadRingHandle::~ThreadRingHandle() {
+  if (ring_ != nullptr) {
+    ring_->owned_.store(false, std::memory_order_release);
+  }
+}
+
+AsyncLogger::AsyncLogger()
+    : num_rings_(0), running_(true), stopped_(false), dropped_(0) {
+  for (auto& ring : rings_) {
+    ring.store(nullptr, std::memory_order_relaxed);
+  }
+  drain_thread_ = std::thread(&AsyncLogger::DrainLoop, this);
+}
+
+AsyncLogger& AsyncLogger::Instance() {
+  AsyncLogger* instance = async_logger_instance.load(std::memory_order_acquire);
+  if (instance == nullptr) {
+    std::lock_guard<std::mutex> lock(async_logger_init_mutex);
+    instance = async_logger_instance.load(std::memory_order_relaxed);
+    if (instance == nullptr) {
+      // Never deleted so that objects destroyed during exit can still log;
+      // after Shutdown() their records are consumed inline
+      instance = new AsyncLogger();
+      async_logger_instance.store(instance, std::memory_order_release);
+      std::atexit(&AsyncLogger::Shutdown);
+    }
+  }
+  return *instance;
+}
+
+void AsyncLogger::FlushIfRunning() {
+  AsyncLogger* instance = async_logger_instance.load(std::memory_order_acquire);
+  if (instance != nullptr) {
+    instance->Flush();
+  }
+}
+
+void AsyncLogger::Shutdown() {
+  AsyncLogger* instance = async_logger_instance.load(std::memory_order_acquire);
+  if (instance == nullptr ||
+      instance->stopped_.exchange(true, std::memory_order_seq_cst)) {
+    return;
+  }
+  instance->running_.store(false, std::memory_order_release);
+  instance->drain_thread_.join();
+  {
+    std::lock_guard<std::mutex> lock(instance->drain_mutex_);
+    // Producers that passed the stopped_ check before it was set commit
+    // their records to the rings; later ones consume inline
+    const size_t num_rings =
+        instance->num_rings_.load(std::memory_order_seq_cst);
+    for (size_t i = 0; i < num_rings; i++) {
+      const LogRing* ring =
+          instance->rings_[i].load(std::memory_order_acquire);
+      while (ring->logging_.load(std::memory_order_seq_cst)) {
+        std::this_thread::yield();
+      }
+    }
+    instance->DrainAll();
+  }
+
+  const size_t num_dropped = instance->NumDropped();
+  if (num_dropped > 0) {
+    std::fprintf(stderr, "AsyncLogger: %zu log records dropped\n",
+                 num_dropped);
+  }
+}
+
+AsyncLogger::LogRing* AsyncLogger::ClaimRing() {
+  std::lock_guard<std::mutex> lock(claim_mutex_);
+  const size_t num_rings = num_rings_.load(std::memory_order_relaxed);
+  // Reuse the ring of a thread that has exited. Its unconsumed records stay
+  // in order ahead of the new thread's.
+  for (size_t i = 0; i < num_rings; i++) {
+    LogRing* ring = rings_[i].load(std::memory_order_relaxed);
+    bool expected = false;
+    if (ring->owned_.compare_exchange_strong(expected, true,
+                                             std::memory_order_acq_rel)) {
+      return ring;
+    }
+  }
+  if (num_rings == kMaxRings) {
+    return nullptr;
+  }
+  auto* ring = new LogRing();
+  rings_[num_rings].store(ring, std::memory_order_release);
+  num_rings_.store(num_rings + 1, std::memory_order_release);
+  return ring;
+}
+
+size_t AsyncLogger::DrainAll() {
+  const size_t num_rings = num_rings_.load(std::memory_order_acquire);
+  size_t num_consumed = 0;
+  for (size_t i = 0; i < num_rings; i++) {
+    num_consumed += rings_[i].load(std::memory_order_acquire)->Drain();
+  }
+  return num_consumed;
+}
+
+void AsyncLogger::DrainLoop() {
+  while (running_.load(std::memory_order_acquire)) {
+    if (DrainAll() == 0) {
+      std::this_thread::sleep_for(std::chrono::microseconds(kIdleSleepUs));
+    }
+  }
+}
+
+void AsyncLogger::Flush() {
+  if (stopped_.load(std::memory_order_acquire)) {
+    std::lock_guard<std::mutex> lock(drain_mutex_);
+    DrainAll();
+    return;
+  }
+  if (std::this_thread::get_id() == drain_thread_.get_id()) {
+    return;  // A consume function logged; waiting would deadlock
+  }
+
+  const size_t num_rings = num_rings_.load(std::memory_order_acquire);
+  std::array<uint64_t, kMaxRings> heads;
+  for (size_t i = 0; i < num_rings; i++) {
+    heads[i] = rings_[i].load(std::memory_order_acquire)->Head();
+  }
+  for (size_t i = 0; i < num_rings; i++) {
+    const LogRing* ring = rings_[i].load(std::memory_order_acquire);
+    while (ring->Tail() < heads[i] &&
+           !stopped_.load(std::memory_order_acquire)) {
+      std::this_thread::sleep_for(std::chrono::microseconds(kIdleSleepUs));
+    }
+  }
+  if (stopped_.load(std::memory_order_acquire)) {
+    std::lock_guard<std::mutex> lock(drain_mutex_);
+    DrainAll();
+  }
+}
@@ -0,0 +1,183 @@
+/**
+ * @file async_logger.h
+ * @brief Declaration file for the AsyncLogger class, a lock-free logger that
+ * moves formatting and file I/O off the calling thread.
+ *
+ * Every producer thread owns a single-producer single-consumer byte ring.
+ * A log call copies a binary record into the calling thread's ring and
+ * returns; a background drain thread hands each record to the consume
+ * function it was logged with, which formats and writes it. Logging never
+ * blocks the producer: if its ring is full the record is dropped and
+ * counted.
+ */
+#ifndef ASYNC_LOGGER_H_
+#define ASYNC_LOGGER_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+class AsyncLogger {
+ public:
+  /// Called on the drain thread for every record. [data] holds the [len]
+  /// bytes written by the producer, [sink] is passed through unchanged.
+  using ConsumeFn = void (*)(void* sink, const uint8_t* data, size_t len);
+
+  // Bytes of ring space per producer thread
+  static constexpr size_t kRingCapacity = (1u << 20);
+  // Maximum number of threads that can log concurrently
+  static constexpr size_t kMaxRings = 256;
+  // Time the drain thread sleeps when all rings are empty
+  static constexpr size_t kIdleSleepUs = 100;
+
+  /// The process-wide logger. The drain thread is started on first use and
+  /// stopped (after draining every ring) at exit.
+  static AsyncLogger& Instance();
+
+  /// Block until every record logged before this call has been consumed.
+  /// Does nothing if the logger was never used.
+  static void FlushIfRunning();
+
+  /**
+   * @brief Append a record of [len] bytes to the calling thread's ring.
+   * [fill] is called with a pointer to the record bytes and must write all
+   * [len] of them. Returns false if the record was dropped because the ring
+   * is full.
+   */
+  template <typename Fill>
+  inline bool Log(ConsumeFn consume, void* sink, size_t len, Fill&& fill) {
+    if (__builtin_expect(stopped_.load(std::memory_order_acquire), 0)) {
+      return ConsumeInline(consume, sink, len, std::forward<Fill>(fill));
+    }
+    LogRing* ring = ThreadRing();
+    if (__builtin_expect(ring == nullptr, 0)) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    // Shutdown() waits for a producer that saw stopped_ unset to commit, so
+    // that its final DrainAll() consumes the record
+    ring->logging_.store(true, std::memory_order_seq_cst);
+    if (__builtin_expect(stopped_.load(std::memory_order_seq_cst), 0)) {
+      ring->logging_.store(false, std::memory_order_release);
+      return ConsumeInline(consume, sink, len, std::forward<Fill>(fill));
+    }
+    uint8_t* data = ring->Reserve(len, consume, sink);
+    if (__builtin_expect(data == nullptr, 0)) {
+      ring->logging_.store(false, std::memory_order_release);
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    fill(data);
+    ring->Commit();
+    ring->logging_.store(false, std::memory_order_release);
+    return true;
+  }
+
+  /// Block until every record logged before this call has been consumed
+  void Flush();
+
+  /// Number of records dropped because a ring was full
+  inline size_t NumDropped() const {
+    return this->dropped_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  struct RecordHeader {
+    uint32_t size_;  // Bytes from this header to the next one
+    uint32_t len_;   // Bytes of record data after this header
+    ConsumeFn consume_;  // nullptr marks padding up to the end of the ring
+    void* sink_;
+    uint64_t reserved_;
+  };
+  // Records are padded to a multiple of the header size, so the space left
+  // before the end of the ring always fits a padding header
+  static constexpr size_t kRecordAlign = sizeof(RecordHeader);
+  static_assert(kRecordAlign == 32 && (kRingCapacity % kRecordAlign == 0));
+
+  class LogRing {
+   public:
+    LogRing();
+    ~LogRing();
+
+    /// Producer side: reserve space for a record, or return nullptr if the
+    /// ring is full
+    uint8_t* Reserve(size_t len, ConsumeFn consume, void* sink);
+    /// Producer side: publish the record returned by the last Reserve()
+    inline void Commit() {
+      head_.store(pending_head_, std::memory_order_release);
+    }
+
+    /// Consumer side: consume all published records. Returns the number of
+    /// records consumed.
+    size_t Drain();
+
+    inline uint64_t Head() const {
+      return this->head_.load(std::memory_order_acquire);
+    }
+    inline uint64_t Tail() const {
+      return this->tail_.load(std::memory_order_acquire);
+    }
+
+    // True while a live thread produces into this ring
+    std::atomic<bool> owned_;
+    // True while the owning thread is inside Log()
+    std::atomic<bool> logging_;
+
+   private:
+    uint8_t* buffer_;
+    uint64_t pending_head_ = 0;  // Producer-private
+    alignas(64) std::atomic<uint64_t> head_;
+    alignas(64) std::atomic<uint64_t> tail_;
+  };
+
+  /// Releases the calling thread's ring when the thread exits
+  struct ThreadRingHandle {
+    LogRing* ring_ = nullptr;
+    bool claimed_ = false;
+    ~ThreadRingHandle();
+  };
+
+  AsyncLogger();
+  ~AsyncLogger() = delete;  // Intentionally leaked, see Instance()
+
+  static void Shutdown();
+
+  inline LogRing* ThreadRing() {
+    static thread_local ThreadRingHandle handle;
+    if (__builtin_expect(handle.claimed_ == false, 0)) {
+      handle.ring_ = ClaimRing();
+      handle.claimed_ = true;
+    }
+    return handle.ring_;
+  }
+  LogRing* ClaimRing();
+
+  template <typename Fill>
+  inline bool ConsumeInline(ConsumeFn consume, void* sink, size_t len,
+                            Fill&& fill) {
+    auto* data = new uint8_t[len == 0 ? 1 : len];
+    fill(data);
+    consume(sink, data, len);
+    delete[] data;
+    return true;
+  }
+
+  void DrainLoop();
+  size_t DrainAll();
+
+  std::array<std::atomic<LogRing*>, kMaxRings> rings_;
+  std::atomic<size_t> num_rings_;
+  std::mutex claim_mutex_;  // Only taken when a thread logs for the first time
+  std::mutex drain_mutex_;  // Serializes DrainAll() after shutdown
+
+  std::atomic<bool> running_;
+  std::atomic<bool> stopped_;
+  std::atomic<size_t> dropped_;
+  std::thread drain_thread_;
+};
+
+#endif  // ASYNC_LOGGER_H_
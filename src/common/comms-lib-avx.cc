@@ -297,6 +297,66 @@ std::vector<std::complex<float>> CommsLib::ComplexMultAvx(
   return out;
 }
 
+/// Divide complex single precision floats: num / den = num * conj(den) /
+/// |den|^2
+__m256 CommsLib::M256ComplexCf32Div(__m256 num, __m256 den) {
+  const __m256 prod = M256ComplexCf32Mult(num, den, true);
+  const __m256 sq = _mm256_mul_ps(den, den);
+  // |den|^2 in both the real and the imaginary slot
+  const __m256 mag = _mm256_add_ps(sq, _mm256_permute_ps(sq, 0xb1));
+  return _mm256_div_ps(prod, mag);
+}
+
+void CommsLib::CsiAccumulateAvx(const complex_float* rx,
+                                const complex_float* pilot,
+                                complex_float* csi, size_t len) {
+  const auto* in0 = reinterpret_cast<const float*>(rx);
+  const auto* in1 = reinterpret_cast<const float*>(pilot);
+  auto* outf = reinterpret_cast<float*>(csi);
+
+  const size_t rem = (2 * len) - ((2 * len) % AVX_PACKED_SP);
+  for (size_t i = 0; i < rem; i += AVX_PACKED_SP) {
+    const __m256 res = M256ComplexCf32Div(_mm256_loadu_ps(in0 + i),
+                                          _mm256_loadu_ps(in1 + i));
+    _mm256_storeu_ps(outf + i, _mm256_add_ps(_mm256_loadu_ps(outf + i), res));
+  }
+
+  for (size_t i = rem / 2; i < len; i++) {
+    const std::complex<float> res =
+        std::complex<float>(rx[i].re, rx[i].im) /
+        std::complex<float>(pilot[i].re, pilot[i].im);
+    csi[i].re += res.real();
+    csi[i].im += res.imag();
+  }
+}
+
+void CommsLib::EqualizeAvx(const complex_float* rx, const complex_float* csi,
+                           complex_float phase, complex_float* out,
+                           size_t len) {
+  const auto* in0 = reinterpret_cast<const float*>(rx);
+  const auto* in1 = reinterpret_cast<const float*>(csi);
+  auto* outf = reinterpret_cast<float*>(out);
+  const __m256 phase_vec =
+      _mm256_setr_ps(phase.re, phase.im, phase.re, phase.im, phase.re,
+                     phase.im, phase.re, phase.im);
+
+  const size_t rem = (2 * len) - ((2 * len) % AVX_PACKED_SP);
+  for (size_t i = 0; i < rem; i += AVX_PACKED_SP) {
+    const __m256 res = M256ComplexCf32Div(_mm256_loadu_ps(in0 + i),
+                                          _mm256_loadu_ps(in1 + i));
+    _mm256_storeu_ps(outf + i, M256ComplexCf32Mult(res, phase_vec, false));
+  }
+
+  for (size_t i = rem / 2; i < len; i++) {
+    const std::complex<float> res =
+        std::complex<float>(rx[i].re, rx[i].im) /
+        std::complex<float>(csi[i].re, csi[i].im) *
+        std::complex<float>(phase.re, phase.im);
+    out[i].re = res.real();
+    out[i].im = res.imag();
+  }
+}
+
 std::vector<std::complex<float>> CommsLib::AutoCorrMultAvx(
     std::vector<std::complex<float>> const& f, const int dly, const bool conj) {
 #if 0
@@ -24,6 +24,8 @@
 
 #include <utility>
 
+#include "fft_backend.h"
+
 size_t CommsLib::FindPilotSeq(std::vector<std::complex<float>> iq,
                               std::vector<std::complex<float>> pilot,
                               size_t seq_len) {
@@ -339,12 +341,8 @@ std::vector<std::complex<float>> CommsLib::GetPilotSc(int fftSize) {
 
 std::vector<std::complex<float>> CommsLib::IFFT(
     std::vector<std::complex<float>> in, int fftsize, bool normalize) {
-  DFTI_DESCRIPTOR_HANDLE mkl_handle;
-  (void)DftiCreateDescriptor(&mkl_handle, DFTI_SINGLE, DFTI_COMPLEX, 1,
-                             fftsize);
-  (void)DftiCommitDescriptor(mkl_handle);
-  DftiComputeBackward(mkl_handle, in.data());
-  DftiFreeDescriptor(&mkl_handle);
+  FftPlan::Create(FftDirection::kBackward, fftsize)
+      ->Execute(reinterpret_cast<complex_float*>(in.data()));
   if (normalize) {
     float max_val = 0;
     float scale = 0.5;
@@ -368,40 +366,14 @@ std::vector<std::complex<float>> CommsLib::IFFT(
 
 std::vector<std::complex<float>> CommsLib::FFT(
     std::vector<std::complex<float>> in, int fftsize) {
-  DFTI_DESCRIPTOR_HANDLE mkl_handle;
-  (void)DftiCreateDescriptor(&mkl_handle, DFTI_SINGLE, DFTI_COMPLEX, 1,
-                             fftsize);
-  (void)DftiCommitDescriptor(mkl_handle);
   /* compute FFT */
-  DftiComputeForward(mkl_handle, in.data());
-  DftiFreeDescriptor(&mkl_handle);
+  FftPlan::Create(FftDirection::kForward, fftsize)
+      ->Execute(reinterpret_cast<complex_float*>(in.data()));
   return in;
 }
 
 void CommsLib::IFFT(complex_float* in, int fftsize, bool normalize) {
-  DFTI_DESCRIPTOR_HANDLE mkl_handle;
-  MKL_LONG status =
-      DftiCreateDescriptor(&mkl_handle, DFTI_SINGLE, DFTI_COMPLEX, 1, fftsize);
-  if (DftiErrorClass(status, DFTI_NO_ERROR) == 0) {
-    std::printf("Error in DftiCreateDescriptor: %s\n",
-                DftiErrorMessage(status));
-    assert(status != 0);
-  }
-  status = DftiCommitDescriptor(mkl_handle);
-  if (DftiErrorClass(status, DFTI_NO_ERROR) == 0) {
-    std::printf("Error in DftiErrorClass: %s\n", DftiErrorMessage(status));
-    assert(status != 0);
-  }
-  status = DftiComputeBackward(mkl_handle, in);
-  if (DftiErrorClass(status, DFTI_NO_ERROR) == 0) {
-    std::printf("Error in DftiComputeBackward: %s\n", DftiErrorMessage(status));
-    assert(status != 0);
-  }
-  status = DftiFreeDescriptor(&mkl_handle);
-  if (DftiErrorClass(status, DFTI_NO_ERROR) == 0) {
-    std::printf("Error in DftiFreeDescriptor: %s\n", DftiErrorMessage(status));
-    assert(status != 0);
-  }
+  FftPlan::Create(FftDirection::kBackward, fftsize)->Execute(in);
   if (normalize == true) {
     float max_val = 0;
     // int max_ind = 0;
@@ -427,14 +399,8 @@ void CommsLib::IFFT(complex_float* in, int fftsize, bool normalize) {
 }
 
 void CommsLib::FFT(complex_float* in, int fftsize) {
-  DFTI_DESCRIPTOR_HANDLE mkl_handle;
-  MKL_LONG status =
-      DftiCreateDescriptor(&mkl_handle, DFTI_SINGLE, DFTI_COMPLEX, 1, fftsize);
-  status = DftiCommitDescriptor(mkl_handle);
   /* compute FFT */
-  status = DftiComputeForward(mkl_handle, in);
-  status = DftiFreeDescriptor(&mkl_handle);
-  (void)(status);
+  FftPlan::Create(FftDirection::kForward, fftsize)->Execute(in);
 }
 
 std::vector<std::complex<float>> CommsLib::ComposePartialPilotSym(
@@ -24,7 +24,6 @@
 
 #include "buffer.h"
 #include "memory_manage.h"
-#include "mkl_dfti.h"
 
 class CommsLib {
  public:
@@ -128,8 +127,18 @@ class CommsLib {
   static std::vector<std::complex<int16_t>> CorrelateAvx(
       std::vector<std::complex<int16_t>> const& f,
       std::vector<std::complex<int16_t>> const& g);
+  /// Add the channel estimate of [len] subcarriers to [csi]:
+  /// csi += rx / pilot
+  static void CsiAccumulateAvx(const complex_float* rx,
+                               const complex_float* pilot, complex_float* csi,
+                               size_t len);
+  /// Equalize [len] subcarriers and correct their phase:
+  /// out = rx / csi * phase
+  static void EqualizeAvx(const complex_float* rx, const complex_float* csi,
+                          complex_float phase, complex_float* out, size_t len);
 
   static __m256 M256ComplexCf32Mult(__m256 data1, __m256 data2, bool conj);
+  static __m256 M256ComplexCf32Div(__m256 num, __m256 den);
 #ifdef __AVX512F__
   static __m512 M512ComplexCf32Mult(__m512 data1, __m512 data2, bool conj);
 #endif
@@ -9,17 +9,65 @@
 
 #include "config.h"
 
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#include <algorithm>
 #include <boost/range/algorithm/count.hpp>
+#include <cinttypes>
+#include <thread>
 
 #include "logger.h"
 #include "nlohmann/json.hpp"
+#include "parallel_for.h"
 #include "scrambler.h"
+#include "table_file.h"
 #include "utils_ldpc.h"
 
 using json = nlohmann::json;
 
 static const size_t kMacAlignmentBytes = 64u;
 static constexpr bool kDebugPrintConfiguration = false;
+// Bump when GenData() changes what it generates, to invalidate old caches
+static constexpr uint64_t kGenDataCacheVersion = 1;
+// GenData caches kept in the cache directory; the least recently used ones
+// beyond this are deleted
+static constexpr size_t kMaxGenDataCacheFiles = 8;
+static const std::string kGenDataCachePrefix = "gendata_cache_";
+
+/// Delete all but the kMaxGenDataCacheFiles most recently used GenData caches
+/// in [cache_dir]
+static void EvictGenDataCaches(const std::string& cache_dir) {
+  DIR* dir = opendir(cache_dir.c_str());
+  if (dir == nullptr) {
+    return;
+  }
+  std::vector<std::pair<time_t, std::string>> caches;
+  for (struct dirent* entry = readdir(dir); entry != nullptr;
+       entry = readdir(dir)) {
+    const std::string name = entry->d_name;
+    if (name.compare(0, kGenDataCachePrefix.size(), kGenDataCachePrefix) !=
+        0) {
+      continue;
+    }
+    const std::string path = cache_dir + "/" + name;
+    struct stat file_stat;
+    if (stat(path.c_str(), &file_stat) == 0) {
+      caches.emplace_back(file_stat.st_mtime, path);
+    }
+  }
+  closedir(dir);
+
+  if (caches.size() <= kMaxGenDataCacheFiles) {
+    return;
+  }
+  std::sort(caches.begin(), caches.end(), std::greater<>());
+  for (size_t i = kMaxGenDataCacheFiles; i < caches.size(); i++) {
+    MLPD_INFO("Config: Evicting GenData cache %s\n", caches[i].second.c_str());
+    std::remove(caches[i].second.c_str());
+  }
+}
 
 Config::Config(const std::string& jsonfile)
     : freq_ghz_(GetTime::MeasureRdtscFreq()),
@@ -30,6 +78,7 @@ Config::Config(const std::string& jsonfile)
 
   std::string conf;
   Utils::LoadTddConfig(jsonfile, conf);
+  config_hash_ = TableFile<uint8_t>::Checksum(conf.data(), conf.size());
   // Allow json comments
   const auto tdd_conf = json::parse(conf, nullptr, true, true);
 
@@ -214,6 +263,10 @@ Config::Config(const std::string& jsonfile)
   bs_rru_port_ = tdd_conf.value("bs_rru_port", 9000);
   ue_rru_port_ = tdd_conf.value("ue_rru_port", 7000);
   ue_server_port_ = tdd_conf.value("ue_server_port", 6000);
+  closed_loop_port_ = tdd_conf.value("closed_loop_port", 0);
+  closed_loop_window_ = tdd_conf.value("closed_loop_window", 1);
+  RtAssert((closed_loop_window_ > 0) && (closed_loop_window_ <= kFrameWnd),
+           "Closed loop window must be between 1 and the frame window");
 
   dpdk_num_ports_ = tdd_conf.value("dpdk_num_ports", 1);
   dpdk_port_offset_ = tdd_conf.value("dpdk_port_offset", 0);
@@ -452,6 +505,11 @@ Config::Config(const std::string& jsonfile)
   core_offset_ = tdd_conf.value("core_offset", 0);
   worker_thread_num_ = tdd_conf.value("worker_thread_num", 25);
   socket_thread_num_ = tdd_conf.value("socket_thread_num", 4);
+  mac_thread_num_ = tdd_conf.value("mac_thread_num", 1);
+  RtAssert((mac_thread_num_ > 0) && (mac_thread_num_ <= kMaxMacThreads) &&
+               (mac_thread_num_ <= ue_ant_num_),
+           "mac_thread_num must be between 1 and the number of UE antennas "
+           "(at most kMaxMacThreads)");
   ue_core_offset_ = tdd_conf.value("ue_core_offset", 0);
   ue_worker_thread_num_ = tdd_conf.value("ue_worker_thread_num", 25);
   ue_socket_thread_num_ = tdd_conf.value("ue_socket_thread_num", 4);
@@ -477,7 +535,22 @@ Config::Config(const std::string& jsonfile)
 
   fft_block_size_ = tdd_conf.value("fft_block_size", 1);
   fft_block_size_ = std::max(fft_block_size_, num_channels_);
+  RtAssert(fft_block_size_ <= EventData::kMaxTags,
+           "FFT block size exceeds the number of tags in an event");
   encode_block_size_ = tdd_conf.value("encode_block_size", 1);
+  RtAssert(encode_block_size_ <= EventData::kMaxTags,
+           "Encode block size exceeds the number of tags in an event");
+  ue_fft_block_size_ = tdd_conf.value("ue_fft_block_size", 1);
+  ue_demul_block_size_ = tdd_conf.value("ue_demul_block_size", 1);
+  ue_decode_block_size_ = tdd_conf.value("ue_decode_block_size", 1);
+  RtAssert((ue_fft_block_size_ > 0) &&
+               (ue_fft_block_size_ <= EventData::kMaxTags) &&
+               (ue_demul_block_size_ > 0) &&
+               (ue_demul_block_size_ <= EventData::kMaxTags) &&
+               (ue_decode_block_size_ > 0) &&
+               (ue_decode_block_size_ <= EventData::kMaxTags),
+           "UE block sizes must be between 1 and the number of tags in an "
+           "event");
 
   noise_level_ = tdd_conf.value("noise_level", 0.03);  // default: 30 dB
   MLPD_SYMBOL("Noise level: %.2f\n", noise_level_);
@@ -493,10 +566,26 @@ Config::Config(const std::string& jsonfile)
 
   ldpc_config_ = LDPCconfig(base_graph, zc, max_decoder_iter, early_term,
                             num_cb_len, num_cb_codew_len, num_rows, 0);
+  harq_max_tx_ = tdd_conf.value("harq_max_tx", 1);
+  RtAssert(harq_max_tx_ > 0, "harq_max_tx must be at least 1");
+  // With the MAC each frame carries new data, and frames do not yet say
+  // which code blocks are retransmissions, so there is nothing to combine
+  RtAssert((kEnableMac == false) || (harq_max_tx_ == 1),
+           "harq_max_tx > 1 is not supported with the MAC enabled");
+  decoder_deadline_us_ = tdd_conf.value("decoderDeadlineUs", 0.0);
+  decoder_min_iter_ = tdd_conf.value("decoderMinIter", 1);
+  RtAssert((decoder_min_iter_ > 0) &&
+               (decoder_min_iter_ <= static_cast<size_t>(max_decoder_iter)),
+           "decoderMinIter must be between 1 and decoderIter");
+  llr_scaling_ = tdd_conf.value("llr_scaling", false);
+  llr_scale_ref_snr_db_ = tdd_conf.value("llr_scale_ref_snr_db", 20.0f);
 
   // Scrambler and descrambler configurations
   scramble_enabled_ = tdd_conf.value("wlan_scrambler", true);
 
+  // Downlink encode + modulation fusion
+  fused_dl_modulation_ = tdd_conf.value("dl_fused_modulation", false);
+
   // Modulation configurations
   mod_order_bits_ =
       modulation_ == "64QAM"
@@ -522,6 +611,18 @@ Config::Config(const std::string& jsonfile)
       ldpc_config_.NumRows());
 
   fft_in_rru_ = tdd_conf.value("fft_in_rru", false);
+  fft_pruning_ = tdd_conf.value("fft_pruning", false);
+  fft_pruning_decimation_ = tdd_conf.value("fft_pruning_decimation", 0);
+  fft_batched_ = tdd_conf.value("fft_batched", false);
+  // The batched DoFFT path transforms whole symbols and bypasses PrunedFft
+  RtAssert((fft_batched_ == false) || (fft_pruning_ == false),
+           "fft_batched and fft_pruning cannot be enabled together");
+  gen_data_cache_ = tdd_conf.value("gen_data_cache", true);
+  std::string fft_backend = tdd_conf.value("fft_backend", "default");
+  fft_backend_ = (fft_backend == "default") ? kDefaultFftBackend
+                                            : FftPlan::FromString(fft_backend);
+  RtAssert(FftPlan::IsAvailable(fft_backend_),
+           "FFT backend " + fft_backend + " is not compiled into this binary");
 
   samps_per_symbol_ =
       ofdm_tx_zero_prefix_ + ofdm_ca_num_ + cp_len_ + ofdm_tx_zero_postfix_;
@@ -576,6 +677,28 @@ Config::Config(const std::string& jsonfile)
   Print();
 }
 
+/// Map the reference bits in [filename], which must hold a [num_rows] x
+/// [row_bytes] table
+static std::unique_ptr<TableFile<int8_t>> MapReferenceBits(
+    const std::string& filename, size_t num_rows, size_t row_bytes) {
+  std::unique_ptr<TableFile<int8_t>> file;
+  try {
+    file = TableFile<int8_t>::Open(filename);
+  } catch (const std::runtime_error& e) {
+    MLPD_ERROR("Failed to map reference data file %s: %s\n", filename.c_str(),
+               e.what());
+    throw std::runtime_error("Config: Failed to map reference data file");
+  }
+  if ((file->Dim1() != num_rows) || (file->Dim2() != row_bytes)) {
+    MLPD_ERROR(
+        "Reference data file %s holds %zu x %zu bytes, expected %zu x %zu. "
+        "Rerun the data generator with this config.\n",
+        filename.c_str(), file->Dim1(), file->Dim2(), num_rows, row_bytes);
+    throw std::runtime_error("Config: Reference data file does not match");
+  }
+  return file;
+}
+
 void Config::GenData() {
   if ((kUseArgos == true) || (kUseUHD == true)) {
     std::vector<std::vector<double>> gold_ifft =
@@ -688,18 +811,12 @@ void Config::GenData() {
   // Get uplink and downlink raw bits either from file or random numbers
   size_t num_bytes_per_ue_pad = Roundup<64>(this->num_bytes_per_cb_) *
                                 this->ldpc_config_.NumBlocksInSymbol();
-  dl_bits_.Malloc(this->frame_.NumDLSyms(),
-                  num_bytes_per_ue_pad * this->ue_ant_num_,
-                  Agora_memory::Alignment_t::kAlign64);
   dl_iq_f_.Calloc(this->frame_.NumDLSyms(), ofdm_ca_num_ * ue_ant_num_,
                   Agora_memory::Alignment_t::kAlign64);
   dl_iq_t_.Calloc(this->frame_.NumDLSyms(),
                   this->samps_per_symbol_ * this->ue_ant_num_,
                   Agora_memory::Alignment_t::kAlign64);
 
-  ul_bits_.Malloc(this->frame_.NumULSyms(),
-                  num_bytes_per_ue_pad * this->ue_ant_num_,
-                  Agora_memory::Alignment_t::kAlign64);
   ul_iq_f_.Calloc(this->frame_.NumULSyms(),
                   this->ofdm_ca_num_ * this->ue_ant_num_,
                   Agora_memory::Alignment_t::kAlign64);
@@ -707,7 +824,14 @@ void Config::GenData() {
                   this->samps_per_symbol_ * this->ue_ant_num_,
                   Agora_memory::Alignment_t::kAlign64);
 
+  uint64_t cache_key = 0;
 #ifdef GENERATE_DATA
+  dl_bits_.Malloc(this->frame_.NumDLSyms(),
+                  num_bytes_per_ue_pad * this->ue_ant_num_,
+                  Agora_memory::Alignment_t::kAlign64);
+  ul_bits_.Malloc(this->frame_.NumULSyms(),
+                  num_bytes_per_ue_pad * this->ue_ant_num_,
+                  Agora_memory::Alignment_t::kAlign64);
   for (size_t ue_id = 0; ue_id < this->ue_ant_num_; ue_id++) {
     for (size_t j = 0; j < num_bytes_per_ue_pad; j++) {
       int cur_offset = j * ue_ant_num_ + ue_id;
@@ -720,233 +844,245 @@ void Config::GenData() {
     }
   }
 #else
+  // The reference files hold the bits of all UEs in the layout of ul_bits_
+  // and dl_bits_, so they are mapped and used in place. The tables of UEs
+  // ue_ant_offset_ to ue_ant_offset_ + ue_ant_num_ start ue_ant_offset_
+  // UEs into each row of the file.
   std::string cur_directory = TOSTRING(PROJECT_DIRECTORY);
   if (this->frame_.NumUlDataSyms() > 0) {
     std::string ul_data_file = cur_directory + "/data/LDPC_orig_ul_data_" +
                                std::to_string(this->ofdm_ca_num_) + "_ant" +
                                std::to_string(this->ue_ant_total_) + ".bin";
-    MLPD_SYMBOL("Config: Reading raw ul data from %s\n", ul_data_file.c_str());
-    FILE* fd = std::fopen(ul_data_file.c_str(), "rb");
-    if (fd == nullptr) {
-      MLPD_ERROR("Failed to open antenna file %s. Error %s.\n",
-                 ul_data_file.c_str(), strerror(errno));
-      throw std::runtime_error("Config: Failed to open antenna file");
-    }
-
-    for (size_t i = this->frame_.ClientUlPilotSymbols();
-         i < this->frame_.NumULSyms(); i++) {
-      if (std::fseek(fd, (data_bytes_num_persymbol_ * this->ue_ant_offset_),
-                     SEEK_CUR) != 0) {
-        MLPD_ERROR(" *** Error: failed to seek propertly (pre) into %s file\n",
-                   ul_data_file.c_str());
-        RtAssert(false,
-                 "Failed to seek propertly into " + ul_data_file + "file\n");
-      }
-      for (size_t j = 0; j < this->ue_ant_num_; j++) {
-        size_t r = std::fread(this->ul_bits_[i] + (j * num_bytes_per_ue_pad),
-                              sizeof(int8_t), data_bytes_num_persymbol_, fd);
-        if (r < data_bytes_num_persymbol_) {
-          MLPD_ERROR(
-              " *** Error: Uplink bad read from file %s (batch %zu : %zu) "
-              "%zu : %zu\n",
-              ul_data_file.c_str(), i, j, r, data_bytes_num_persymbol_);
-        }
-      }
-      if (std::fseek(fd,
-                     data_bytes_num_persymbol_ *
-                         (this->ue_ant_total_ - this->ue_ant_offset_ -
-                          this->ue_ant_num_),
-                     SEEK_CUR) != 0) {
-        MLPD_ERROR(" *** Error: failed to seek propertly (post) into %s file\n",
-                   ul_data_file.c_str());
-        RtAssert(false,
-                 "Failed to seek propertly into " + ul_data_file + "file\n");
-      }
-    }
-    std::fclose(fd);
+    MLPD_SYMBOL("Config: Mapping raw ul data from %s\n", ul_data_file.c_str());
+    ul_bits_file_ =
+        MapReferenceBits(ul_data_file, this->frame_.NumULSyms(),
+                         num_bytes_per_ue_pad * this->ue_ant_total_);
+    ul_bits_.View(ul_bits_file_->Row(0) +
+                      (num_bytes_per_ue_pad * this->ue_ant_offset_),
+                  ul_bits_file_->Dim1(), ul_bits_file_->Dim2());
+  } else {
+    ul_bits_.Calloc(this->frame_.NumULSyms(),
+                    num_bytes_per_ue_pad * this->ue_ant_num_,
+                    Agora_memory::Alignment_t::kAlign64);
   }
 
   if (this->frame_.NumDlDataSyms() > 0) {
     std::string dl_data_file = cur_directory + "/data/LDPC_orig_dl_data_" +
                                std::to_string(this->ofdm_ca_num_) + "_ant" +
                                std::to_string(this->ue_ant_total_) + ".bin";
+    MLPD_SYMBOL("Config: Mapping raw dl data from %s\n", dl_data_file.c_str());
+    dl_bits_file_ =
+        MapReferenceBits(dl_data_file, this->frame_.NumDLSyms(),
+                         num_bytes_per_ue_pad * this->ue_ant_total_);
+    dl_bits_.View(dl_bits_file_->Row(0) +
+                      (num_bytes_per_ue_pad * this->ue_ant_offset_),
+                  dl_bits_file_->Dim1(), dl_bits_file_->Dim2());
+  } else {
+    dl_bits_.Calloc(this->frame_.NumDLSyms(),
+                    num_bytes_per_ue_pad * this->ue_ant_num_,
+                    Agora_memory::Alignment_t::kAlign64);
+  }
 
-    MLPD_SYMBOL("Config: Reading raw dl data from %s\n", dl_data_file.c_str());
-    FILE* fd = std::fopen(dl_data_file.c_str(), "rb");
-    if (fd == nullptr) {
-      MLPD_ERROR("Failed to open antenna file %s. Error %s.\n",
-                 dl_data_file.c_str(), strerror(errno));
-      throw std::runtime_error("Config: Failed to open dl antenna file");
+  // The reference symbols only depend on the config and the reference bits
+  const std::string cache_dir =
+      this->gen_data_cache_ ? Utils::CacheDir() : std::string();
+  if (this->gen_data_cache_ && cache_dir.empty()) {
+    MLPD_WARN("Config: No cache directory, not caching the GenData output\n");
+  } else if (this->gen_data_cache_) {
+    const uint64_t key_inputs[] = {
+        kGenDataCacheVersion, this->config_hash_,
+        (ul_bits_file_ == nullptr) ? 0 : ul_bits_file_->StoredChecksum(),
+        (dl_bits_file_ == nullptr) ? 0 : dl_bits_file_->StoredChecksum()};
+    cache_key = TableFile<uint8_t>::Checksum(key_inputs, sizeof(key_inputs));
+    char cache_name[64];
+    std::snprintf(cache_name, sizeof(cache_name), "/%s%016" PRIx64 ".bin",
+                  kGenDataCachePrefix.c_str(), cache_key);
+    gen_data_cache_file_ = cache_dir + cache_name;
+  }
+#endif
+
+  // Peak of the pilots, which scale_ must also cover
+  const float pilot_max_val =
+      std::max(CommsLib::FindMaxAbs(ue_pilot_ifft, this->ue_ant_num_,
+                                    this->ofdm_ca_num_),
+               CommsLib::FindMaxAbs(pilot_ifft, this->ofdm_ca_num_));
+
+  if (gen_data_cache_file_.empty() ||
+      !LoadGenDataCache(gen_data_cache_file_, cache_key)) {
+    const double gen_start_us = GetTime::GetTimeUs();
+    GenIqSymbols(pilot_max_val);
+    MLPD_INFO("Config: Generated the reference symbols in %.1f ms\n",
+              (GetTime::GetTimeUs() - gen_start_us) / 1000.0);
+    if (!gen_data_cache_file_.empty()) {
+      SaveGenDataCache(gen_data_cache_file_, cache_key);
     }
+  }
 
-    for (size_t i = this->frame_.ClientDlPilotSymbols();
-         i < this->frame_.NumDLSyms(); i++) {
-      for (size_t j = 0; j < this->ue_ant_num_; j++) {
-        size_t r = std::fread(this->dl_bits_[i] + j * num_bytes_per_ue_pad,
-                              sizeof(int8_t), data_bytes_num_persymbol_, fd);
-        if (r < data_bytes_num_persymbol_) {
-          MLPD_ERROR(
-              "***Error: Downlink bad read from file %s (batch %zu : %zu) "
-              "\n",
-              dl_data_file.c_str(), i, j);
-        }
+  // Generate time domain ue-specific pilot symbols
+  for (size_t i = 0; i < this->ue_ant_num_; i++) {
+    CommsLib::Ifft2tx(ue_pilot_ifft[i], this->ue_specific_pilot_t_[i],
+                      this->ofdm_ca_num_, this->ofdm_tx_zero_prefix_,
+                      this->cp_len_, this->scale_);
+    if (kDebugPrintPilot == true) {
+      std::printf("ue_specific_pilot_t%zu=[", i);
+      for (size_t j = 0; j < this->ofdm_ca_num_; j++) {
+        std::printf("%2.4f+%2.4fi ", ue_pilot_ifft[i][j].re,
+                    ue_pilot_ifft[i][j].im);
       }
+      std::printf("]\n");
     }
-    std::fclose(fd);
   }
-#endif
 
-  auto scrambler = std::make_unique<AgoraScrambler::Scrambler>();
-
-  const size_t encoded_bytes_per_block =
-      BitsToBytes(this->ldpc_config_.NumCbCodewLen());
-  const size_t num_blocks_per_symbol =
-      this->ldpc_config_.NumBlocksInSymbol() * this->ue_ant_num_;
-
-  // Used as an input ptr to
-  auto* scramble_buffer =
-      new int8_t[num_bytes_per_cb_ +
-                 kLdpcHelperFunctionInputBufferSizePaddingBytes]();
-  int8_t* ldpc_input = nullptr;
+  this->pilot_ci16_.resize(samps_per_symbol_, 0);
+  CommsLib::Ifft2tx(pilot_ifft,
+                    (std::complex<int16_t>*)this->pilot_ci16_.data(),
+                    ofdm_ca_num_, ofdm_tx_zero_prefix_, cp_len_, scale_);
 
-  // Encode uplink bits
-  ul_encoded_bits_.Malloc(this->frame_.NumULSyms() * num_blocks_per_symbol,
-                          encoded_bytes_per_block,
-                          Agora_memory::Alignment_t::kAlign64);
-  ul_mod_input_.Calloc(this->frame_.NumULSyms(),
-                       this->ofdm_data_num_ * this->ue_ant_num_,
-                       Agora_memory::Alignment_t::kAlign32);
-  auto* temp_parity_buffer = new int8_t[LdpcEncodingParityBufSize(
-      this->ldpc_config_.BaseGraph(), this->ldpc_config_.ExpansionFactor())];
+  for (size_t i = 0; i < ofdm_ca_num_; i++) {
+    this->pilot_cf32_.emplace_back(pilot_ifft[i].re / scale_,
+                                   pilot_ifft[i].im / scale_);
+  }
+  this->pilot_cf32_.insert(this->pilot_cf32_.begin(),
+                           this->pilot_cf32_.end() - this->cp_len_,
+                           this->pilot_cf32_.end());  // add CP
 
-  for (size_t i = 0; i < frame_.NumULSyms(); i++) {
-    for (size_t j = 0; j < ue_ant_num_; j++) {
-      for (size_t k = 0; k < ldpc_config_.NumBlocksInSymbol(); k++) {
-        int8_t* coded_bits_ptr =
-            ul_encoded_bits_[i * num_blocks_per_symbol +
-                             j * ldpc_config_.NumBlocksInSymbol() + k];
+  // generate a UINT32 version to write to FPGA buffers
+  this->pilot_ = Utils::Cfloat32ToUint32(this->pilot_cf32_, false, "QI");
 
-        if (scramble_enabled_) {
-          std::memcpy(scramble_buffer, GetInfoBits(ul_bits_, i, j, k),
-                      num_bytes_per_cb_);
-          scrambler->Scramble(scramble_buffer, num_bytes_per_cb_);
-          ldpc_input = scramble_buffer;
-        } else {
-          ldpc_input = GetInfoBits(ul_bits_, i, j, k);
-        }
+  std::vector<uint32_t> pre_uint32(this->ofdm_tx_zero_prefix_, 0);
+  this->pilot_.insert(this->pilot_.begin(), pre_uint32.begin(),
+                      pre_uint32.end());
+  this->pilot_.resize(this->samps_per_symbol_);
 
-        LdpcEncodeHelper(ldpc_config_.BaseGraph(),
-                         ldpc_config_.ExpansionFactor(), ldpc_config_.NumRows(),
-                         coded_bits_ptr, temp_parity_buffer, ldpc_input);
-        AdaptBitsForMod(reinterpret_cast<uint8_t*>(coded_bits_ptr),
-                        ul_mod_input_[i] + j * ofdm_data_num_ +
-                            k * encoded_bytes_per_block / mod_order_bits_,
-                        encoded_bytes_per_block, mod_order_bits_);
-      }
+  if (kDebugPrintPilot == true) {
+    std::cout << "Pilot data: " << std::endl;
+    for (size_t i = 0; i < this->ofdm_data_num_; i++) {
+      std::cout << this->pilots_[i].re << "+1i*" << this->pilots_[i].im << ",";
     }
+    std::cout << std::endl;
   }
 
-  // Generate freq-domain uplink symbols
-  Table<complex_float> ul_iq_ifft;
-  ul_iq_ifft.Calloc(this->frame_.NumULSyms(),
-                    this->ofdm_ca_num_ * this->ue_ant_num_,
-                    Agora_memory::Alignment_t::kAlign64);
-  for (size_t i = 0; i < this->frame_.NumULSyms(); i++) {
-    for (size_t u = 0; u < this->ue_ant_num_; u++) {
-      size_t p = u * this->ofdm_data_num_;
-      size_t q = u * this->ofdm_ca_num_;
-
-      for (size_t j = this->ofdm_data_start_; j < this->ofdm_data_stop_; j++) {
-        size_t k = j - ofdm_data_start_;
-        size_t s = p + k;
-        ul_iq_f_[i][q + j] = ModSingleUint8(ul_mod_input_[i][s], mod_table_);
-        ul_iq_ifft[i][q + j] = ul_iq_f_[i][q + j];
+  if (kDebugPrintPilot) {
+    for (size_t ue_id = 0; ue_id < ue_ant_num_; ue_id++) {
+      std::cout << "UE" << ue_id << "_pilot_data =[" << std::endl;
+      for (size_t i = 0; i < ofdm_data_num_; i++) {
+        std::cout << ue_specific_pilot_[ue_id][i].re << "+1i*"
+                  << ue_specific_pilot_[ue_id][i].im << " ";
       }
-      CommsLib::IFFT(&ul_iq_ifft[i][q], ofdm_ca_num_, false);
+      std::cout << "];" << std::endl;
     }
   }
 
-  // Encode downlink bits
+  ue_pilot_ifft.Free();
+  FreeBuffer1d(&pilot_ifft);
+}
+
+void Config::GenIqSymbols(float pilot_max_val) {
+  const size_t num_ul_syms = this->frame_.NumULSyms();
+  const size_t num_dl_syms = this->frame_.NumDLSyms();
+  const size_t num_blocks_in_symbol = this->ldpc_config_.NumBlocksInSymbol();
+  const size_t encoded_bytes_per_block =
+      BitsToBytes(this->ldpc_config_.NumCbCodewLen());
+  const size_t num_blocks_per_symbol = num_blocks_in_symbol * this->ue_ant_num_;
+
+  ul_encoded_bits_.Malloc(num_ul_syms * num_blocks_per_symbol,
+                          encoded_bytes_per_block,
+                          Agora_memory::Alignment_t::kAlign64);
+  ul_mod_input_.Calloc(num_ul_syms, this->ofdm_data_num_ * this->ue_ant_num_,
+                       Agora_memory::Alignment_t::kAlign32);
   Table<int8_t> dl_encoded_bits;
-  dl_encoded_bits.Malloc(this->frame_.NumDLSyms() * num_blocks_per_symbol,
+  dl_encoded_bits.Malloc(num_dl_syms * num_blocks_per_symbol,
                          encoded_bytes_per_block,
                          Agora_memory::Alignment_t::kAlign64);
-  dl_mod_input_.Calloc(this->frame_.NumDLSyms(), ofdm_data_num_ * ue_ant_num_,
+  dl_mod_input_.Calloc(num_dl_syms, this->ofdm_data_num_ * this->ue_ant_num_,
                        Agora_memory::Alignment_t::kAlign32);
+  Table<complex_float> ul_iq_ifft;
+  ul_iq_ifft.Calloc(num_ul_syms, this->ofdm_ca_num_ * this->ue_ant_num_,
+                    Agora_memory::Alignment_t::kAlign64);
+  Table<complex_float> dl_iq_ifft;
+  dl_iq_ifft.Calloc(num_dl_syms, this->ofdm_ca_num_ * this->ue_ant_num_,
+                    Agora_memory::Alignment_t::kAlign64);
 
-  for (size_t i = 0; i < this->frame_.NumDLSyms(); i++) {
-    for (size_t j = 0; j < this->ue_ant_num_; j++) {
-      for (size_t k = 0; k < ldpc_config_.NumBlocksInSymbol(); k++) {
+  // Each task encodes, modulates and IFFTs one UL or DL symbol, with its own
+  // scrambler and buffers
+  const size_t num_threads =
+      std::max(1u, std::thread::hardware_concurrency());
+  ParallelFor(num_threads, num_ul_syms + num_dl_syms, [&](size_t task_id) {
+    const bool uplink = task_id < num_ul_syms;
+    const size_t i = uplink ? task_id : task_id - num_ul_syms;
+    Table<int8_t>& bits = uplink ? ul_bits_ : dl_bits_;
+    Table<int8_t>& encoded_bits = uplink ? ul_encoded_bits_ : dl_encoded_bits;
+    Table<uint8_t>& mod_input = uplink ? ul_mod_input_ : dl_mod_input_;
+
+    AgoraScrambler::Scrambler scrambler;
+    std::vector<int8_t> scramble_buffer(
+        num_bytes_per_cb_ + kLdpcHelperFunctionInputBufferSizePaddingBytes);
+    std::vector<int8_t> parity_buffer(
+        LdpcEncodingParityBufSize(this->ldpc_config_.BaseGraph(),
+                                  this->ldpc_config_.ExpansionFactor()));
+    for (size_t j = 0; j < ue_ant_num_; j++) {
+      for (size_t k = 0; k < num_blocks_in_symbol; k++) {
         int8_t* coded_bits_ptr =
-            dl_encoded_bits[i * num_blocks_per_symbol +
-                            j * ldpc_config_.NumBlocksInSymbol() + k];
-
+            encoded_bits[i * num_blocks_per_symbol + j * num_blocks_in_symbol +
+                         k];
+        int8_t* ldpc_input = nullptr;
         if (scramble_enabled_) {
-          std::memcpy(scramble_buffer, GetInfoBits(dl_bits_, i, j, k),
+          std::memcpy(scramble_buffer.data(), GetInfoBits(bits, i, j, k),
                       num_bytes_per_cb_);
-          scrambler->Scramble(scramble_buffer, num_bytes_per_cb_);
-          ldpc_input = scramble_buffer;
+          scrambler.Scramble(scramble_buffer.data(), num_bytes_per_cb_);
+          ldpc_input = scramble_buffer.data();
         } else {
-          ldpc_input = GetInfoBits(dl_bits_, i, j, k);
+          ldpc_input = GetInfoBits(bits, i, j, k);
         }
 
         LdpcEncodeHelper(ldpc_config_.BaseGraph(),
                          ldpc_config_.ExpansionFactor(), ldpc_config_.NumRows(),
-                         coded_bits_ptr, temp_parity_buffer, ldpc_input);
+                         coded_bits_ptr, parity_buffer.data(), ldpc_input);
         AdaptBitsForMod(reinterpret_cast<uint8_t*>(coded_bits_ptr),
-                        dl_mod_input_[i] + j * ofdm_data_num_ +
+                        mod_input[i] + j * ofdm_data_num_ +
                             k * encoded_bytes_per_block / mod_order_bits_,
                         encoded_bytes_per_block, mod_order_bits_);
       }
     }
-  }
 
-  // Generate freq-domain downlink symbols
-  Table<complex_float> dl_iq_ifft;
-  dl_iq_ifft.Calloc(this->frame_.NumDLSyms(), ofdm_ca_num_ * ue_ant_num_,
-                    Agora_memory::Alignment_t::kAlign64);
-  for (size_t i = 0; i < this->frame_.NumDLSyms(); i++) {
+    // Generate the freq-domain symbol. Downlink symbols carry the
+    // UE-specific pilots every ofdm_pilot_spacing_ subcarriers.
+    Table<complex_float>& iq_f = uplink ? ul_iq_f_ : dl_iq_f_;
+    Table<complex_float>& iq_ifft = uplink ? ul_iq_ifft : dl_iq_ifft;
     for (size_t u = 0; u < ue_ant_num_; u++) {
       size_t p = u * ofdm_data_num_;
       size_t q = u * ofdm_ca_num_;
 
       for (size_t j = ofdm_data_start_; j < ofdm_data_stop_; j++) {
-        int k = j - ofdm_data_start_;
+        size_t k = j - ofdm_data_start_;
         size_t s = p + k;
-        if (k % ofdm_pilot_spacing_ != 0) {
-          dl_iq_f_[i][q + j] = ModSingleUint8(dl_mod_input_[i][s], mod_table_);
+        if (uplink || (k % ofdm_pilot_spacing_ != 0)) {
+          iq_f[i][q + j] = ModSingleUint8(mod_input[i][s], mod_table_);
         } else {
-          dl_iq_f_[i][q + j] = ue_specific_pilot_[u][k];
+          iq_f[i][q + j] = ue_specific_pilot_[u][k];
         }
-        dl_iq_ifft[i][q + j] = dl_iq_f_[i][q + j];
+        iq_ifft[i][q + j] = iq_f[i][q + j];
       }
-      CommsLib::IFFT(&dl_iq_ifft[i][q], ofdm_ca_num_, false);
+      CommsLib::IFFT(&iq_ifft[i][q], ofdm_ca_num_, false);
     }
-  }
+  });
 
   // Find normalization factor through searching for max value in IFFT results
-  float max_val = CommsLib::FindMaxAbs(ul_iq_ifft, this->frame_.NumULSyms(),
+  float max_val = CommsLib::FindMaxAbs(ul_iq_ifft, num_ul_syms,
                                        this->ue_ant_num_ * this->ofdm_ca_num_);
-  float cur_max_val =
-      CommsLib::FindMaxAbs(dl_iq_ifft, this->frame_.NumDLSyms(),
-                           this->ue_ant_num_ * this->ofdm_ca_num_);
+  float cur_max_val = CommsLib::FindMaxAbs(
+      dl_iq_ifft, num_dl_syms, this->ue_ant_num_ * this->ofdm_ca_num_);
   if (cur_max_val > max_val) {
     max_val = cur_max_val;
   }
-  cur_max_val = CommsLib::FindMaxAbs(ue_pilot_ifft, this->ue_ant_num_,
-                                     this->ofdm_ca_num_);
-  if (cur_max_val > max_val) {
-    max_val = cur_max_val;
-  }
-  cur_max_val = CommsLib::FindMaxAbs(pilot_ifft, this->ofdm_ca_num_);
-  if (cur_max_val > max_val) {
-    max_val = cur_max_val;
+  if (pilot_max_val > max_val) {
+    max_val = pilot_max_val;
   }
 
   this->scale_ = 2 * max_val;  // additional 2^2 (6dB) power backoff
 
   // Generate time domain symbols for downlink
-  for (size_t i = 0; i < this->frame_.NumDLSyms(); i++) {
+  for (size_t i = 0; i < num_dl_syms; i++) {
     for (size_t u = 0; u < this->ue_ant_num_; u++) {
       size_t q = u * this->ofdm_ca_num_;
       size_t r = u * this->samps_per_symbol_;
@@ -957,7 +1093,7 @@ void Config::GenData() {
   }
 
   // Generate time domain uplink symbols
-  for (size_t i = 0; i < this->frame_.NumULSyms(); i++) {
+  for (size_t i = 0; i < num_ul_syms; i++) {
     for (size_t u = 0; u < this->ue_ant_num_; u++) {
       size_t q = u * this->ofdm_ca_num_;
       size_t r = u * this->samps_per_symbol_;
@@ -967,71 +1103,100 @@ void Config::GenData() {
     }
   }
 
-  // Generate time domain ue-specific pilot symbols
-  for (size_t i = 0; i < this->ue_ant_num_; i++) {
-    CommsLib::Ifft2tx(ue_pilot_ifft[i], this->ue_specific_pilot_t_[i],
-                      this->ofdm_ca_num_, this->ofdm_tx_zero_prefix_,
-                      this->cp_len_, this->scale_);
-    if (kDebugPrintPilot == true) {
-      std::printf("ue_specific_pilot_t%zu=[", i);
-      for (size_t j = 0; j < this->ofdm_ca_num_; j++) {
-        std::printf("%2.4f+%2.4fi ", ue_pilot_ifft[i][j].re,
-                    ue_pilot_ifft[i][j].im);
-      }
-      std::printf("]\n");
-    }
-  }
+  dl_encoded_bits.Free();
+  ul_iq_ifft.Free();
+  dl_iq_ifft.Free();
+  ul_mod_input_.Free();
+  ul_encoded_bits_.Free();
+  dl_mod_input_.Free();
+}
 
-  this->pilot_ci16_.resize(samps_per_symbol_, 0);
-  CommsLib::Ifft2tx(pilot_ifft,
-                    (std::complex<int16_t>*)this->pilot_ci16_.data(),
-                    ofdm_ca_num_, ofdm_tx_zero_prefix_, cp_len_, scale_);
+std::vector<std::pair<void*, size_t>> Config::GenDataCacheSections() {
+  std::vector<std::pair<void*, size_t>> sections = {
+      {&this->scale_, sizeof(this->scale_)}};
+  auto add_table = [&](auto& table, size_t num_rows, size_t row_size) {
+    if (num_rows > 0) {
+      sections.emplace_back(table[0], num_rows * row_size * sizeof(*table[0]));
+    }
+  };
+  add_table(ul_iq_f_, this->frame_.NumULSyms(),
+            this->ofdm_ca_num_ * this->ue_ant_num_);
+  add_table(ul_iq_t_, this->frame_.NumULSyms(),
+            this->samps_per_symbol_ * this->ue_ant_num_);
+  add_table(dl_iq_f_, this->frame_.NumDLSyms(),
+            this->ofdm_ca_num_ * this->ue_ant_num_);
+  add_table(dl_iq_t_, this->frame_.NumDLSyms(),
+            this->samps_per_symbol_ * this->ue_ant_num_);
+  return sections;
+}
 
-  for (size_t i = 0; i < ofdm_ca_num_; i++) {
-    this->pilot_cf32_.emplace_back(pilot_ifft[i].re / scale_,
-                                   pilot_ifft[i].im / scale_);
+bool Config::LoadGenDataCache(const std::string& filename, uint64_t key) {
+  const double load_start_us = GetTime::GetTimeUs();
+  std::unique_ptr<TableFile<uint8_t>> cache;
+  try {
+    cache = TableFile<uint8_t>::Open(filename);
+  } catch (const std::runtime_error& e) {
+    MLPD_INFO("Config: No usable GenData cache: %s\n", e.what());
+    return false;
   }
-  this->pilot_cf32_.insert(this->pilot_cf32_.begin(),
-                           this->pilot_cf32_.end() - this->cp_len_,
-                           this->pilot_cf32_.end());  // add CP
 
-  // generate a UINT32 version to write to FPGA buffers
-  this->pilot_ = Utils::Cfloat32ToUint32(this->pilot_cf32_, false, "QI");
+  const auto sections = GenDataCacheSections();
+  size_t cache_size = 0;
+  for (const auto& section : sections) {
+    cache_size += section.second;
+  }
+  if ((cache->Tag() != key) || (cache->Dim1() != 1) ||
+      (cache->Dim2() != cache_size)) {
+    MLPD_WARN("Config: GenData cache %s does not match this config\n",
+              filename.c_str());
+    return false;
+  }
 
-  std::vector<uint32_t> pre_uint32(this->ofdm_tx_zero_prefix_, 0);
-  this->pilot_.insert(this->pilot_.begin(), pre_uint32.begin(),
-                      pre_uint32.end());
-  this->pilot_.resize(this->samps_per_symbol_);
+  const uint8_t* src = cache->Row(0);
+  for (const auto& section : sections) {
+    std::memcpy(section.first, src, section.second);
+    src += section.second;
+  }
+  // Mark the cache as recently used for EvictGenDataCaches()
+  utimes(filename.c_str(), nullptr);
+  MLPD_INFO("Config: Loaded the reference symbols from %s in %.1f ms\n",
+            filename.c_str(), (GetTime::GetTimeUs() - load_start_us) / 1000.0);
+  return true;
+}
 
-  if (kDebugPrintPilot == true) {
-    std::cout << "Pilot data: " << std::endl;
-    for (size_t i = 0; i < this->ofdm_data_num_; i++) {
-      std::cout << this->pilots_[i].re << "+1i*" << this->pilots_[i].im << ",";
-    }
-    std::cout << std::endl;
+void Config::SaveGenDataCache(const std::string& filename, uint64_t key) {
+  const auto sections = GenDataCacheSections();
+  size_t cache_size = 0;
+  for (const auto& section : sections) {
+    cache_size += section.second;
   }
 
-  if (kDebugPrintPilot) {
-    for (size_t ue_id = 0; ue_id < ue_ant_num_; ue_id++) {
-      std::cout << "UE" << ue_id << "_pilot_data =[" << std::endl;
-      for (size_t i = 0; i < ofdm_data_num_; i++) {
-        std::cout << ue_specific_pilot_[ue_id][i].re << "+1i*"
-                  << ue_specific_pilot_[ue_id][i].im << " ";
-      }
-      std::cout << "];" << std::endl;
+  // Write a file of this process and rename it, so that processes starting
+  // at the same time never map a partly written cache
+  const std::string temp_filename =
+      filename + "." + std::to_string(getpid());
+  try {
+    auto cache =
+        TableFile<uint8_t>::Create(temp_filename, 1, cache_size, key);
+    uint8_t* dst = cache->Row(0);
+    for (const auto& section : sections) {
+      std::memcpy(dst, section.first, section.second);
+      dst += section.second;
     }
+    cache->Seal();
+  } catch (const std::runtime_error& e) {
+    MLPD_WARN("Config: Failed to write GenData cache: %s\n", e.what());
+    std::remove(temp_filename.c_str());
+    return;
   }
-
-  delete[](temp_parity_buffer);
-  dl_encoded_bits.Free();
-  ul_iq_ifft.Free();
-  dl_iq_ifft.Free();
-  ue_pilot_ifft.Free();
-  ul_mod_input_.Free();
-  ul_encoded_bits_.Free();
-  dl_mod_input_.Free();
-  FreeBuffer1d(&pilot_ifft);
-  delete[] scramble_buffer;
+  if (std::rename(temp_filename.c_str(), filename.c_str()) != 0) {
+    MLPD_WARN("Config: Failed to write GenData cache %s: %s\n",
+              filename.c_str(), strerror(errno));
+    std::remove(temp_filename.c_str());
+    return;
+  }
+  MLPD_INFO("Config: Cached the reference symbols in %s\n", filename.c_str());
+  EvictGenDataCaches(filename.substr(0, filename.rfind('/')));
 }
 
 Config::~Config() {
@@ -1162,6 +1327,7 @@ void Config::Print() const {
               << "Rate: " << rate_ << std::endl
               << "NCO: " << nco_ << std::endl
               << "Scrambler Enabled: " << scramble_enabled_ << std::endl
+              << "Fused DL Modulation: " << fused_dl_modulation_ << std::endl
               << "Radio Rf Freq: " << radio_rf_freq_ << std::endl
               << "Bw filter: " << bw_filter_ << std::endl
               << "Single Gain: " << single_gain_ << std::endl
@@ -1189,7 +1355,11 @@ void Config::Print() const {
               << "Transport Block Size: " << transport_block_size_ << std::endl
               << "Noise Level: " << noise_level_ << std::endl
               << "Bytes per CB: " << num_bytes_per_cb_ << std::endl
-              << "FFT in rru: " << fft_in_rru_ << std::endl;
+              << "FFT in rru: " << fft_in_rru_ << std::endl
+              << "FFT pruning: " << fft_pruning_ << std::endl
+              << "FFT batched: " << fft_batched_ << std::endl
+              << "FFT backend: " << FftPlan::ToString(fft_backend_)
+              << std::endl;
   }
 }
 
@@ -17,16 +17,20 @@
 #include <boost/range/algorithm/count.hpp>
 #include <fstream>  // std::ifstream
 #include <iostream>
+#include <memory>
+#include <utility>
 #include <vector>
 
 #include "buffer.h"
 #include "comms-lib.h"
+#include "fft_backend.h"
 #include "framestats.h"
 #include "gettime.h"
 #include "ldpc_config.h"
 #include "memory_manage.h"
 #include "modulation.h"
 #include "symbols.h"
+#include "table_file.h"
 #include "utils.h"
 #include "utils_ldpc.h"
 
@@ -66,6 +70,9 @@ class Config {
   inline double Rate() const { return this->rate_; }
   inline double Nco() const { return this->nco_; }
   inline bool ScrambleEnabled() const { return this->scramble_enabled_; }
+  /// If true, downlink DoEncode modulates its code blocks directly into a
+  /// complex-valued buffer in precoding order, skipping the int8 buffer
+  inline bool FusedDlModulation() const { return this->fused_dl_modulation_; }
 
   inline double RadioRfFreq() const { return this->radio_rf_freq_; }
   inline double BwFilter() const { return this->bw_filter_; }
@@ -119,6 +126,12 @@ class Config {
   inline size_t CoreOffset() const { return this->core_offset_; }
   inline size_t WorkerThreadNum() const { return this->worker_thread_num_; }
   inline size_t SocketThreadNum() const { return this->socket_thread_num_; }
+  inline size_t MacThreadNum() const { return this->mac_thread_num_; }
+  /// Return the MAC thread that serves UE antenna [ue_id]. UEs are assigned
+  /// to the MAC threads round-robin.
+  inline size_t MacThreadForUe(size_t ue_id) const {
+    return ue_id % this->mac_thread_num_;
+  }
   inline size_t UeCoreOffset() const { return this->ue_core_offset_; }
   inline size_t UeWorkerThreadNum() const {
     return this->ue_worker_thread_num_;
@@ -144,6 +157,13 @@ class Config {
   inline size_t FftBlockSize() const { return this->fft_block_size_; }
 
   inline size_t EncodeBlockSize() const { return this->encode_block_size_; }
+  inline size_t UeFftBlockSize() const { return this->ue_fft_block_size_; }
+  inline size_t UeDemulBlockSize() const {
+    return this->ue_demul_block_size_;
+  }
+  inline size_t UeDecodeBlockSize() const {
+    return this->ue_decode_block_size_;
+  }
   inline bool FreqOrthogonalPilot() const {
     return this->freq_orthogonal_pilot_;
   }
@@ -200,11 +220,19 @@ class Config {
   inline int BsRruPort() const { return this->bs_rru_port_; }
   inline int UeServerPort() const { return this->ue_server_port_; }
   inline int UeRruPort() const { return this->ue_rru_port_; }
+  inline int ClosedLoopPort() const { return this->closed_loop_port_; }
+  inline size_t ClosedLoopWindow() const { return this->closed_loop_window_; }
 
   inline size_t FramesToTest() const { return this->frames_to_test_; }
   inline float NoiseLevel() const { return this->noise_level_; }
   inline size_t NumBytesPerCb() const { return this->num_bytes_per_cb_; }
   inline bool FftInRru() const { return this->fft_in_rru_; }
+  inline bool FftPruning() const { return this->fft_pruning_; }
+  inline bool FftBatched() const { return this->fft_batched_; }
+  inline FftBackendType FftBackend() const { return this->fft_backend_; }
+  inline size_t FftPruningDecimation() const {
+    return this->fft_pruning_decimation_;
+  }
 
   inline uint16_t DpdkNumPorts() const { return this->dpdk_num_ports_; }
   inline uint16_t DpdkPortOffset() const { return this->dpdk_port_offset_; }
@@ -222,6 +250,18 @@ class Config {
   }
 
   inline const LDPCconfig& LdpcConfig() const { return this->ldpc_config_; }
+  /// Maximum number of transmissions of an uplink code block that the HARQ
+  /// soft buffer combines. 1 disables HARQ combining.
+  inline size_t HarqMaxTx() const { return this->harq_max_tx_; }
+  /// Time from the first packet of a frame by which its uplink code blocks
+  /// should be decoded. 0 disables the deadline-aware iteration budget.
+  inline double DecoderDeadlineUs() const { return this->decoder_deadline_us_; }
+  /// Fewest LDPC iterations a code block gets under deadline pressure
+  inline size_t DecoderMinIter() const { return this->decoder_min_iter_; }
+  /// If true, the uplink demapper scales each UE's LLRs by its pilot SNR
+  inline bool LlrScaling() const { return this->llr_scaling_; }
+  /// Mean per-antenna pilot SNR at which LLR scaling leaves LLRs unchanged
+  inline float LlrScaleRefSnrDb() const { return this->llr_scale_ref_snr_db_; }
   inline const FrameStats& Frame() const { return this->frame_; }
   inline const std::vector<std::complex<float>>& PilotCf32() const {
     return this->pilot_cf32_;
@@ -271,7 +311,19 @@ class Config {
   inline Table<complex_float>& ModTable() { return this->mod_table_; };
 
   // Public functions
+  /**
+   * @brief Generate the pilots and the UL / DL reference symbols. The
+   * reference symbols are encoded and modulated on all cores, and cached in
+   * $XDG_CACHE_HOME/agora (default ~/.cache/agora) under a hash of the JSON
+   * config and the reference bits, so that later runs with the same inputs
+   * map the cache instead (disable with "gen_data_cache": false). Only the
+   * most recently used caches are kept.
+   */
   void GenData();
+  /// The GenData() cache file of this config, empty if it is not cached
+  inline const std::string& GenDataCacheFile() const {
+    return this->gen_data_cache_file_;
+  }
 
   /// TODO document and review
   size_t GetSymbolId(size_t input_id) const;
@@ -397,6 +449,17 @@ class Config {
  private:
   void Print() const;
 
+  /// Encode, modulate and IFFT the UL / DL reference symbols into ul_iq_f_,
+  /// ul_iq_t_, dl_iq_f_ and dl_iq_t_, and set scale_ from their peak and
+  /// [pilot_max_val], the peak of the pilots
+  void GenIqSymbols(float pilot_max_val);
+  /// Buffers that GenIqSymbols() fills and the cache holds, as (base, bytes)
+  std::vector<std::pair<void*, size_t>> GenDataCacheSections();
+  /// Fill the GenDataCacheSections() from [filename] if it holds the cache
+  /// of [key]. Return false if it does not.
+  bool LoadGenDataCache(const std::string& filename, uint64_t key);
+  void SaveGenDataCache(const std::string& filename, uint64_t key);
+
   /* Class constants */
   inline static const size_t kDefaultSymbolNumPerFrame = 70;
   inline static const size_t kDefaultPilotSymPerFrame = 8;
@@ -444,6 +507,11 @@ class Config {
   size_t ofdm_pilot_spacing_;
 
   LDPCconfig ldpc_config_;  // LDPC parameters
+  size_t harq_max_tx_;
+  double decoder_deadline_us_;
+  size_t decoder_min_iter_;
+  bool llr_scaling_;
+  float llr_scale_ref_snr_db_;
 
   // A class that holds the frame configuration the id contains letters
   // representing the symbol types in the frame (e.g., 'P' for pilot symbols,
@@ -456,6 +524,9 @@ class Config {
 
   Table<int8_t> dl_bits_;
   Table<int8_t> ul_bits_;
+  // Mapped reference files that dl_bits_ and ul_bits_ view, if any
+  std::unique_ptr<TableFile<int8_t>> dl_bits_file_;
+  std::unique_ptr<TableFile<int8_t>> ul_bits_file_;
   Table<int8_t> ul_encoded_bits_;
   Table<uint8_t> ul_mod_input_;
   Table<uint8_t> dl_mod_input_;
@@ -506,6 +577,7 @@ class Config {
   double rate_;
   double nco_;
   bool scramble_enabled_;
+  bool fused_dl_modulation_;
   double radio_rf_freq_;
   double bw_filter_;
   bool single_gain_;
@@ -539,6 +611,7 @@ class Config {
   size_t core_offset_;
   size_t worker_thread_num_;
   size_t socket_thread_num_;
+  size_t mac_thread_num_;
   size_t fft_thread_num_;
   size_t demul_thread_num_;
   size_t decode_thread_num_;
@@ -565,6 +638,12 @@ class Config {
   // Number of code blocks handled in one encode event
   size_t encode_block_size_;
 
+  // Number of UE antennas handled in one UE FFT and one UE demul event
+  size_t ue_fft_block_size_;
+  size_t ue_demul_block_size_;
+  // Number of code blocks handled in one UE decode event
+  size_t ue_decode_block_size_;
+
   bool freq_orthogonal_pilot_;
 
   // The number of zero IQ samples prepended to a time-domain symbol (i.e.,
@@ -605,6 +684,11 @@ class Config {
 
   float scale_;  // Scaling factor for all transmit symbols
 
+  // Hash of the JSON config text, part of the key of the GenData() cache
+  uint64_t config_hash_;
+  bool gen_data_cache_;  // If true, GenData() caches the reference symbols
+  std::string gen_data_cache_file_;
+
   bool bigstation_mode_;      // If true, use pipeline-parallel scheduling
   bool correct_phase_shift_;  // If true, do phase shift correction
 
@@ -658,6 +742,13 @@ class Config {
   // Base RRU/channel simulator UDP port used by UEs to transmit uplink data
   int ue_rru_port_;
 
+  // If non-zero, the UDP port at bs_rru_addr_ that Agora reports completed
+  // frames to. The sender then releases a frame only when fewer than
+  // closed_loop_window_ earlier frames are still being processed, instead
+  // of pacing frames with the frame duration.
+  int closed_loop_port_;
+  size_t closed_loop_window_;
+
   // Number of NIC ports used for DPDK
   uint16_t dpdk_num_ports_;
 
@@ -688,5 +779,17 @@ class Config {
   size_t num_bytes_per_cb_;
 
   bool fft_in_rru_;  // If true, the RRU does FFT instead of Agora
+
+  // If true, the uplink data FFT and the downlink IFFT only compute the
+  // OFDM data subcarriers (see PrunedFft)
+  bool fft_pruning_;
+  // Decimation factor of the pruned FFT, 0 selects it automatically
+  size_t fft_pruning_decimation_;
+  // If true, DoFFT transforms all antennas of an FFT event (fft_block_size)
+  // with one batched MKL call. The batched path always runs full-size FFTs,
+  // so it is mutually exclusive with fft_pruning.
+  bool fft_batched_;
+  // FFT library used by the FFT/IFFT doers, the sender and the UE
+  FftBackendType fft_backend_;
 };
 #endif /* CONFIG_HPP_ */
@@ -0,0 +1,483 @@
+/**
+ * @file fft_backend.cc
+ * @brief Implementation file for the FFT backends (MKL DFTI, FFTW and the
+ * in-tree native radix-2 FFT)
+ */
+#include "fft_backend.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+#include "logger.h"
+#include "memory_manage.h"
+#include "symbols.h"
+#include "utils.h"
+
+#if defined(USE_MKL_FFT)
+#include "mkl_dfti.h"
+#endif
+
+#if defined(USE_FFTW)
+#include <fftw3.h>
+#endif
+
+// Number of timed executions per backend when selecting a backend with kAuto
+static constexpr size_t kAutoTuneIterations = 50;
+
+/// Fill in the default distances
+static FftLayout NormalizeLayout(const FftLayout& layout) {
+  FftLayout normalized = layout;
+  if (normalized.in_distance_ == 0) {
+    normalized.in_distance_ = normalized.fft_size_ * normalized.in_stride_;
+  }
+  if (normalized.out_distance_ == 0) {
+    normalized.out_distance_ = normalized.fft_size_ * normalized.out_stride_;
+  }
+  return normalized;
+}
+
+/// Number of complex elements spanned by the input or output of a layout
+static size_t InputSpan(const FftLayout& layout) {
+  return (layout.num_transforms_ - 1) * layout.in_distance_ +
+         (layout.fft_size_ - 1) * layout.in_stride_ + 1;
+}
+static size_t OutputSpan(const FftLayout& layout) {
+  return (layout.num_transforms_ - 1) * layout.out_distance_ +
+         (layout.fft_size_ - 1) * layout.out_stride_ + 1;
+}
+
+using FftPlanKey =
+    std::tuple<size_t, size_t, size_t, size_t, size_t, size_t, bool, int>;
+
+static FftPlanKey MakePlanKey(FftDirection direction,
+                              const FftLayout& layout) {
+  return std::make_tuple(layout.fft_size_, layout.num_transforms_,
+                         layout.in_stride_, layout.in_distance_,
+                         layout.out_stride_, layout.out_distance_,
+                         layout.in_place_, static_cast<int>(direction));
+}
+
+#if defined(USE_MKL_FFT)
+class MklFftPlan : public FftPlan {
+ public:
+  MklFftPlan(FftDirection direction, const FftLayout& layout)
+      : FftPlan(FftBackendType::kMkl, direction, layout) {
+    CheckStatus(DftiCreateDescriptor(&mkl_handle_, DFTI_SINGLE, DFTI_COMPLEX,
+                                     1,
+                                     static_cast<MKL_LONG>(layout.fft_size_)),
+                "DftiCreateDescriptor");
+    if (layout.in_place_ == false) {
+      CheckStatus(DftiSetValue(mkl_handle_, DFTI_PLACEMENT, DFTI_NOT_INPLACE),
+                  "DFTI_PLACEMENT");
+    }
+    if (layout.num_transforms_ > 1) {
+      CheckStatus(DftiSetValue(mkl_handle_, DFTI_NUMBER_OF_TRANSFORMS,
+                               static_cast<MKL_LONG>(layout.num_transforms_)),
+                  "DFTI_NUMBER_OF_TRANSFORMS");
+      CheckStatus(DftiSetValue(mkl_handle_, DFTI_INPUT_DISTANCE,
+                               static_cast<MKL_LONG>(layout.in_distance_)),
+                  "DFTI_INPUT_DISTANCE");
+      CheckStatus(DftiSetValue(mkl_handle_, DFTI_OUTPUT_DISTANCE,
+                               static_cast<MKL_LONG>(layout.out_distance_)),
+                  "DFTI_OUTPUT_DISTANCE");
+    }
+    if (layout.in_stride_ != 1) {
+      MKL_LONG strides[2] = {0, static_cast<MKL_LONG>(layout.in_stride_)};
+      CheckStatus(DftiSetValue(mkl_handle_, DFTI_INPUT_STRIDES, strides),
+                  "DFTI_INPUT_STRIDES");
+    }
+    if (layout.out_stride_ != 1) {
+      MKL_LONG strides[2] = {0, static_cast<MKL_LONG>(layout.out_stride_)};
+      CheckStatus(DftiSetValue(mkl_handle_, DFTI_OUTPUT_STRIDES, strides),
+                  "DFTI_OUTPUT_STRIDES");
+    }
+    CheckStatus(DftiCommitDescriptor(mkl_handle_), "DftiCommitDescriptor");
+  }
+
+  ~MklFftPlan() override { DftiFreeDescriptor(&mkl_handle_); }
+
+  void Execute(complex_float* in, complex_float* out) override {
+    if (direction_ == FftDirection::kForward) {
+      if (layout_.in_place_) {
+        DftiComputeForward(mkl_handle_, in);
+      } else {
+        DftiComputeForward(mkl_handle_, in, out);
+      }
+    } else {
+      if (layout_.in_place_) {
+        DftiComputeBackward(mkl_handle_, in);
+      } else {
+        DftiComputeBackward(mkl_handle_, in, out);
+      }
+    }
+  }
+
+ private:
+  static void CheckStatus(MKL_LONG status, const char* what) {
+    if ((status != 0) && (DftiErrorClass(status, DFTI_NO_ERROR) == 0)) {
+      throw std::runtime_error(std::string("MklFftPlan: ") + what +
+                               " failed: " + DftiErrorMessage(status));
+    }
+  }
+
+  DFTI_DESCRIPTOR_HANDLE mkl_handle_;
+};
+#endif  // defined(USE_MKL_FFT)
+
+#if defined(USE_FFTW)
+/**
+ * FFTW plans are created once per layout and shared by every FftwFftPlan with
+ * that layout through a process-wide cache, since FFTW planning is slow and
+ * not thread-safe while the new-array execute interface is. Accumulated
+ * wisdom is loaded from and saved to the file returned by WisdomFile(), so
+ * FFTW_MEASURE planning only happens once per host.
+ */
+class FftwFftPlan : public FftPlan {
+ public:
+  FftwFftPlan(FftDirection direction, const FftLayout& layout)
+      : FftPlan(FftBackendType::kFftw, direction, layout) {
+    aligned_plan_ = GetPlan(direction, layout, false);
+  }
+
+  void Execute(complex_float* in, complex_float* out) override {
+    auto* fftw_in = reinterpret_cast<fftwf_complex*>(in);
+    auto* fftw_out = reinterpret_cast<fftwf_complex*>(out);
+    // Plans made with aligned arrays may only run on equally aligned arrays
+    if ((fftwf_alignment_of(reinterpret_cast<float*>(in)) == 0) &&
+        (fftwf_alignment_of(reinterpret_cast<float*>(out)) == 0)) {
+      fftwf_execute_dft(aligned_plan_, fftw_in, fftw_out);
+    } else {
+      if (unaligned_plan_ == nullptr) {
+        unaligned_plan_ = GetPlan(direction_, layout_, true);
+      }
+      fftwf_execute_dft(unaligned_plan_, fftw_in, fftw_out);
+    }
+  }
+
+ private:
+  static fftwf_plan GetPlan(FftDirection direction, const FftLayout& layout,
+                            bool unaligned) {
+    static std::mutex plan_mutex;
+    static std::map<std::pair<FftPlanKey, bool>, fftwf_plan> plan_cache;
+    static bool wisdom_loaded = false;
+
+    std::lock_guard<std::mutex> lock(plan_mutex);
+    const std::string wisdom_file = WisdomFile();
+    if ((wisdom_loaded == false) && (wisdom_file.empty() == false)) {
+      if (fftwf_import_wisdom_from_filename(wisdom_file.c_str()) != 0) {
+        MLPD_INFO("FFTW: imported wisdom from %s\n", wisdom_file.c_str());
+      }
+      wisdom_loaded = true;
+    }
+
+    const auto key = std::make_pair(MakePlanKey(direction, layout), unaligned);
+    auto it = plan_cache.find(key);
+    if (it != plan_cache.end()) {
+      return it->second;
+    }
+
+    // FFTW_MEASURE overwrites the arrays, so plan on scratch arrays
+    const size_t in_len = InputSpan(layout);
+    const size_t out_len = layout.in_place_ ? 0 : OutputSpan(layout);
+    auto* in = fftwf_alloc_complex(in_len);
+    auto* out = layout.in_place_ ? in : fftwf_alloc_complex(out_len);
+    const int n = static_cast<int>(layout.fft_size_);
+    const unsigned flags = FFTW_MEASURE | (unaligned ? FFTW_UNALIGNED : 0);
+    fftwf_plan plan = fftwf_plan_many_dft(
+        1, &n, static_cast<int>(layout.num_transforms_), in, nullptr,
+        static_cast<int>(layout.in_stride_),
+        static_cast<int>(layout.in_distance_), out, nullptr,
+        static_cast<int>(layout.out_stride_),
+        static_cast<int>(layout.out_distance_),
+        direction == FftDirection::kForward ? FFTW_FORWARD : FFTW_BACKWARD,
+        flags);
+    if (layout.in_place_ == false) {
+      fftwf_free(out);
+    }
+    fftwf_free(in);
+    RtAssert(plan != nullptr, "FftwFftPlan: failed to create FFTW plan");
+
+    plan_cache[key] = plan;
+    if ((wisdom_file.empty() == false) &&
+        (fftwf_export_wisdom_to_filename(wisdom_file.c_str()) == 0)) {
+      MLPD_WARN("FFTW: failed to save wisdom to %s\n", wisdom_file.c_str());
+    }
+    return plan;
+  }
+
+  /// The file named by the AGORA_FFTW_WISDOM environment variable, else
+  /// fftw_wisdom_f32.dat in Agora's user cache directory. Empty if there is
+  /// no cache directory, in which case wisdom is not kept.
+  static std::string WisdomFile() {
+    const char* env_file = std::getenv("AGORA_FFTW_WISDOM");
+    if (env_file != nullptr) {
+      return std::string(env_file);
+    }
+    const std::string cache_dir = Utils::CacheDir();
+    return cache_dir.empty() ? std::string()
+                             : cache_dir + "/fftw_wisdom_f32.dat";
+  }
+
+  // Owned by the plan cache
+  fftwf_plan aligned_plan_;
+  fftwf_plan unaligned_plan_ = nullptr;
+};
+#endif  // defined(USE_FFTW)
+
+/**
+ * Portable fallback without external dependencies: an iterative radix-2 FFT
+ * for power-of-two sizes and a direct O(N^2) DFT for other sizes. Each
+ * transform is gathered into a contiguous scratch buffer first, which also
+ * makes strided and in-place layouts safe.
+ */
+class NativeFftPlan : public FftPlan {
+ public:
+  NativeFftPlan(FftDirection direction, const FftLayout& layout)
+      : FftPlan(FftBackendType::kNative, direction, layout),
+        radix2_(IsPowerOfTwo(layout.fft_size_)),
+        scratch_(layout.fft_size_),
+        dft_out_(radix2_ ? 0 : layout.fft_size_) {
+    const size_t n = layout.fft_size_;
+    const double sign = (direction == FftDirection::kForward) ? -1.0 : 1.0;
+    // Radix-2 butterflies need W_N^k for k < N/2, the direct DFT all N
+    twiddles_.resize(radix2_ ? n / 2 : n);
+    for (size_t k = 0; k < twiddles_.size(); k++) {
+      const double phase = sign * 2.0 * M_PI * k / n;
+      twiddles_[k] = {static_cast<float>(std::cos(phase)),
+                      static_cast<float>(std::sin(phase))};
+    }
+    if (radix2_) {
+      bit_reverse_.resize(n);
+      size_t log2_n = 0;
+      while ((size_t{1} << log2_n) < n) {
+        log2_n++;
+      }
+      for (size_t i = 0; i < n; i++) {
+        size_t rev = 0;
+        for (size_t b = 0; b < log2_n; b++) {
+          rev |= ((i >> b) & 1) << (log2_n - 1 - b);
+        }
+        bit_reverse_[i] = rev;
+      }
+    }
+  }
+
+  void Execute(complex_float* in, complex_float* out) override {
+    const size_t n = layout_.fft_size_;
+    for (size_t t = 0; t < layout_.num_transforms_; t++) {
+      const complex_float* src = in + t * layout_.in_distance_;
+      complex_float* dst = out + t * layout_.out_distance_;
+      if (radix2_) {
+        for (size_t i = 0; i < n; i++) {
+          scratch_[bit_reverse_[i]] = src[i * layout_.in_stride_];
+        }
+        Radix2(scratch_.data());
+        for (size_t i = 0; i < n; i++) {
+          dst[i * layout_.out_stride_] = scratch_[i];
+        }
+      } else {
+        for (size_t i = 0; i < n; i++) {
+          scratch_[i] = src[i * layout_.in_stride_];
+        }
+        Dft(scratch_.data(), dft_out_.data());
+        for (size_t i = 0; i < n; i++) {
+          dst[i * layout_.out_stride_] = dft_out_[i];
+        }
+      }
+    }
+  }
+
+ private:
+  /// In-place decimation-in-time FFT of bit-reversed input
+  void Radix2(complex_float* a) const {
+    const size_t n = layout_.fft_size_;
+    for (size_t len = 2; len <= n; len <<= 1) {
+      const size_t half = len / 2;
+      const size_t tw_step = n / len;
+      for (size_t i = 0; i < n; i += len) {
+        for (size_t j = 0; j < half; j++) {
+          const complex_float w = twiddles_[j * tw_step];
+          const complex_float u = a[i + j];
+          const complex_float x = a[i + j + half];
+          const complex_float v = {x.re * w.re - x.im * w.im,
+                                   x.re * w.im + x.im * w.re};
+          a[i + j] = {u.re + v.re, u.im + v.im};
+          a[i + j + half] = {u.re - v.re, u.im - v.im};
+        }
+      }
+    }
+  }
+
+  void Dft(const complex_float* x, complex_float* y) const {
+    const size_t n = layout_.fft_size_;
+    for (size_t k = 0; k < n; k++) {
+      float re = 0;
+      float im = 0;
+      size_t tw_idx = 0;
+      for (size_t j = 0; j < n; j++) {
+        const complex_float w = twiddles_[tw_idx];
+        re += x[j].re * w.re - x[j].im * w.im;
+        im += x[j].re * w.im + x[j].im * w.re;
+        tw_idx += k;
+        if (tw_idx >= n) {
+          tw_idx -= n;
+        }
+      }
+      y[k] = {re, im};
+    }
+  }
+
+  const bool radix2_;
+  std::vector<complex_float> twiddles_;
+  std::vector<size_t> bit_reverse_;
+  std::vector<complex_float> scratch_;
+  std::vector<complex_float> dft_out_;
+};
+
+/// Time every compiled backend on this layout and return the fastest. The
+/// result is cached per layout.
+static FftBackendType SelectFastestBackend(FftDirection direction,
+                                           const FftLayout& layout) {
+  static std::mutex select_mutex;
+  static std::map<FftPlanKey, FftBackendType> selected;
+
+  std::lock_guard<std::mutex> lock(select_mutex);
+  const FftPlanKey key = MakePlanKey(direction, layout);
+  auto it = selected.find(key);
+  if (it != selected.end()) {
+    return it->second;
+  }
+
+  const size_t in_len = InputSpan(layout);
+  const size_t out_len = std::max(in_len, OutputSpan(layout));
+  auto* in = static_cast<complex_float*>(Agora_memory::PaddedAlignedAlloc(
+      Agora_memory::Alignment_t::kAlign64, out_len * sizeof(complex_float)));
+  auto* out = layout.in_place_
+                  ? in
+                  : static_cast<complex_float*>(
+                        Agora_memory::PaddedAlignedAlloc(
+                            Agora_memory::Alignment_t::kAlign64,
+                            out_len * sizeof(complex_float)));
+
+  FftBackendType best_backend = FftBackendType::kNative;
+  double best_time = 0;
+  for (auto backend : {FftBackendType::kMkl, FftBackendType::kFftw,
+                       FftBackendType::kNative}) {
+    if (FftPlan::IsAvailable(backend) == false) {
+      continue;
+    }
+    auto plan = FftPlan::Create(direction, layout, backend);
+    std::memset(static_cast<void*>(in), 0, out_len * sizeof(complex_float));
+    plan->Execute(in, out);  // Warm up
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < kAutoTuneIterations; i++) {
+      plan->Execute(in, out);
+    }
+    const double time =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+            .count();
+    MLPD_INFO("FFT backend %s: %zu x %zu-point %s FFT, %.3f us\n",
+              FftPlan::ToString(backend).c_str(), layout.num_transforms_,
+              layout.fft_size_,
+              direction == FftDirection::kForward ? "forward" : "backward",
+              1e6 * time / kAutoTuneIterations);
+    if ((best_time == 0) || (time < best_time)) {
+      best_time = time;
+      best_backend = backend;
+    }
+  }
+
+  if (layout.in_place_ == false) {
+    std::free(out);
+  }
+  std::free(in);
+  selected[key] = best_backend;
+  return best_backend;
+}
+
+std::unique_ptr<FftPlan> FftPlan::Create(FftDirection direction,
+                                         const FftLayout& layout,
+                                         FftBackendType backend) {
+  const FftLayout normalized = NormalizeLayout(layout);
+  RtAssert(normalized.fft_size_ > 0, "FftPlan: FFT size must be positive");
+  if (backend == FftBackendType::kAuto) {
+    backend = SelectFastestBackend(direction, normalized);
+  }
+  RtAssert(IsAvailable(backend),
+           "FftPlan: FFT backend " + ToString(backend) +
+               " is not compiled into this binary");
+
+  switch (backend) {
+#if defined(USE_MKL_FFT)
+    case FftBackendType::kMkl:
+      return std::make_unique<MklFftPlan>(direction, normalized);
+#endif
+#if defined(USE_FFTW)
+    case FftBackendType::kFftw:
+      return std::make_unique<FftwFftPlan>(direction, normalized);
+#endif
+    default:
+      return std::make_unique<NativeFftPlan>(direction, normalized);
+  }
+}
+
+std::unique_ptr<FftPlan> FftPlan::Create(FftDirection direction,
+                                         size_t fft_size, bool in_place,
+                                         FftBackendType backend) {
+  FftLayout layout(fft_size);
+  layout.in_place_ = in_place;
+  return Create(direction, layout, backend);
+}
+
+bool FftPlan::IsAvailable(FftBackendType backend) {
+  switch (backend) {
+    case FftBackendType::kMkl:
+#if defined(USE_MKL_FFT)
+      return true;
+#else
+      return false;
+#endif
+    case FftBackendType::kFftw:
+#if defined(USE_FFTW)
+      return true;
+#else
+      return false;
+#endif
+    case FftBackendType::kNative:
+    case FftBackendType::kAuto:
+      return true;
+  }
+  return false;
+}
+
+std::string FftPlan::ToString(FftBackendType backend) {
+  switch (backend) {
+    case FftBackendType::kMkl:
+      return "mkl";
+    case FftBackendType::kFftw:
+      return "fftw";
+    case FftBackendType::kNative:
+      return "native";
+    case FftBackendType::kAuto:
+      return "auto";
+  }
+  return "unknown";
+}
+
+FftBackendType FftPlan::FromString(const std::string& name) {
+  for (auto backend : {FftBackendType::kMkl, FftBackendType::kFftw,
+                       FftBackendType::kNative, FftBackendType::kAuto}) {
+    if (name == ToString(backend)) {
+      return backend;
+    }
+  }
+  throw std::runtime_error("FftPlan: unknown FFT backend " + name);
+}
@@ -0,0 +1,94 @@
+/**
+ * @file fft_backend.h
+ * @brief Declaration file for the FFT backend abstraction. All complex FFTs in
+ * Agora (DoFFT, DoIFFT, PrunedFft, CommsLib, the sender and the UE) go through
+ * FftPlan so that the library doing the work can be swapped.
+ */
+#ifndef FFT_BACKEND_H_
+#define FFT_BACKEND_H_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "buffer.h"
+
+/// Backends that can be compiled in. kMkl needs USE_MKL_FFT, kFftw needs
+/// USE_FFTW, and kNative (an in-tree radix-2 FFT) is always available.
+/// kAuto times every compiled backend once per FFT layout and keeps the
+/// fastest one.
+enum class FftBackendType { kMkl, kFftw, kNative, kAuto };
+
+enum class FftDirection { kForward, kBackward };
+
+#if defined(DEFAULT_FFT_BACKEND_FFTW)
+static constexpr FftBackendType kDefaultFftBackend = FftBackendType::kFftw;
+#elif defined(DEFAULT_FFT_BACKEND_NATIVE)
+static constexpr FftBackendType kDefaultFftBackend = FftBackendType::kNative;
+#else
+static constexpr FftBackendType kDefaultFftBackend = FftBackendType::kMkl;
+#endif
+
+/**
+ * Memory layout of a batch of equally sized 1-D complex FFTs, with the same
+ * meaning as the MKL DFTI stride / distance parameters and FFTW's advanced
+ * interface: element j of transform i is read from in[i * in_distance +
+ * j * in_stride] and written to out[i * out_distance + j * out_stride].
+ */
+struct FftLayout {
+  size_t fft_size_;
+  size_t num_transforms_ = 1;
+  size_t in_stride_ = 1;
+  size_t in_distance_ = 0;  // 0 means fft_size_ * in_stride_
+  size_t out_stride_ = 1;
+  size_t out_distance_ = 0;  // 0 means fft_size_ * out_stride_
+  bool in_place_ = true;
+
+  explicit FftLayout(size_t fft_size) : fft_size_(fft_size) {}
+};
+
+/**
+ * A planned, unnormalized, single-precision complex FFT. Plans are created
+ * once (e.g. in a Doer constructor) and executed many times. Execute() may be
+ * called from one thread at a time per plan; create one plan per worker.
+ */
+class FftPlan {
+ public:
+  static std::unique_ptr<FftPlan> Create(
+      FftDirection direction, const FftLayout& layout,
+      FftBackendType backend = kDefaultFftBackend);
+
+  /// Convenience for the common case of one contiguous transform
+  static std::unique_ptr<FftPlan> Create(
+      FftDirection direction, size_t fft_size, bool in_place = true,
+      FftBackendType backend = kDefaultFftBackend);
+
+  virtual ~FftPlan() = default;
+
+  /// Transform [in] into [out]. For in-place plans, [out] must equal [in].
+  virtual void Execute(complex_float* in, complex_float* out) = 0;
+
+  inline void Execute(complex_float* inout) { Execute(inout, inout); }
+
+  inline FftBackendType Backend() const { return this->backend_; }
+  inline FftDirection Direction() const { return this->direction_; }
+  inline const FftLayout& Layout() const { return this->layout_; }
+
+  /// True if the backend was compiled into this binary
+  static bool IsAvailable(FftBackendType backend);
+
+  static std::string ToString(FftBackendType backend);
+  /// Parse "mkl", "fftw", "native" or "auto". Throws on unknown names.
+  static FftBackendType FromString(const std::string& name);
+
+ protected:
+  FftPlan(FftBackendType backend, FftDirection direction,
+          const FftLayout& layout)
+      : backend_(backend), direction_(direction), layout_(layout) {}
+
+  const FftBackendType backend_;
+  const FftDirection direction_;
+  const FftLayout layout_;
+};
+
+#endif  // FFT_BACKEND_H_
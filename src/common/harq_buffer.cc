@@ -0,0 +1,128 @@
+/**
+ * @file harq_buffer.cc
+ * @brief Implementation file for the HarqSoftBuffer class
+ */
+#include "harq_buffer.h"
+
+#include <immintrin.h>
+
+#include <cstdio>
+#include <cstring>
+
+#include "memory_manage.h"
+#include "utils.h"
+
+HarqSoftBuffer::HarqSoftBuffer(size_t num_ues, size_t num_symbols,
+                               size_t num_cbs, size_t llrs_per_cb,
+                               size_t max_transmissions)
+    : num_ues_(num_ues),
+      num_symbols_(num_symbols),
+      num_cbs_(num_cbs),
+      llrs_per_cb_(llrs_per_cb),
+      llr_stride_(Roundup<64>(llrs_per_cb)),
+      max_transmissions_(max_transmissions),
+      cbs_(num_ues * num_symbols * num_cbs),
+      process_mutexes_(std::make_unique<std::mutex[]>(num_ues * num_symbols)),
+      num_combined_(0),
+      num_dropped_(0) {
+  RtAssert(max_transmissions_ > 1,
+           "HarqSoftBuffer: at least two transmissions are needed to combine");
+  llrs_ = static_cast<int8_t*>(Agora_memory::PaddedAlignedAlloc(
+      Agora_memory::Alignment_t::kAlign64, cbs_.size() * llr_stride_));
+  for (auto& cb : cbs_) {
+    cb.frame_id_ = 0;
+    cb.num_transmissions_ = 0;
+    cb.state_ = State::kEmpty;
+  }
+}
+
+HarqSoftBuffer::~HarqSoftBuffer() { std::free(llrs_); }
+
+size_t HarqSoftBuffer::Combine(size_t ue_id, size_t symbol_idx, size_t cb_id,
+                               size_t frame_id, bool new_data,
+                               int8_t* llrs) {
+  const size_t cb_index = CbIndex(ue_id, symbol_idx, cb_id);
+  std::lock_guard<std::mutex> lock(
+      process_mutexes_[ProcessIndex(ue_id, symbol_idx)]);
+  CodeBlock& cb = cbs_[cb_index];
+  if (new_data) {
+    // The kept LLRs belong to a different code block
+    cb.state_ = State::kEmpty;
+    return 1;
+  }
+  if ((cb.state_ != State::kFailed) || (cb.frame_id_ >= frame_id)) {
+    return 1;
+  }
+
+  const int8_t* kept = llrs_ + (cb_index * llr_stride_);
+  size_t i = 0;
+  for (; i + 32 <= llrs_per_cb_; i += 32) {
+    const __m256i new_llrs =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(llrs + i));
+    const __m256i kept_llrs =
+        _mm256_load_si256(reinterpret_cast<const __m256i*>(kept + i));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(llrs + i),
+                        _mm256_adds_epi8(new_llrs, kept_llrs));
+  }
+  for (; i < llrs_per_cb_; i++) {
+    const int sum = static_cast<int>(llrs[i]) + kept[i];
+    llrs[i] = static_cast<int8_t>(sum > 127 ? 127 : (sum < -128 ? -128 : sum));
+  }
+  num_combined_.fetch_add(1, std::memory_order_relaxed);
+  return cb.num_transmissions_ + 1;
+}
+
+void HarqSoftBuffer::Store(size_t ue_id, size_t symbol_idx, size_t cb_id,
+                           size_t frame_id, const int8_t* llrs,
+                           size_t num_transmissions) {
+  const size_t cb_index = CbIndex(ue_id, symbol_idx, cb_id);
+  std::lock_guard<std::mutex> lock(
+      process_mutexes_[ProcessIndex(ue_id, symbol_idx)]);
+  CodeBlock& cb = cbs_[cb_index];
+  // Feedback for a later frame has already arrived
+  if ((cb.state_ != State::kEmpty) && (cb.frame_id_ > frame_id)) {
+    return;
+  }
+  std::memcpy(llrs_ + (cb_index * llr_stride_), llrs, llrs_per_cb_);
+  cb.frame_id_ = frame_id;
+  cb.num_transmissions_ = num_transmissions;
+  cb.state_ = State::kPending;
+}
+
+void HarqSoftBuffer::Feedback(size_t ue_id, size_t symbol_idx, size_t cb_id,
+                              size_t frame_id, bool crc_ok) {
+  std::lock_guard<std::mutex> lock(
+      process_mutexes_[ProcessIndex(ue_id, symbol_idx)]);
+  CodeBlock& cb = cbs_[CbIndex(ue_id, symbol_idx, cb_id)];
+  if ((cb.state_ != State::kPending) || (cb.frame_id_ != frame_id)) {
+    return;
+  }
+  if (crc_ok) {
+    cb.state_ = State::kEmpty;
+  } else if (cb.num_transmissions_ >= max_transmissions_) {
+    cb.state_ = State::kEmpty;
+    num_dropped_.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    cb.state_ = State::kFailed;
+  }
+}
+
+void HarqSoftBuffer::Release(size_t ue_id, size_t symbol_idx, size_t cb_id) {
+  std::lock_guard<std::mutex> lock(
+      process_mutexes_[ProcessIndex(ue_id, symbol_idx)]);
+  cbs_[CbIndex(ue_id, symbol_idx, cb_id)].state_ = State::kEmpty;
+}
+
+size_t HarqSoftBuffer::MemoryBytes() const {
+  return (cbs_.size() * (llr_stride_ + sizeof(CodeBlock))) +
+         (num_ues_ * num_symbols_ * sizeof(std::mutex));
+}
+
+void HarqSoftBuffer::PrintSummary() const {
+  std::printf(
+      "HARQ soft buffer: %zu UEs x %zu symbols x %zu code blocks, %.2f MB, "
+      "%zu combined decodes, %zu code blocks dropped after %zu "
+      "transmissions\n",
+      num_ues_, num_symbols_, num_cbs_, MemoryBytes() / (1024.0 * 1024.0),
+      NumCombined(), NumDropped(), max_transmissions_);
+}
@@ -0,0 +1,113 @@
+/**
+ * @file harq_buffer.h
+ * @brief Declaration file for the HarqSoftBuffer class, the HARQ soft buffer
+ * of the uplink decoder.
+ *
+ * The soft buffer keeps the int8 LLRs of code blocks that failed decoding.
+ * When a code block is received again, DoDecode chase-combines the kept LLRs
+ * with the new ones (a saturating add) before LDPC decoding, so code blocks
+ * of low-SNR UEs converge in fewer decoder iterations and transmissions.
+ */
+#ifndef HARQ_BUFFER_H_
+#define HARQ_BUFFER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class HarqSoftBuffer {
+ public:
+  /**
+   * @brief Create a soft buffer with one HARQ process for each UE and uplink
+   * symbol. Each process holds the LLRs of [num_cbs] code blocks with
+   * [llrs_per_cb] LLRs each.
+   *
+   * @param max_transmissions A code block that still fails after this many
+   * combined transmissions is dropped from the soft buffer
+   */
+  HarqSoftBuffer(size_t num_ues, size_t num_symbols, size_t num_cbs,
+                 size_t llrs_per_cb, size_t max_transmissions);
+  ~HarqSoftBuffer();
+
+  /**
+   * @brief Chase-combine [llrs], the LLRs of code block [cb_id] received in
+   * frame [frame_id], with the LLRs kept from the failed earlier
+   * transmissions of the code block. The sum is written back to [llrs].
+   *
+   * @param new_data True if the frame carries new data rather than a
+   * retransmission. The kept LLRs are then released instead of combined.
+   *
+   * @return The number of transmissions that [llrs] now holds
+   */
+  size_t Combine(size_t ue_id, size_t symbol_idx, size_t cb_id,
+                 size_t frame_id, bool new_data, int8_t* llrs);
+
+  /// Keep [llrs], which hold [num_transmissions] transmissions of code block
+  /// [cb_id] received in frame [frame_id], until Feedback() reports whether
+  /// the code block was decoded correctly
+  void Store(size_t ue_id, size_t symbol_idx, size_t cb_id, size_t frame_id,
+             const int8_t* llrs, size_t num_transmissions);
+
+  /// Report whether code block [cb_id] received in frame [frame_id] passed
+  /// its CRC. The LLRs kept by Store() are released if it did, and combined
+  /// with the next transmission otherwise.
+  void Feedback(size_t ue_id, size_t symbol_idx, size_t cb_id,
+                size_t frame_id, bool crc_ok);
+
+  /// Forget the kept LLRs of code block [cb_id]
+  void Release(size_t ue_id, size_t symbol_idx, size_t cb_id);
+
+  inline size_t NumCbs() const { return num_cbs_; }
+
+  /// Bytes of memory allocated for LLRs and process state
+  size_t MemoryBytes() const;
+
+  /// Number of decodes that combined at least one earlier transmission
+  inline size_t NumCombined() const { return num_combined_.load(); }
+  /// Number of code blocks dropped after [max_transmissions_] failures
+  inline size_t NumDropped() const { return num_dropped_.load(); }
+
+  void PrintSummary() const;
+
+ private:
+  enum class State : uint8_t {
+    kEmpty,    // No LLRs kept
+    kPending,  // LLRs kept, waiting for Feedback()
+    kFailed    // LLRs kept, to be combined with the next transmission
+  };
+
+  struct CodeBlock {
+    size_t frame_id_;
+    size_t num_transmissions_;
+    State state_;
+  };
+
+  inline size_t ProcessIndex(size_t ue_id, size_t symbol_idx) const {
+    return (ue_id * num_symbols_) + symbol_idx;
+  }
+  inline size_t CbIndex(size_t ue_id, size_t symbol_idx, size_t cb_id) const {
+    return (ProcessIndex(ue_id, symbol_idx) * num_cbs_) + cb_id;
+  }
+
+  const size_t num_ues_;
+  const size_t num_symbols_;
+  const size_t num_cbs_;
+  const size_t llrs_per_cb_;
+  // LLRs of one code block are this many bytes apart in llrs_
+  const size_t llr_stride_;
+  const size_t max_transmissions_;
+
+  int8_t* llrs_;
+  std::vector<CodeBlock> cbs_;
+  // Guards the code blocks of one HARQ process. The decoders of consecutive
+  // frames can touch a process at the same time.
+  std::unique_ptr<std::mutex[]> process_mutexes_;
+
+  std::atomic<size_t> num_combined_;
+  std::atomic<size_t> num_dropped_;
+};
+
+#endif  // HARQ_BUFFER_H_
@@ -1,156 +1,296 @@
-/***************************************************************************
- *   Copyright (C) 2008 by H-Store Project                                 *
- *   Brown University                                                      *
- *   Massachusetts Institute of Technology                                 *
- *   Yale University                                                       *
- *                                                                         *
- *   This software may be modified and distributed under the terms         *
- *   of the MIT license.  See the LICENSE file for details.                *
- *                                                                         *
- *   Copyright (C) 2018 by eRPC Project                                    *
- *   Carnegie Mellon University                                            *
- ***************************************************************************/
-
-/**
- * @file logger.h
- * @brief Logging macros that can be optimized out by the compiler
- * @author Hideaki, modified by Anuj
- */
-
-#ifndef LOGGER_H_
-#define LOGGER_H_
-
-#include <ctime>
-#include <string>
-
-// Log levels: higher means more verbose
-#define MLPD_LOG_LEVEL_OFF 0
-#define MLPD_LOG_LEVEL_ERROR 1  // Only fatal conditions
-#define MLPD_LOG_LEVEL_WARN 2  // Conditions from which it's possible to recover
-#define MLPD_LOG_LEVEL_INFO 3  // Reasonable to log (e.g., management packets)
-#define MLPD_LOG_LEVEL_FRAME 4   // Per-frame logging
-#define MLPD_LOG_LEVEL_SYMBOL 5  // Per-symbol logging
-#define MLPD_LOG_LEVEL_TRACE 6   // Reserved for very high verbosity
-
-#define MLPD_LOG_DEFAULT_STREAM stdout
-
-// Log messages with "FRAME" or higher verbosity get written to
-// mlpd_trace_file_or_default_stream. This can be stdout for basic debugging, or
-// a file named "trace_file" for more involved debugging.
-
-//#define mlpd_trace_file_or_default_stream trace_file
-#define mlpd_trace_file_or_default_stream MLPD_LOG_DEFAULT_STREAM
-
-// If MLPD_LOG_LEVEL is not defined, default to the highest level so that
-// YouCompleteMe does not report compilation errors
-#ifndef MLPD_LOG_LEVEL
-#define MLPD_LOG_LEVEL MLPD_LOG_LEVEL_TRACE
-#endif
-
-#if MLPD_LOG_LEVEL >= MLPD_LOG_LEVEL_ERROR
-#define MLPD_ERROR(...)                                               \
-  MlpdOutputLogHeader(MLPD_LOG_DEFAULT_STREAM, MLPD_LOG_LEVEL_ERROR); \
-  std::fprintf(MLPD_LOG_DEFAULT_STREAM, __VA_ARGS__);                 \
-  std::fflush(MLPD_LOG_DEFAULT_STREAM)
-#else
-#define MLPD_ERROR(...) ((void)0)
-#endif
-
-#if MLPD_LOG_LEVEL >= MLPD_LOG_LEVEL_WARN
-#define MLPD_WARN(...)                                               \
-  MlpdOutputLogHeader(MLPD_LOG_DEFAULT_STREAM, MLPD_LOG_LEVEL_WARN); \
-  std::fprintf(MLPD_LOG_DEFAULT_STREAM, __VA_ARGS__);                \
-  std::fflush(MLPD_LOG_DEFAULT_STREAM)
-#else
-#define MLPD_WARN(...) ((void)0)
-#endif
-
-#if MLPD_LOG_LEVEL >= MLPD_LOG_LEVEL_INFO
-#define MLPD_INFO(...)                                               \
-  MlpdOutputLogHeader(MLPD_LOG_DEFAULT_STREAM, MLPD_LOG_LEVEL_INFO); \
-  std::fprintf(MLPD_LOG_DEFAULT_STREAM, __VA_ARGS__);                \
-  std::fflush(MLPD_LOG_DEFAULT_STREAM)
-#else
-#define MLPD_INFO(...) ((void)0)
-#endif
-
-#if MLPD_LOG_LEVEL >= MLPD_LOG_LEVEL_FRAME
-#define MLPD_FRAME(...)                                         \
-  MlpdOutputLogHeader(mlpd_trace_file_or_default_stream,        \
-                      MLPD_LOG_LEVEL_FRAME);                    \
-  std::fprintf(mlpd_trace_file_or_default_stream, __VA_ARGS__); \
-  std::fflush(mlpd_trace_file_or_default_stream)
-#else
-#define MLPD_FRAME(...) ((void)0)
-#endif
-
-#if MLPD_LOG_LEVEL >= MLPD_LOG_LEVEL_SYMBOL
-#define MLPD_SYMBOL(...)                                        \
-  MlpdOutputLogHeader(mlpd_trace_file_or_default_stream,        \
-                      MLPD_LOG_LEVEL_SYMBOL);                   \
-  std::fprintf(mlpd_trace_file_or_default_stream, __VA_ARGS__); \
-  std::fflush(mlpd_trace_file_or_default_stream)
-#else
-#define MLPD_SYMBOL(...) ((void)0)
-#endif
-
-#if MLPD_LOG_LEVEL >= MLPD_LOG_LEVEL_TRACE
-#define MLPD_TRACE(...)                                         \
-  MlpdOutputLogHeader(mlpd_trace_file_or_default_stream,        \
-                      MLPD_LOG_LEVEL_TRACE);                    \
-  std::fprintf(mlpd_trace_file_or_default_stream, __VA_ARGS__); \
-  std::fflush(mlpd_trace_file_or_default_stream)
-#else
-#define MLPD_TRACE(...) ((void)0)
-#endif
-
-/// Return decent-precision time formatted as seconds:microseconds
-static std::string MlpdGetFormattedTime() {
-  struct timespec t;
-  clock_gettime(CLOCK_REALTIME, &t);
-  char buf[20];
-  uint32_t seconds = t.tv_sec % 100;  // Rollover every 100 seconds
-  uint32_t usec = t.tv_nsec / 1000;
-
-  sprintf(buf, "%u:%06u", seconds, usec);
-  return std::string(buf);
-}
-
-// Output log message header
-static inline void MlpdOutputLogHeader(FILE* stream, int level) {
-  std::string formatted_time = MlpdGetFormattedTime();
-
-  const char* type;
-  switch (level) {
-    case MLPD_LOG_LEVEL_ERROR:
-      type = "ERROR";
-      break;
-    case MLPD_LOG_LEVEL_WARN:
-      type = "WARNG";
-      break;
-    case MLPD_LOG_LEVEL_INFO:
-      type = "INFOR";
-      break;
-    case MLPD_LOG_LEVEL_FRAME:
-      type = "FRAME";
-      break;
-    case MLPD_LOG_LEVEL_SYMBOL:
-      type = "SBFRM";
-      break;
-    case MLPD_LOG_LEVEL_TRACE:
-      type = "TRACE";
-      break;
-    default:
-      type = "UNKWN";
-  }
-
-  std::fprintf(stream, "%s %s: ", formatted_time.c_str(), type);
-}
-
-/// Return true if the logging verbosity is reasonable for non-developer users
-/// of Agora
-static inline bool IsLogLevelReasonable() {
-  return MLPD_LOG_LEVEL <= MLPD_LOG_LEVEL_INFO;
-}
-
+/***************************************************************************
+ *   Copyright (C) 2008 by H-Store Project                                 *
+ *   Brown University                                                      *
+ *   Massachusetts Institute of Technology                                 *
+ *   Yale University                                                       *
+ *                                                                         *
+ *   This software may be modified and distributed under the terms         *
+ *   of the MIT license.  See the LICENSE file for details.                *
+ *                                                                         *
+ *   Copyright (C) 2018 by eRPC Project                                    *
+ *   Carnegie Mellon University                                            *
+ ***************************************************************************/
+
+/**
+ * @file logger.h
+ * @brief Logging macros that can be optimized out by the compiler
+ * @author Hideaki, modified by Anuj
+ */
+
+#ifndef LOGGER_H_
+#define LOGGER_H_
+
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <string>
+
+#if defined(ENABLE_ASYNC_LOG)
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "async_logger.h"
+#endif
+
+// Log levels: higher means more verbose
+#define MLPD_LOG_LEVEL_OFF 0
+#define MLPD_LOG_LEVEL_ERROR 1  // Only fatal conditions
+#define MLPD_LOG_LEVEL_WARN 2  // Conditions from which it's possible to recover
+#define MLPD_LOG_LEVEL_INFO 3  // Reasonable to log (e.g., management packets)
+#define MLPD_LOG_LEVEL_FRAME 4   // Per-frame logging
+#define MLPD_LOG_LEVEL_SYMBOL 5  // Per-symbol logging
+#define MLPD_LOG_LEVEL_TRACE 6   // Reserved for very high verbosity
+
+#define MLPD_LOG_DEFAULT_STREAM stdout
+
+// Log messages with "FRAME" or higher verbosity get written to
+// mlpd_trace_file_or_default_stream. This can be stdout for basic debugging, or
+// a file named "trace_file" for more involved debugging.
+
+//#define mlpd_trace_file_or_default_stream trace_file
+#define mlpd_trace_file_or_default_stream MLPD_LOG_DEFAULT_STREAM
+
+// If MLPD_LOG_LEVEL is not defined, default to the highest level so that
+// YouCompleteMe does not report compilation errors
+#ifndef MLPD_LOG_LEVEL
+#define MLPD_LOG_LEVEL MLPD_LOG_LEVEL_TRACE
+#endif
+
+// With ENABLE_ASYNC_LOG, messages below ERROR are copied into the
+// AsyncLogger ring of the calling thread and formatted by its drain thread.
+// Arguments are captured by value and "%s" strings are copied, so callers
+// may pass temporaries such as std::string::c_str(). ERROR messages are
+// written synchronously after the queued messages are flushed, so they are
+// never lost if the process terminates right after.
+#if defined(ENABLE_ASYNC_LOG)
+#define MLPD_LOG_MESSAGE(stream, level, ...) \
+  do {                                       \
+    if (false) {                             \
+      std::printf(__VA_ARGS__);              \
+    }                                        \
+    MlpdAsyncLog(stream, level, __VA_ARGS__); \
+  } while (0)
+#define MLPD_LOG_MESSAGE_SYNC(stream, level, ...) \
+  AsyncLogger::FlushIfRunning();                  \
+  MlpdOutputLogHeader(stream, level);             \
+  std::fprintf(stream, __VA_ARGS__);              \
+  std::fflush(stream)
+#else
+#define MLPD_LOG_MESSAGE(stream, level, ...) \
+  MlpdOutputLogHeader(stream, level);        \
+  std::fprintf(stream, __VA_ARGS__);         \
+  std::fflush(stream)
+#define MLPD_LOG_MESSAGE_SYNC(stream, level, ...) \
+  MLPD_LOG_MESSAGE(stream, level, __VA_ARGS__)
+#endif
+
+#if MLPD_LOG_LEVEL >= MLPD_LOG_LEVEL_ERROR
+#define MLPD_ERROR(...)                                                   \
+  MLPD_LOG_MESSAGE_SYNC(MLPD_LOG_DEFAULT_STREAM, MLPD_LOG_LEVEL_ERROR, \
+                        __VA_ARGS__)
+#else
+#define MLPD_ERROR(...) ((void)0)
+#endif
+
+#if MLPD_LOG_LEVEL >= MLPD_LOG_LEVEL_WARN
+#define MLPD_WARN(...) \
+  MLPD_LOG_MESSAGE(MLPD_LOG_DEFAULT_STREAM, MLPD_LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define MLPD_WARN(...) ((void)0)
+#endif
+
+#if MLPD_LOG_LEVEL >= MLPD_LOG_LEVEL_INFO
+#define MLPD_INFO(...) \
+  MLPD_LOG_MESSAGE(MLPD_LOG_DEFAULT_STREAM, MLPD_LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define MLPD_INFO(...) ((void)0)
+#endif
+
+#if MLPD_LOG_LEVEL >= MLPD_LOG_LEVEL_FRAME
+#define MLPD_FRAME(...)                                                    \
+  MLPD_LOG_MESSAGE(mlpd_trace_file_or_default_stream, MLPD_LOG_LEVEL_FRAME, \
+                   __VA_ARGS__)
+#else
+#define MLPD_FRAME(...) ((void)0)
+#endif
+
+#if MLPD_LOG_LEVEL >= MLPD_LOG_LEVEL_SYMBOL
+#define MLPD_SYMBOL(...)                                \
+  MLPD_LOG_MESSAGE(mlpd_trace_file_or_default_stream, \
+                   MLPD_LOG_LEVEL_SYMBOL, __VA_ARGS__)
+#else
+#define MLPD_SYMBOL(...) ((void)0)
+#endif
+
+#if MLPD_LOG_LEVEL >= MLPD_LOG_LEVEL_TRACE
+#define MLPD_TRACE(...)                                                    \
+  MLPD_LOG_MESSAGE(mlpd_trace_file_or_default_stream, MLPD_LOG_LEVEL_TRACE, \
+                   __VA_ARGS__)
+#else
+#define MLPD_TRACE(...) ((void)0)
+#endif
+
+/// Format [t] with decent precision as seconds:microseconds
+static inline std::string MlpdFormatTime(const struct timespec& t) {
+  char buf[20];
+  uint32_t seconds = t.tv_sec % 100;  // Rollover every 100 seconds
+  uint32_t usec = t.tv_nsec / 1000;
+
+  sprintf(buf, "%u:%06u", seconds, usec);
+  return std::string(buf);
+}
+
+/// Return decent-precision time formatted as seconds:microseconds
+static inline std::string MlpdGetFormattedTime() {
+  struct timespec t;
+  clock_gettime(CLOCK_REALTIME, &t);
+  return MlpdFormatTime(t);
+}
+
+// Output log message header for a message logged at time [t]
+static inline void MlpdOutputLogHeader(FILE* stream, int level,
+                                       const struct timespec& t) {
+  std::string formatted_time = MlpdFormatTime(t);
+
+  const char* type;
+  switch (level) {
+    case MLPD_LOG_LEVEL_ERROR:
+      type = "ERROR";
+      break;
+    case MLPD_LOG_LEVEL_WARN:
+      type = "WARNG";
+      break;
+    case MLPD_LOG_LEVEL_INFO:
+      type = "INFOR";
+      break;
+    case MLPD_LOG_LEVEL_FRAME:
+      type = "FRAME";
+      break;
+    case MLPD_LOG_LEVEL_SYMBOL:
+      type = "SBFRM";
+      break;
+    case MLPD_LOG_LEVEL_TRACE:
+      type = "TRACE";
+      break;
+    default:
+      type = "UNKWN";
+  }
+
+  std::fprintf(stream, "%s %s: ", formatted_time.c_str(), type);
+}
+
+// Output log message header
+static inline void MlpdOutputLogHeader(FILE* stream, int level) {
+  struct timespec t;
+  clock_gettime(CLOCK_REALTIME, &t);
+  MlpdOutputLogHeader(stream, level, t);
+}
+
+#if defined(ENABLE_ASYNC_LOG)
+/// How an argument of a log message is stored in its AsyncLogger record
+template <typename T>
+struct MlpdAsyncArg {
+  static_assert(std::is_trivially_copyable_v<T>,
+                "Log message arguments must be printf-compatible");
+  using Stored = T;
+  static inline size_t StringBytes(T /*arg*/) { return 0; }
+  static inline Stored Store(T arg, char* /*strings*/, size_t& /*pos*/) {
+    return arg;
+  }
+  static inline T Load(Stored stored, const char* /*strings*/) {
+    return stored;
+  }
+};
+
+/// Strings are copied behind the arguments and stored as an offset
+template <>
+struct MlpdAsyncArg<const char*> {
+  using Stored = size_t;
+  static inline size_t StringBytes(const char* arg) {
+    return std::strlen(arg == nullptr ? "(null)" : arg) + 1;
+  }
+  static inline Stored Store(const char* arg, char* strings, size_t& pos) {
+    const char* str = (arg == nullptr) ? "(null)" : arg;
+    const size_t bytes = std::strlen(str) + 1;
+    std::memcpy(strings + pos, str, bytes);
+    pos += bytes;
+    return pos - bytes;
+  }
+  static inline const char* Load(Stored stored, const char* strings) {
+    return strings + stored;
+  }
+};
+template <>
+struct MlpdAsyncArg<char*> : public MlpdAsyncArg<const char*> {};
+
+struct MlpdAsyncRecord {
+  struct timespec time_;
+  int level_;
+  const char* format_;  // Always a string literal
+};
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+#pragma GCC diagnostic ignored "-Wformat-security"
+template <typename... Args, size_t... I>
+static inline void MlpdAsyncPrint(
+    FILE* stream, const MlpdAsyncRecord* record,
+    const std::tuple<typename MlpdAsyncArg<Args>::Stored...>* args,
+    std::index_sequence<I...>) {
+  [[maybe_unused]] const char* strings =
+      reinterpret_cast<const char*>(args + 1);
+  MlpdOutputLogHeader(stream, record->level_, record->time_);
+  std::fprintf(stream, record->format_,
+               MlpdAsyncArg<Args>::Load(std::get<I>(*args), strings)...);
+  std::fflush(stream);
+}
+#pragma GCC diagnostic pop
+
+/// Runs on the AsyncLogger drain thread
+template <typename... Args>
+static void MlpdAsyncConsume(void* sink, const uint8_t* data,
+                             size_t /*len*/) {
+  using StoredArgs = std::tuple<typename MlpdAsyncArg<Args>::Stored...>;
+  const auto* record = reinterpret_cast<const MlpdAsyncRecord*>(data);
+  const auto* args =
+      reinterpret_cast<const StoredArgs*>(data + sizeof(MlpdAsyncRecord));
+  MlpdAsyncPrint<Args...>(static_cast<FILE*>(sink), record, args,
+                          std::index_sequence_for<Args...>());
+}
+
+/// Queue a log message. Formatting happens on the drain thread.
+template <typename... Args>
+static inline void MlpdAsyncLog(FILE* stream, int level, const char* format,
+                                Args... args) {
+  using StoredArgs = std::tuple<typename MlpdAsyncArg<Args>::Stored...>;
+  const size_t string_bytes = (MlpdAsyncArg<Args>::StringBytes(args) + ... + 0);
+  const size_t len =
+      sizeof(MlpdAsyncRecord) + sizeof(StoredArgs) + string_bytes;
+
+  struct timespec t;
+  clock_gettime(CLOCK_REALTIME, &t);
+  AsyncLogger::Instance().Log(
+      &MlpdAsyncConsume<Args...>, stream, len, [&](uint8_t* data) {
+        auto* record = reinterpret_cast<MlpdAsyncRecord*>(data);
+        record->time_ = t;
+        record->level_ = level;
+        record->format_ = format;
+        [[maybe_unused]] char* strings = reinterpret_cast<char*>(
+            data + sizeof(MlpdAsyncRecord) + sizeof(StoredArgs));
+        [[maybe_unused]] size_t pos = 0;
+        // Braced initialization stores the arguments in order
+        new (data + sizeof(MlpdAsyncRecord))
+            StoredArgs{MlpdAsyncArg<Args>::Store(args, strings, pos)...};
+      });
+}
+#endif  // defined(ENABLE_ASYNC_LOG)
+
+/// Return true if the logging verbosity is reasonable for non-developer users
+/// of Agora
+static inline bool IsLogLevelReasonable() {
+  return MLPD_LOG_LEVEL <= MLPD_LOG_LEVEL_INFO;
+}
+
 #endif  // LOGGER_INC_
\ No newline at end of file
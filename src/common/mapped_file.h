@@ -0,0 +1,101 @@
+/**
+ * @file mapped_file.h
+ * @brief Files mapped into memory, so that large data files are written in
+ * place by many threads instead of being assembled in heap buffers and copied
+ * out with fwrite, and read without copies by processes that share the page
+ * cache.
+ */
+#ifndef MAPPED_FILE_H_
+#define MAPPED_FILE_H_
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring> /* std::strerror */
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+class MappedFile {
+ public:
+  /**
+   * @brief Create [path], or truncate it if it exists, with [size] zero
+   * bytes and map it for writing. The contents reach the file when the
+   * MappedFile is destroyed at the latest.
+   */
+  static std::unique_ptr<MappedFile> Create(const std::string& path,
+                                            size_t size) {
+    const int fd = open(path.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0644);
+    if (fd == -1) {
+      throw std::runtime_error("MappedFile: open " + path +
+                               " failed: " + std::strerror(errno));
+    }
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+      close(fd);
+      throw std::runtime_error("MappedFile: ftruncate " + path +
+                               " failed: " + std::strerror(errno));
+    }
+    void* base = nullptr;
+    if (size > 0) {
+      base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (base == MAP_FAILED) {
+      throw std::runtime_error("MappedFile: mmap " + path +
+                               " failed: " + std::strerror(errno));
+    }
+    return std::unique_ptr<MappedFile>(new MappedFile(base, size));
+  }
+
+  /// Map all of [path] read-only. Writes through the mapping fault.
+  static std::unique_ptr<MappedFile> Open(const std::string& path) {
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+      throw std::runtime_error("MappedFile: open " + path +
+                               " failed: " + std::strerror(errno));
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+      close(fd);
+      throw std::runtime_error("MappedFile: fstat " + path +
+                               " failed: " + std::strerror(errno));
+    }
+    const auto size = static_cast<size_t>(st.st_size);
+    void* base = nullptr;
+    if (size > 0) {
+      base = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (base == MAP_FAILED) {
+      throw std::runtime_error("MappedFile: mmap " + path +
+                               " failed: " + std::strerror(errno));
+    }
+    return std::unique_ptr<MappedFile>(new MappedFile(base, size));
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  ~MappedFile() {
+    if (base_ != nullptr) {
+      munmap(base_, size_);
+    }
+  }
+
+  template <typename T>
+  inline T* Data() const {
+    return static_cast<T*>(base_);
+  }
+  inline size_t Size() const { return size_; }
+
+ private:
+  MappedFile(void* base, size_t size) : base_(base), size_(size) {}
+
+  void* base_;
+  size_t size_;
+};
+
+#endif  // MAPPED_FILE_H_
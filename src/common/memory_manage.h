@@ -29,6 +29,8 @@ class Table {
   size_t dim2_{0};
   size_t dim1_{0};
   T* data_;
+  // False if data_ belongs to someone else (see View())
+  bool owned_{true};
 
  public:
   Table() : data_(nullptr) {}
@@ -36,6 +38,7 @@ class Table {
   void Malloc(size_t dim1, size_t dim2, Agora_memory::Alignment_t alignment) {
     this->dim2_ = dim2;
     this->dim1_ = dim1;
+    this->owned_ = true;
     // RtAssert(((dim1 > 0) && (dim2 == 0)), "Table: Malloc one dimension = 0");
     size_t alloc_size = (this->dim1_ * this->dim2_ * sizeof(T));
     this->data_ = static_cast<T*>(
@@ -78,15 +81,25 @@ class Table {
     }
   }
 
+  /// Use the [dim1] x [dim2] elements at [data], which belong to someone
+  /// else (e.g. a memory-mapped file), as the table. Free() leaves them.
+  void View(T* data, size_t dim1, size_t dim2) {
+    this->dim2_ = dim2;
+    this->dim1_ = dim1;
+    this->data_ = data;
+    this->owned_ = false;
+  }
+
   bool IsAllocated() { return (this->data_ != nullptr); }
 
   void Free() {
-    if (this->data_ != nullptr) {
+    if ((this->data_ != nullptr) && (this->owned_ == true)) {
       std::free(this->data_);
     }
     this->dim2_ = 0;
     this->dim1_ = 0;
     this->data_ = nullptr;
+    this->owned_ = true;
   }
 
   T* At(size_t dim1) const { return (*this)[dim1]; }
@@ -1,5 +1,7 @@
 #include "modulation.h"
 
+#include "comms-lib.h"
+
 void Print256Epi32(__m256i var) {
   auto* val = reinterpret_cast<int32_t*>(&var);
   std::printf("Numerical: %i %i %i %i %i %i %i %i \n", val[0], val[1], val[2],
@@ -575,7 +577,7 @@ void Demod16qamHardAvx2(float* vec_in, uint8_t* vec_out, int num) {
                     num - next_start);
 }
 
-void Demod16qamSoftAvx2(float* vec_in, int8_t* llr, int num) {
+void Demod16qamSoftAvx2(float* vec_in, int8_t* llr, int num, float scale) {
   float* symbols_ptr = vec_in;
   auto* result_ptr = reinterpret_cast<__m256i*>(llr);
   __m256 symbol1;
@@ -590,14 +592,15 @@ void Demod16qamSoftAvx2(float* vec_in, int8_t* llr, int num) {
   __m256i symbol_abs;
   __m256i symbol_12;
   __m256i symbol_34;
-  __m256i offset = _mm256_set1_epi8(2 * SCALE_BYTE_CONV_QAM16 / sqrt(10));
+  __m256i offset = _mm256_set1_epi8(2 * scale / sqrt(10));
   __m256i result1n;
   __m256i result1a;
   __m256i result2n;
   __m256i result2a;
   __m256i result1na;
   __m256i result2na;
-  __m256 scale_v = _mm256_set1_ps(SCALE_BYTE_CONV_QAM16);
+  __m256 scale_v = _mm256_set1_ps(scale);
+  __m256i min_llr = _mm256_set1_epi8(-127);
 
   __m256i shuffle_negated_1 = _mm256_set_epi8(
       0xff, 0xff, 7, 6, 0xff, 0xff, 5, 4, 0xff, 0xff, 3, 2, 0xff, 0xff, 1, 0,
@@ -634,6 +637,8 @@ void Demod16qamSoftAvx2(float* vec_in, int8_t* llr, int num) {
     symbol_34 = _mm256_permute4x64_epi64(symbol_34, 0xd8);
     symbol_i = _mm256_packs_epi16(symbol_12, symbol_34);
     symbol_i = _mm256_permute4x64_epi64(symbol_i, 0xd8);
+    // Saturate at -127 so that the absolute values below do not overflow
+    symbol_i = _mm256_max_epi8(symbol_i, min_llr);
 
     symbol_abs = _mm256_abs_epi8(symbol_i);
     symbol_abs = _mm256_sub_epi8(offset, symbol_abs);
@@ -657,7 +662,7 @@ void Demod16qamSoftAvx2(float* vec_in, int8_t* llr, int num) {
   // Demodulate last symbols
   int next_start = 16 * (num / 16);
   Demod16qamSoftSse(vec_in + 2 * next_start, llr + next_start * 4,
-                    num - next_start);
+                    num - next_start, scale);
 }
 
 /**
@@ -1077,7 +1082,7 @@ void Demod64qamHardAvx2(float* vec_in, uint8_t* vec_out, int num) {
                     num - next_start);
 }
 
-void Demod64qamSoftAvx2(float* vec_in, int8_t* llr, int num) {
+void Demod64qamSoftAvx2(float* vec_in, int8_t* llr, int num, float scale) {
   auto* symbols_ptr = static_cast<float*>(vec_in);
   auto* result_ptr = reinterpret_cast<__m256i*>(llr);
   __m256 symbol1;
@@ -1093,9 +1098,10 @@ void Demod64qamSoftAvx2(float* vec_in, int8_t* llr, int num) {
   __m256i symbol_abs2;
   __m256i symbol_12;
   __m256i symbol_34;
-  __m256i offset1 = _mm256_set1_epi8(4 * SCALE_BYTE_CONV_QAM64 / sqrt(42));
-  __m256i offset2 = _mm256_set1_epi8(2 * SCALE_BYTE_CONV_QAM64 / sqrt(42));
-  __m256 scale_v = _mm256_set1_ps(SCALE_BYTE_CONV_QAM64);
+  __m256i offset1 = _mm256_set1_epi8(4 * scale / sqrt(42));
+  __m256i offset2 = _mm256_set1_epi8(2 * scale / sqrt(42));
+  __m256 scale_v = _mm256_set1_ps(scale);
+  __m256i min_llr = _mm256_set1_epi8(-127);
   __m256i result11;
   __m256i result12;
   __m256i result13;
@@ -1171,6 +1177,8 @@ void Demod64qamSoftAvx2(float* vec_in, int8_t* llr, int num) {
     // Pack symbols into 8 bit integers (one 256 bit vector)
     symbol_i = _mm256_packs_epi16(symbol_12, symbol_34);
     symbol_i = _mm256_permute4x64_epi64(symbol_i, 0xd8);
+    // Saturate at -127 so that the absolute values below do not overflow
+    symbol_i = _mm256_max_epi8(symbol_i, min_llr);
     // first LLR is simply the symbol
     // this LLR corresponds to bit 5 and 4 (both flip over the I and Q axis)
     // LLR(b5,b4) = |x|
@@ -1219,7 +1227,7 @@ void Demod64qamSoftAvx2(float* vec_in, int8_t* llr, int num) {
   }
   int next_start = 16 * (num / 16);
   Demod64qamSoftSse(vec_in + 2 * next_start, llr + next_start * 6,
-                    num - next_start);
+                    num - next_start, scale);
 }
 
 /**
@@ -2687,4 +2695,25 @@ void Demod256qamSoftAvx512(const float* vec_in, int8_t* llr, int num) {
   Demod256qamSoftAvx2(vec_in + 2 * next_start, llr + next_start * 8,
                       num - next_start);
 }
-#endif
\ No newline at end of file
+#endif
+
+bool DemodSoftAvx2(float* vec_in, int8_t* llr, size_t num_sc,
+                   size_t mod_order_bits, float llr_scale) {
+  switch (mod_order_bits) {
+    case CommsLib::kQpsk:
+      // The QPSK demapper counts real values, not symbols
+      DemodQpskSoftSse(vec_in, llr, num_sc * 2,
+                       llr_scale * SCALE_BYTE_CONV_QPSK);
+      return true;
+    case CommsLib::kQaM16:
+      Demod16qamSoftAvx2(vec_in, llr, num_sc,
+                         llr_scale * SCALE_BYTE_CONV_QAM16);
+      return true;
+    case CommsLib::kQaM64:
+      Demod64qamSoftAvx2(vec_in, llr, num_sc,
+                         llr_scale * SCALE_BYTE_CONV_QAM64);
+      return true;
+    default:
+      return false;
+  }
+}
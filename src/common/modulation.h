@@ -42,23 +42,35 @@ complex_float ModSingleUint8(uint8_t x, Table<complex_float>& mod_table);
 void ModSimd(uint8_t* in, complex_float*& out, size_t len,
              Table<complex_float>& mod_table);
 
-void DemodQpskSoftSse(float* x, int8_t* z, int len);
+// The soft demappers below take an optional LLR scale: the int8 LLR of a
+// received value is [scale] times its distance from the decision boundary.
+// Scales much larger than the defaults saturate the outer 16-QAM and 64-QAM
+// points and corrupt the LLRs of their inner bits.
+// DemodQpskSoftSse() demaps [len] real values, i.e., len / 2 symbols.
+void DemodQpskSoftSse(float* x, int8_t* z, int len,
+                      float scale = SCALE_BYTE_CONV_QPSK);
 
 void Demod16qamHardLoop(const float* vec_in, uint8_t* vec_out, int num);
 void Demod16qamHardSse(float* vec_in, uint8_t* vec_out, int num);
 void Demod16qamHardAvx2(float* vec_in, uint8_t* vec_out, int num);
 
-void Demod16qamSoftLoop(const float* vec_in, int8_t* llr, int num);
-void Demod16qamSoftSse(float* vec_in, int8_t* llr, int num);
-void Demod16qamSoftAvx2(float* vec_in, int8_t* llr, int num);
+void Demod16qamSoftLoop(const float* vec_in, int8_t* llr, int num,
+                        float scale = SCALE_BYTE_CONV_QAM16);
+void Demod16qamSoftSse(float* vec_in, int8_t* llr, int num,
+                       float scale = SCALE_BYTE_CONV_QAM16);
+void Demod16qamSoftAvx2(float* vec_in, int8_t* llr, int num,
+                        float scale = SCALE_BYTE_CONV_QAM16);
 
 void Demod64qamHardLoop(const float* vec_in, uint8_t* vec_out, int num);
 void Demod64qamHardSse(float* vec_in, uint8_t* vec_out, int num);
 void Demod64qamHardAvx2(float* vec_in, uint8_t* vec_out, int num);
 
-void Demod64qamSoftLoop(const float* vec_in, int8_t* llr, int num);
-void Demod64qamSoftSse(float* vec_in, int8_t* llr, int num);
-void Demod64qamSoftAvx2(float* vec_in, int8_t* llr, int num);
+void Demod64qamSoftLoop(const float* vec_in, int8_t* llr, int num,
+                        float scale = SCALE_BYTE_CONV_QAM64);
+void Demod64qamSoftSse(float* vec_in, int8_t* llr, int num,
+                       float scale = SCALE_BYTE_CONV_QAM64);
+void Demod64qamSoftAvx2(float* vec_in, int8_t* llr, int num,
+                        float scale = SCALE_BYTE_CONV_QAM64);
 
 void Demod256qamHardLoop(const float* vec_in, uint8_t* vec_out, int num);
 void Demod256qamHardSse(float* vec_in, uint8_t* vec_out, int num);
@@ -73,6 +85,16 @@ void Demod256qamSoftAvx2(const float* vec_in, int8_t* llr, int num);
 #ifdef __AVX512F__
 void Demod256qamSoftAvx512(const float* vec_in, int8_t* llr, int num);
 #endif
+
+/**
+ * @brief Soft-demap [num_sc] equalized subcarriers of [mod_order_bits] bits
+ * each with the fastest soft demapper of the modulation. [llr_scale]
+ * multiplies the default LLR scale of the modulation.
+ *
+ * @return Return false if the modulation is not supported
+ */
+bool DemodSoftAvx2(float* vec_in, int8_t* llr, size_t num_sc,
+                   size_t mod_order_bits, float llr_scale = 1.0f);
 void Print256Epi8(__m256i var);
 
 #endif  // MODULATION_H_
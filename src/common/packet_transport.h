@@ -0,0 +1,22 @@
+/**
+ * @file packet_transport.h
+ * @brief Selects the transport of packets between the sender, the channel
+ * simulator, the UE application and Agora: UDP sockets by default, or
+ * shared-memory rings if USE_SHM_TRANSPORT is defined (all processes must
+ * then run on one host and be built with the same setting).
+ */
+#ifndef PACKET_TRANSPORT_H_
+#define PACKET_TRANSPORT_H_
+
+#if defined(USE_SHM_TRANSPORT)
+#include "shm_transport.h"
+using PacketServer = ShmServer;
+using PacketClient = ShmClient;
+#else
+#include "udp_client.h"
+#include "udp_server.h"
+using PacketServer = UDPServer;
+using PacketClient = UDPClient;
+#endif
+
+#endif  // PACKET_TRANSPORT_H_
@@ -0,0 +1,40 @@
+/**
+ * @file parallel_for.h
+ * @brief Fork-join loop for one-off setup work, such as generating data, that
+ * runs before (or without) the worker threads
+ */
+#ifndef PARALLEL_FOR_H_
+#define PARALLEL_FOR_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Run task(i) for every i in [0, num_tasks) on up to [num_threads]
+ * threads, including the calling thread, and return when all tasks are done.
+ * Threads take the next task from a shared counter, so tasks of uneven cost
+ * balance out.
+ */
+static inline void ParallelFor(size_t num_threads, size_t num_tasks,
+                               const std::function<void(size_t)>& task) {
+  std::atomic<size_t> next_task(0);
+  auto worker = [&]() {
+    for (size_t i = next_task++; i < num_tasks; i = next_task++) {
+      task(i);
+    }
+  };
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < std::min(num_threads, num_tasks); i++) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+#endif  // PARALLEL_FOR_H_
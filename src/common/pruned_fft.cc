@@ -0,0 +1,170 @@
+/**
+ * @file pruned_fft.cc
+ * @brief Implementation file for the PrunedFft class
+ */
+#include "pruned_fft.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#include "memory_manage.h"
+#include "utils.h"
+
+/// Call func(m, idx) for every band bin m in [0, band_len), where idx is the
+/// bin index modulo sub_size, without computing a modulo per bin
+template <typename Func>
+static inline void ForEachBandBin(size_t band_start, size_t band_len,
+                                  size_t sub_size, Func&& func) {
+  size_t m = 0;
+  size_t idx = band_start % sub_size;
+  while (m < band_len) {
+    const size_t seg_len = std::min(band_len - m, sub_size - idx);
+    for (size_t j = 0; j < seg_len; j++) {
+      func(m + j, idx + j);
+    }
+    m += seg_len;
+    idx = 0;
+  }
+}
+
+PrunedFft::PrunedFft(FftDirection direction, size_t fft_size,
+                     size_t band_start, size_t band_len, size_t decimation,
+                     FftBackendType backend)
+    : direction_(direction),
+      fft_size_(fft_size),
+      band_start_(band_start),
+      band_len_(band_len),
+      decimation_(decimation),
+      twiddles_(nullptr) {
+  RtAssert(band_start + band_len <= fft_size,
+           "PrunedFft: band exceeds the FFT size");
+  if (decimation_ == kAutoDecimation) {
+    decimation_ = ChooseDecimation(fft_size_, band_len_);
+  }
+  RtAssert((decimation_ <= kMaxDecimation) && IsPowerOfTwo(decimation_) &&
+               (fft_size_ % decimation_ == 0),
+           "PrunedFft: decimation must be a power of two dividing fft_size");
+  sub_size_ = fft_size_ / decimation_;
+
+  FftLayout layout(sub_size_);
+  layout.in_place_ = false;
+  if (decimation_ > 1) {
+    // The i-th sub-transform operates on every Q-th time-domain sample
+    // starting at sample i, and on a contiguous row of the scratch buffer
+    const bool forward = (direction_ == FftDirection::kForward);
+    layout.num_transforms_ = decimation_;
+    layout.in_stride_ = forward ? decimation_ : 1;
+    layout.in_distance_ = forward ? 1 : sub_size_;
+    layout.out_stride_ = forward ? 1 : decimation_;
+    layout.out_distance_ = forward ? sub_size_ : 1;
+  }
+  fft_plan_ = FftPlan::Create(direction_, layout, backend);
+
+  scratch_ = static_cast<complex_float*>(Agora_memory::PaddedAlignedAlloc(
+      Agora_memory::Alignment_t::kAlign64, fft_size_ * sizeof(complex_float)));
+
+  if (decimation_ > 1) {
+    twiddles_ = static_cast<complex_float*>(Agora_memory::PaddedAlignedAlloc(
+        Agora_memory::Alignment_t::kAlign64,
+        decimation_ * band_len_ * sizeof(complex_float)));
+    const double sign = (direction_ == FftDirection::kForward) ? -1.0 : 1.0;
+    for (size_t n2 = 0; n2 < decimation_; n2++) {
+      for (size_t m = 0; m < band_len_; m++) {
+        // Reduce the exponent first to keep the phase accurate
+        const size_t exponent = (n2 * (band_start_ + m)) % fft_size_;
+        const double phase = sign * 2.0 * M_PI * exponent / fft_size_;
+        twiddles_[n2 * band_len_ + m] = {static_cast<float>(std::cos(phase)),
+                                         static_cast<float>(std::sin(phase))};
+      }
+    }
+  }
+}
+
+PrunedFft::~PrunedFft() {
+  std::free(scratch_);
+  std::free(twiddles_);
+}
+
+size_t PrunedFft::ChooseDecimation(size_t fft_size, size_t band_len) {
+  // Radix-2 FFTs need about N/2 * log2(N) complex multiplications. The
+  // recombination multiplies each band bin by Q - 1 non-trivial twiddles.
+  size_t best_decimation = 1;
+  double best_cost = 0.5 * fft_size * std::log2(fft_size);
+  for (size_t q = 2; (q <= kMaxDecimation) && (fft_size % q == 0) &&
+                     (fft_size / q >= 2);
+       q *= 2) {
+    const double cost = 0.5 * fft_size * std::log2(fft_size / q) +
+                        static_cast<double>(band_len) * (q - 1);
+    if (cost < best_cost) {
+      best_cost = cost;
+      best_decimation = q;
+    }
+  }
+  return best_decimation;
+}
+
+void PrunedFft::Forward(const complex_float* in, complex_float* out) {
+  assert(direction_ == FftDirection::kForward);
+  fft_plan_->Execute(const_cast<complex_float*>(in), scratch_);
+
+  if (decimation_ == 1) {
+    std::memcpy(out, scratch_ + band_start_, band_len_ * sizeof(complex_float));
+    return;
+  }
+
+  // X[k] = sum_{n2} W_N^(n2 * k) * Y_n2[k mod L], and W_N^0 = 1
+  ForEachBandBin(band_start_, band_len_, sub_size_,
+                 [&](size_t m, size_t idx) { out[m] = scratch_[idx]; });
+  for (size_t n2 = 1; n2 < decimation_; n2++) {
+    const complex_float* sub_out = scratch_ + n2 * sub_size_;
+    const complex_float* tw = twiddles_ + n2 * band_len_;
+    ForEachBandBin(band_start_, band_len_, sub_size_,
+                   [&](size_t m, size_t idx) {
+                     out[m].re += tw[m].re * sub_out[idx].re -
+                                  tw[m].im * sub_out[idx].im;
+                     out[m].im += tw[m].re * sub_out[idx].im +
+                                  tw[m].im * sub_out[idx].re;
+                   });
+  }
+}
+
+void PrunedFft::Backward(const complex_float* in, complex_float* out) {
+  assert(direction_ == FftDirection::kBackward);
+  if (decimation_ == 1) {
+    std::memset(scratch_, 0, band_start_ * sizeof(complex_float));
+    std::memcpy(scratch_ + band_start_, in, band_len_ * sizeof(complex_float));
+    std::memset(scratch_ + band_start_ + band_len_, 0,
+                (fft_size_ - band_start_ - band_len_) * sizeof(complex_float));
+    fft_plan_->Execute(scratch_, out);
+    return;
+  }
+
+  // V_n2[k'] = sum_{k mod L = k'} W_N^(-n2 * k) * X[k]
+  if (band_len_ < sub_size_) {
+    std::memset(scratch_, 0, fft_size_ * sizeof(complex_float));
+  }
+  for (size_t n2 = 0; n2 < decimation_; n2++) {
+    complex_float* sub_in = scratch_ + n2 * sub_size_;
+    const complex_float* tw = twiddles_ + n2 * band_len_;
+    // The first pass over each sub-transform input assigns instead of
+    // accumulating, so only bins that the band wraps onto twice accumulate
+    size_t first_pass_len = std::min(band_len_, sub_size_);
+    ForEachBandBin(band_start_, first_pass_len, sub_size_,
+                   [&](size_t m, size_t idx) {
+                     sub_in[idx].re = tw[m].re * in[m].re - tw[m].im * in[m].im;
+                     sub_in[idx].im = tw[m].re * in[m].im + tw[m].im * in[m].re;
+                   });
+    ForEachBandBin(band_start_ + first_pass_len, band_len_ - first_pass_len,
+                   sub_size_, [&](size_t m, size_t idx) {
+                     const size_t k = m + first_pass_len;
+                     sub_in[idx].re +=
+                         tw[k].re * in[k].re - tw[k].im * in[k].im;
+                     sub_in[idx].im +=
+                         tw[k].re * in[k].im + tw[k].im * in[k].re;
+                   });
+  }
+  fft_plan_->Execute(scratch_, out);
+}
@@ -0,0 +1,79 @@
+/**
+ * @file pruned_fft.h
+ * @brief Declaration file for the PrunedFft class, an FFT engine that only
+ * computes (forward) or only reads (backward) the contiguous band of OFDM
+ * data subcarriers.
+ */
+#ifndef PRUNED_FFT_H_
+#define PRUNED_FFT_H_
+
+#include <cstddef>
+#include <memory>
+
+#include "buffer.h"
+#include "fft_backend.h"
+
+/**
+ * Input/output pruned FFT over the subcarrier band [band_start, band_start +
+ * band_len) of an fft_size-point transform, using transform decomposition
+ * (Sorensen & Burrus). The transform is split as fft_size = Q * L:
+ *
+ * Forward (output pruning): Q L-point FFTs over the Q decimated input
+ * sequences x[Q * n1 + n2], followed by a twiddle recombination that only
+ * produces the band_len requested bins.
+ *
+ * Backward (input pruning): the band_len inputs are folded with twiddles into
+ * Q L-point sequences, followed by Q L-point IFFTs whose outputs are
+ * interleaved into the fft_size time-domain samples. Guard subcarriers are
+ * never read, so the caller does not need to zero-fill them.
+ *
+ * The decimation factor Q trades Q * band_len complex multiplications
+ * against log2(Q) butterfly stages, so it only pays off when the band is
+ * narrow relative to the FFT size. With Q = 1 the engine falls back to a
+ * single full-size transform. The sub-transforms run on any FftPlan backend.
+ */
+class PrunedFft {
+ public:
+  using FftDirection = ::FftDirection;
+
+  /// Select the decimation factor with a complex-multiplication cost model
+  static constexpr size_t kAutoDecimation = 0;
+  static constexpr size_t kMaxDecimation = 64;
+
+  PrunedFft(FftDirection direction, size_t fft_size, size_t band_start,
+            size_t band_len, size_t decimation = kAutoDecimation,
+            FftBackendType backend = kDefaultFftBackend);
+  ~PrunedFft();
+
+  /// Compute the band_len output bins of the forward FFT of the fft_size
+  /// time-domain samples in [in]. [in] is not modified and may alias [out].
+  void Forward(const complex_float* in, complex_float* out);
+
+  /// Compute the (unnormalized) fft_size-point inverse FFT of a spectrum that
+  /// is zero outside the band. [in] holds only the band_len band bins.
+  void Backward(const complex_float* in, complex_float* out);
+
+  inline size_t Decimation() const { return this->decimation_; }
+
+  /// Return the decimation factor that minimizes the estimated number of
+  /// complex multiplications for this FFT size and band length
+  static size_t ChooseDecimation(size_t fft_size, size_t band_len);
+
+ private:
+  const FftDirection direction_;
+  const size_t fft_size_;
+  const size_t band_start_;
+  const size_t band_len_;
+  size_t decimation_;  // Q
+  size_t sub_size_;    // L = fft_size_ / Q
+
+  std::unique_ptr<FftPlan> fft_plan_;
+
+  // Q x L intermediate sub-transforms (or the full-size buffer if Q = 1)
+  complex_float* scratch_;
+
+  // Q x band_len twiddles W_N^(+/- n2 * k) for every band bin k
+  complex_float* twiddles_;
+};
+
+#endif  // PRUNED_FFT_H_
@@ -0,0 +1,371 @@
+/**
+ * @file shm_transport.h
+ * @brief Shared-memory packet transport between processes on one host, a
+ * drop-in replacement for UDPServer and UDPClient (see packet_transport.h).
+ * Each server port owns a ring of fixed-size packet slots in a POSIX shared
+ * memory object, and clients copy packets into the ring of the destination
+ * port instead of sending datagrams through the loopback interface.
+ */
+#ifndef SHM_TRANSPORT_H_
+#define SHM_TRANSPORT_H_
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring> /* std::strerror, std::memcpy */
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Bounded ring of fixed-size message slots in shared memory, after
+ * Dmitry Vyukov's bounded queue. Each slot carries a sequence number that
+ * tells producers and the consumer whose turn it is, so neither side takes a
+ * lock or makes a system call. Any number of producers may push concurrently
+ * (channel simulator workers share their clients); there is one consumer.
+ */
+class ShmRing {
+ public:
+  static_assert(std::atomic<uint64_t>::is_always_lock_free,
+                "Shared-memory rings need address-free atomics");
+  static constexpr size_t kCacheLineSize = 64;
+
+  /// Name of the shared memory object of the ring of [port]
+  static std::string ObjectName(uint16_t port) {
+    return "/agora_shm_" + std::to_string(port);
+  }
+
+  /**
+   * @brief Create the ring of [port] with [num_slots] slots of [slot_size]
+   * bytes, or reset it if it exists. [num_slots] must be a power of two.
+   *
+   * The object is not removed when the ring is destroyed, so that clients
+   * keep a valid mapping across server restarts. Remove the rings with
+   * rm /dev/shm/agora_shm_*.
+   */
+  static std::unique_ptr<ShmRing> Create(uint16_t port, size_t num_slots,
+                                         size_t slot_size) {
+    if ((num_slots == 0) || ((num_slots & (num_slots - 1)) != 0)) {
+      throw std::runtime_error("ShmRing: slot count must be a power of two");
+    }
+    const size_t slot_stride = SlotStride(slot_size);
+    const size_t map_size = HeaderSize() + num_slots * slot_stride;
+    const std::string name = ObjectName(port);
+    const int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0666);
+    if (fd == -1) {
+      throw std::runtime_error("ShmRing: shm_open " + name +
+                               " failed: " + std::strerror(errno));
+    }
+    if (ftruncate(fd, static_cast<off_t>(map_size)) != 0) {
+      close(fd);
+      throw std::runtime_error("ShmRing: ftruncate " + name +
+                               " failed: " + std::strerror(errno));
+    }
+    void* base = Map(fd, map_size);
+    close(fd);
+    if (base == nullptr) {
+      throw std::runtime_error("ShmRing: mmap " + name +
+                               " failed: " + std::strerror(errno));
+    }
+
+    auto* header = static_cast<Header*>(base);
+    header->ready_.store(0, std::memory_order_relaxed);
+    header->num_slots_ = num_slots;
+    header->slot_size_ = slot_size;
+    header->slot_stride_ = slot_stride;
+    header->enqueue_pos_.store(0, std::memory_order_relaxed);
+    header->dequeue_pos_.store(0, std::memory_order_relaxed);
+    std::unique_ptr<ShmRing> ring(new ShmRing(base, map_size));
+    for (size_t i = 0; i < num_slots; i++) {
+      ring->SlotAt(i)->sequence_.store(i, std::memory_order_relaxed);
+    }
+    header->ready_.store(1, std::memory_order_release);
+    return ring;
+  }
+
+  /// Map the ring of [port]. Return nullptr if no server has created it.
+  static std::unique_ptr<ShmRing> Open(uint16_t port) {
+    const int fd = shm_open(ObjectName(port).c_str(), O_RDWR, 0666);
+    if (fd == -1) {
+      return nullptr;
+    }
+    struct stat st;
+    if ((fstat(fd, &st) != 0) ||
+        (static_cast<size_t>(st.st_size) < HeaderSize())) {
+      close(fd);
+      return nullptr;
+    }
+    const size_t map_size = static_cast<size_t>(st.st_size);
+    void* base = Map(fd, map_size);
+    close(fd);
+    if (base == nullptr) {
+      return nullptr;
+    }
+    std::unique_ptr<ShmRing> ring(new ShmRing(base, map_size));
+    if (ring->header_->ready_.load(std::memory_order_acquire) == 0) {
+      return nullptr;
+    }
+    return ring;
+  }
+
+  ShmRing(const ShmRing&) = delete;
+  ShmRing& operator=(const ShmRing&) = delete;
+  ~ShmRing() { munmap(base_, map_size_); }
+
+  /// Copy [len] bytes at [msg] into a free slot. Return false if the ring is
+  /// full or [len] exceeds the slot size.
+  bool Push(const uint8_t* msg, size_t len) {
+    // The second check guards against a server that recreated the ring with
+    // more slots than this mapping covers
+    if ((len > header_->slot_size_) ||
+        (HeaderSize() + header_->num_slots_ * header_->slot_stride_ >
+         map_size_)) {
+      return false;
+    }
+    uint64_t pos = header_->enqueue_pos_.load(std::memory_order_relaxed);
+    Slot* slot;
+    while (true) {
+      slot = SlotAt(pos);
+      const uint64_t seq = slot->sequence_.load(std::memory_order_acquire);
+      const auto diff = static_cast<int64_t>(seq - pos);
+      if (diff == 0) {
+        // The slot is free; claim it
+        if (header_->enqueue_pos_.compare_exchange_weak(
+                pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        // Another producer claimed the slot first
+        pos = header_->enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    slot->len_ = len;
+    std::memcpy(SlotData(slot), msg, len);
+    slot->sequence_.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  /// Copy the oldest message into [buf], truncated to [len] bytes like a
+  /// datagram. Return the number of bytes copied, or 0 if the ring is empty.
+  /// Only one thread may pop from a ring.
+  size_t Pop(uint8_t* buf, size_t len) {
+    const uint64_t pos = header_->dequeue_pos_.load(std::memory_order_relaxed);
+    Slot* slot = SlotAt(pos);
+    if (slot->sequence_.load(std::memory_order_acquire) != pos + 1) {
+      return 0;
+    }
+    const size_t msg_len = std::min(len, static_cast<size_t>(slot->len_));
+    std::memcpy(buf, SlotData(slot), msg_len);
+    slot->sequence_.store(pos + header_->num_slots_,
+                          std::memory_order_release);
+    header_->dequeue_pos_.store(pos + 1, std::memory_order_relaxed);
+    return msg_len;
+  }
+
+  inline size_t NumSlots() const { return header_->num_slots_; }
+  inline size_t SlotSize() const { return header_->slot_size_; }
+
+ private:
+  struct Header {
+    // Set once the ring is initialized
+    std::atomic<uint64_t> ready_;
+    uint64_t num_slots_;
+    uint64_t slot_size_;
+    uint64_t slot_stride_;
+    alignas(kCacheLineSize) std::atomic<uint64_t> enqueue_pos_;
+    alignas(kCacheLineSize) std::atomic<uint64_t> dequeue_pos_;
+  };
+
+  struct Slot {
+    std::atomic<uint64_t> sequence_;
+    uint64_t len_;
+  };
+
+  static size_t HeaderSize() {
+    return (sizeof(Header) + kCacheLineSize - 1) / kCacheLineSize *
+           kCacheLineSize;
+  }
+
+  static size_t SlotStride(size_t slot_size) {
+    return (sizeof(Slot) + slot_size + kCacheLineSize - 1) / kCacheLineSize *
+           kCacheLineSize;
+  }
+
+  static void* Map(int fd, size_t map_size) {
+    void* base =
+        mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    return (base == MAP_FAILED) ? nullptr : base;
+  }
+
+  ShmRing(void* base, size_t map_size)
+      : base_(base),
+        map_size_(map_size),
+        header_(static_cast<Header*>(base)) {}
+
+  inline Slot* SlotAt(uint64_t pos) const {
+    const size_t index = pos & (header_->num_slots_ - 1);
+    return reinterpret_cast<Slot*>(static_cast<uint8_t*>(base_) +
+                                   HeaderSize() +
+                                   index * header_->slot_stride_);
+  }
+
+  static inline uint8_t* SlotData(Slot* slot) {
+    return reinterpret_cast<uint8_t*>(slot) + sizeof(Slot);
+  }
+
+  void* base_;
+  size_t map_size_;
+  Header* header_;
+};
+
+/// Shared-memory counterpart of UDPServer that receives the packets sent to
+/// one port by ShmClients on the same host
+class ShmServer {
+ public:
+  static const bool kDebugPrintShmServerInit = true;
+  // Largest packet that fits in a slot
+  static constexpr size_t kSlotSize = 16384;
+  static constexpr size_t kMinNumSlots = 64;
+  static constexpr size_t kMaxNumSlots = 512;
+
+  // Create the ring of this port with about rx_buffer_size bytes of slots,
+  // as the socket buffer size of a UDPServer
+  explicit ShmServer(uint16_t port, size_t rx_buffer_size = 0) : port_(port) {
+    size_t num_slots = kMinNumSlots;
+    while ((num_slots < kMaxNumSlots) &&
+           (num_slots * kSlotSize < rx_buffer_size)) {
+      num_slots *= 2;
+    }
+    if (kDebugPrintShmServerInit) {
+      std::printf("Creating shared-memory server for port %d with %zu slots\n",
+                  port, num_slots);
+    }
+    ring_ = ShmRing::Create(port, num_slots, kSlotSize);
+  }
+
+  ShmServer& operator=(const ShmServer&) = delete;
+  ShmServer(const ShmServer&) = delete;
+  ~ShmServer() = default;
+
+  /**
+   * @brief Try to receive up to len bytes in buf. Never blocks.
+   *
+   * @return Return the number of bytes received, or zero if there is no
+   * packet. Unlike UDPServer, it never fails.
+   */
+  ssize_t Recv(uint8_t* buf, size_t len) const {
+    return static_cast<ssize_t>(ring_->Pop(buf, len));
+  }
+
+ private:
+  uint16_t port_;
+  std::unique_ptr<ShmRing> ring_;
+};
+
+/// Shared-memory counterpart of UDPClient. Maps the ring of each destination
+/// port on first use. As with UDP, packets sent before the destination server
+/// exists or while its ring is full are dropped.
+class ShmClient {
+ public:
+  // While a destination server is down, opening its ring is retried at most
+  // this often rather than once for every dropped packet
+  static constexpr int64_t kOpenRetryIntervalNs = 100 * 1000 * 1000;
+
+  ShmClient()
+      : rings_(std::make_unique<std::atomic<ShmRing*>[]>(kNumPorts)) {
+    for (size_t i = 0; i < kNumPorts; i++) {
+      rings_[i].store(nullptr, std::memory_order_relaxed);
+    }
+  }
+  ShmClient(const ShmClient&) = delete;
+  ~ShmClient() {
+    if (num_dropped_ > 0) {
+      std::printf("ShmClient: dropped %zu packets\n", num_dropped_.load());
+    }
+  }
+
+  /**
+   * @brief Copy one packet into the ring of a server on this host. Several
+   * threads may send through one client.
+   *
+   * @param rem_hostname Unused; the server must be on this host
+   * @param rem_port Port that the server is receiving on
+   * @param msg Pointer to the message to send
+   * @param len Length in bytes of the message to send
+   */
+  void Send(const std::string& rem_hostname, uint16_t rem_port,
+            const uint8_t* msg, size_t len) {
+    (void)rem_hostname;
+    ShmRing* ring = Resolve(rem_port);
+    if (ring == nullptr) {
+      num_dropped_++;
+      return;
+    }
+    if (len > ring->SlotSize()) {
+      throw std::runtime_error("ShmClient: " + std::to_string(len) +
+                               " byte packet exceeds the slot size of " +
+                               std::to_string(ring->SlotSize()));
+    }
+    if (ring->Push(msg, len) == false) {
+      num_dropped_++;
+    }
+  }
+
+  inline size_t NumDropped() const { return num_dropped_; }
+
+ private:
+  static constexpr size_t kNumPorts = UINT16_MAX + 1;
+
+  /// Return the ring of [port], mapping it the first time. Senders of a
+  /// mapped port take no lock.
+  ShmRing* Resolve(uint16_t port) {
+    ShmRing* ring = rings_[port].load(std::memory_order_acquire);
+    if (ring != nullptr) {
+      return ring;
+    }
+    const int64_t now_ns =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    if (now_ns < next_open_ns_.load(std::memory_order_relaxed)) {
+      return nullptr;
+    }
+
+    std::scoped_lock open_access(open_access_);
+    ring = rings_[port].load(std::memory_order_relaxed);
+    if (ring == nullptr) {
+      std::unique_ptr<ShmRing> opened = ShmRing::Open(port);
+      if (opened == nullptr) {
+        next_open_ns_.store(now_ns + kOpenRetryIntervalNs,
+                            std::memory_order_relaxed);
+        return nullptr;
+      }
+      ring = opened.get();
+      opened_rings_.push_back(std::move(opened));
+      rings_[port].store(ring, std::memory_order_release);
+    }
+    return ring;
+  }
+
+  // The mapped ring of each port, or nullptr if it is not mapped yet
+  std::unique_ptr<std::atomic<ShmRing*>[]> rings_;
+  // Guards opening rings and opened_rings_
+  std::mutex open_access_;
+  std::vector<std::unique_ptr<ShmRing>> opened_rings_;
+  // Steady clock time before which no ring is opened again after a failure
+  std::atomic<int64_t> next_open_ns_{0};
+  std::atomic<size_t> num_dropped_{0};
+};
+
+#endif  // SHM_TRANSPORT_H_
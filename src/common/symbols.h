@@ -1,8 +1,6 @@
 #ifndef SYMBOLS_H_
 #define SYMBOLS_H_
 
-#include <mkl.h>
-
 #include <map>
 #include <string>
 
@@ -21,8 +19,14 @@ static constexpr size_t kFrameWnd = 40;
 #define SETTLE_TIME_MS 1
 
 // Just-in-time optimization for MKL cgemm is available only after MKL 2019
-// update 3. Disable this on systems with an older MKL version.
-#if __INTEL_MKL__ >= 2020 || (__INTEL_MKL__ == 2019 && __INTEL_MKL_UPDATE__ > 3)
+// update 3. Disable this on systems with an older MKL version, and on builds
+// without MKL (USE_MKL_FFT off), which multiply with armadillo instead.
+#if defined(USE_MKL_FFT)
+#include <mkl_version.h>
+#endif
+#if defined(USE_MKL_FFT) &&   \
+    (__INTEL_MKL__ >= 2020 || \
+     (__INTEL_MKL__ == 2019 && __INTEL_MKL_UPDATE__ > 3))
 #define USE_MKL_JIT 1
 #else
 #define USE_MKL_JIT 0
@@ -246,6 +250,10 @@ static constexpr size_t kMaxAntennas = 64;
 // Maximum number of UEs supported by Agora
 static constexpr size_t kMaxUEs = 64;
 
+// Maximum number of MAC threads at the Agora server, each serving a disjoint
+// subset of the UEs
+static constexpr size_t kMaxMacThreads = 8;
+
 // Maximum number of transceiver channels per radio
 static constexpr size_t kMaxChannels = 2;
 
@@ -308,6 +316,12 @@ static constexpr bool kUseAVX2Encoder = true;
 static constexpr bool kUseAVX2Encoder = false;
 #endif
 
+#ifdef USE_AVX2_DECODER
+static constexpr bool kUseAVX2Decoder = true;
+#else
+static constexpr bool kUseAVX2Decoder = false;
+#endif
+
 // Enable debugging for sender and receiver applications
 static constexpr bool kDebugSenderReceiver = false;
 #endif  // SYMBOLS_H_
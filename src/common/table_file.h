@@ -0,0 +1,141 @@
+/**
+ * @file table_file.h
+ * @brief Tables stored in files in their in-memory layout, behind a small
+ * header with the dimensions and a checksum, so that readers map them and
+ * use them in place instead of parsing them.
+ */
+#ifndef TABLE_FILE_H_
+#define TABLE_FILE_H_
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "mapped_file.h"
+#include "memory_manage.h"
+
+template <typename T>
+class TableFile {
+ public:
+  // "AGORATBL" in little-endian byte order
+  static constexpr uint64_t kMagic = 0x4c425441524f4741ull;
+  static constexpr uint32_t kVersion = 1;
+  // Zero bytes after the table, so that kernels which read a little past
+  // the last element (e.g. the LDPC encoder) stay within the mapping
+  static constexpr size_t kTailPadding = 64;
+
+  /**
+   * @brief Create [path] with a zeroed [dim1] x [dim2] table, mapped for
+   * writing. Call Seal() once the table is filled. [tag] is stored in the
+   * header for the writer's own use, e.g. to identify the inputs that the
+   * table was derived from.
+   */
+  static std::unique_ptr<TableFile<T>> Create(const std::string& path,
+                                              size_t dim1, size_t dim2,
+                                              uint64_t tag = 0) {
+    auto file = MappedFile::Create(
+        path, sizeof(Header) + dim1 * dim2 * sizeof(T) + kTailPadding);
+    auto* header = file->template Data<Header>();
+    header->magic_ = kMagic;
+    header->version_ = kVersion;
+    header->element_size_ = sizeof(T);
+    header->dim1_ = dim1;
+    header->dim2_ = dim2;
+    header->tag_ = tag;
+    return std::unique_ptr<TableFile<T>>(new TableFile<T>(std::move(file)));
+  }
+
+  /**
+   * @brief Map the table in [path] read-only, after checking its header and
+   * checksum. Throws std::runtime_error if the file is not a sealed table of
+   * T, e.g. if it was written by an older data generator.
+   */
+  static std::unique_ptr<TableFile<T>> Open(const std::string& path) {
+    auto file = MappedFile::Open(path);
+    const auto* header = file->template Data<Header>();
+    if ((file->Size() < sizeof(Header)) || (header->magic_ != kMagic) ||
+        (header->version_ != kVersion) ||
+        (header->element_size_ != sizeof(T))) {
+      throw std::runtime_error("TableFile: " + path +
+                               " is not a table file of this version; rerun "
+                               "the data generator");
+    }
+    const size_t table_size = header->dim1_ * header->dim2_ * sizeof(T);
+    if (file->Size() < sizeof(Header) + table_size + kTailPadding) {
+      throw std::runtime_error("TableFile: " + path + " is truncated");
+    }
+    if (Checksum(file->template Data<uint8_t>() + sizeof(Header),
+                 table_size) != header->checksum_) {
+      throw std::runtime_error("TableFile: checksum mismatch in " + path);
+    }
+    return std::unique_ptr<TableFile<T>>(new TableFile<T>(std::move(file)));
+  }
+
+  /// Record the checksum of the table in the header
+  void Seal() {
+    auto* header = file_->template Data<Header>();
+    header->checksum_ = Checksum(
+        file_->template Data<uint8_t>() + sizeof(Header),
+        header->dim1_ * header->dim2_ * sizeof(T));
+  }
+
+  inline size_t Dim1() const { return file_->template Data<Header>()->dim1_; }
+  inline size_t Dim2() const { return file_->template Data<Header>()->dim2_; }
+  inline uint64_t Tag() const { return file_->template Data<Header>()->tag_; }
+  /// Checksum of the table when it was sealed
+  inline uint64_t StoredChecksum() const {
+    return file_->template Data<Header>()->checksum_;
+  }
+
+  /// First element of row [dim1]. Rows of read-only tables must not be
+  /// written.
+  inline T* Row(size_t dim1) const {
+    return reinterpret_cast<T*>(file_->template Data<uint8_t>() +
+                                sizeof(Header)) +
+           dim1 * Dim2();
+  }
+
+  /// View the whole table as a Table
+  inline void View(Table<T>& table) const {
+    table.View(Row(0), Dim1(), Dim2());
+  }
+
+  /// 64-bit FNV-1a over 8-byte words, then the trailing bytes
+  static uint64_t Checksum(const void* data, size_t len) {
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    uint64_t hash = 0xcbf29ce484222325ull;
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= len; i += sizeof(uint64_t)) {
+      uint64_t word;
+      std::memcpy(&word, bytes + i, sizeof(word));
+      hash = (hash ^ word) * 0x100000001b3ull;
+    }
+    for (; i < len; i++) {
+      hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+    }
+    return hash;
+  }
+
+ private:
+  struct Header {
+    uint64_t magic_;
+    uint32_t version_;
+    uint32_t element_size_;
+    uint64_t dim1_;
+    uint64_t dim2_;
+    uint64_t checksum_;
+    uint64_t tag_;
+    uint8_t reserved_[16];
+  };
+  static_assert(sizeof(Header) == 64, "Keep the table cache-line aligned");
+
+  explicit TableFile(std::unique_ptr<MappedFile> file)
+      : file_(std::move(file)) {}
+
+  std::unique_ptr<MappedFile> file_;
+};
+
+#endif  // TABLE_FILE_H_
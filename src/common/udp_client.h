@@ -16,6 +16,7 @@
 
 #include <netdb.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include <cstring> /* std::strerror, std::memset, std::memcpy */
@@ -70,13 +71,104 @@ class UDPClient {
    */
   void Send(const std::string& rem_hostname, uint16_t rem_port,
             const uint8_t* msg, size_t len) {
-    std::string remote_uri = rem_hostname + ":" + std::to_string(rem_port);
-    struct addrinfo* rem_addrinfo = nullptr;
-
     if (kDebugPrintUdpClientSend) {
       std::printf("UDPClient sending message to %s to port %d\n",
                   rem_hostname.c_str(), rem_port);
     }
+    const struct addrinfo* rem_addrinfo = Resolve(rem_hostname, rem_port);
+
+    ssize_t ret = sendto(sock_fd_, msg, len, 0, rem_addrinfo->ai_addr,
+                         rem_addrinfo->ai_addrlen);
+    if (ret != static_cast<ssize_t>(len)) {
+      throw std::runtime_error("sendto() failed. errno = " +
+                               std::string(std::strerror(errno)));
+    }
+
+    if (enable_recording_flag_) {
+      std::scoped_lock map_access(map_insert_access_);
+      sent_vec_.emplace_back(msg, msg + len);
+    }
+  }
+
+  /// One UDP packet gathered from [iovcnt_] buffers, for SendBatch()
+  struct GatherPacket {
+    uint16_t rem_port_;
+    const struct iovec* iov_;
+    size_t iovcnt_;
+  };
+
+  /**
+   * @brief Send UDP packets to ports on one remote server. Each packet is
+   * gathered by the kernel straight from the caller's buffers, and all
+   * packets are handed over with as few sendmmsg() calls as possible. The
+   * buffers can be reused as soon as this function returns.
+   *
+   * @param rem_hostname Hostname or IP address of the remote server
+   * @param pkts The packets to send
+   * @param num_pkts Number of packets in pkts
+   */
+  void SendBatch(const std::string& rem_hostname, const GatherPacket* pkts,
+                 size_t num_pkts) {
+    batch_msgs_.resize(num_pkts);
+    for (size_t i = 0; i < num_pkts; i++) {
+      if (kDebugPrintUdpClientSend) {
+        std::printf("UDPClient sending message to %s to port %d\n",
+                    rem_hostname.c_str(), pkts[i].rem_port_);
+      }
+      const struct addrinfo* rem_addrinfo =
+          Resolve(rem_hostname, pkts[i].rem_port_);
+      struct msghdr& hdr = batch_msgs_[i].msg_hdr;
+      std::memset(&hdr, 0, sizeof(hdr));
+      hdr.msg_name = rem_addrinfo->ai_addr;
+      hdr.msg_namelen = rem_addrinfo->ai_addrlen;
+      hdr.msg_iov = const_cast<struct iovec*>(pkts[i].iov_);
+      hdr.msg_iovlen = pkts[i].iovcnt_;
+      batch_msgs_[i].msg_len = 0;
+    }
+
+    size_t num_sent = 0;
+    while (num_sent < num_pkts) {
+      int ret = sendmmsg(sock_fd_, &batch_msgs_[num_sent],
+                         static_cast<unsigned int>(num_pkts - num_sent), 0);
+      if (ret <= 0) {
+        throw std::runtime_error("sendmmsg() failed. errno = " +
+                                 std::string(std::strerror(errno)));
+      }
+      num_sent += static_cast<size_t>(ret);
+    }
+
+    for (size_t i = 0; i < num_pkts; i++) {
+      size_t len = 0;
+      for (size_t j = 0; j < pkts[i].iovcnt_; j++) {
+        len += pkts[i].iov_[j].iov_len;
+      }
+      if (batch_msgs_[i].msg_len != len) {
+        throw std::runtime_error("sendmmsg() sent a truncated packet");
+      }
+      if (enable_recording_flag_) {
+        std::scoped_lock map_access(map_insert_access_);
+        std::vector<uint8_t> pkt;
+        pkt.reserve(len);
+        for (size_t j = 0; j < pkts[i].iovcnt_; j++) {
+          const auto* base =
+              static_cast<const uint8_t*>(pkts[i].iov_[j].iov_base);
+          pkt.insert(pkt.end(), base, base + pkts[i].iov_[j].iov_len);
+        }
+        sent_vec_.push_back(std::move(pkt));
+      }
+    }
+  }
+
+  // Enable recording of all packets sent by this UDP client
+  void EnableRecording() { enable_recording_flag_ = true; }
+
+ private:
+  /// Return the remote server's addrinfo, resolving and caching it the first
+  /// time
+  const struct addrinfo* Resolve(const std::string& rem_hostname,
+                                 uint16_t rem_port) {
+    std::string remote_uri = rem_hostname + ":" + std::to_string(rem_port);
+    struct addrinfo* rem_addrinfo = nullptr;
 
     const auto remote_itr = addrinfo_map_.find(remote_uri);
     if (remote_itr == addrinfo_map_.end()) {
@@ -119,24 +211,9 @@ class UDPClient {
     } else {
       rem_addrinfo = remote_itr->second;
     }
-
-    ssize_t ret = sendto(sock_fd_, msg, len, 0, rem_addrinfo->ai_addr,
-                         rem_addrinfo->ai_addrlen);
-    if (ret != static_cast<ssize_t>(len)) {
-      throw std::runtime_error("sendto() failed. errno = " +
-                               std::string(std::strerror(errno)));
-    }
-
-    if (enable_recording_flag_) {
-      std::scoped_lock map_access(map_insert_access_);
-      sent_vec_.emplace_back(msg, msg + len);
-    }
+    return rem_addrinfo;
   }
 
-  // Enable recording of all packets sent by this UDP client
-  void EnableRecording() { enable_recording_flag_ = true; }
-
- private:
   /**
    * @brief The raw socket file descriptor
    */
@@ -157,6 +234,12 @@ class UDPClient {
    */
   std::vector<std::vector<uint8_t>> sent_vec_;
 
+  /**
+   * @brief Message headers passed to sendmmsg(), reused across SendBatch()
+   * calls
+   */
+  std::vector<struct mmsghdr> batch_msgs_;
+
   /**
    * @brief If set to ture, we record all sent packets, otherwise we dont
    */
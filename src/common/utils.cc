@@ -8,6 +8,8 @@
 
 #include "utils.h"
 
+#include <sys/stat.h>
+
 #include <list>
 #include <mutex>
 
@@ -380,6 +382,29 @@ std::vector<std::string> Utils::Split(const std::string& s, char delimiter) {
   return tokens;
 }
 
+std::string Utils::CacheDir() {
+  std::string base_dir;
+  const char* xdg_cache_home = std::getenv("XDG_CACHE_HOME");
+  const char* home = std::getenv("HOME");
+  if ((xdg_cache_home != nullptr) && (xdg_cache_home[0] != '\0')) {
+    base_dir = xdg_cache_home;
+  } else if ((home != nullptr) && (home[0] != '\0')) {
+    base_dir = std::string(home) + "/.cache";
+  } else {
+    return "";
+  }
+  const std::string cache_dir = base_dir + "/agora";
+  // Either may exist already
+  mkdir(base_dir.c_str(), 0755);
+  mkdir(cache_dir.c_str(), 0755);
+  struct stat dir_stat;
+  if ((stat(cache_dir.c_str(), &dir_stat) != 0) ||
+      (S_ISDIR(dir_stat.st_mode) == false)) {
+    return "";
+  }
+  return cache_dir;
+}
+
 void Utils::PrintVector(std::vector<std::complex<int16_t>>& data) {
   for (auto& i : data) {
     std::cout << real(i) << " " << imag(i) << std::endl;
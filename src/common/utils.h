@@ -106,6 +106,10 @@ class Utils {
                        int samples);
   static void LoadTddConfig(const std::string& filename, std::string& jconfig);
   static std::vector<std::string> Split(const std::string& s, char delimiter);
+  /// Return Agora's per-user cache directory, $XDG_CACHE_HOME/agora or
+  /// $HOME/.cache/agora, creating it if needed. Return an empty string if
+  /// there is no usable directory.
+  static std::string CacheDir();
   static void PrintVector(std::vector<std::complex<int16_t>>& data);
   static void WriteBinaryFile(const std::string& name, size_t elem_size,
                               size_t buffer_size, void* buff);
@@ -2,9 +2,13 @@
 #define UTILS_LDPC_H_
 
 #include <cstdlib> /* for std::aligned_alloc */
+#include <cstring>
+#include <iterator>
 
+#include "decoder.h"
 #include "encoder.h"
 #include "iobuffer.h"
+#include "phy_ldpc_decoder_5gnr.h"
 #include "phy_ldpc_encoder_5gnr.h"
 #include "symbols.h"
 #include "utils.h"
@@ -44,10 +48,134 @@ static inline uint8_t Bitreverse8(uint8_t x) {
 #endif
 }
 
+// Scalar reference implementation of AdaptBitsForMod()
+static inline void AdaptBitsForModLoop(const uint8_t* bit_seq_in,
+                                       uint8_t* bytes_out, size_t len,
+                                       size_t mod_type) {
+  uint16_t bits = 0;      // Bits collected from the input
+  size_t bits_avail = 0;  // Number of valid bits filled into [bits]
+  for (size_t i = 0; i < len; i++) {
+    bits |= static_cast<uint32_t>(Bitreverse8(bit_seq_in[i]))
+            << (8 - bits_avail);
+    bits_avail += 8;
+    while (bits_avail >= mod_type) {
+      *bytes_out++ = bits >> (16 - mod_type);
+      bits <<= mod_type;
+      bits_avail -= mod_type;
+    }
+  }
+
+  if (bits_avail > 0) {
+    *bytes_out++ = bits >> (16 - mod_type);
+  }
+}
+
+// Return true if the SIMD AdaptBitsForMod() kernels support [mod_type], i.e.,
+// if a whole number of input bytes fills eight output bytes
+static inline bool AdaptBitsForModSimdSupported(size_t mod_type) {
+  return (mod_type == 2) || (mod_type == 4) || (mod_type == 6) ||
+         (mod_type == 8);
+}
+
+#ifdef __BMI2__
+// AdaptBitsForMod() with BMI2: PDEP spreads [mod_type] input bits into each
+// of eight output bytes at a time. Requires AdaptBitsForModSimdSupported().
+static inline void AdaptBitsForModBmi2(const uint8_t* bit_seq_in,
+                                       uint8_t* bytes_out, size_t len,
+                                       size_t mod_type) {
+  const uint64_t low_bits_mask =
+      0x0101010101010101ull * ((1ull << mod_type) - 1);
+  size_t i = 0;
+  for (; i + sizeof(uint64_t) <= len; i += mod_type) {
+    // Input bits are LSB-first, so the little-endian load keeps their order
+    uint64_t bits;
+    std::memcpy(&bits, bit_seq_in + i, sizeof(bits));
+    uint64_t out = _pdep_u64(bits, low_bits_mask);
+    // The first input bit of each output byte becomes its MSB
+    out = ((out & 0x0f0f0f0f0f0f0f0full) << 4) |
+          ((out >> 4) & 0x0f0f0f0f0f0f0f0full);
+    out = ((out & 0x3333333333333333ull) << 2) |
+          ((out >> 2) & 0x3333333333333333ull);
+    out = ((out & 0x5555555555555555ull) << 1) |
+          ((out >> 1) & 0x5555555555555555ull);
+    out = (out >> (8 - mod_type)) & low_bits_mask;
+    std::memcpy(bytes_out, &out, sizeof(out));
+    bytes_out += sizeof(out);
+  }
+  AdaptBitsForModLoop(bit_seq_in + i, bytes_out, len - i, mod_type);
+}
+#endif
+
+#ifdef __AVX2__
+// AdaptBitsForMod() with AVX2, producing 32 output bytes per iteration.
+// Requires AdaptBitsForModSimdSupported().
+static inline void AdaptBitsForModAvx2(const uint8_t* bit_seq_in,
+                                       uint8_t* bytes_out, size_t len,
+                                       size_t mod_type) {
+  // Each 128-bit lane makes eight outputs from [mod_type] input bytes. For
+  // output j of a lane, gather its two source bytes into a big-endian 16-bit
+  // word, and record the bit offset of the output in that word.
+  alignas(32) int8_t gather[32];
+  alignas(32) int16_t shift_mult[16];
+  for (size_t j = 0; j < 8; j++) {
+    const size_t first_bit = j * mod_type;
+    gather[2 * j] = gather[16 + 2 * j] = first_bit / 8 + 1;
+    gather[2 * j + 1] = gather[16 + 2 * j + 1] = first_bit / 8;
+    shift_mult[j] = shift_mult[8 + j] = 1 << (first_bit % 8);
+  }
+  const __m256i gather_ctrl =
+      _mm256_load_si256(reinterpret_cast<const __m256i*>(gather));
+  const __m256i shift_ctrl =
+      _mm256_load_si256(reinterpret_cast<const __m256i*>(shift_mult));
+  const __m256i rev_lo = _mm256_setr_epi8(
+      0x0, 0x8, 0x4, 0xc, 0x2, 0xa, 0x6, 0xe, 0x1, 0x9, 0x5, 0xd, 0x3, 0xb, 0x7,
+      0xf, 0x0, 0x8, 0x4, 0xc, 0x2, 0xa, 0x6, 0xe, 0x1, 0x9, 0x5, 0xd, 0x3, 0xb,
+      0x7, 0xf);
+  const __m256i rev_hi = _mm256_slli_epi16(rev_lo, 4);
+  const __m256i nibble_mask = _mm256_set1_epi8(0x0f);
+
+  // Return eight outputs per lane, for the bytes at [in] and [in + mod_type]
+  auto adapt_16 = [&](const uint8_t* in) {
+    __m256i bytes = _mm256_inserti128_si256(
+        _mm256_castsi128_si256(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(in))),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + mod_type)), 1);
+    // Reverse the bits of each byte, so that earlier bits are more
+    // significant
+    const __m256i lo_nibbles = _mm256_and_si256(bytes, nibble_mask);
+    const __m256i hi_nibbles =
+        _mm256_and_si256(_mm256_srli_epi16(bytes, 4), nibble_mask);
+    bytes = _mm256_or_si256(_mm256_shuffle_epi8(rev_hi, lo_nibbles),
+                            _mm256_shuffle_epi8(rev_lo, hi_nibbles));
+    const __m256i words = _mm256_shuffle_epi8(bytes, gather_ctrl);
+    return _mm256_srli_epi16(_mm256_mullo_epi16(words, shift_ctrl),
+                             16 - mod_type);
+  };
+
+  size_t i = 0;
+  for (; i + 3 * mod_type + sizeof(__m128i) <= len; i += 4 * mod_type) {
+    const __m256i out = _mm256_packus_epi16(
+        adapt_16(bit_seq_in + i), adapt_16(bit_seq_in + i + 2 * mod_type));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(bytes_out),
+                        _mm256_permute4x64_epi64(out, 0xd8));
+    bytes_out += sizeof(__m256i);
+  }
+#ifdef __BMI2__
+  AdaptBitsForModBmi2(bit_seq_in + i, bytes_out, len - i, mod_type);
+#else
+  AdaptBitsForModLoop(bit_seq_in + i, bytes_out, len - i, mod_type);
+#endif
+}
+#endif
+
 /**
  * \brief Fill-in the bytes of \p bytes_out with \p mod_type bits per byte,
  * taken from the bit sequence \p bit_seq_in
  *
+ * Uses the fastest kernel available for \p mod_type and \p len: AVX2 for long
+ * inputs, BMI2 for short ones, and the scalar loop for modulation orders that
+ * the SIMD kernels do not support.
+ *
  * \param bit_seq_in The input bit sequence
  *
  * \param bytes_out The output byte array with \p mod_type bits per byte. It
@@ -61,22 +189,19 @@ static inline uint8_t Bitreverse8(uint8_t x) {
 static inline void AdaptBitsForMod(const uint8_t* bit_seq_in,
                                    uint8_t* bytes_out, size_t len,
                                    size_t mod_type) {
-  uint16_t bits = 0;      // Bits collected from the input
-  size_t bits_avail = 0;  // Number of valid bits filled into [bits]
-  for (size_t i = 0; i < len; i++) {
-    bits |= static_cast<uint32_t>(Bitreverse8(bit_seq_in[i]))
-            << (8 - bits_avail);
-    bits_avail += 8;
-    while (bits_avail >= mod_type) {
-      *bytes_out++ = bits >> (16 - mod_type);
-      bits <<= mod_type;
-      bits_avail -= mod_type;
+  if (AdaptBitsForModSimdSupported(mod_type)) {
+#ifdef __AVX2__
+    if (len >= 3 * mod_type + sizeof(__m128i)) {
+      AdaptBitsForModAvx2(bit_seq_in, bytes_out, len, mod_type);
+      return;
     }
+#endif
+#ifdef __BMI2__
+    AdaptBitsForModBmi2(bit_seq_in, bytes_out, len, mod_type);
+    return;
+#endif
   }
-
-  if (bits_avail > 0) {
-    *bytes_out++ = bits >> (16 - mod_type);
-  }
+  AdaptBitsForModLoop(bit_seq_in, bytes_out, len, mod_type);
 }
 
 /*
@@ -192,27 +317,14 @@ static inline size_t LdpcGetMaxZc() {
   return kUseAVX2Encoder ? avx2enc::kZcMax : ZC_MAX;
 }
 
-// Generate the codeword output and parity buffer for this input buffer
-static inline void LdpcEncodeHelper(size_t base_graph, size_t zc, size_t nRows,
-                                    int8_t* encoded_buffer,
-                                    int8_t* parity_buffer,
-                                    const int8_t* input_buffer) {
+// Fill the codeword output from an input buffer and its encoded parity buffer
+static inline void LdpcFillEncodedBuffer(size_t base_graph, size_t zc,
+                                         size_t nRows, int8_t* encoded_buffer,
+                                         int8_t* parity_buffer,
+                                         const int8_t* input_buffer) {
   const size_t num_input_bits = LdpcNumInputBits(base_graph, zc);
   const size_t num_parity_bits = nRows * zc;
 
-  bblib_ldpc_encoder_5gnr_request req;
-  bblib_ldpc_encoder_5gnr_response resp;
-  req.baseGraph = base_graph;
-  req.nRows = kUseAVX2Encoder ? LdpcMaxNumRows(base_graph) : nRows;
-  req.Zc = zc;
-  req.nRows = nRows;
-  req.numberCodeblocks = 1;
-  req.input[0] = const_cast<int8_t*>(input_buffer);
-  resp.output[0] = parity_buffer;
-
-  kUseAVX2Encoder ? avx2enc::BblibLdpcEncoder5gnr(&req, &resp)
-                  : bblib_ldpc_encoder_5gnr(&req, &resp);
-
   // Copy punctured input bits from the encoding request, and parity bits from
   // the encoding response into encoded_buffer
   static size_t k_num_punctured_cols = 2;
@@ -272,4 +384,56 @@ static inline void LdpcEncodeHelper(size_t base_graph, size_t zc, size_t nRows,
   }
 }
 
+// Generate the codeword outputs and parity buffers for [num_cbs] input
+// buffers with one encoder call, which encodes small-Zc code blocks side by
+// side in SIMD lanes
+static inline void LdpcEncodeBatchHelper(size_t base_graph, size_t zc,
+                                         size_t nRows, size_t num_cbs,
+                                         int8_t* const* encoded_buffers,
+                                         int8_t* const* parity_buffers,
+                                         const int8_t* const* input_buffers) {
+  bblib_ldpc_encoder_5gnr_request req;
+  bblib_ldpc_encoder_5gnr_response resp;
+  RtAssert(num_cbs <= std::size(req.input),
+           "Too many code blocks for one encoder request");
+  req.baseGraph = base_graph;
+  req.nRows = kUseAVX2Encoder ? LdpcMaxNumRows(base_graph) : nRows;
+  req.Zc = zc;
+  req.nRows = nRows;
+  req.numberCodeblocks = num_cbs;
+  for (size_t i = 0; i < num_cbs; i++) {
+    req.input[i] = const_cast<int8_t*>(input_buffers[i]);
+    resp.output[i] = parity_buffers[i];
+  }
+
+  kUseAVX2Encoder ? avx2enc::BblibLdpcEncoder5gnr(&req, &resp)
+                  : bblib_ldpc_encoder_5gnr(&req, &resp);
+
+  for (size_t i = 0; i < num_cbs; i++) {
+    LdpcFillEncodedBuffer(base_graph, zc, nRows, encoded_buffers[i],
+                          parity_buffers[i], input_buffers[i]);
+  }
+}
+
+// Generate the codeword output and parity buffer for this input buffer
+static inline void LdpcEncodeHelper(size_t base_graph, size_t zc, size_t nRows,
+                                    int8_t* encoded_buffer,
+                                    int8_t* parity_buffer,
+                                    const int8_t* input_buffer) {
+  LdpcEncodeBatchHelper(base_graph, zc, nRows, 1, &encoded_buffer,
+                        &parity_buffer, &input_buffer);
+}
+
+// Decode one code block with Agora's AVX2 decoder or FlexRAN's decoder. The
+// unused decoder is not referenced, so its library need not be linked.
+static inline void LdpcDecodeHelper(
+    struct bblib_ldpc_decoder_5gnr_request* request,
+    struct bblib_ldpc_decoder_5gnr_response* response) {
+  if constexpr (kUseAVX2Decoder) {
+    avx2dec::BblibLdpcDecoder5gnr(request, response);
+  } else {
+    bblib_ldpc_decoder_5gnr(request, response);
+  }
+}
+
 #endif  // UTILS_LDPC_H_
\ No newline at end of file
@@ -9,18 +9,24 @@
 #include <immintrin.h>
 
 #include <armadillo>
+#include <atomic>
 #include <bitset>
 #include <fstream>
 #include <iostream>
 #include <memory>
+#include <thread>
 
 #include "comms-lib.h"
 #include "config.h"
 #include "crc.h"
+#include "gettime.h"
 #include "logger.h"
+#include "mapped_file.h"
 #include "memory_manage.h"
 #include "modulation.h"
+#include "parallel_for.h"
 #include "scrambler.h"
+#include "table_file.h"
 #include "utils_ldpc.h"
 
 static constexpr bool kPrintDebugCSI = false;
@@ -30,38 +36,98 @@ static constexpr bool kPrintDlModData = false;
 static constexpr bool kPrintUplinkInformationBytes = false;
 static constexpr bool kPrintDownlinkInformationBytes = false;
 
-static float RandFloatFromShort(float min, float max) {
-  float rand_val = ((float(rand()) / float(RAND_MAX)) * (max - min)) + min;
+static float RandFloatFromShort(FastRand& fast_rand, float min, float max) {
+  float rand_val =
+      ((static_cast<float>(fast_rand.NextU32()) / 4294967296.0f) *
+       (max - min)) +
+      min;
   auto rand_val_ushort = static_cast<short>(rand_val * 32768);
   rand_val = (float)rand_val_ushort / 32768;
   return rand_val;
 }
 
-void DataGenerator::DoDataGeneration(const std::string& directory) {
-  srand(time(nullptr));
-  auto scrambler = std::make_unique<AgoraScrambler::Scrambler>();
+// Random number generator of one parallel task, independent of the thread
+// that runs it so that the output only depends on [seed]
+static FastRand TaskRand(uint64_t seed, size_t task_id) {
+  FastRand fast_rand;
+  fast_rand.seed_ = seed ^ ((task_id + 1) * 0x9E3779B97F4A7C15ull);
+  return fast_rand;
+}
+
+static void ReportStage(const char* stage, double start_us) {
+  MLPD_INFO("DataGenerator: %s took %.1f ms\n", stage,
+            (GetTime::GetTimeUs() - start_us) / 1000.0);
+}
+
+void DataGenerator::ParallelFor(size_t num_tasks,
+                                const std::function<void(size_t)>& task) const {
+  ::ParallelFor(num_threads_, num_tasks, task);
+}
+
+void DataGenerator::DoDataGeneration(const std::string& directory,
+                                     size_t num_rx_frames) {
+  const double gen_start_us = GetTime::GetTimeUs();
+  double stage_start_us = gen_start_us;
   std::unique_ptr<DoCRC> crc_obj = std::make_unique<DoCRC>();
   size_t input_size = cfg_->NumBytesPerCb();
   // size_t input_size =
   //    LdpcEncodingInputBufSize(this->cfg_->LdpcConfig().BaseGraph(),
   //                             this->cfg_->LdpcConfig().ExpansionFactor());
-
-  auto* scrambler_buffer =
-      new int8_t[input_size + kLdpcHelperFunctionInputBufferSizePaddingBytes];
+  MLPD_INFO("DataGenerator: Using %zu threads\n", num_threads_);
+
+  // Code blocks are scrambled, encoded and modulated in parallel, each task
+  // with its own scrambler and buffers
+  auto encode_and_modulate = [&](const int8_t* information) {
+    AgoraScrambler::Scrambler scrambler;
+    std::vector<int8_t> scrambler_buffer(
+        input_size + kLdpcHelperFunctionInputBufferSizePaddingBytes);
+    std::memcpy(scrambler_buffer.data(), information, input_size);
+    if (this->cfg_->ScrambleEnabled()) {
+      scrambler.Scramble(scrambler_buffer.data(), input_size);
+    }
+    std::vector<int8_t> encoded_codeword;
+    this->GenCodeblock(scrambler_buffer.data(), encoded_codeword);
+    return this->GetModulation(encoded_codeword);
+  };
+
+  // Information bytes of code block cb (in symbol -> ue -> block order) in
+  // a reference table laid out like Config::UlBits() and Config::DlBits(),
+  // whose first pilot_syms rows belong to pilot symbols
+  const size_t num_bytes_per_ue_pad = Roundup<64>(input_size) *
+                                      cfg_->LdpcConfig().NumBlocksInSymbol();
+  auto info_bits = [&](Table<int8_t>& table, size_t pilot_syms, size_t cb) {
+    const size_t blocks = cfg_->LdpcConfig().NumBlocksInSymbol();
+    const size_t symbol_blocks = blocks * cfg_->UeAntNum();
+    return cfg_->GetInfoBits(table, pilot_syms + cb / symbol_blocks,
+                             (cb % symbol_blocks) / blocks, cb % blocks);
+  };
+
+  // Pilot and data symbols of all UEs
+  Table<complex_float> tx_data_all_symbols;
+  tx_data_all_symbols.Calloc(this->cfg_->Frame().NumTotalSyms(),
+                             this->cfg_->UeAntNum() * this->cfg_->OfdmCaNum(),
+                             Agora_memory::Alignment_t::kAlign64);
 
   // Step 1: Generate the information buffers (MAC Packets) and LDPC-encoded
-  // buffers for uplink
-  std::vector<std::vector<complex_float>> pre_ifft_data_syms;
+  // buffers for uplink, and place the modulated codewords in the central IFFT
+  // bins of the uplink data symbols
   const size_t num_ul_mac_bytes = this->cfg_->UlMacBytesNumPerframe();
   if (num_ul_mac_bytes > 0) {
-    std::vector<std::vector<int8_t>> ul_mac_info(cfg_->UeAntNum());
     MLPD_INFO("Total number of uplink MAC bytes: %zu\n", num_ul_mac_bytes);
+    const std::string filename_mac =
+        directory + "/data/orig_ul_data_" +
+        std::to_string(this->cfg_->OfdmCaNum()) + "_ant" +
+        std::to_string(this->cfg_->UeAntNum()) + ".bin";
+    MLPD_INFO("Saving uplink MAC data to %s\n", filename_mac.c_str());
+    auto ul_mac_file =
+        MappedFile::Create(filename_mac, cfg_->UeAntNum() * num_ul_mac_bytes);
+    // The MAC bytes of UE i start at ul_mac_info + i * num_ul_mac_bytes
+    auto* ul_mac_info = ul_mac_file->Data<int8_t>();
     for (size_t ue_id = 0; ue_id < cfg_->UeAntNum(); ue_id++) {
-      ul_mac_info.at(ue_id).resize(num_ul_mac_bytes);
       for (size_t pkt_id = 0; pkt_id < cfg_->UlMacPacketsPerframe(); pkt_id++) {
         size_t pkt_offset = pkt_id * cfg_->MacPacketLength();
         auto* pkt = reinterpret_cast<MacPacketPacked*>(
-            &ul_mac_info.at(ue_id).at(pkt_offset));
+            &ul_mac_info[ue_id * num_ul_mac_bytes + pkt_offset]);
 
         pkt->Set(0, pkt_id, ue_id, cfg_->MacPayloadMaxLength());
         this->GenMacData(pkt, ue_id);
@@ -71,28 +137,15 @@ void DataGenerator::DoDataGeneration(const std::string& directory) {
       }
     }
 
-    {
-      const std::string filename_input =
-          directory + "/data/orig_ul_data_" +
-          std::to_string(this->cfg_->OfdmCaNum()) + "_ant" +
-          std::to_string(this->cfg_->UeAntNum()) + ".bin";
-      MLPD_INFO("Saving uplink MAC data to %s\n", filename_input.c_str());
-      FILE* fp_input = std::fopen(filename_input.c_str(), "wb");
-      for (size_t i = 0; i < cfg_->UeAntNum(); i++) {
-        std::fwrite(reinterpret_cast<uint8_t*>(ul_mac_info.at(i).data()),
-                    num_ul_mac_bytes, sizeof(uint8_t), fp_input);
-      }
-      std::fclose(fp_input);
-
-      if (kPrintUplinkInformationBytes) {
-        std::printf("Uplink information bytes\n");
-        for (size_t n = 0; n < cfg_->UeAntNum(); n++) {
-          std::printf("UE %zu\n", n % this->cfg_->UeAntNum());
-          for (size_t i = 0; i < num_ul_mac_bytes; i++) {
-            std::printf("%u ", static_cast<uint8_t>(ul_mac_info.at(n).at(i)));
-          }
-          std::printf("\n");
+    if (kPrintUplinkInformationBytes) {
+      std::printf("Uplink information bytes\n");
+      for (size_t n = 0; n < cfg_->UeAntNum(); n++) {
+        std::printf("UE %zu\n", n % this->cfg_->UeAntNum());
+        for (size_t i = 0; i < num_ul_mac_bytes; i++) {
+          std::printf("%u ", static_cast<uint8_t>(
+                                 ul_mac_info[n * num_ul_mac_bytes + i]));
         }
+        std::printf("\n");
       }
     }
 
@@ -101,11 +154,23 @@ void DataGenerator::DoDataGeneration(const std::string& directory) {
     const size_t num_ul_codeblocks =
         this->cfg_->Frame().NumUlDataSyms() * symbol_blocks;
     MLPD_SYMBOL("Total number of ul blocks: %zu\n", num_ul_codeblocks);
+    RtAssert(this->cfg_->LdpcConfig().NumBlocksInSymbol() ==
+             1);  // TODO: Assumption
 
-    std::vector<std::vector<int8_t>> ul_information(num_ul_codeblocks);
-    std::vector<std::vector<int8_t>> ul_encoded_codewords(num_ul_codeblocks);
-
-    for (size_t cb = 0; cb < num_ul_codeblocks; cb++) {
+    const std::string filename_input =
+        directory + "/data/LDPC_orig_ul_data_" +
+        std::to_string(this->cfg_->OfdmCaNum()) + "_ant" +
+        std::to_string(this->cfg_->UeAntNum()) + ".bin";
+    MLPD_INFO("Saving raw uplink data (using LDPC) to %s\n",
+              filename_input.c_str());
+    auto ul_information_file = TableFile<int8_t>::Create(
+        filename_input, this->cfg_->Frame().NumULSyms(),
+        num_bytes_per_ue_pad * this->cfg_->UeAntNum());
+    Table<int8_t> ul_information;
+    ul_information_file->View(ul_information);
+    const size_t ul_pilot_syms = this->cfg_->Frame().ClientUlPilotSymbols();
+
+    ParallelFor(num_ul_codeblocks, [&](size_t cb) {
       // i : symbol -> ue -> cb (repeat)
       size_t sym_id = cb / (symbol_blocks);
       // ue antenna for code block
@@ -120,63 +185,39 @@ void DataGenerator::DoDataGeneration(const std::string& directory) {
           "cb %zu -- user %zu -- user block %zu -- user cb id %zu -- input "
           "size %zu, index %zu, total size %zu\n",
           cb, ue_id, ue_cb_id, ue_cb_cnt, input_size, ue_cb_cnt * input_size,
-          ul_mac_info.at(ue_id).size());
-      int8_t* cb_start = &ul_mac_info.at(ue_id).at(ue_cb_cnt * input_size);
-      ul_information.at(cb) =
-          std::vector<int8_t>(cb_start, cb_start + input_size);
-
-      std::memcpy(scrambler_buffer, ul_information.at(cb).data(), input_size);
-
-      if (this->cfg_->ScrambleEnabled()) {
-        scrambler->Scramble(scrambler_buffer, input_size);
-      }
-      this->GenCodeblock(scrambler_buffer, ul_encoded_codewords.at(cb));
-    }
-
-    {
-      const std::string filename_input =
-          directory + "/data/LDPC_orig_ul_data_" +
-          std::to_string(this->cfg_->OfdmCaNum()) + "_ant" +
-          std::to_string(this->cfg_->UeAntNum()) + ".bin";
-      MLPD_INFO("Saving raw uplink data (using LDPC) to %s\n",
-                filename_input.c_str());
-      FILE* fp_input = std::fopen(filename_input.c_str(), "wb");
-      for (size_t i = 0; i < num_ul_codeblocks; i++) {
-        std::fwrite(reinterpret_cast<uint8_t*>(&ul_information.at(i).at(0)),
-                    input_size, sizeof(uint8_t), fp_input);
-      }
-      std::fclose(fp_input);
-
-      if (kPrintUplinkInformationBytes) {
-        std::printf("Uplink information bytes\n");
-        for (size_t n = 0; n < num_ul_codeblocks; n++) {
-          std::printf("Symbol %zu, UE %zu\n", n / this->cfg_->UeAntNum(),
-                      n % this->cfg_->UeAntNum());
-          for (size_t i = 0; i < input_size; i++) {
-            std::printf("%u ",
-                        static_cast<uint8_t>(ul_information.at(n).at(i)));
-          }
-          std::printf("\n");
+          num_ul_mac_bytes);
+      int8_t* information = info_bits(ul_information, ul_pilot_syms, cb);
+      std::memcpy(information,
+                  &ul_mac_info[ue_id * num_ul_mac_bytes +
+                               ue_cb_cnt * input_size],
+                  input_size);
+
+      const std::vector<complex_float> modulated_codeword =
+          encode_and_modulate(information);
+      // With one block per symbol, code block cb is UE ue_id's data on
+      // uplink data symbol sym_id
+      std::memcpy(
+          tx_data_all_symbols[this->cfg_->Frame().GetULDataSymbol(sym_id)] +
+              (ue_id * this->cfg_->OfdmCaNum()) + this->cfg_->OfdmDataStart(),
+          modulated_codeword.data(),
+          this->cfg_->OfdmDataNum() * sizeof(complex_float));
+    });
+    ul_information_file->Seal();
+
+    if (kPrintUplinkInformationBytes) {
+      std::printf("Uplink information bytes\n");
+      for (size_t n = 0; n < num_ul_codeblocks; n++) {
+        std::printf("Symbol %zu, UE %zu\n", n / this->cfg_->UeAntNum(),
+                    n % this->cfg_->UeAntNum());
+        const int8_t* information = info_bits(ul_information, ul_pilot_syms, n);
+        for (size_t i = 0; i < input_size; i++) {
+          std::printf("%u ", static_cast<uint8_t>(information[i]));
         }
+        std::printf("\n");
       }
     }
-
-    // Modulate the encoded codewords
-    std::vector<std::vector<complex_float>> ul_modulated_codewords(
-        num_ul_codeblocks);
-    for (size_t i = 0; i < num_ul_codeblocks; i++) {
-      ul_modulated_codewords.at(i) =
-          this->GetModulation(ul_encoded_codewords.at(i));
-    }
-
-    // Place modulated uplink data codewords into central IFFT bins
-    RtAssert(this->cfg_->LdpcConfig().NumBlocksInSymbol() ==
-             1);  // TODO: Assumption
-    pre_ifft_data_syms.resize(this->cfg_->UeAntNum() *
-                              this->cfg_->Frame().NumUlDataSyms());
-    for (size_t i = 0; i < pre_ifft_data_syms.size(); i++) {
-      pre_ifft_data_syms.at(i) = this->BinForIfft(ul_modulated_codewords.at(i));
-    }
+    ReportStage("Uplink encoding", stage_start_us);
+    stage_start_us = GetTime::GetTimeUs();
   }
 
   // Generate UE-specific pilots (phase tracking & downlink channel estimation)
@@ -201,11 +242,6 @@ void DataGenerator::DoDataGeneration(const std::string& directory) {
   std::vector<complex_float> pilot_td = this->GetCommonPilotTimeDomain();
 
   // Put pilot and data symbols together
-  Table<complex_float> tx_data_all_symbols;
-  tx_data_all_symbols.Calloc(this->cfg_->Frame().NumTotalSyms(),
-                             this->cfg_->UeAntNum() * this->cfg_->OfdmCaNum(),
-                             Agora_memory::Alignment_t::kAlign64);
-
   if (this->cfg_->FreqOrthogonalPilot() == true) {
     for (size_t i = 0; i < this->cfg_->UeAntNum(); i++) {
       std::vector<complex_float> pilots_t_ue(
@@ -230,111 +266,132 @@ void DataGenerator::DoDataGeneration(const std::string& directory) {
     }
   }
 
-  // Populate the UL symbols
-  for (size_t i = 0; i < this->cfg_->Frame().NumULSyms(); i++) {
+  // Populate the UL pilot symbols. The UL data symbols are filled in above.
+  for (size_t i = 0; i < this->cfg_->Frame().ClientUlPilotSymbols(); i++) {
     const size_t data_sym_id = this->cfg_->Frame().GetULSymbol(i);
     for (size_t j = 0; j < this->cfg_->UeAntNum(); j++) {
-      if (i < this->cfg_->Frame().ClientUlPilotSymbols()) {
-        std::memcpy(tx_data_all_symbols[data_sym_id] +
-                        (j * this->cfg_->OfdmCaNum()) +
-                        this->cfg_->OfdmDataStart(),
-                    ue_specific_pilot[j],
-                    this->cfg_->OfdmDataNum() * sizeof(complex_float));
-      } else {
-        size_t k = i - this->cfg_->Frame().ClientUlPilotSymbols();
-        std::memcpy(
-            tx_data_all_symbols[data_sym_id] + (j * this->cfg_->OfdmCaNum()),
-            &pre_ifft_data_syms.at(k * this->cfg_->UeAntNum() + j).at(0),
-            this->cfg_->OfdmCaNum() * sizeof(complex_float));
-      }
+      std::memcpy(tx_data_all_symbols[data_sym_id] +
+                      (j * this->cfg_->OfdmCaNum()) +
+                      this->cfg_->OfdmDataStart(),
+                  ue_specific_pilot[j],
+                  this->cfg_->OfdmDataNum() * sizeof(complex_float));
     }
   }
 
-  // Generate CSI matrix
-  Table<complex_float> csi_matrices;
+  // Generate the flat-fading CSI of every frame. The downlink data below uses
+  // the channel of the first frame.
+  const size_t num_pairs = this->cfg_->UeAntNum() * this->cfg_->BsAntNum();
+  const uint64_t channel_seed =
+      (static_cast<uint64_t>(fast_rand_.NextU32()) << 32) |
+      fast_rand_.NextU32();
   float sqrt2_norm = 1 / std::sqrt(2);
-  csi_matrices.Calloc(this->cfg_->OfdmCaNum(),
-                      this->cfg_->UeAntNum() * this->cfg_->BsAntNum(),
+  std::vector<complex_float> frame_csi(num_rx_frames * num_pairs);
+  FastRand csi_rand = TaskRand(channel_seed, SIZE_MAX - 1);
+  for (auto& csi : frame_csi) {
+    csi = {RandFloatFromShort(csi_rand, -1, 1) * sqrt2_norm,
+           RandFloatFromShort(csi_rand, -1, 1) * sqrt2_norm};
+  }
+  Table<complex_float> csi_matrices;
+  csi_matrices.Calloc(this->cfg_->OfdmCaNum(), num_pairs,
                       Agora_memory::Alignment_t::kAlign32);
-  for (size_t i = 0; i < (this->cfg_->UeAntNum() * this->cfg_->BsAntNum());
-       i++) {
-    complex_float csi = {RandFloatFromShort(-1, 1), RandFloatFromShort(-1, 1)};
-    for (size_t j = 0; j < this->cfg_->OfdmCaNum(); j++) {
-      csi_matrices[j][i].re = csi.re * sqrt2_norm;
-      csi_matrices[j][i].im = csi.im * sqrt2_norm;
-    }
+  for (size_t j = 0; j < this->cfg_->OfdmCaNum(); j++) {
+    std::memcpy(csi_matrices[j], frame_csi.data(),
+                num_pairs * sizeof(complex_float));
   }
 
-  // Generate RX data received by base station after going through channels
-  Table<complex_float> rx_data_all_symbols;
-  rx_data_all_symbols.Calloc(this->cfg_->Frame().NumTotalSyms(),
-                             this->cfg_->OfdmCaNum() * this->cfg_->BsAntNum(),
-                             Agora_memory::Alignment_t::kAlign64);
-  for (size_t i = 0; i < this->cfg_->Frame().NumTotalSyms(); i++) {
+  // Generate RX data received by base station after going through channels.
+  // Every frame has the same transmitted data but its own channel and noise,
+  // so that the sender can replay the file as a multi-frame corpus. Each
+  // (frame, symbol) task writes its samples straight into the output file.
+  const size_t rx_symbol_size =
+      this->cfg_->OfdmCaNum() * this->cfg_->BsAntNum();
+  const size_t num_rx_symbols =
+      num_rx_frames * this->cfg_->Frame().NumTotalSyms();
+  std::string filename_rx = directory + "/data/LDPC_rx_data_" +
+                            std::to_string(this->cfg_->OfdmCaNum()) + "_ant" +
+                            std::to_string(this->cfg_->BsAntNum()) + ".bin";
+  MLPD_INFO("Saving %zu frames of rx data to %s\n", num_rx_frames,
+            filename_rx.c_str());
+  auto rx_file = MappedFile::Create(
+      filename_rx, num_rx_symbols * rx_symbol_size * sizeof(complex_float));
+  auto* rx_data_all_symbols = rx_file->Data<complex_float>();
+  std::atomic<size_t> num_rx_symbols_done(0);
+  ParallelFor(num_rx_symbols, [&](size_t task_id) {
+    const size_t frame = task_id / this->cfg_->Frame().NumTotalSyms();
+    const size_t i = task_id % this->cfg_->Frame().NumTotalSyms();
+    FastRand noise_rand = TaskRand(channel_seed, task_id);
+    complex_float* rx_symbol = rx_data_all_symbols + task_id * rx_symbol_size;
+
     arma::cx_fmat mat_input_data(
         reinterpret_cast<arma::cx_float*>(tx_data_all_symbols[i]),
         this->cfg_->OfdmCaNum(), this->cfg_->UeAntNum(), false);
-    arma::cx_fmat mat_output(
-        reinterpret_cast<arma::cx_float*>(rx_data_all_symbols[i]),
-        this->cfg_->OfdmCaNum(), this->cfg_->BsAntNum(), false);
-
+    arma::cx_fmat mat_output(reinterpret_cast<arma::cx_float*>(rx_symbol),
+                             this->cfg_->OfdmCaNum(), this->cfg_->BsAntNum(),
+                             false);
+    // The channel is the same on every subcarrier
+    arma::cx_fmat mat_csi(
+        reinterpret_cast<arma::cx_float*>(&frame_csi[frame * num_pairs]),
+        this->cfg_->BsAntNum(), this->cfg_->UeAntNum());
+    mat_output = mat_input_data * mat_csi.st();
     for (size_t j = 0; j < this->cfg_->OfdmCaNum(); j++) {
-      arma::cx_fmat mat_csi(reinterpret_cast<arma::cx_float*>(csi_matrices[j]),
-                            this->cfg_->BsAntNum(), this->cfg_->UeAntNum());
-      mat_output.row(j) = mat_input_data.row(j) * mat_csi.st();
       for (size_t k = 0; k < this->cfg_->BsAntNum(); k++) {
-        arma::cx_float noise(RandFloatFromShort(-1, 1),
-                             RandFloatFromShort(-1, 1));
+        arma::cx_float noise(RandFloatFromShort(noise_rand, -1, 1),
+                             RandFloatFromShort(noise_rand, -1, 1));
         noise *= this->cfg_->NoiseLevel() * sqrt2_norm;
         mat_output.at(j, k) += noise;
       }
     }
     for (size_t j = 0; j < this->cfg_->BsAntNum(); j++) {
-      CommsLib::IFFT(rx_data_all_symbols[i] + j * this->cfg_->OfdmCaNum(),
+      CommsLib::IFFT(rx_symbol + j * this->cfg_->OfdmCaNum(),
                      this->cfg_->OfdmCaNum(), false);
     }
-  }
 
-  std::string filename_rx = directory + "/data/LDPC_rx_data_" +
-                            std::to_string(this->cfg_->OfdmCaNum()) + "_ant" +
-                            std::to_string(this->cfg_->BsAntNum()) + ".bin";
-  MLPD_INFO("Saving rx data to %s\n", filename_rx.c_str());
-  FILE* fp_rx = std::fopen(filename_rx.c_str(), "wb");
-  for (size_t i = 0; i < this->cfg_->Frame().NumTotalSyms(); i++) {
-    auto* ptr = reinterpret_cast<float*>(rx_data_all_symbols[i]);
-    std::fwrite(ptr, this->cfg_->OfdmCaNum() * this->cfg_->BsAntNum() * 2,
-                sizeof(float), fp_rx);
-  }
-  std::fclose(fp_rx);
+    const size_t done = ++num_rx_symbols_done;
+    if ((num_rx_frames > 1) && ((done * 10) / num_rx_symbols !=
+                                ((done - 1) * 10) / num_rx_symbols)) {
+      MLPD_INFO("DataGenerator: rx data %zu%% done\n",
+                (done * 100) / num_rx_symbols);
+    }
+  });
+  ReportStage("Uplink rx data", stage_start_us);
+  stage_start_us = GetTime::GetTimeUs();
 
   if (kDebugPrintRxData) {
     std::printf("rx data\n");
     for (size_t i = 0; i < 10; i++) {
-      for (size_t j = 0; j < this->cfg_->OfdmCaNum() * this->cfg_->BsAntNum();
-           j++) {
+      for (size_t j = 0; j < rx_symbol_size; j++) {
         if (j % this->cfg_->OfdmCaNum() == 0) {
           std::printf("\nsymbol %zu ant %zu\n", i, j / this->cfg_->OfdmCaNum());
         }
-        std::printf("%.4f+%.4fi ", rx_data_all_symbols[i][j].re,
-                    rx_data_all_symbols[i][j].im);
+        const complex_float& sample =
+            rx_data_all_symbols[i * rx_symbol_size + j];
+        std::printf("%.4f+%.4fi ", sample.re, sample.im);
       }
       std::printf("\n");
     }
   }
+  rx_file.reset();
 
   /* ------------------------------------------------
    * Generate data for downlink test
    * ------------------------------------------------ */
   if (this->cfg_->Frame().NumDLSyms() > 0) {
     const size_t num_dl_mac_bytes = this->cfg_->DlMacBytesNumPerframe();
-    std::vector<std::vector<int8_t>> dl_mac_info(cfg_->UeAntNum());
     MLPD_SYMBOL("Total number of downlink MAC bytes: %zu\n", num_dl_mac_bytes);
+    const std::string filename_mac =
+        directory + "/data/orig_dl_data_" +
+        std::to_string(this->cfg_->OfdmCaNum()) + "_ant" +
+        std::to_string(this->cfg_->UeAntNum()) + ".bin";
+    MLPD_INFO("Saving downlink MAC data to %s\n", filename_mac.c_str());
+    auto dl_mac_file =
+        MappedFile::Create(filename_mac, cfg_->UeAntNum() * num_dl_mac_bytes);
+    // The MAC bytes of UE i start at dl_mac_info + i * num_dl_mac_bytes
+    auto* dl_mac_info = dl_mac_file->Data<int8_t>();
     for (size_t ue_id = 0; ue_id < cfg_->UeAntNum(); ue_id++) {
-      dl_mac_info[ue_id].resize(num_dl_mac_bytes);
       for (size_t pkt_id = 0; pkt_id < cfg_->DlMacPacketsPerframe(); pkt_id++) {
         size_t pkt_offset = pkt_id * cfg_->MacPacketLength();
         auto* pkt = reinterpret_cast<MacPacketPacked*>(
-            &dl_mac_info.at(ue_id).at(pkt_offset));
+            &dl_mac_info[ue_id * num_dl_mac_bytes + pkt_offset]);
 
         pkt->Set(0, pkt_id, ue_id, cfg_->MacPayloadMaxLength());
         this->GenMacData(pkt, ue_id);
@@ -344,28 +401,15 @@ void DataGenerator::DoDataGeneration(const std::string& directory) {
       }
     }
 
-    {
-      const std::string filename_input =
-          directory + "/data/orig_dl_data_" +
-          std::to_string(this->cfg_->OfdmCaNum()) + "_ant" +
-          std::to_string(this->cfg_->UeAntNum()) + ".bin";
-      MLPD_INFO("Saving downlink MAC data to %s\n", filename_input.c_str());
-      FILE* fp_input = std::fopen(filename_input.c_str(), "wb");
-      for (size_t i = 0; i < cfg_->UeAntNum(); i++) {
-        std::fwrite(reinterpret_cast<uint8_t*>(dl_mac_info.at(i).data()),
-                    num_dl_mac_bytes, sizeof(uint8_t), fp_input);
-      }
-      std::fclose(fp_input);
-
-      if (kPrintDownlinkInformationBytes) {
-        std::printf("Downlink information bytes\n");
-        for (size_t n = 0; n < cfg_->UeAntNum(); n++) {
-          std::printf("UE %zu\n", n % this->cfg_->UeAntNum());
-          for (size_t i = 0; i < num_dl_mac_bytes; i++) {
-            std::printf("%u ", static_cast<uint8_t>(dl_mac_info.at(n).at(i)));
-          }
-          std::printf("\n");
+    if (kPrintDownlinkInformationBytes) {
+      std::printf("Downlink information bytes\n");
+      for (size_t n = 0; n < cfg_->UeAntNum(); n++) {
+        std::printf("UE %zu\n", n % this->cfg_->UeAntNum());
+        for (size_t i = 0; i < num_dl_mac_bytes; i++) {
+          std::printf("%u ", static_cast<uint8_t>(
+                                 dl_mac_info[n * num_dl_mac_bytes + i]));
         }
+        std::printf("\n");
       }
     }
 
@@ -375,9 +419,25 @@ void DataGenerator::DoDataGeneration(const std::string& directory) {
         this->cfg_->Frame().NumDlDataSyms() * symbol_blocks;
     MLPD_SYMBOL("Total number of dl data blocks: %zu\n", num_dl_codeblocks);
 
-    std::vector<std::vector<int8_t>> dl_information(num_dl_codeblocks);
-    std::vector<std::vector<int8_t>> dl_encoded_codewords(num_dl_codeblocks);
-    for (size_t cb = 0; cb < num_dl_codeblocks; cb++) {
+    // Save downlink information bytes to file
+    const std::string filename_input =
+        directory + "/data/LDPC_orig_dl_data_" +
+        std::to_string(this->cfg_->OfdmCaNum()) + "_ant" +
+        std::to_string(this->cfg_->UeAntNum()) + ".bin";
+    MLPD_INFO("Saving raw dl data (using LDPC) to %s\n",
+              filename_input.c_str());
+    auto dl_information_file = TableFile<int8_t>::Create(
+        filename_input, this->cfg_->Frame().NumDLSyms(),
+        num_bytes_per_ue_pad * this->cfg_->UeAntNum());
+    Table<int8_t> dl_information;
+    dl_information_file->View(dl_information);
+    const size_t dl_pilot_syms = this->cfg_->Frame().ClientDlPilotSymbols();
+
+    // Modulated codewords, OfdmDataNum() subcarriers each
+    Table<complex_float> dl_modulated_codewords;
+    dl_modulated_codewords.Malloc(num_dl_codeblocks, this->cfg_->OfdmDataNum(),
+                                  Agora_memory::Alignment_t::kAlign64);
+    ParallelFor(num_dl_codeblocks, [&](size_t cb) {
       // i : symbol -> ue -> cb (repeat)
       size_t sym_id = cb / (symbol_blocks);
       // ue antenna for code block
@@ -387,61 +447,40 @@ void DataGenerator::DoDataGeneration(const std::string& directory) {
           sym_offset % this->cfg_->LdpcConfig().NumBlocksInSymbol();
       size_t ue_cb_cnt =
           (sym_id * this->cfg_->LdpcConfig().NumBlocksInSymbol()) + ue_cb_id;
-      int8_t* cb_start = &dl_mac_info.at(ue_id).at(ue_cb_cnt * input_size);
-      dl_information.at(cb) =
-          std::vector<int8_t>(cb_start, cb_start + input_size);
-
-      std::memcpy(scrambler_buffer, dl_information.at(cb).data(), input_size);
-
-      if (this->cfg_->ScrambleEnabled()) {
-        scrambler->Scramble(scrambler_buffer, input_size);
-      }
-      this->GenCodeblock(scrambler_buffer, dl_encoded_codewords.at(cb));
-    }
-
-    // Modulate the encoded codewords
-    std::vector<std::vector<complex_float>> dl_modulated_codewords(
-        num_dl_codeblocks);
-    for (size_t i = 0; i < num_dl_codeblocks; i++) {
-      dl_modulated_codewords.at(i) =
-          this->GetModulation(dl_encoded_codewords.at(i));
-    }
-
-    {
-      // Save downlink information bytes to file
-      const std::string filename_input =
-          directory + "/data/LDPC_orig_dl_data_" +
-          std::to_string(this->cfg_->OfdmCaNum()) + "_ant" +
-          std::to_string(this->cfg_->UeAntNum()) + ".bin";
-      MLPD_INFO("Saving raw dl data (using LDPC) to %s\n",
-                filename_input.c_str());
-      FILE* fp_input = std::fopen(filename_input.c_str(), "wb");
-      for (size_t i = 0; i < num_dl_codeblocks; i++) {
-        std::fwrite(reinterpret_cast<uint8_t*>(&dl_information.at(i).at(0)),
-                    input_size, sizeof(uint8_t), fp_input);
-      }
-      std::fclose(fp_input);
-
-      if (kPrintDownlinkInformationBytes == true) {
-        std::printf("Downlink information bytes\n");
-        for (size_t n = 0; n < num_dl_codeblocks; n++) {
-          std::printf("Symbol %zu, UE %zu\n", n / this->cfg_->UeAntNum(),
-                      n % this->cfg_->UeAntNum());
-          for (size_t i = 0; i < input_size; i++) {
-            std::printf("%u ",
-                        static_cast<unsigned>(dl_information.at(n).at(i)));
-          }
-          std::printf("\n");
+      int8_t* information = info_bits(dl_information, dl_pilot_syms, cb);
+      std::memcpy(information,
+                  &dl_mac_info[ue_id * num_dl_mac_bytes +
+                               ue_cb_cnt * input_size],
+                  input_size);
+
+      const std::vector<complex_float> modulated_codeword =
+          encode_and_modulate(information);
+      std::memcpy(dl_modulated_codewords[cb], modulated_codeword.data(),
+                  this->cfg_->OfdmDataNum() * sizeof(complex_float));
+    });
+    dl_information_file->Seal();
+
+    if (kPrintDownlinkInformationBytes == true) {
+      std::printf("Downlink information bytes\n");
+      for (size_t n = 0; n < num_dl_codeblocks; n++) {
+        std::printf("Symbol %zu, UE %zu\n", n / this->cfg_->UeAntNum(),
+                    n % this->cfg_->UeAntNum());
+        const int8_t* information = info_bits(dl_information, dl_pilot_syms, n);
+        for (size_t i = 0; i < input_size; i++) {
+          std::printf("%u ", static_cast<unsigned>(information[i]));
         }
+        std::printf("\n");
       }
     }
+    ReportStage("Downlink encoding", stage_start_us);
+    stage_start_us = GetTime::GetTimeUs();
 
-    // Compute precoder
+    // Compute precoder, normalized to a largest magnitude of 1
     Table<complex_float> precoder;
     precoder.Calloc(this->cfg_->OfdmCaNum(),
                     this->cfg_->UeAntNum() * this->cfg_->BsAntNum(),
                     Agora_memory::Alignment_t::kAlign32);
-    for (size_t i = 0; i < this->cfg_->OfdmCaNum(); i++) {
+    ParallelFor(this->cfg_->OfdmCaNum(), [&](size_t i) {
       arma::cx_fmat mat_input(
           reinterpret_cast<arma::cx_float*>(csi_matrices[i]),
           this->cfg_->BsAntNum(), this->cfg_->UeAntNum(), false);
@@ -449,7 +488,8 @@ void DataGenerator::DoDataGeneration(const std::string& directory) {
                                this->cfg_->UeAntNum(), this->cfg_->BsAntNum(),
                                false);
       pinv(mat_output, mat_input, 1e-2, "dc");
-    }
+      mat_output /= abs(mat_output).max();
+    });
 
     if (kPrintDebugCSI) {
       std::printf("CSI \n");
@@ -483,12 +523,10 @@ void DataGenerator::DoDataGeneration(const std::string& directory) {
               (sc_id % this->cfg_->OfdmPilotSpacing() == 0)) {
             sc_data = ue_specific_pilot[j][sc_id];
           } else {
-            sc_data =
-                dl_modulated_codewords
-                    .at(((i - this->cfg_->Frame().ClientDlPilotSymbols()) *
-                         this->cfg_->UeAntNum()) +
-                        j)
-                    .at(sc_id);
+            sc_data = dl_modulated_codewords
+                [((i - this->cfg_->Frame().ClientDlPilotSymbols()) *
+                  this->cfg_->UeAntNum()) +
+                 j][sc_id];
           }
           dl_mod_data[i][j * this->cfg_->OfdmCaNum() + sc_id +
                          this->cfg_->OfdmDataStart()] = sc_data;
@@ -515,17 +553,25 @@ void DataGenerator::DoDataGeneration(const std::string& directory) {
       }
     }
 
-    // Perform precoding and IFFT
+    // Perform precoding and IFFT, one task per symbol, writing the samples
+    // straight into the output file
     Table<complex_float> dl_ifft_data;
     dl_ifft_data.Calloc(this->cfg_->Frame().NumDLSyms(),
                         this->cfg_->OfdmCaNum() * this->cfg_->BsAntNum(),
                         Agora_memory::Alignment_t::kAlign64);
-    Table<short> dl_tx_data;
-    dl_tx_data.Calloc(this->cfg_->Frame().NumDLSyms(),
-                      2 * this->cfg_->SampsPerSymbol() * this->cfg_->BsAntNum(),
-                      Agora_memory::Alignment_t::kAlign64);
+    const size_t dl_tx_symbol_size =
+        2 * this->cfg_->SampsPerSymbol() * this->cfg_->BsAntNum();
+    std::string filename_dl_tx =
+        directory + "/data/LDPC_dl_tx_data_" +
+        std::to_string(this->cfg_->OfdmCaNum()) + "_ant" +
+        std::to_string(this->cfg_->BsAntNum()) + ".bin";
+    MLPD_INFO("Saving dl tx data to %s\n", filename_dl_tx.c_str());
+    auto dl_tx_file = MappedFile::Create(
+        filename_dl_tx,
+        this->cfg_->Frame().NumDLSyms() * dl_tx_symbol_size * sizeof(short));
+    auto* dl_tx_data = dl_tx_file->Data<short>();
 
-    for (size_t i = 0; i < this->cfg_->Frame().NumDLSyms(); i++) {
+    ParallelFor(this->cfg_->Frame().NumDLSyms(), [&](size_t i) {
       arma::cx_fmat mat_input_data(
           reinterpret_cast<arma::cx_float*>(dl_mod_data[i]),
           this->cfg_->OfdmCaNum(), this->cfg_->UeAntNum(), false);
@@ -539,20 +585,14 @@ void DataGenerator::DoDataGeneration(const std::string& directory) {
         arma::cx_fmat mat_precoder(
             reinterpret_cast<arma::cx_float*>(precoder[j]),
             this->cfg_->UeAntNum(), this->cfg_->BsAntNum(), false);
-        mat_precoder /= abs(mat_precoder).max();
         mat_output.row(j) = mat_input_data.row(j) * mat_precoder;
-
-        // std::printf("symbol %d, sc: %d\n", i, j -
-        // this->cfg_->ofdm_data_start()); cout << "Precoder: \n" <<
-        // mat_precoder
-        // << endl; cout << "Data: \n" << mat_input_data.row(j) << endl; cout <<
-        // "Precoded data: \n" << mat_output.row(j) << endl;
       }
       for (size_t j = 0; j < this->cfg_->BsAntNum(); j++) {
         complex_float* ptr_ifft = dl_ifft_data[i] + j * this->cfg_->OfdmCaNum();
         CommsLib::IFFT(ptr_ifft, this->cfg_->OfdmCaNum(), false);
 
-        short* tx_symbol = dl_tx_data[i] + j * this->cfg_->SampsPerSymbol() * 2;
+        short* tx_symbol = dl_tx_data + i * dl_tx_symbol_size +
+                           j * this->cfg_->SampsPerSymbol() * 2;
         std::memset(tx_symbol, 0,
                     sizeof(short) * 2 * this->cfg_->OfdmTxZeroPrefix());
         for (size_t k = 0; k < this->cfg_->OfdmCaNum(); k++) {
@@ -578,21 +618,8 @@ void DataGenerator::DoDataGeneration(const std::string& directory) {
         std::memset(tx_symbol + tx_zero_postfix_offset, 0,
                     sizeof(short) * 2 * this->cfg_->OfdmTxZeroPostfix());
       }
-    }
-
-    std::string filename_dl_tx =
-        directory + "/data/LDPC_dl_tx_data_" +
-        std::to_string(this->cfg_->OfdmCaNum()) + "_ant" +
-        std::to_string(this->cfg_->BsAntNum()) + ".bin";
-    MLPD_INFO("Saving dl tx data to %s\n", filename_dl_tx.c_str());
-    FILE* fp_dl_tx = std::fopen(filename_dl_tx.c_str(), "wb");
-    for (size_t i = 0; i < this->cfg_->Frame().NumDLSyms(); i++) {
-      short* ptr = dl_tx_data[i];
-      std::fwrite(ptr,
-                  this->cfg_->SampsPerSymbol() * this->cfg_->BsAntNum() * 2,
-                  sizeof(short), fp_dl_tx);
-    }
-    std::fclose(fp_dl_tx);
+    });
+    ReportStage("Downlink precoding", stage_start_us);
 
     if (kPrintDlTxData) {
       std::printf("rx data\n");
@@ -611,14 +638,13 @@ void DataGenerator::DoDataGeneration(const std::string& directory) {
 
     /* Clean Up memory */
     dl_ifft_data.Free();
-    dl_tx_data.Free();
     dl_mod_data.Free();
+    dl_modulated_codewords.Free();
     precoder.Free();
   }
 
   csi_matrices.Free();
   tx_data_all_symbols.Free();
-  rx_data_all_symbols.Free();
   ue_specific_pilot.Free();
-  delete[] scrambler_buffer;
+  ReportStage("Data generation", gen_start_us);
 }
@@ -6,6 +6,7 @@
 #ifndef DATA_GENERATOR_H_
 #define DATA_GENERATOR_H_
 
+#include <functional>
 #include <string>
 
 #include "config.h"
@@ -27,14 +28,25 @@ class DataGenerator {
   };
 
   explicit DataGenerator(Config* cfg, uint64_t seed = 0,
-                         Profile profile = Profile::kRandom)
-      : cfg_(cfg), profile_(profile) {
+                         Profile profile = Profile::kRandom,
+                         size_t num_threads = 1)
+      : cfg_(cfg), profile_(profile), num_threads_(num_threads) {
     if (seed != 0) {
       fast_rand_.seed_ = seed;
     }
   }
 
-  void DoDataGeneration(const std::string& directory);
+  /**
+   * @brief Generate the uplink and downlink data files in [directory]/data.
+   * The base station RX data file holds [num_rx_frames] frames, each with
+   * its own channel and noise realization.
+   *
+   * Code blocks, RX symbols and downlink symbols are generated on
+   * num_threads_ threads and written straight into the memory-mapped output
+   * files. Given a seed, the output does not depend on the number of threads.
+   */
+  void DoDataGeneration(const std::string& directory,
+                        size_t num_rx_frames = 1);
 
   /**
    * @brief                        Generate random Mac payload bit
@@ -165,9 +177,14 @@ class DataGenerator {
   }
 
  private:
-  FastRand fast_rand_;     // A fast random number generator
-  Config* cfg_;            // The global Agora config
-  const Profile profile_;  // The pattern of the input byte sequence
+  /// Run task(i) for every i in [0, num_tasks) on up to num_threads_ threads
+  void ParallelFor(size_t num_tasks,
+                   const std::function<void(size_t)>& task) const;
+
+  FastRand fast_rand_;        // A fast random number generator
+  Config* cfg_;               // The global Agora config
+  const Profile profile_;     // The pattern of the input byte sequence
+  const size_t num_threads_;  // Threads used by DoDataGeneration()
 };
 
 #endif  // DATA_GENERATOR_H_
@@ -10,6 +10,7 @@
 #include <bitset>
 #include <fstream>
 #include <iostream>
+#include <thread>
 
 #include "data_generator.h"
 #include "logger.h"
@@ -24,6 +25,11 @@ DEFINE_string(profile, "random",
 DEFINE_string(conf_file,
               TOSTRING(PROJECT_DIRECTORY) "/data/tddconfig-sim-ul.json",
               "Agora config filename");
+DEFINE_uint64(num_rx_frames, 1,
+              "Number of frames of base station RX data to generate, each "
+              "with its own channel and noise, for the sender to replay");
+DEFINE_uint64(num_threads, std::thread::hardware_concurrency(),
+              "Number of threads generating data");
 
 int main(int argc, char* argv[]) {
   const std::string cur_directory = TOSTRING(PROJECT_DIRECTORY);
@@ -35,7 +41,8 @@ int main(int argc, char* argv[]) {
       FLAGS_profile == "123" ? DataGenerator::Profile::kProfile123
                              : DataGenerator::Profile::kRandom;
   std::unique_ptr<DataGenerator> data_generator =
-      std::make_unique<DataGenerator>(cfg.get(), 0 /* RNG seed */, profile);
+      std::make_unique<DataGenerator>(cfg.get(), 0 /* RNG seed */, profile,
+                                      std::max<size_t>(FLAGS_num_threads, 1));
 
   MLPD_INFO("DataGenerator: Config file: %s, data profile = %s\n",
             FLAGS_conf_file.c_str(),
@@ -45,7 +52,7 @@ int main(int argc, char* argv[]) {
             cfg->FreqOrthogonalPilot() ? "frequency" : "time");
 
   MLPD_INFO("DataGenerator: Generating encoded and modulated data\n");
-  data_generator->DoDataGeneration(cur_directory);
+  data_generator->DoDataGeneration(cur_directory, FLAGS_num_rx_frames);
 
   return 0;
 }
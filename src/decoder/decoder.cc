@@ -0,0 +1,427 @@
+/**
+ * @file decoder.cc
+ * @brief Implementation of Agora's AVX2-based layered min-sum LDPC decoder.
+ *
+ * Each column of the lifted parity check matrix holds Zc posterior LLRs, and
+ * each edge of the base graph holds Zc check-to-variable messages. A layer
+ * (base graph row) is processed 32 Zc lanes at a time: the cyclic shift of
+ * an edge becomes an offset into the column, which is stored three times
+ * back to back so that every shifted view is a contiguous load, and every
+ * shifted store can refresh all three copies.
+ */
+#include "decoder.h"
+
+#include <immintrin.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include "gcc_phy_ldpc_encoder_5gnr_internal.h"
+
+namespace avx2dec {
+// Number of punctured information columns that are never transmitted
+static constexpr size_t kNumPuncturedCols = 2;
+// Base graph 1 edges, including the 4x4 double-diagonal parity block
+static constexpr size_t kMaxNumEdges = BG1_NONZERO_NUM + 9;
+static constexpr size_t kMaxRowDegree = 19;
+// Bytes of one column: three copies of the Zc LLRs, and room for the last
+// 32-lane store to the third copy
+static constexpr size_t kMaxColStride = 4 * kZcMax;
+// Channel LLRs are scaled down by a power of two until their mean magnitude
+// is at most this, so that int8 posteriors have headroom to add up many
+// messages before they saturate. A saturated posterior loses the sum of its
+// messages, and can then change sign wrongly as the messages change.
+// Min-sum decoding does not depend on the LLR scale.
+static constexpr size_t kMaxMeanChannelLlr = 12;
+
+struct Edge {
+  uint16_t col_;
+  uint16_t shift_;  // Shift value before reduction modulo Zc
+};
+
+struct BaseGraph {
+  std::vector<Edge> edges_;
+  // Edges of row r are edges_[row_start_[r]] to edges_[row_start_[r + 1]]
+  std::array<size_t, BG1_ROW_TOTAL + 1> row_start_;
+};
+
+// Build the row-major base graph [base_graph] for shift set [i_ls] from the
+// encoder's column-major tables
+static BaseGraph BuildBaseGraph(size_t base_graph, size_t i_ls) {
+  const bool bg1 = (base_graph == 1);
+  const size_t num_rows = bg1 ? BG1_ROW_TOTAL : BG2_ROW_TOTAL;
+  const size_t num_cols = bg1 ? BG1_COL_TOTAL : BG2_COL_TOTAL;
+  const int16_t* num_per_col =
+      bg1 ? kBg1MatrixNumPerCol : kBg2MatrixNumPerCol;
+  const int16_t* addr = bg1 ? kBg1Address : kBg2Address;
+  const int16_t* shifts = bg1 ? (kBg1HShiftMatrix + i_ls * BG1_NONZERO_NUM)
+                              : (kBg2HShiftMatrix + i_ls * BG2_NONZERO_NUM);
+
+  std::vector<std::vector<Edge>> rows(num_rows);
+  size_t idx = 0;
+  for (size_t col = 0; col < num_cols; col++) {
+    for (int16_t i = 0; i < num_per_col[col]; i++) {
+      // The encoder's addresses are row offsets of 64 bytes
+      rows.at(addr[idx] / 64).push_back(
+          {static_cast<uint16_t>(col), static_cast<uint16_t>(shifts[idx])});
+      idx++;
+    }
+  }
+
+  // The encoder's tables leave out the 4x4 double-diagonal block of the
+  // first parity columns, which it solves directly. Its shift values follow
+  // from the encoder's row transform.
+  const size_t p = bg1 ? BG1_COL_INF_NUM : BG2_COL_INF_NUM;
+  auto add = [&rows](size_t row, size_t col, size_t shift) {
+    rows[row].push_back(
+        {static_cast<uint16_t>(col), static_cast<uint16_t>(shift)});
+  };
+  if (bg1) {
+    const size_t v_diag = (i_ls == 6) ? 0 : 1;
+    const size_t v_row1 = (i_ls == 6) ? 105 : 0;
+    add(0, p, v_diag);
+    add(0, p + 1, 0);
+    add(1, p, v_row1);
+    add(1, p + 1, 0);
+    add(1, p + 2, 0);
+    add(2, p + 2, 0);
+    add(2, p + 3, 0);
+    add(3, p, v_diag);
+    add(3, p + 3, 0);
+  } else {
+    const bool unshifted = (i_ls == 3) || (i_ls == 7);
+    const size_t v_diag = unshifted ? 1 : 0;
+    const size_t v_row2 = unshifted ? 0 : 1;
+    add(0, p, v_diag);
+    add(0, p + 1, 0);
+    add(1, p + 1, 0);
+    add(1, p + 2, 0);
+    add(2, p, v_row2);
+    add(2, p + 2, 0);
+    add(2, p + 3, 0);
+    add(3, p, v_diag);
+    add(3, p + 3, 0);
+  }
+
+  BaseGraph graph;
+  graph.row_start_.fill(0);
+  for (size_t r = 0; r < num_rows; r++) {
+    if (rows[r].size() > kMaxRowDegree) {
+      throw std::runtime_error("Decoder: base graph row degree too large");
+    }
+    graph.row_start_[r] = graph.edges_.size();
+    graph.edges_.insert(graph.edges_.end(), rows[r].begin(), rows[r].end());
+  }
+  graph.row_start_[num_rows] = graph.edges_.size();
+  return graph;
+}
+
+static const BaseGraph& GetBaseGraph(size_t base_graph, size_t i_ls) {
+  static const std::array<BaseGraph, 2 * I_LS_NUM> kGraphs = []() {
+    std::array<BaseGraph, 2 * I_LS_NUM> graphs;
+    for (size_t i = 0; i < I_LS_NUM; i++) {
+      graphs[i] = BuildBaseGraph(1, i);
+      graphs[I_LS_NUM + i] = BuildBaseGraph(2, i);
+    }
+    return graphs;
+  }();
+  return kGraphs[(base_graph == 1 ? 0 : I_LS_NUM) + i_ls];
+}
+
+// i_LS of TS 38.212 Table 5.3.2-1, which selects the shift values for Zc
+static size_t SelectShiftSet(size_t zc) {
+  static constexpr size_t kFactors[] = {15, 13, 11, 9, 7, 5, 3};
+  for (size_t i = 0; i < 7; i++) {
+    if (zc % kFactors[i] == 0) {
+      return 7 - i;
+    }
+  }
+  return 0;
+}
+
+// Bit mask of the first [n] of 32 lanes
+static inline uint32_t FirstLanes(size_t n) {
+  return (n >= kLanes) ? 0xffffffffu : ((1u << n) - 1);
+}
+
+// Byte mask of the first [n] of 32 lanes
+static inline __m256i LaneMask(size_t n) {
+  const __m256i lane_ids =
+      _mm256_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+                       16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29,
+                       30, 31);
+  return _mm256_cmpgt_epi8(
+      _mm256_set1_epi8(static_cast<int8_t>(std::min(n, kLanes))), lane_ids);
+}
+
+class LayeredDecoder {
+ public:
+  LayeredDecoder(const BaseGraph& graph, size_t zc, size_t num_rows)
+      : graph_(graph),
+        zc_(zc),
+        zc_pad_(((zc + kLanes - 1) / kLanes) * kLanes),
+        col_stride_(((3 * zc + zc_pad_ + kLanes - 1) / kLanes) * kLanes),
+        num_rows_(num_rows) {}
+
+  // Load the channel LLRs into the columns and clear the messages
+  void Init(const int8_t* channel_llrs, size_t num_channel_llrs,
+            size_t num_cols) {
+    const size_t shift = ChannelLlrShift(channel_llrs, num_channel_llrs);
+    const __m128i shift_count = _mm_cvtsi32_si128(static_cast<int>(shift));
+    const __m256i shift_mask = _mm256_set1_epi8(
+        static_cast<int8_t>(static_cast<uint8_t>(0xff >> shift)));
+    const __m256i round =
+        _mm256_set1_epi8(static_cast<int8_t>((1 << shift) >> 1));
+    const __m256i neg_max = _mm256_set1_epi8(-127);
+    for (size_t col = 0; col < num_cols; col++) {
+      int8_t* col_llrs = llrs_ + col * col_stride_;
+      std::memset(col_llrs, 0, col_stride_);
+      if (col >= kNumPuncturedCols) {
+        const size_t first = (col - kNumPuncturedCols) * zc_;
+        if (first < num_channel_llrs) {
+          std::memcpy(col_llrs, channel_llrs + first,
+                      std::min(zc_, num_channel_llrs - first));
+        }
+      }
+      // Divide by 2^shift, rounding the magnitude. -128 has no positive
+      // counterpart for the message signs.
+      for (size_t j = 0; j < zc_pad_; j += kLanes) {
+        auto* ptr = reinterpret_cast<__m256i*>(col_llrs + j);
+        const __m256i llr = _mm256_max_epi8(_mm256_load_si256(ptr), neg_max);
+        const __m256i mag = _mm256_and_si256(
+            _mm256_srl_epi16(_mm256_adds_epu8(_mm256_abs_epi8(llr), round),
+                             shift_count),
+            shift_mask);
+        _mm256_store_si256(ptr, _mm256_sign_epi8(mag, llr));
+      }
+      std::memcpy(col_llrs + zc_, col_llrs, zc_);
+      std::memcpy(col_llrs + 2 * zc_, col_llrs, zc_);
+    }
+    std::memset(msgs_, 0, graph_.row_start_[num_rows_] * zc_pad_);
+  }
+
+  void ProcessLayer(size_t row) {
+    const size_t first_edge = graph_.row_start_[row];
+    const size_t degree = graph_.row_start_[row + 1] - first_edge;
+    int8_t* col_ptr[kMaxRowDegree];
+    int8_t* msg_ptr[kMaxRowDegree];
+    for (size_t e = 0; e < degree; e++) {
+      const Edge& edge = graph_.edges_[first_edge + e];
+      col_ptr[e] = llrs_ + edge.col_ * col_stride_ + zc_ + edge.shift_ % zc_;
+      msg_ptr[e] = msgs_ + (first_edge + e) * zc_pad_;
+    }
+
+    const __m256i neg_max = _mm256_set1_epi8(-127);
+    const __m256i pos_max = _mm256_set1_epi8(127);
+    const __m256i low6_mask = _mm256_set1_epi8(0x3f);
+    const __m256i one = _mm256_set1_epi8(1);
+    for (size_t j = 0; j < zc_pad_; j += kLanes) {
+      const bool partial = (j + kLanes > zc_);
+      const __m256i valid = LaneMask(zc_ - j);
+      __m256i q[kMaxRowDegree];
+      __m256i min1 = pos_max;
+      __m256i min2 = pos_max;
+      __m256i sign = _mm256_setzero_si256();
+      // Variable-to-check messages: posterior minus the old message
+      for (size_t e = 0; e < degree; e++) {
+        const __m256i app = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(col_ptr[e] + j));
+        q[e] = _mm256_max_epi8(
+            _mm256_subs_epi8(app, _mm256_load_si256(
+                                      reinterpret_cast<const __m256i*>(
+                                          msg_ptr[e] + j))),
+            neg_max);
+        const __m256i mag = _mm256_abs_epi8(q[e]);
+        min2 = _mm256_min_epi8(min2, _mm256_max_epi8(min1, mag));
+        min1 = _mm256_min_epi8(min1, mag);
+        sign = _mm256_xor_si256(sign, q[e]);
+      }
+
+      // Normalized min-sum: scale the magnitudes by 3/4
+      const __m256i scaled_min1 = _mm256_sub_epi8(
+          min1, _mm256_and_si256(_mm256_srli_epi16(min1, 2), low6_mask));
+      const __m256i scaled_min2 = _mm256_sub_epi8(
+          min2, _mm256_and_si256(_mm256_srli_epi16(min2, 2), low6_mask));
+
+      // New check-to-variable messages, and the updated posteriors
+      for (size_t e = 0; e < degree; e++) {
+        const __m256i is_min =
+            _mm256_cmpeq_epi8(_mm256_abs_epi8(q[e]), min1);
+        const __m256i mag =
+            _mm256_blendv_epi8(scaled_min1, scaled_min2, is_min);
+        const __m256i msg_sign =
+            _mm256_or_si256(_mm256_xor_si256(sign, q[e]), one);
+        const __m256i msg = _mm256_sign_epi8(mag, msg_sign);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(msg_ptr[e] + j), msg);
+        const __m256i app =
+            _mm256_max_epi8(_mm256_adds_epi8(q[e], msg), neg_max);
+        // Lanes past Zc would overwrite other LLRs of the column, so the
+        // last partial chunk keeps the old values there
+        for (int8_t* dst = col_ptr[e] + j - zc_;
+             dst <= col_ptr[e] + j + zc_; dst += zc_) {
+          auto* ptr = reinterpret_cast<__m256i*>(dst);
+          _mm256_storeu_si256(
+              ptr, partial ? _mm256_blendv_epi8(_mm256_loadu_si256(ptr), app,
+                                                valid)
+                           : app);
+        }
+      }
+    }
+  }
+
+  // Return true if the hard decisions satisfy every parity check
+  bool CheckParity() const {
+    for (size_t row = 0; row < num_rows_; row++) {
+      const size_t first_edge = graph_.row_start_[row];
+      const size_t last_edge = graph_.row_start_[row + 1];
+      for (size_t j = 0; j < zc_pad_; j += kLanes) {
+        __m256i parity = _mm256_setzero_si256();
+        for (size_t e = first_edge; e < last_edge; e++) {
+          const Edge& edge = graph_.edges_[e];
+          const int8_t* ptr = llrs_ + edge.col_ * col_stride_ + zc_ +
+                              (edge.shift_ % zc_) + j;
+          parity = _mm256_xor_si256(
+              parity,
+              _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ptr)));
+        }
+        if ((static_cast<uint32_t>(_mm256_movemask_epi8(parity)) &
+             FirstLanes(zc_ - j)) != 0) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  // Write the hard decisions of the first [num_bits] bits, LSB first
+  void HardDecide(uint8_t* out, size_t num_bits) const {
+    uint64_t bits = 0;
+    size_t num_pending = 0;
+    size_t num_done = 0;
+    for (size_t col = 0; num_done < num_bits; col++) {
+      // The shifted stores keep the second and third copies up to date
+      const int8_t* col_llrs = llrs_ + col * col_stride_ + zc_;
+      for (size_t j = 0; (j < zc_) && (num_done < num_bits); j += kLanes) {
+        const size_t n = std::min({kLanes, zc_ - j, num_bits - num_done});
+        const auto signs = static_cast<uint32_t>(_mm256_movemask_epi8(
+            _mm256_loadu_si256(
+                reinterpret_cast<const __m256i*>(col_llrs + j))));
+        bits |= static_cast<uint64_t>(signs & FirstLanes(n))
+                << num_pending;
+        num_pending += n;
+        num_done += n;
+        while (num_pending >= 8) {
+          *out++ = static_cast<uint8_t>(bits);
+          bits >>= 8;
+          num_pending -= 8;
+        }
+      }
+    }
+    if (num_pending > 0) {
+      *out = static_cast<uint8_t>(bits);
+    }
+  }
+
+ private:
+  // Return the right shift that brings the mean magnitude of the [num_llrs]
+  // channel LLRs within kMaxMeanChannelLlr
+  static size_t ChannelLlrShift(const int8_t* llrs, size_t num_llrs) {
+    // Four 64-bit sums of absolute values
+    __m256i sums = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + kLanes <= num_llrs; i += kLanes) {
+      const __m256i mag = _mm256_abs_epi8(
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(llrs + i)));
+      sums = _mm256_add_epi64(sums,
+                              _mm256_sad_epu8(mag, _mm256_setzero_si256()));
+    }
+    alignas(32) uint64_t lanes[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), sums);
+    size_t sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    for (; i < num_llrs; i++) {
+      sum += static_cast<size_t>(std::abs(static_cast<int>(llrs[i])));
+    }
+    size_t shift = 0;
+    while ((shift < 7) && ((sum >> shift) > kMaxMeanChannelLlr * num_llrs)) {
+      shift++;
+    }
+    return shift;
+  }
+
+  const BaseGraph& graph_;
+  const size_t zc_;
+  const size_t zc_pad_;
+  const size_t col_stride_;
+  const size_t num_rows_;
+
+  // Posterior LLRs and check-to-variable messages of the calling thread
+  alignas(32) static thread_local int8_t llrs_[BG1_COL_TOTAL * kMaxColStride];
+  alignas(32) static thread_local int8_t msgs_[kMaxNumEdges * kZcMax];
+};
+
+alignas(32) thread_local int8_t
+    LayeredDecoder::llrs_[BG1_COL_TOTAL * kMaxColStride];
+alignas(32) thread_local int8_t LayeredDecoder::msgs_[kMaxNumEdges * kZcMax];
+
+int32_t BblibLdpcDecoder5gnr(
+    struct bblib_ldpc_decoder_5gnr_request* request,
+    struct bblib_ldpc_decoder_5gnr_response* response) {
+  const size_t zc = request->Zc;
+  const size_t base_graph = request->baseGraph;
+  const auto num_rows = static_cast<size_t>(request->nRows);
+  const size_t max_rows = (base_graph == 1) ? BG1_ROW_TOTAL : BG2_ROW_TOTAL;
+  if ((zc < 2) || (zc > kZcMax)) {
+    std::fprintf(stderr, "Error: The AVX2 decoder supports 2 <= Zc <= %zu\n",
+                 kZcMax);
+    throw std::runtime_error("Decoder: Zc not supported");
+  }
+  if (((base_graph != 1) && (base_graph != 2)) || (num_rows < 4) ||
+      (num_rows > max_rows)) {
+    throw std::runtime_error("Decoder: invalid base graph or nRows");
+  }
+  if (request->numFillerBits != 0) {
+    throw std::runtime_error("Decoder: filler bits are not supported");
+  }
+
+  const size_t num_inf_cols =
+      (base_graph == 1) ? BG1_COL_INF_NUM : BG2_COL_INF_NUM;
+  LayeredDecoder decoder(GetBaseGraph(base_graph, SelectShiftSet(zc)), zc,
+                         num_rows);
+  decoder.Init(request->varNodes,
+               std::max<int16_t>(request->numChannelLlrs, 0),
+               num_inf_cols + num_rows);
+
+  int32_t iter = 0;
+  bool parity_passed = false;
+  bool parity_checked = false;
+  while (iter < request->maxIterations) {
+    for (size_t row = 0; row < num_rows; row++) {
+      decoder.ProcessLayer(row);
+    }
+    iter++;
+    if (request->enableEarlyTermination) {
+      parity_passed = decoder.CheckParity();
+      parity_checked = true;
+      if (parity_passed) {
+        break;
+      }
+    } else {
+      parity_checked = false;
+    }
+  }
+  if (!parity_checked) {
+    parity_passed = decoder.CheckParity();
+  }
+
+  decoder.HardDecide(response->compactedMessageBytes,
+                     std::max<int16_t>(response->numMsgBits, 0));
+  response->iterationAtTermination = iter;
+  response->parityPassedAtTermination = parity_passed;
+  return 0;
+}
+}  // namespace avx2dec
@@ -0,0 +1,41 @@
+/**
+ * @file decoder.h
+ * @brief Definitions for Agora's AVX2-based LDPC decoder.
+ *
+ * A layered normalized min-sum decoder for 5G NR base graphs 1 and 2, for
+ * hosts where FlexRAN's decoder library is unavailable. It takes FlexRAN's
+ * decoder request and response structs, so it can replace
+ * bblib_ldpc_decoder_5gnr() without changes to the callers.
+ */
+#ifndef DECODER_H_
+#define DECODER_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "phy_ldpc_decoder_5gnr.h"
+
+namespace avx2dec {
+
+// Maximum 5G NR LDPC expansion factor (Zc) supported by the AVX2 decoder
+static constexpr size_t kZcMax = 384;
+
+// Number of int8 LLRs (one per Zc lane) processed by one AVX2 instruction
+static constexpr size_t kLanes = 32;
+
+/**
+ * @brief Decode one code block.
+ *
+ * The decoder reads request->numChannelLlrs int8 LLRs from request->varNodes,
+ * starting at the first non-punctured column. A positive LLR means bit 0.
+ * It writes the hard-decided information bits, including the punctured
+ * ones, to response->compactedMessageBytes (LSB first), and sets
+ * response->iterationAtTermination and
+ * response->parityPassedAtTermination. response->varNodes is not written.
+ * Filler bits are not supported.
+ */
+int32_t BblibLdpcDecoder5gnr(struct bblib_ldpc_decoder_5gnr_request* request,
+                             struct bblib_ldpc_decoder_5gnr_response* response);
+}  // namespace avx2dec
+
+#endif  // DECODER_H_
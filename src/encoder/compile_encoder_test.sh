@@ -8,8 +8,9 @@ CPU_FEATURES_DETECT_AVX512=`cat /proc/cpuinfo | grep avx512 | wc -l`
 
 compile_with_agora_encoder() {
   g++ -std=c++17 -mavx2 -Wall -DUSE_AVX2_ENCODER \
-    -I. \
+    -I. -I../decoder \
     -isystem ${FLEXRAN_FEC_SDK_DIR}/source/phy/lib_ldpc_encoder_5gnr \
+    -isystem ${FLEXRAN_FEC_SDK_DIR}/source/phy/lib_ldpc_decoder_5gnr \
     -isystem ${FLEXRAN_FEC_SDK_DIR}/source/phy/lib_common \
     ${SOURCES} -o test_avx2
 }
@@ -18,8 +19,9 @@ compile_with_flexran_encoder() {
   FLEXRAN_FEC_LIB_DIR=${FLEXRAN_FEC_SDK_DIR}/build-avx512-icc
   g++ -g -std=c++17 -march=native -Wall -no-pie \
     -D_BBLIB_AVX512_ \
-    -I. \
+    -I. -I../decoder \
     -isystem ${FLEXRAN_FEC_SDK_DIR}/source/phy/lib_ldpc_encoder_5gnr \
+    -isystem ${FLEXRAN_FEC_SDK_DIR}/source/phy/lib_ldpc_decoder_5gnr \
     -isystem ${FLEXRAN_FEC_SDK_DIR}/source/phy/lib_common \
     ${SOURCES} -o test_avx512 \
     ${FLEXRAN_FEC_LIB_DIR}/source/phy/lib_ldpc_encoder_5gnr/libldpc_encoder_5gnr.a \
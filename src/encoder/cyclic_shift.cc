@@ -8,6 +8,7 @@
 #include <cstring> /* std::strerror, std::memset, std::memcpy */
 
 namespace avx2enc {
+// Each 64-bit lane holds the Zc bits of a different code block
 inline __m256i CycleBitShift2to64(__m256i data, int16_t cyc_shift, int16_t zc) {
   __m256i x1;
   __m256i x2;
@@ -21,7 +22,7 @@ inline __m256i CycleBitShift2to64(__m256i data, int16_t cyc_shift, int16_t zc) {
     e0 = (1UL << zc) - 1;
   }
 
-  bit_mask = _mm256_set_epi64x(0, 0, 0, e0);
+  bit_mask = _mm256_set1_epi64x(e0);
   data = _mm256_and_si256(data, bit_mask);
 
   x1 = _mm256_srli_epi64(data, cyc_shift);
@@ -33,69 +34,49 @@ inline __m256i CycleBitShift2to64(__m256i data, int16_t cyc_shift, int16_t zc) {
   return x1;
 }
 
+// Byte shuffle mask that rotates the first [zc_in_bytes] bytes of each
+// 128-bit lane left by [byte_shift] bytes, and zeroes the rest of the lane
+static inline __m256i RotateBytesMask(int byte_shift, int zc_in_bytes) {
+  const __m256i byte_idx = _mm256_setr_epi8(
+      0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5,
+      6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+  const __m256i num_bytes = _mm256_set1_epi8(static_cast<int8_t>(zc_in_bytes));
+  __m256i src_idx =
+      _mm256_add_epi8(byte_idx, _mm256_set1_epi8(static_cast<int8_t>(
+                                    byte_shift % zc_in_bytes)));
+  // Wrap around the end of the Zc bits
+  src_idx = _mm256_sub_epi8(
+      src_idx,
+      _mm256_andnot_si256(_mm256_cmpgt_epi8(num_bytes, src_idx), num_bytes));
+  // Bytes past the Zc bits select nothing
+  return _mm256_or_si256(src_idx, _mm256_cmpgt_epi8(
+                                      _mm256_add_epi8(byte_idx,
+                                                      _mm256_set1_epi8(1)),
+                                      num_bytes));
+}
+
+// Each 128-bit lane holds the Zc bits of a different code block
 inline __m256i CycleBitShift72to128(__m256i data, int16_t cyc_shift,
                                     int16_t zc) {
-  /* when zc is 88 or 104 or 120 */
-  int8_t shuffle_table[9][32] = {
-      {0, 1, 2,  3,  4,  5,  6,  7,  8,  0,  1,  2,  3,  4,  5,  6,
-       7, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},  // 72
-      {0, 1, 2, 3, 4,  5,  6,  7,  8,  9,  0,  1,  2,  3,  4,  5,
-       6, 7, 8, 9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},  // 80
-      {0, 1, 2, 3, 4, 5,  6,  7,  8,  9,  10, 0,  1,  2,  3,  4,
-       5, 6, 7, 8, 9, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},  // 88
-      {0, 1, 2, 3, 4, 5, 6,  7,  8,  9,  10, 11, 0,  1,  2,  3,
-       4, 5, 6, 7, 8, 9, 10, 11, -1, -1, -1, -1, -1, -1, -1, -1},  // 96
-      {0, 1, 2, 3, 4, 5, 6, 7,  8,  9,  10, 11, 12, 0,  1,  2,
-       3, 4, 5, 6, 7, 8, 9, 10, 11, 12, -1, -1, -1, -1, -1, -1},  // 104
-      {0, 1, 2, 3, 4, 5, 6, 7, 8,  9,  10, 11, 12, 13, 0,  1,
-       2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, -1, -1, -1, -1},  // 112
-      {0, 1, 2, 3, 4, 5, 6, 7, 8, 9,  10, 11, 12, 13, 14, 0,
-       1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, -1, -1},  // 120
-      {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
-       0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},  // 128
-      {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-       0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},  // padding to avoid memory
-                                                      // overrun
-  };
-
-  __m256i x0;
-  __m256i x2;
-  __m256i bit_mask;
-  __m256i shift_mask0;
-  int64_t e0;
-  int zc_in_bytes = zc >> 3;
-  auto* p_out = reinterpret_cast<uint8_t*>(&x2);
-
-  int right_shift = cyc_shift % zc;
-  int byte_shift = right_shift >> 3;
-  int bit_shift = right_shift - (byte_shift << 3);
-  int zc_index = (zc >> 3) - 9;
-
-  shift_mask0 =
-      _mm256_loadu_si256((__m256i*)(shuffle_table[zc_index] + byte_shift));
-
-  // shift by bytes
-  x0 = _mm256_shuffle_epi8(data, shift_mask0);
-
-  // shift remaining memcpybits
-  auto* p_data = reinterpret_cast<uint8_t*>(&x0);
-  p_out[zc_in_bytes - 1] =
-      (p_data[zc_in_bytes - 1] >> bit_shift) | (p_data[0] << (8 - bit_shift));
-  for (int i = 0; i < zc_in_bytes - 1; i++) {
-    p_out[i] = (p_data[0] >> bit_shift) | (p_data[1] << (8 - bit_shift));
-    p_data++;
-  }
-
-  // zero out the bits outside zc range in the output
-  if (zc >= 128) {
-    e0 = 0xffffffffffffffff;
-  } else {
-    e0 = (1UL << (zc - 64)) - 1;
-  }
-  bit_mask = _mm256_set_epi64x(0, 0, e0, 0xffffffffffffffff);
-  x2 = _mm256_and_si256(x2, bit_mask);
-
-  return x2;
+  /* zc in this range is always a multiple of 8 */
+  const int zc_in_bytes = zc >> 3;
+  const int right_shift = cyc_shift % zc;
+  const int byte_shift = right_shift >> 3;
+  const int bit_shift = right_shift & 0x7;
+
+  // Output byte i takes the high bits of input byte (i + byte_shift) and the
+  // low bits of the input byte after it
+  const __m256i x0 =
+      _mm256_shuffle_epi8(data, RotateBytesMask(byte_shift, zc_in_bytes));
+  const __m256i x1 =
+      _mm256_shuffle_epi8(data, RotateBytesMask(byte_shift + 1, zc_in_bytes));
+  const __m256i lo = _mm256_and_si256(
+      _mm256_srli_epi16(x0, bit_shift),
+      _mm256_set1_epi8(static_cast<int8_t>(0xff >> bit_shift)));
+  const __m256i hi = _mm256_and_si256(
+      _mm256_slli_epi16(x1, 8 - bit_shift),
+      _mm256_set1_epi8(static_cast<int8_t>(0xff << (8 - bit_shift))));
+  return _mm256_or_si256(lo, hi);
 }
 
 inline __m256i CycleBitShift144to256(__m256i data, int16_t cyc_shift,
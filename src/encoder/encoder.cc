@@ -7,6 +7,9 @@
  */
 #include "encoder.h"
 
+#include <algorithm>
+#include <cstring>
+
 #include "common_typedef_sdk.h"
 #include "cyclic_shift.h"
 #include "iobuffer.h"
@@ -299,16 +302,43 @@ int32_t BblibLdpcEncoder5gnr(
   int8_t input_internal_buffer[BG1_COL_TOTAL * avx2enc::kProcBytes] = {0};
   __attribute__((aligned(64)))
   int8_t parity_internal_buffer[BG1_ROW_TOTAL * avx2enc::kProcBytes] = {0};
+  // One code block's kProcBytes-sized chunks, before they are interleaved
+  // into (or after they are extracted from) their lane of the chunks above
+  __attribute__((aligned(64)))
+  int8_t lane_internal_buffer[BG1_COL_TOTAL * avx2enc::kProcBytes] = {0};
 
   avx2enc::LDPC_ADAPTER_P ldpc_adapter_func =
       avx2enc::LdpcSelectAdapterFunc(zc);
   auto ldpc_encoder_func =
       (bg == 1 ? avx2enc::LdpcEncoderBg1 : avx2enc::LdpcEncoderBg2);
 
-  for (int n = 0; n < number_codeblocks; n++) {
+  // The cyclic shifts and XORs work on each lane independently, so the
+  // code blocks of a group are encoded together. Lanes left over in the
+  // last group encode stale data that is never gathered.
+  const size_t num_lanes = NumCodeblockLanes(zc);
+  const size_t lane_bytes = kProcBytes / num_lanes;
+  const size_t num_input_chunks = cb_len / zc;
+  const size_t num_parity_chunks = cb_enc_len / zc;
+  for (int first = 0; first < number_codeblocks;
+       first += static_cast<int>(num_lanes)) {
+    const size_t group_size =
+        std::min(num_lanes, static_cast<size_t>(number_codeblocks - first));
+
     // Scatter Zc-bit chunks of the input into kProcBytes-sized chunks
     // of input_internal_buffer
-    ldpc_adapter_func(input[n], input_internal_buffer, zc, cb_len, 1);
+    if (num_lanes == 1) {
+      ldpc_adapter_func(input[first], input_internal_buffer, zc, cb_len, 1);
+    } else {
+      for (size_t lane = 0; lane < group_size; lane++) {
+        ldpc_adapter_func(input[first + lane], lane_internal_buffer, zc,
+                          cb_len, 1);
+        for (size_t i = 0; i < num_input_chunks; i++) {
+          std::memcpy(input_internal_buffer + i * kProcBytes +
+                          lane * lane_bytes,
+                      lane_internal_buffer + i * kProcBytes, lane_bytes);
+        }
+      }
+    }
 
     // Encode into parity_internal_buffer
     ldpc_encoder_func(input_internal_buffer, parity_internal_buffer,
@@ -317,7 +347,21 @@ int32_t BblibLdpcEncoder5gnr(
 
     // Gather parity bits from kProcBytes-sized chunks of
     // parity_internal_buffer
-    ldpc_adapter_func(parity[n], parity_internal_buffer, zc, cb_enc_len, 0);
+    if (num_lanes == 1) {
+      ldpc_adapter_func(parity[first], parity_internal_buffer, zc, cb_enc_len,
+                        0);
+    } else {
+      for (size_t lane = 0; lane < group_size; lane++) {
+        for (size_t i = 0; i < num_parity_chunks; i++) {
+          std::memcpy(lane_internal_buffer + i * kProcBytes,
+                      parity_internal_buffer + i * kProcBytes +
+                          lane * lane_bytes,
+                      lane_bytes);
+        }
+        ldpc_adapter_func(parity[first + lane], lane_internal_buffer, zc,
+                          cb_enc_len, 0);
+      }
+    }
   }
 
   return 0;
@@ -20,6 +20,23 @@ namespace avx2enc {
 static constexpr size_t kZcMax = 255;
 
 static constexpr size_t kProcBytes = 32;
+
+// Number of code blocks encoded side by side in each kProcBytes chunk: one
+// per 64-bit lane for Zc <= 64, and one per 128-bit lane for Zc <= 128
+static inline size_t NumCodeblockLanes(size_t zc) {
+  if (zc <= 64) {
+    return 4;
+  } else if (zc <= 128) {
+    return 2;
+  }
+  return 1;
+}
+
+/**
+ * @brief Encode request->numberCodeblocks code blocks with the same base
+ * graph and Zc. Up to NumCodeblockLanes(Zc) of them are encoded together, one
+ * per SIMD lane.
+ */
 int32_t BblibLdpcEncoder5gnr(struct bblib_ldpc_encoder_5gnr_request* request,
                              struct bblib_ldpc_encoder_5gnr_response* response);
 };  // namespace avx2enc
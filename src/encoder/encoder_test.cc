@@ -5,6 +5,7 @@
 #include "encoder.h"
 
 #include <algorithm>
+#include <chrono>
 #include <fstream>
 #include <vector>
 
@@ -12,6 +13,9 @@
 #include "gcc_phy_ldpc_encoder_5gnr_internal.h"
 
 static constexpr size_t kNumCodeBlocks = 1;
+// Code blocks encoded per batched encoder call in the throughput test
+static constexpr size_t kBatchSize = 4;
+static constexpr size_t kNumThroughputIters = 2000;
 
 char* read_binfile(std::string filename, int buffer_size) {
   std::ifstream infile;
@@ -28,7 +32,8 @@ char* read_binfile(std::string filename, int buffer_size) {
   return x;
 }
 
-void run_test(size_t base_graph, size_t zc) {
+// Return true if the parity bits of all code blocks match the reference
+bool run_test(size_t base_graph, size_t zc) {
   const std::string bg_string = base_graph == 1 ? "BG1" : "BG2";
   const std::string zc_string = std::string("Zc") + std::to_string(zc);
   const std::string input_filename =
@@ -52,11 +57,13 @@ void run_test(size_t base_graph, size_t zc) {
                      parity[n], input[n]);
   }
 
+  bool passed = true;
   for (size_t n = 0; n < kNumCodeBlocks; n++) {
     if (std::memcmp(parity[n], parity_reference[n],
                     BitsToBytes(LdpcMaxNumParityBits(base_graph, zc))) != 0) {
       std::fprintf(stderr, "Mismatch for Zc = %zu, base graph = %zu\n", zc,
                    base_graph);
+      passed = false;
     } else {
       std::printf("Passed for Zc = %zu, base graph = %zu\n", zc, base_graph);
     }
@@ -68,6 +75,74 @@ void run_test(size_t base_graph, size_t zc) {
     delete[] encoded[n];
     delete[] parity_reference[n];
   }
+  return passed;
+}
+
+// Compare the throughput of encoding kBatchSize code blocks one at a time and
+// with one batched encoder call. Return true if both produce the same parity.
+bool run_throughput_test(size_t base_graph, size_t zc) {
+  const size_t num_rows = LdpcMaxNumRows(base_graph);
+  std::vector<std::vector<int8_t>> input(kBatchSize);
+  std::vector<std::vector<int8_t>> parity(kBatchSize);
+  std::vector<std::vector<int8_t>> encoded(kBatchSize);
+  int8_t* input_ptrs[kBatchSize];
+  int8_t* parity_ptrs[kBatchSize];
+  int8_t* encoded_ptrs[kBatchSize];
+  for (size_t n = 0; n < kBatchSize; n++) {
+    input[n].resize(LdpcEncodingInputBufSize(base_graph, zc));
+    for (auto& byte : input[n]) {
+      byte = static_cast<int8_t>(rand());
+    }
+    parity[n].resize(LdpcEncodingParityBufSize(base_graph, zc));
+    encoded[n].resize(LdpcEncodingEncodedBufSize(base_graph, zc));
+    input_ptrs[n] = input[n].data();
+    parity_ptrs[n] = parity[n].data();
+    encoded_ptrs[n] = encoded[n].data();
+  }
+
+  std::vector<std::vector<int8_t>> parity_reference(kBatchSize);
+  for (size_t n = 0; n < kBatchSize; n++) {
+    parity_reference[n].resize(parity[n].size());
+    LdpcEncodeHelper(base_graph, zc, num_rows, encoded_ptrs[n],
+                     parity_reference[n].data(), input_ptrs[n]);
+  }
+
+  double us[2];
+  for (size_t batched = 0; batched < 2; batched++) {
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t iter = 0; iter < kNumThroughputIters; iter++) {
+      if (batched == 1) {
+        LdpcEncodeBatchHelper(base_graph, zc, num_rows, kBatchSize,
+                              encoded_ptrs, parity_ptrs, input_ptrs);
+      } else {
+        for (size_t n = 0; n < kBatchSize; n++) {
+          LdpcEncodeHelper(base_graph, zc, num_rows, encoded_ptrs[n],
+                           parity_ptrs[n], input_ptrs[n]);
+        }
+      }
+    }
+    us[batched] = std::chrono::duration<double, std::micro>(
+                      std::chrono::steady_clock::now() - start)
+                      .count();
+  }
+
+  bool passed = true;
+  for (size_t n = 0; n < kBatchSize; n++) {
+    if (parity[n] != parity_reference[n]) {
+      std::fprintf(stderr,
+                   "Batched encoding mismatch for Zc = %zu, base graph = %zu\n",
+                   zc, base_graph);
+      passed = false;
+    }
+  }
+
+  const double num_bits = static_cast<double>(
+      LdpcNumInputBits(base_graph, zc) * kBatchSize * kNumThroughputIters);
+  std::printf(
+      "Throughput for Zc = %zu, base graph = %zu: %.1f Mbps one code block "
+      "at a time, %.1f Mbps %zu code blocks per call\n",
+      zc, base_graph, num_bits / us[0], num_bits / us[1], kBatchSize);
+  return passed;
 }
 
 int main() {
@@ -82,6 +157,8 @@ int main() {
   // For some expansion factors, we don't have input and reference files yet
   const std::vector<size_t> zc_nofiles_vec = {2, 3, 4, 5, 6, 9, 13};
 
+  bool passed = true;
+
   for (const size_t& zc : zc_all_vec) {
     if (zc < LdpcGetMinZc() || zc > LdpcGetMaxZc()) {
       std::fprintf(stderr, "Zc value %zu not supported. Skipping.\n", zc);
@@ -94,8 +171,19 @@ int main() {
 
     if (!no_files) {
       std::printf("Running for zc = %zu\n", zc);
-      run_test(1 /* base graph */, zc);
-      run_test(2 /* base graph */, zc);
+      passed &= run_test(1 /* base graph */, zc);
+      passed &= run_test(2 /* base graph */, zc);
+    }
+  }
+
+  for (const size_t& zc : zc_all_vec) {
+    // LdpcEncodeHelper supports Zc >= 64 only if it is a multiple of four
+    if (zc < LdpcGetMinZc() || zc > LdpcGetMaxZc() ||
+        (zc >= 64 && zc % 4 != 0)) {
+      continue;
     }
+    passed &= run_throughput_test(1 /* base graph */, zc);
+    passed &= run_throughput_test(2 /* base graph */, zc);
   }
+  return passed ? 0 : 1;
 }
\ No newline at end of file
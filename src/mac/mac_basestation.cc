@@ -98,7 +98,7 @@ int main(int argc, char* argv[]) {
                       std::placeholders::_1),
             thread_start, FLAGS_num_sender_worker_threads,
             FLAGS_num_sender_update_threads, FLAGS_frame_duration, 0,
-            FLAGS_enable_slow_start, true);
+            FLAGS_enable_slow_start, true, cfg->MacThreadNum());
         thread_start += k_num_total_sender_threads;
         sender->StartTXfromMain(frame_start, frame_end);
       }
@@ -0,0 +1,34 @@
+/**
+ * @file mac_log.cc
+ * @brief Implementation file for the MacLog class
+ */
+#include "mac_log.h"
+
+#include "utils.h"
+
+MacLog::MacLog(const std::string& filename, const std::string& name,
+               double freq_ghz)
+    : filename_(filename) {
+  file_ = std::fopen(filename_.c_str(), "wb");
+  RtAssert(file_ != nullptr, "Failed to open MAC log file");
+
+  FileHeader header;
+  std::memset(&header, 0, sizeof(FileHeader));
+  header.magic_ = kMagic;
+  header.version_ = kVersion;
+  header.freq_ghz_ = freq_ghz;
+  header.start_tsc_ = GetTime::Rdtsc();
+  std::strncpy(header.name_, name.c_str(), kMaxNameLength - 1);
+  RtAssert(std::fwrite(&header, sizeof(FileHeader), 1, file_) == 1,
+           "Failed to write MAC log file header");
+}
+
+MacLog::~MacLog() {
+  // Records still queued refer to file_
+  AsyncLogger::FlushIfRunning();
+  std::fclose(file_);
+}
+
+void MacLog::Consume(void* sink, const uint8_t* data, size_t len) {
+  std::fwrite(data, 1, len, static_cast<FILE*>(sink));
+}
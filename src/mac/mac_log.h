@@ -0,0 +1,160 @@
+/**
+ * @file mac_log.h
+ * @brief Declaration file for the MacLog class, the binary packet log written
+ * by the MAC threads.
+ *
+ * Records are copied into the AsyncLogger ring of the MAC thread and written
+ * to the log file by the drain thread, so the PHY-to-MAC path never formats
+ * text or touches the file. Use mac_log_decoder to print a log as text.
+ */
+#ifndef MAC_LOG_H_
+#define MAC_LOG_H_
+
+#include <sys/uio.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "async_logger.h"
+#include "gettime.h"
+
+class MacLog {
+ public:
+  // "AGMACLOG" in little-endian byte order
+  static constexpr uint64_t kMagic = 0x474f4c43414d4741ull;
+  static constexpr uint32_t kVersion = 1;
+  static constexpr size_t kMaxNameLength = 32;
+
+  enum class RecordType : uint16_t {
+    kRxFromPhy,  // Decoded MAC packet received from the PHY
+    kTxToApp,    // Reassembled frame sent to the application
+    kRxFromApp,  // Frame of MAC packets received from the application
+    kTxToPhy     // MAC packet handed to the PHY
+  };
+
+  struct FileHeader {
+    uint64_t magic_;
+    uint32_t version_;
+    uint32_t reserved_;
+    double freq_ghz_;  // RDTSC frequency, to convert record timestamps
+    uint64_t start_tsc_;
+    char name_[kMaxNameLength];  // Name of the MAC thread that wrote the log
+  };
+
+  /// Precedes every record in the file. [length_] bytes of the record
+  /// struct identified by [type_] follow, then its payload bytes.
+  struct RecordHeader {
+    uint64_t tsc_;
+    uint16_t type_;
+    uint16_t reserved_;
+    uint32_t length_;
+  };
+
+  struct RxFromPhy {
+    static constexpr RecordType kType = RecordType::kRxFromPhy;
+    uint32_t frame_id_;
+    uint16_t symbol_id_;
+    uint16_t ue_id_;
+    // Header fields of the received packet
+    uint16_t pkt_frame_;
+    uint16_t pkt_symbol_;
+    uint16_t pkt_ue_;
+    uint16_t pkt_payload_length_;
+    uint16_t pkt_crc_;
+    uint16_t max_payload_length_;
+    uint32_t frame_data_offset_;
+    uint8_t valid_;  // 0 if the packet failed the data integrity check
+    uint8_t reserved_[7];
+  };
+
+  struct TxToApp {
+    static constexpr RecordType kType = RecordType::kTxToApp;
+    uint32_t frame_id_;
+    uint16_t ue_id_;
+    uint16_t reserved_;
+    uint32_t size_;
+    uint32_t max_size_;
+  };
+
+  struct RxFromApp {
+    static constexpr RecordType kType = RecordType::kRxFromApp;
+    uint32_t frame_id_;
+    uint16_t ue_id_;
+    uint16_t reserved_;
+    uint32_t size_;
+    uint32_t reserved2_;
+  };
+
+  struct TxToPhy {
+    static constexpr RecordType kType = RecordType::kTxToPhy;
+    uint32_t frame_id_;
+    uint16_t pkt_id_;
+    uint16_t ue_id_;
+    uint16_t symbol_id_;
+    uint16_t payload_length_;
+    uint16_t max_payload_length_;
+    uint16_t radio_buf_id_;
+    uint64_t dest_offset_;
+  };
+
+  MacLog(const std::string& filename, const std::string& name,
+         double freq_ghz);
+  ~MacLog();
+
+  /// Log [record] followed by [payload_len] bytes of [payload]
+  template <typename Record>
+  inline void Write(const Record& record, const void* payload = nullptr,
+                    size_t payload_len = 0) {
+    const RecordHeader header = {GetTime::Rdtsc(),
+                                 static_cast<uint16_t>(Record::kType), 0,
+                                 static_cast<uint32_t>(sizeof(Record) +
+                                                       payload_len)};
+    AsyncLogger::Instance().Log(
+        &MacLog::Consume, file_, sizeof(RecordHeader) + header.length_,
+        [&](uint8_t* data) {
+          std::memcpy(data, &header, sizeof(RecordHeader));
+          std::memcpy(data + sizeof(RecordHeader), &record, sizeof(Record));
+          if (payload_len > 0) {
+            std::memcpy(data + sizeof(RecordHeader) + sizeof(Record), payload,
+                        payload_len);
+          }
+        });
+  }
+
+  /// Log [record] followed by the bytes of the [iovcnt] buffers in [iov]
+  template <typename Record>
+  inline void WriteGather(const Record& record, const struct iovec* iov,
+                          size_t iovcnt) {
+    size_t payload_len = 0;
+    for (size_t i = 0; i < iovcnt; i++) {
+      payload_len += iov[i].iov_len;
+    }
+    const RecordHeader header = {GetTime::Rdtsc(),
+                                 static_cast<uint16_t>(Record::kType), 0,
+                                 static_cast<uint32_t>(sizeof(Record) +
+                                                       payload_len)};
+    AsyncLogger::Instance().Log(
+        &MacLog::Consume, file_, sizeof(RecordHeader) + header.length_,
+        [&](uint8_t* data) {
+          std::memcpy(data, &header, sizeof(RecordHeader));
+          std::memcpy(data + sizeof(RecordHeader), &record, sizeof(Record));
+          uint8_t* dest = data + sizeof(RecordHeader) + sizeof(Record);
+          for (size_t i = 0; i < iovcnt; i++) {
+            std::memcpy(dest, iov[i].iov_base, iov[i].iov_len);
+            dest += iov[i].iov_len;
+          }
+        });
+  }
+
+  inline const std::string& Filename() const { return this->filename_; }
+
+ private:
+  static void Consume(void* sink, const uint8_t* data, size_t len);
+
+  FILE* file_;
+  const std::string filename_;
+};
+
+#endif  // MAC_LOG_H_
@@ -0,0 +1,157 @@
+/**
+ * @file mac_log_decoder.cc
+ * @brief Print a binary MAC log written by MacLog as text
+ */
+#include <gflags/gflags.h>
+
+#include <cinttypes>
+#include <cstdio>
+#include <vector>
+
+#include "mac_log.h"
+
+DEFINE_string(log_file, "data/mac_log_server", "Binary MAC log to decode");
+DEFINE_bool(payload, true, "Print the payload bytes of every record");
+
+static void PrintPayload(const uint8_t* payload, size_t len) {
+  if (FLAGS_payload == false || len == 0) {
+    return;
+  }
+  std::printf("PAYLOAD:\n");
+  for (size_t i = 0; i < len; i++) {
+    std::printf("%u ", payload[i]);
+  }
+  std::printf("\n");
+}
+
+static void PrintPacketHeader(size_t frame, size_t symbol, size_t ue,
+                              size_t length) {
+  std::printf(
+      "Header Info:\nFRAME_ID: %zu\nSYMBOL_ID: %zu\nUE_ID: %zu\nDATLEN: "
+      "%zu\n",
+      frame, symbol, ue, length);
+}
+
+/// Print one record. Returns false if the record is malformed.
+static bool PrintRecord(const MacLog::FileHeader& file_header,
+                        const MacLog::RecordHeader& header,
+                        const uint8_t* data) {
+  const double time_us =
+      GetTime::CyclesToUs(header.tsc_ - file_header.start_tsc_,
+                          file_header.freq_ghz_);
+  std::printf("[%.3f us] %s: ", time_us, file_header.name_);
+
+  switch (static_cast<MacLog::RecordType>(header.type_)) {
+    case MacLog::RecordType::kRxFromPhy: {
+      MacLog::RxFromPhy rec;
+      if (header.length_ < sizeof(rec)) {
+        return false;
+      }
+      std::memcpy(&rec, data, sizeof(rec));
+      std::printf(
+          "Received frame %u:%u symbol %u:%u user %u:%u length %u:%u crc %u "
+          "copied to offset %u\n",
+          rec.pkt_frame_, rec.frame_id_, rec.pkt_symbol_, rec.symbol_id_,
+          rec.pkt_ue_, rec.ue_id_, rec.pkt_payload_length_,
+          rec.max_payload_length_, rec.pkt_crc_, rec.frame_data_offset_);
+      if (rec.valid_ == 0) {
+        std::printf(
+            "  *****Failed Data integrity check - invalid parameters\n");
+      }
+      if (header.length_ > sizeof(rec)) {
+        PrintPacketHeader(rec.pkt_frame_, rec.pkt_symbol_, rec.pkt_ue_,
+                          rec.pkt_payload_length_);
+        PrintPayload(data + sizeof(rec), header.length_ - sizeof(rec));
+      }
+      return true;
+    }
+    case MacLog::RecordType::kTxToApp: {
+      MacLog::TxToApp rec;
+      if (header.length_ < sizeof(rec)) {
+        return false;
+      }
+      std::memcpy(&rec, data, sizeof(rec));
+      std::printf("Sent data for frame %u, ue %u, size %u:%u\n", rec.frame_id_,
+                  rec.ue_id_, rec.size_, rec.max_size_);
+      PrintPayload(data + sizeof(rec), header.length_ - sizeof(rec));
+      return true;
+    }
+    case MacLog::RecordType::kRxFromApp: {
+      MacLog::RxFromApp rec;
+      if (header.length_ < sizeof(rec)) {
+        return false;
+      }
+      std::memcpy(&rec, data, sizeof(rec));
+      std::printf("Received data from app for frame %u, ue %u size %u\n",
+                  rec.frame_id_, rec.ue_id_, rec.size_);
+      PrintPayload(data + sizeof(rec), header.length_ - sizeof(rec));
+      return true;
+    }
+    case MacLog::RecordType::kTxToPhy: {
+      MacLog::TxToPhy rec;
+      if (header.length_ < sizeof(rec)) {
+        return false;
+      }
+      std::memcpy(&rec, data, sizeof(rec));
+      std::printf(
+          "created packet frame %u, pkt %u, size %u radio buff id %u, dest "
+          "offset %" PRIu64 "\n",
+          rec.frame_id_, rec.pkt_id_, rec.max_payload_length_,
+          rec.radio_buf_id_, rec.dest_offset_);
+      PrintPacketHeader(rec.frame_id_, rec.symbol_id_, rec.ue_id_,
+                        rec.payload_length_);
+      PrintPayload(data + sizeof(rec), header.length_ - sizeof(rec));
+      return true;
+    }
+    default:
+      std::printf("Unknown record type %u (%u bytes)\n", header.type_,
+                  header.length_);
+      return true;
+  }
+}
+
+int main(int argc, char* argv[]) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+  FILE* file = std::fopen(FLAGS_log_file.c_str(), "rb");
+  if (file == nullptr) {
+    std::fprintf(stderr, "Failed to open MAC log %s\n",
+                 FLAGS_log_file.c_str());
+    return 1;
+  }
+
+  MacLog::FileHeader file_header;
+  if ((std::fread(&file_header, sizeof(file_header), 1, file) != 1) ||
+      (file_header.magic_ != MacLog::kMagic)) {
+    std::fprintf(stderr, "%s is not a binary MAC log\n",
+                 FLAGS_log_file.c_str());
+    std::fclose(file);
+    return 1;
+  }
+  if (file_header.version_ != MacLog::kVersion) {
+    std::fprintf(stderr, "Unsupported MAC log version %u (expected %u)\n",
+                 file_header.version_, MacLog::kVersion);
+    std::fclose(file);
+    return 1;
+  }
+  file_header.name_[MacLog::kMaxNameLength - 1] = '\0';
+
+  MacLog::RecordHeader header;
+  std::vector<uint8_t> data;
+  size_t num_records = 0;
+  while (std::fread(&header, sizeof(header), 1, file) == 1) {
+    data.resize(header.length_);
+    if ((header.length_ > 0) &&
+        (std::fread(data.data(), header.length_, 1, file) != 1)) {
+      std::fprintf(stderr, "Truncated record %zu\n", num_records);
+      break;
+    }
+    if (PrintRecord(file_header, header, data.data()) == false) {
+      std::fprintf(stderr, "Malformed record %zu\n", num_records);
+      break;
+    }
+    num_records++;
+  }
+  std::fclose(file);
+  return 0;
+}
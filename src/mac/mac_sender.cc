@@ -51,7 +51,8 @@ MacSender::MacSender(Config* cfg, std::string& data_filename,
                      size_t core_offset, size_t worker_thread_num,
                      size_t update_thread_num, size_t frame_duration_us,
                      size_t inter_frame_delay, size_t enable_slow_start,
-                     bool create_thread_for_master)
+                     bool create_thread_for_master,
+                     size_t num_server_rx_ports)
     : cfg_(cfg),
       freq_ghz_(GetTime::MeasureRdtscFreq()),
       ticks_per_usec_(freq_ghz_ * 1e3f),
@@ -66,6 +67,7 @@ MacSender::MacSender(Config* cfg, std::string& data_filename,
       packets_per_frame_(packets_per_frame),
       server_address_(std::move(server_address)),
       server_rx_port_(server_rx_port),
+      num_server_rx_ports_(num_server_rx_ports),
       get_data_symbol_id_(std::move(get_data_symbol_id))
 // end -- Ul / Dl     UE / BS
 {
@@ -323,6 +325,10 @@ void* MacSender::WorkerThread(size_t tid) {
         const uint8_t* mac_packet_location =
             tx_buffers_[TagToTxBuffersIndex(tag)];
 
+        // The server's MAC thread for this UE listens at server_rx_port
+        const size_t server_rx_port =
+            server_rx_port_ + (tag.ue_id_ % num_server_rx_ports_);
+
         // Send the mac data to the data sinc
         for (size_t packet = 0; packet < packets_per_frame_; packet++) {
           ///\todo Use assume_aligned<kTxBufferElementAlignment> when code has
@@ -341,7 +347,7 @@ void* MacSender::WorkerThread(size_t tid) {
           //    tx_packet->symbol_id_, mac_packet_tx_size,
           //    mac_packet_storage_size);
 
-          udp_client.Send(server_address_, server_rx_port_,
+          udp_client.Send(server_address_, server_rx_port,
                           reinterpret_cast<const uint8_t*>(tx_packet),
                           mac_packet_tx_size);
           mac_packet_location += tx_buffer_pkt_offset_;
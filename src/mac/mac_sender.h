@@ -41,6 +41,10 @@ class MacSender {
    *
    * @param enable_slow_start If 1, the sender initially sends frames in a
    * duration larger than the TTI
+   *
+   * @param num_server_rx_ports Frames of UE #i are sent to port
+   * [server_rx_port + (i % num_server_rx_ports)], matching the UE sharding
+   * of the MAC threads at the server
    */
   MacSender(Config* cfg, std::string& data_filename, size_t packets_per_frame,
             std::string server_address, size_t server_rx_port,
@@ -48,7 +52,8 @@ class MacSender {
             size_t core_offset = 30, size_t worker_thread_num = 1,
             size_t update_thread_num = 1, size_t frame_duration_us = 0,
             size_t inter_frame_delay = 0, size_t enable_slow_start = 1,
-            bool create_thread_for_master = false);
+            bool create_thread_for_master = false,
+            size_t num_server_rx_ports = 1);
   ~MacSender();
 
   void StartTx();
@@ -122,6 +127,7 @@ class MacSender {
   size_t packets_per_frame_;
   const std::string server_address_;
   const size_t server_rx_port_;
+  const size_t num_server_rx_ports_;
   std::function<size_t(size_t)> get_data_symbol_id_;
 };
 
@@ -4,13 +4,15 @@
  */
 #include "mac_thread_basestation.h"
 
+#include <algorithm>
+
 #include "logger.h"
 #include "utils_ldpc.h"
 
 static constexpr size_t kUdpRxBufferPadding = 2048u;
 
 MacThreadBaseStation::MacThreadBaseStation(
-    Config* cfg, size_t core_offset,
+    Config* cfg, size_t core_offset, size_t mac_thread_id,
     PtrCube<kFrameWnd, kMaxSymbols, kMaxUEs, int8_t>& decoded_buffer,
     Table<int8_t>* dl_bits_buffer, Table<int8_t>* dl_bits_buffer_status,
     moodycamel::ConcurrentQueue<EventData>* rx_queue,
@@ -20,6 +22,7 @@ MacThreadBaseStation::MacThreadBaseStation(
       freq_ghz_(GetTime::MeasureRdtscFreq()),
       tsc_delta_((cfg_->GetFrameDurationSec() * 1e9) / freq_ghz_),
       core_offset_(core_offset),
+      mac_thread_id_(mac_thread_id),
       decoded_buffer_(decoded_buffer),
       rx_queue_(rx_queue),
       tx_queue_(tx_queue) {
@@ -29,11 +32,19 @@ MacThreadBaseStation::MacThreadBaseStation(
   } else {
     log_filename_ = kDefaultLogFilename;
   }
-  log_file_ = std::fopen(log_filename_.c_str(), "w");
-  RtAssert(log_file_ != nullptr, "Failed to open MAC log file");
+  std::string log_name = "MacThreadBasestation";
+  if (cfg_->MacThreadNum() > 1) {
+    log_filename_ += "_" + std::to_string(mac_thread_id_);
+    log_name += std::to_string(mac_thread_id_);
+  }
+  log_ = std::make_unique<MacLog>(log_filename_, log_name, freq_ghz_);
 
-  MLPD_INFO("MacThreadBaseStation: Frame duration %.2f ms, tsc_delta %zu\n",
-            cfg_->GetFrameDurationSec() * 1000, tsc_delta_);
+  MLPD_INFO(
+      "MacThreadBaseStation %zu: Frame duration %.2f ms, tsc_delta %zu\n",
+      mac_thread_id_, cfg_->GetFrameDurationSec() * 1000, tsc_delta_);
+
+  // The first UE served by this thread
+  next_radio_id_ = mac_thread_id_;
 
   // Set up buffers
   client_.dl_bits_buffer_id_.fill(0);
@@ -41,24 +52,26 @@ MacThreadBaseStation::MacThreadBaseStation(
   client_.dl_bits_buffer_status_ = dl_bits_buffer_status;
 
   server_.n_filled_in_frame_.fill(0);
-  for (size_t ue_ant = 0; ue_ant < cfg_->UeAntTotal(); ue_ant++) {
-    server_.data_size_.emplace_back(
-        std::vector<size_t>(cfg->Frame().NumUlDataSyms()));
+  server_.tx_pending_.fill(false);
+  for (auto& iov : server_.frame_iov_) {
+    iov.resize(cfg_->UlMacPacketsPerframe(), {nullptr, 0});
   }
-
-  for (auto& v : server_.frame_data_) {
-    v.resize(cfg_->UlMacDataBytesNumPerframe());
+  for (auto& tags : server_.pinned_tags_) {
+    tags.reserve(cfg_->Frame().NumULSyms());
   }
+  server_.tx_frames_.reserve(kMaxUEs);
+  server_.tx_frame_ues_.reserve(kMaxUEs);
 
   const size_t udp_pkt_len = cfg_->DlMacDataBytesNumPerframe();
   udp_pkt_buf_.resize(udp_pkt_len + kUdpRxBufferPadding);
 
   // TODO: See if it makes more sense to split up the UE's by port here for
   // client mode.
-  size_t udp_server_port = cfg_->BsMacRxPort();
+  size_t udp_server_port = cfg_->BsMacRxPort() + mac_thread_id_;
   MLPD_INFO(
-      "MacThreadBaseStation: setting up udp server for mac data at port %zu\n",
-      udp_server_port);
+      "MacThreadBaseStation %zu: setting up udp server for mac data at port "
+      "%zu\n",
+      mac_thread_id_, udp_server_port);
   udp_server_ = std::make_unique<UDPServer>(
       udp_server_port, udp_pkt_len * kMaxUEs * kMaxPktsPerUE);
 
@@ -67,27 +80,31 @@ MacThreadBaseStation::MacThreadBaseStation(
 }
 
 MacThreadBaseStation::~MacThreadBaseStation() {
-  std::fclose(log_file_);
+  log_.reset();
   MLPD_INFO("MacThreadBaseStation: MAC thread destroyed\n");
 }
 
 void MacThreadBaseStation::ProcessRxFromPhy() {
-  EventData event;
-  if (rx_queue_->try_dequeue(event) == false) {
-    return;
-  }
-
-  if (event.event_type_ == EventType::kPacketToMac) {
-    MLPD_TRACE("MacThreadBaseStation: MAC thread event kPacketToMac\n");
-    ProcessCodeblocksFromPhy(event);
-  } else if (event.event_type_ == EventType::kSNRReport) {
-    MLPD_TRACE("MacThreadBaseStation: MAC thread event kSNRReport\n");
-    ProcessSnrReportFromPhy(event);
+  std::array<EventData, kRxEventBatchSize> events;
+  const size_t num_events =
+      rx_queue_->try_dequeue_bulk(events.begin(), kRxEventBatchSize);
+
+  for (size_t i = 0; i < num_events; i++) {
+    const EventData& event = events[i];
+    if (event.event_type_ == EventType::kPacketToMac) {
+      MLPD_TRACE("MacThreadBaseStation: MAC thread event kPacketToMac\n");
+      ProcessCodeblocksFromPhy(event);
+    } else if (event.event_type_ == EventType::kSNRReport) {
+      MLPD_TRACE("MacThreadBaseStation: MAC thread event kSNRReport\n");
+      ProcessSnrReportFromPhy(event);
+    }
   }
+  SendFramesToApps();
 }
 
 void MacThreadBaseStation::ProcessSnrReportFromPhy(EventData event) {
   const size_t ue_id = gen_tag_t(event.tags_[0]).ue_id_;
+  assert(cfg_->MacThreadForUe(ue_id) == mac_thread_id_);
   if (server_.snr_[ue_id].size() == kSNRWindowSize) {
     server_.snr_[ue_id].pop();
   }
@@ -123,6 +140,7 @@ void MacThreadBaseStation::ProcessCodeblocksFromPhy(EventData event) {
   const size_t frame_id = gen_tag_t(event.tags_[0]).frame_id_;
   const size_t symbol_id = gen_tag_t(event.tags_[0]).symbol_id_;
   const size_t ue_id = gen_tag_t(event.tags_[0]).ue_id_;
+  assert(cfg_->MacThreadForUe(ue_id) == mac_thread_id_);
   // Helper variables (changes with bs / user)
   const size_t num_pilot_symbols = cfg_->Frame().ClientUlPilotSymbols();
   const size_t symbol_array_index = cfg_->Frame().GetULSymbolIdx(symbol_id);
@@ -134,7 +152,11 @@ void MacThreadBaseStation::ProcessCodeblocksFromPhy(EventData event) {
   const int8_t* src_data =
       decoded_buffer_[(frame_id % kFrameWnd)][symbol_array_index][ue_id];
 
-  std::stringstream ss;  // Debug formatting
+  // frame_iov_ of this UE still describes a frame waiting to be sent
+  if (server_.tx_pending_.at(ue_id)) {
+    SendFramesToApps();
+  }
+  bool pinned = false;
 
   // Only non-pilot data symbols have application data.
   if (symbol_array_index >= num_pilot_symbols) {
@@ -150,25 +172,6 @@ void MacThreadBaseStation::ProcessCodeblocksFromPhy(EventData event) {
     // Who's junk is better? No reason to copy currupted data
     server_.n_filled_in_frame_.at(ue_id) += dest_packet_size;
 
-    ss << "MacThreadBasestation: Received frame " << pkt->Frame() << ":"
-       << frame_id << " symbol " << pkt->Symbol() << ":" << symbol_id
-       << " user " << pkt->Ue() << ":" << ue_id << " length "
-       << pkt->PayloadLength() << ":" << cfg_->MacPayloadMaxLength() << " crc "
-       << pkt->Crc() << " copied to offset " << frame_data_offset << std::endl;
-
-    if (kLogMacPackets) {
-      ss << "Header Info:" << std::endl
-         << "FRAME_ID: " << pkt->Frame() << std::endl
-         << "SYMBOL_ID: " << pkt->Symbol() << std::endl
-         << "UE_ID: " << pkt->Ue() << std::endl
-         << "DATLEN: " << pkt->PayloadLength() << std::endl
-         << "PAYLOAD:" << std::endl;
-      for (size_t i = 0; i < cfg_->MacPayloadMaxLength(); i++) {
-        ss << std::to_string(pkt->Data()[i]) << " ";
-      }
-      ss << std::endl;
-    }
-
     bool data_valid = false;
     // Data validity check
     if ((static_cast<size_t>(pkt->PayloadLength()) <= dest_packet_size) &&
@@ -181,72 +184,118 @@ void MacThreadBaseStation::ProcessCodeblocksFromPhy(EventData event) {
       data_valid = (crc == pkt->Crc());
     }
 
-    if (data_valid) {
-      MLPD_FRAME("%s", ss.str().c_str());
-      /// Spot to be optimized #1
-      std::memcpy(&server_.frame_data_.at(ue_id).at(frame_data_offset),
-                  pkt->Data(), pkt->PayloadLength());
+    MacLog::RxFromPhy rx_log = {};
+    rx_log.frame_id_ = frame_id;
+    rx_log.symbol_id_ = symbol_id;
+    rx_log.ue_id_ = ue_id;
+    rx_log.pkt_frame_ = pkt->Frame();
+    rx_log.pkt_symbol_ = pkt->Symbol();
+    rx_log.pkt_ue_ = pkt->Ue();
+    rx_log.pkt_payload_length_ = pkt->PayloadLength();
+    rx_log.pkt_crc_ = pkt->Crc();
+    rx_log.max_payload_length_ = cfg_->MacPayloadMaxLength();
+    rx_log.frame_data_offset_ = frame_data_offset;
+    rx_log.valid_ = data_valid;
+    // The payload is only kept in the log with kLogMacPackets
+    log_->Write(rx_log, pkt->Data(),
+                kLogMacPackets ? cfg_->MacPayloadMaxLength() : 0);
 
-      server_.data_size_.at(ue_id).at(symbol_array_index - num_pilot_symbols) =
-          pkt->PayloadLength();
+    if (data_valid) {
+      MLPD_FRAME(
+          "MacThreadBasestation: Received frame %d:%zu symbol %d:%zu user "
+          "%d:%zu length %d:%zu crc %d copied to offset %zu\n",
+          pkt->Frame(), frame_id, pkt->Symbol(), symbol_id, pkt->Ue(), ue_id,
+          pkt->PayloadLength(), cfg_->MacPayloadMaxLength(), pkt->Crc(),
+          frame_data_offset);
+      // Gather the payload from decoded_buffer_ when the frame is sent
+      server_.frame_iov_.at(ue_id).at(symbol_array_index - num_pilot_symbols) =
+          {const_cast<unsigned char*>(pkt->Data()), pkt->PayloadLength()};
+      pinned = true;
 
     } else {
-      ss << "  *****Failed Data integrity check - invalid parameters"
-         << std::endl;
-
-      MLPD_ERROR("%s", ss.str().c_str());
+      MLPD_ERROR(
+          "MacThreadBasestation: Received frame %d:%zu symbol %d:%zu user "
+          "%d:%zu length %d:%zu crc %d copied to offset %zu\n  *****Failed "
+          "Data integrity check - invalid parameters\n",
+          pkt->Frame(), frame_id, pkt->Symbol(), symbol_id, pkt->Ue(), ue_id,
+          pkt->PayloadLength(), cfg_->MacPayloadMaxLength(), pkt->Crc(),
+          frame_data_offset);
       // Set the default to 0 valid data bytes
-      server_.data_size_.at(ue_id).at(symbol_array_index - num_pilot_symbols) =
-          0;
+      server_.frame_iov_.at(ue_id).at(symbol_array_index - num_pilot_symbols) =
+          {nullptr, 0};
     }
-    std::fprintf(log_file_, "%s", ss.str().c_str());
-    ss.str("");
   }
 
   // When the frame is full, send it to the application
   if (server_.n_filled_in_frame_.at(ue_id) == max_data_bytes_per_frame) {
     server_.n_filled_in_frame_.at(ue_id) = 0;
-    /// Spot to be optimized #2 -- left shift data over to remove padding
-    bool shifted = false;
-    size_t src_offset = 0;
+    // Drop the packets without valid data from the gather list
+    std::vector<struct iovec>& frame_iov = server_.frame_iov_.at(ue_id);
+    size_t num_iov = 0;
     size_t dest_offset = 0;
     for (size_t packet = 0; packet < num_mac_packets_per_frame; packet++) {
-      const size_t rx_packet_size = server_.data_size_.at(ue_id).at(packet);
-      if (rx_packet_size < cfg_->MacPayloadMaxLength() || (shifted == true)) {
-        shifted = true;
-        if (rx_packet_size > 0) {
-          std::memmove(&server_.frame_data_.at(ue_id).at(dest_offset),
-                       &server_.frame_data_.at(ue_id).at(src_offset),
-                       rx_packet_size);
-        }
+      if (frame_iov.at(packet).iov_len > 0) {
+        dest_offset += frame_iov.at(packet).iov_len;
+        frame_iov.at(num_iov) = frame_iov.at(packet);
+        num_iov++;
       }
-      dest_offset += rx_packet_size;
-      src_offset += cfg_->MacPayloadMaxLength();
     }
 
     if (dest_offset > 0) {
-      udp_client_->Send(kMacRemoteHostname, cfg_->BsMacTxPort() + ue_id,
-                        &server_.frame_data_.at(ue_id).at(0), dest_offset);
+      server_.tx_frames_.push_back(
+          {static_cast<uint16_t>(cfg_->BsMacTxPort() + ue_id), frame_iov.data(),
+           num_iov});
     }
+    server_.tx_frame_ues_.push_back(ue_id);
+    server_.tx_pending_.at(ue_id) = true;
 
-    ss << "MacThreadBasestation: Sent data for frame " << frame_id << ", ue "
-       << ue_id << ", size " << dest_offset << ":" << max_data_bytes_per_frame
-       << std::endl;
+    MacLog::TxToApp tx_log = {};
+    tx_log.frame_id_ = frame_id;
+    tx_log.ue_id_ = ue_id;
+    tx_log.size_ = dest_offset;
+    tx_log.max_size_ = max_data_bytes_per_frame;
+    // The payload is only kept in the log with kLogMacPackets
+    log_->WriteGather(tx_log, frame_iov.data(), kLogMacPackets ? num_iov : 0);
 
     if (kLogMacPackets) {
-      std::fprintf(stdout, "%s", ss.str().c_str());
+      std::printf(
+          "MacThreadBasestation: Sent data for frame %zu, ue %zu, size "
+          "%zu:%zu\n",
+          frame_id, ue_id, dest_offset, max_data_bytes_per_frame);
     }
+  }
 
-    for (size_t i = 0u; i < dest_offset; i++) {
-      ss << std::to_string(server_.frame_data_.at(ue_id).at(i)) << " ";
-    }
-    std::fprintf(log_file_, "%s", ss.str().c_str());
-    ss.str("");
+  if (pinned) {
+    server_.pinned_tags_.at(ue_id).push_back(event.tags_[0]);
+  } else {
+    RtAssert(
+        tx_queue_->enqueue(EventData(EventType::kPacketToMac, event.tags_[0])),
+        "Socket message enqueue failed\n");
+  }
+}
+
+void MacThreadBaseStation::SendFramesToApps() {
+  if (server_.tx_frame_ues_.empty()) {
+    return;
+  }
+  if (server_.tx_frames_.empty() == false) {
+    udp_client_->SendBatch(kMacRemoteHostname, server_.tx_frames_.data(),
+                           server_.tx_frames_.size());
   }
 
-  RtAssert(
-      tx_queue_->enqueue(EventData(EventType::kPacketToMac, event.tags_[0])),
-      "Socket message enqueue failed\n");
+  // The kernel has copied the payloads, so the PHY can reuse the buffers
+  for (size_t ue_id : server_.tx_frame_ues_) {
+    for (size_t tag : server_.pinned_tags_.at(ue_id)) {
+      RtAssert(tx_queue_->enqueue(EventData(EventType::kPacketToMac, tag)),
+               "Socket message enqueue failed\n");
+    }
+    server_.pinned_tags_.at(ue_id).clear();
+    std::fill(server_.frame_iov_.at(ue_id).begin(),
+              server_.frame_iov_.at(ue_id).end(), iovec{nullptr, 0});
+    server_.tx_pending_.at(ue_id) = false;
+  }
+  server_.tx_frames_.clear();
+  server_.tx_frame_ues_.clear();
 }
 
 void MacThreadBaseStation::SendControlInformation() {
@@ -257,8 +306,11 @@ void MacThreadBaseStation::SendControlInformation() {
   udp_client_->Send(cfg_->UeServerAddr(), kMacBaseClientPort + ri.ue_id_,
                     (uint8_t*)&ri, sizeof(RBIndicator));
 
-  // update RAN config within Agora
-  SendRanConfigUpdate(EventData(EventType::kRANUpdate));
+  // update RAN config within Agora. One update per frame is enough, so only
+  // the first MAC thread sends it.
+  if (mac_thread_id_ == 0) {
+    SendRanConfigUpdate(EventData(EventType::kRANUpdate));
+  }
 }
 
 void MacThreadBaseStation::ProcessUdpPacketsFromApps() {
@@ -404,6 +456,13 @@ void MacThreadBaseStation::ProcessUdpPacketsFromAppsBs(const char* payload) {
   if (next_radio_id_ != ue_id) {
     MLPD_ERROR("Error - radio id %zu, expected %zu\n", ue_id, next_radio_id_);
   }
+  if (cfg_->MacThreadForUe(ue_id) != mac_thread_id_) {
+    MLPD_ERROR(
+        "MacThreadBasestation %zu: Dropping frame data for UE %zu, which is "
+        "served by MAC thread %zu\n",
+        mac_thread_id_, ue_id, cfg_->MacThreadForUe(ue_id));
+    return;
+  }
   // End data integrity check
 
   next_radio_id_ = ue_id;
@@ -427,17 +486,11 @@ void MacThreadBaseStation::ProcessUdpPacketsFromAppsBs(const char* payload) {
 #endif
 
   if (kLogMacPackets) {
-    std::stringstream ss;
-    std::fprintf(
-        log_file_,
-        "MacThreadBasestation: Received data from app for frame %zu, ue "
-        "%zu size %zu\n",
-        next_tx_frame_id_, next_radio_id_, pkt_offset);
-
-    for (size_t i = 0; i < pkt_offset; i++) {
-      ss << std::to_string((uint8_t)(payload[i])) << " ";
-    }
-    std::fprintf(log_file_, "%s\n", ss.str().c_str());
+    MacLog::RxFromApp rx_log = {};
+    rx_log.frame_id_ = next_tx_frame_id_;
+    rx_log.ue_id_ = next_radio_id_;
+    rx_log.size_ = pkt_offset;
+    log_->Write(rx_log, payload, pkt_offset);
   }
 
   size_t src_pkt_offset = 0;
@@ -470,26 +523,22 @@ void MacThreadBaseStation::ProcessUdpPacketsFromAppsBs(const char* payload) {
         crc_obj_->CalculateCrc24(pkt->Data(), pkt->PayloadLength()) & 0xFFFF));
 
     if (kLogMacPackets) {
-      std::stringstream ss;
-
-      ss << "MacThreadBasestation: created packet frame " << next_tx_frame_id_
-         << ", pkt " << pkt_id << ", size " << cfg_->MacPayloadMaxLength()
-         << " radio buff id " << radio_buf_id << ", loc " << (size_t)pkt
-         << " dest offset " << dest_pkt_offset << std::endl;
-
-      ss << "Header Info:" << std::endl
-         << "FRAME_ID: " << pkt->Frame() << std::endl
-         << "SYMBOL_ID: " << pkt->Symbol() << std::endl
-         << "UE_ID: " << pkt->Ue() << std::endl
-         << "DATLEN: " << pkt->PayloadLength() << std::endl
-         << "PAYLOAD:" << std::endl;
-      for (size_t i = 0; i < pkt->PayloadLength(); i++) {
-        ss << std::to_string(pkt->Data()[i]) << " ";
-      }
-      ss << std::endl;
-      std::fprintf(stdout, "%s", ss.str().c_str());
-      std::fprintf(log_file_, "%s", ss.str().c_str());
-      ss.str("");
+      MacLog::TxToPhy tx_log = {};
+      tx_log.frame_id_ = next_tx_frame_id_;
+      tx_log.pkt_id_ = pkt_id;
+      tx_log.ue_id_ = pkt->Ue();
+      tx_log.symbol_id_ = pkt->Symbol();
+      tx_log.payload_length_ = pkt->PayloadLength();
+      tx_log.max_payload_length_ = cfg_->MacPayloadMaxLength();
+      tx_log.radio_buf_id_ = radio_buf_id;
+      tx_log.dest_offset_ = dest_pkt_offset;
+      log_->Write(tx_log, pkt->Data(), pkt->PayloadLength());
+
+      std::printf(
+          "MacThreadBasestation: created packet frame %zu, pkt %zu, size %zu "
+          "radio buff id %zu, loc %zu dest offset %zu\n",
+          next_tx_frame_id_, pkt_id, cfg_->MacPayloadMaxLength(), radio_buf_id,
+          (size_t)pkt, dest_pkt_offset);
     }
     src_pkt_offset += pkt->PayloadLength() + MacPacketPacked::kHeaderSize;
   }  // end all packets
@@ -504,19 +553,20 @@ void MacThreadBaseStation::ProcessUdpPacketsFromAppsBs(const char* payload) {
 
   radio_buf_id = (radio_buf_id + 1) % kFrameWnd;
   // Might be unnecessary now.
-  next_radio_id_ = (next_radio_id_ + 1) % cfg_->UeAntNum();
-  if (next_radio_id_ == 0) {
+  next_radio_id_ += cfg_->MacThreadNum();
+  if (next_radio_id_ >= cfg_->UeAntNum()) {
+    next_radio_id_ = mac_thread_id_;
     next_tx_frame_id_++;
   }
 }
 
 void MacThreadBaseStation::RunEventLoop() {
   MLPD_INFO(
-      "MacThreadBasestation: Running MAC thread event loop, logging to file "
-      "%s\n",
-      log_filename_.c_str());
+      "MacThreadBasestation %zu: Running MAC thread event loop, logging to "
+      "binary file %s\n",
+      mac_thread_id_, log_filename_.c_str());
   PinToCoreWithOffset(ThreadType::kWorkerMacTXRX, core_offset_,
-                      0 /* thread ID */);
+                      mac_thread_id_);
 
   size_t last_frame_tx_tsc = 0;
 
@@ -4,6 +4,8 @@
  */
 #include "mac_thread_client.h"
 
+#include <algorithm>
+
 #include "logger.h"
 #include "utils_ldpc.h"
 
@@ -29,8 +31,7 @@ MacThreadClient::MacThreadClient(
   } else {
     log_filename_ = kDefaultLogFilename;
   }
-  log_file_ = std::fopen(log_filename_.c_str(), "w");
-  RtAssert(log_file_ != nullptr, "Failed to open MAC log file");
+  log_ = std::make_unique<MacLog>(log_filename_, "MacThreadClient", freq_ghz_);
 
   MLPD_INFO("MacThreadClient: Frame duration %.2f ms, tsc_delta %zu\n",
             cfg_->GetFrameDurationSec() * 1000, tsc_delta_);
@@ -41,14 +42,15 @@ MacThreadClient::MacThreadClient(
   client_.ul_bits_buffer_status_ = ul_bits_buffer_status;
 
   server_.n_filled_in_frame_.fill(0);
-  for (size_t ue_ant = 0; ue_ant < cfg_->UeAntTotal(); ue_ant++) {
-    server_.data_size_.emplace_back(
-        std::vector<size_t>(cfg->Frame().NumUlDataSyms()));
+  server_.tx_pending_.fill(false);
+  for (auto& iov : server_.frame_iov_) {
+    iov.resize(cfg_->DlMacPacketsPerframe(), {nullptr, 0});
   }
-
-  for (auto& v : server_.frame_data_) {
-    v.resize(cfg_->DlMacDataBytesNumPerframe());
+  for (auto& tags : server_.pinned_tags_) {
+    tags.reserve(cfg_->Frame().NumDLSyms());
   }
+  server_.tx_frames_.reserve(kMaxUEs);
+  server_.tx_frame_ues_.reserve(kMaxUEs);
 
   const size_t udp_pkt_len = cfg_->UlMacDataBytesNumPerframe();
   udp_pkt_buf_.resize(udp_pkt_len + kUdpRxBufferPadding);
@@ -76,23 +78,26 @@ MacThreadClient::MacThreadClient(
 }
 
 MacThreadClient::~MacThreadClient() {
-  std::fclose(log_file_);
+  log_.reset();
   MLPD_INFO("MacThreadClient: MAC thread destroyed\n");
 }
 
 void MacThreadClient::ProcessRxFromPhy() {
-  EventData event;
-  if (rx_queue_->try_dequeue(event) == false) {
-    return;
-  }
-
-  if (event.event_type_ == EventType::kPacketToMac) {
-    MLPD_TRACE("MacThreadClient: MAC thread event kPacketToMac\n");
-    ProcessCodeblocksFromPhy(event);
-  } else if (event.event_type_ == EventType::kSNRReport) {
-    MLPD_TRACE("MacThreadClient: MAC thread event kSNRReport\n");
-    ProcessSnrReportFromPhy(event);
+  std::array<EventData, kRxEventBatchSize> events;
+  const size_t num_events =
+      rx_queue_->try_dequeue_bulk(events.begin(), kRxEventBatchSize);
+
+  for (size_t i = 0; i < num_events; i++) {
+    const EventData& event = events[i];
+    if (event.event_type_ == EventType::kPacketToMac) {
+      MLPD_TRACE("MacThreadClient: MAC thread event kPacketToMac\n");
+      ProcessCodeblocksFromPhy(event);
+    } else if (event.event_type_ == EventType::kSNRReport) {
+      MLPD_TRACE("MacThreadClient: MAC thread event kSNRReport\n");
+      ProcessSnrReportFromPhy(event);
+    }
   }
+  SendFramesToApps();
 }
 
 void MacThreadClient::ProcessSnrReportFromPhy(EventData event) {
@@ -145,7 +150,11 @@ void MacThreadClient::ProcessCodeblocksFromPhy(EventData event) {
   const int8_t* src_data =
       decoded_buffer_[(frame_id % kFrameWnd)][symbol_array_index][ue_id];
 
-  std::stringstream ss;  // Debug-only
+  // frame_iov_ of this UE still describes a frame waiting to be sent
+  if (server_.tx_pending_.at(ue_id)) {
+    SendFramesToApps();
+  }
+  bool pinned = false;
 
   // Only non-pilot data symbols have application data.
   if (symbol_array_index >= num_pilot_symbols) {
@@ -161,25 +170,6 @@ void MacThreadClient::ProcessCodeblocksFromPhy(EventData event) {
     // Who's junk is better? No reason to copy currupted data
     server_.n_filled_in_frame_.at(ue_id) += dest_packet_size;
 
-    ss << "MacThreadClient: Received frame " << pkt->Frame() << ":" << frame_id
-       << " symbol " << pkt->Symbol() << ":" << symbol_id << " user "
-       << pkt->Ue() << ":" << ue_id << " length " << pkt->PayloadLength() << ":"
-       << cfg_->MacPayloadMaxLength() << " crc " << pkt->Crc()
-       << " copied to offset " << frame_data_offset << std::endl;
-
-    if (kLogMacPackets) {
-      ss << "Header Info:" << std::endl
-         << "FRAME_ID: " << pkt->Frame() << std::endl
-         << "SYMBOL_ID: " << pkt->Symbol() << std::endl
-         << "UE_ID: " << pkt->Ue() << std::endl
-         << "DATLEN: " << pkt->PayloadLength() << std::endl
-         << "PAYLOAD:" << std::endl;
-      for (size_t i = 0; i < cfg_->MacPayloadMaxLength(); i++) {
-        ss << std::to_string(pkt->Data()[i]) << " ";
-      }
-      ss << std::endl;
-    }
-
     bool data_valid = false;
     // Data validity check
     if ((static_cast<size_t>(pkt->PayloadLength()) <= dest_packet_size) &&
@@ -192,72 +182,117 @@ void MacThreadClient::ProcessCodeblocksFromPhy(EventData event) {
       data_valid = (crc == pkt->Crc());
     }
 
-    if (data_valid) {
-      MLPD_FRAME("%s", ss.str().c_str());
-      /// Spot to be optimized #1
-      std::memcpy(&server_.frame_data_.at(ue_id).at(frame_data_offset),
-                  pkt->Data(), pkt->PayloadLength());
+    MacLog::RxFromPhy rx_log = {};
+    rx_log.frame_id_ = frame_id;
+    rx_log.symbol_id_ = symbol_id;
+    rx_log.ue_id_ = ue_id;
+    rx_log.pkt_frame_ = pkt->Frame();
+    rx_log.pkt_symbol_ = pkt->Symbol();
+    rx_log.pkt_ue_ = pkt->Ue();
+    rx_log.pkt_payload_length_ = pkt->PayloadLength();
+    rx_log.pkt_crc_ = pkt->Crc();
+    rx_log.max_payload_length_ = cfg_->MacPayloadMaxLength();
+    rx_log.frame_data_offset_ = frame_data_offset;
+    rx_log.valid_ = data_valid;
+    // The payload is only kept in the log with kLogMacPackets
+    log_->Write(rx_log, pkt->Data(),
+                kLogMacPackets ? cfg_->MacPayloadMaxLength() : 0);
 
-      server_.data_size_.at(ue_id).at(symbol_array_index - num_pilot_symbols) =
-          pkt->PayloadLength();
+    if (data_valid) {
+      MLPD_FRAME(
+          "MacThreadClient: Received frame %d:%zu symbol %d:%zu user %d:%zu "
+          "length %d:%zu crc %d copied to offset %zu\n",
+          pkt->Frame(), frame_id, pkt->Symbol(), symbol_id, pkt->Ue(), ue_id,
+          pkt->PayloadLength(), cfg_->MacPayloadMaxLength(), pkt->Crc(),
+          frame_data_offset);
+      // Gather the payload from decoded_buffer_ when the frame is sent
+      server_.frame_iov_.at(ue_id).at(symbol_array_index - num_pilot_symbols) =
+          {const_cast<unsigned char*>(pkt->Data()), pkt->PayloadLength()};
+      pinned = true;
 
     } else {
-      ss << "  *****Failed Data integrity check - invalid parameters"
-         << std::endl;
-
-      MLPD_ERROR("%s", ss.str().c_str());
+      MLPD_ERROR(
+          "MacThreadClient: Received frame %d:%zu symbol %d:%zu user %d:%zu "
+          "length %d:%zu crc %d copied to offset %zu\n  *****Failed Data "
+          "integrity check - invalid parameters\n",
+          pkt->Frame(), frame_id, pkt->Symbol(), symbol_id, pkt->Ue(), ue_id,
+          pkt->PayloadLength(), cfg_->MacPayloadMaxLength(), pkt->Crc(),
+          frame_data_offset);
       // Set the default to 0 valid data bytes
-      server_.data_size_.at(ue_id).at(symbol_array_index - num_pilot_symbols) =
-          0;
+      server_.frame_iov_.at(ue_id).at(symbol_array_index - num_pilot_symbols) =
+          {nullptr, 0};
     }
-    std::fprintf(log_file_, "%s", ss.str().c_str());
-    ss.str("");
   }
 
   // When the frame is full, send it to the application
   if (server_.n_filled_in_frame_.at(ue_id) == max_data_bytes_per_frame) {
     server_.n_filled_in_frame_.at(ue_id) = 0;
-    /// Spot to be optimized #2 -- left shift data over to remove padding
-    bool shifted = false;
-    size_t src_offset = 0;
+    // Drop the packets without valid data from the gather list
+    std::vector<struct iovec>& frame_iov = server_.frame_iov_.at(ue_id);
+    size_t num_iov = 0;
     size_t dest_offset = 0;
     for (size_t packet = 0; packet < num_mac_packets_per_frame; packet++) {
-      const size_t rx_packet_size = server_.data_size_.at(ue_id).at(packet);
-      if (rx_packet_size < cfg_->MacPayloadMaxLength() || (shifted == true)) {
-        shifted = true;
-        if (rx_packet_size > 0) {
-          std::memmove(&server_.frame_data_.at(ue_id).at(dest_offset),
-                       &server_.frame_data_.at(ue_id).at(src_offset),
-                       rx_packet_size);
-        }
+      if (frame_iov.at(packet).iov_len > 0) {
+        dest_offset += frame_iov.at(packet).iov_len;
+        frame_iov.at(num_iov) = frame_iov.at(packet);
+        num_iov++;
       }
-      dest_offset += rx_packet_size;
-      src_offset += cfg_->MacPayloadMaxLength();
     }
 
     if (dest_offset > 0) {
-      udp_client_->Send(kMacRemoteHostname, cfg_->UeMacTxPort() + ue_id,
-                        &server_.frame_data_.at(ue_id).at(0), dest_offset);
+      server_.tx_frames_.push_back(
+          {static_cast<uint16_t>(cfg_->UeMacTxPort() + ue_id), frame_iov.data(),
+           num_iov});
     }
+    server_.tx_frame_ues_.push_back(ue_id);
+    server_.tx_pending_.at(ue_id) = true;
 
-    ss << "MacThreadClient: Sent data for frame " << frame_id << ", ue "
-       << ue_id << ", size " << dest_offset << ":" << max_data_bytes_per_frame
-       << std::endl;
+    MacLog::TxToApp tx_log = {};
+    tx_log.frame_id_ = frame_id;
+    tx_log.ue_id_ = ue_id;
+    tx_log.size_ = dest_offset;
+    tx_log.max_size_ = max_data_bytes_per_frame;
+    // The payload is only kept in the log with kLogMacPackets
+    log_->WriteGather(tx_log, frame_iov.data(), kLogMacPackets ? num_iov : 0);
 
     if (kLogMacPackets) {
-      std::fprintf(stdout, "%s", ss.str().c_str());
+      std::printf(
+          "MacThreadClient: Sent data for frame %zu, ue %zu, size %zu:%zu\n",
+          frame_id, ue_id, dest_offset, max_data_bytes_per_frame);
     }
+  }
 
-    for (size_t i = 0u; i < dest_offset; i++) {
-      ss << std::to_string(server_.frame_data_.at(ue_id).at(i)) << " ";
-    }
-    std::fprintf(log_file_, "%s", ss.str().c_str());
-    ss.str("");
+  if (pinned) {
+    server_.pinned_tags_.at(ue_id).push_back(event.tags_[0]);
+  } else {
+    RtAssert(
+        tx_queue_->enqueue(EventData(EventType::kPacketToMac, event.tags_[0])),
+        "Socket message enqueue failed\n");
   }
+}
 
-  RtAssert(
-      tx_queue_->enqueue(EventData(EventType::kPacketToMac, event.tags_[0])),
-      "Socket message enqueue failed\n");
+void MacThreadClient::SendFramesToApps() {
+  if (server_.tx_frame_ues_.empty()) {
+    return;
+  }
+  if (server_.tx_frames_.empty() == false) {
+    udp_client_->SendBatch(kMacRemoteHostname, server_.tx_frames_.data(),
+                           server_.tx_frames_.size());
+  }
+
+  // The kernel has copied the payloads, so the PHY can reuse the buffers
+  for (size_t ue_id : server_.tx_frame_ues_) {
+    for (size_t tag : server_.pinned_tags_.at(ue_id)) {
+      RtAssert(tx_queue_->enqueue(EventData(EventType::kPacketToMac, tag)),
+               "Socket message enqueue failed\n");
+    }
+    server_.pinned_tags_.at(ue_id).clear();
+    std::fill(server_.frame_iov_.at(ue_id).begin(),
+              server_.frame_iov_.at(ue_id).end(), iovec{nullptr, 0});
+    server_.tx_pending_.at(ue_id) = false;
+  }
+  server_.tx_frames_.clear();
+  server_.tx_frame_ues_.clear();
 }
 
 void MacThreadClient::ProcessControlInformation() {
@@ -437,16 +472,11 @@ void MacThreadClient::ProcessUdpPacketsFromAppsClient(const char* payload,
   }
 
   if (kLogMacPackets) {
-    std::stringstream ss;
-    std::fprintf(log_file_,
-                 "MacThreadClient: Received data from app for frame %zu, ue "
-                 "%zu size %zu\n",
-                 next_tx_frame_id_, next_radio_id_, pkt_offset);
-
-    for (size_t i = 0; i < pkt_offset; i++) {
-      ss << std::to_string((uint8_t)(payload[i])) << " ";
-    }
-    std::fprintf(log_file_, "%s\n", ss.str().c_str());
+    MacLog::RxFromApp rx_log = {};
+    rx_log.frame_id_ = next_tx_frame_id_;
+    rx_log.ue_id_ = next_radio_id_;
+    rx_log.size_ = pkt_offset;
+    log_->Write(rx_log, payload, pkt_offset);
   }
 
   size_t src_pkt_offset = 0;
@@ -479,26 +509,22 @@ void MacThreadClient::ProcessUdpPacketsFromAppsClient(const char* payload,
         crc_obj_->CalculateCrc24(pkt->Data(), pkt->PayloadLength()) & 0xFFFF));
 
     if (kLogMacPackets) {
-      std::stringstream ss;
-
-      ss << "MacThreadClient: created packet frame " << next_tx_frame_id_
-         << ", pkt " << pkt_id << ", size " << cfg_->MacPayloadMaxLength()
-         << " radio buff id " << radio_buf_id << ", loc " << (size_t)pkt
-         << " dest offset " << dest_pkt_offset << std::endl;
-
-      ss << "Header Info:" << std::endl
-         << "FRAME_ID: " << pkt->Frame() << std::endl
-         << "SYMBOL_ID: " << pkt->Symbol() << std::endl
-         << "UE_ID: " << pkt->Ue() << std::endl
-         << "DATLEN: " << pkt->PayloadLength() << std::endl
-         << "PAYLOAD:" << std::endl;
-      for (size_t i = 0; i < pkt->PayloadLength(); i++) {
-        ss << std::to_string(pkt->Data()[i]) << " ";
-      }
-      ss << std::endl;
-      std::fprintf(stdout, "%s", ss.str().c_str());
-      std::fprintf(log_file_, "%s", ss.str().c_str());
-      ss.str("");
+      MacLog::TxToPhy tx_log = {};
+      tx_log.frame_id_ = next_tx_frame_id_;
+      tx_log.pkt_id_ = pkt_id;
+      tx_log.ue_id_ = pkt->Ue();
+      tx_log.symbol_id_ = pkt->Symbol();
+      tx_log.payload_length_ = pkt->PayloadLength();
+      tx_log.max_payload_length_ = cfg_->MacPayloadMaxLength();
+      tx_log.radio_buf_id_ = radio_buf_id;
+      tx_log.dest_offset_ = dest_pkt_offset;
+      log_->Write(tx_log, pkt->Data(), pkt->PayloadLength());
+
+      std::printf(
+          "MacThreadClient: created packet frame %zu, pkt %zu, size %zu radio "
+          "buff id %zu, loc %zu dest offset %zu\n",
+          next_tx_frame_id_, pkt_id, cfg_->MacPayloadMaxLength(), radio_buf_id,
+          (size_t)pkt, dest_pkt_offset);
     }
     src_pkt_offset += pkt->PayloadLength() + MacPacketPacked::kHeaderSize;
   }  // end all packets
@@ -522,7 +548,8 @@ void MacThreadClient::ProcessUdpPacketsFromAppsClient(const char* payload,
 
 void MacThreadClient::RunEventLoop() {
   MLPD_INFO(
-      "MacThreadClient: Running MAC thread event loop, logging to file %s\n",
+      "MacThreadClient: Running MAC thread event loop, logging to binary file "
+      "%s\n",
       log_filename_.c_str());
   PinToCoreWithOffset(ThreadType::kWorkerMacTXRX, core_offset_,
                       0 /* thread ID */);
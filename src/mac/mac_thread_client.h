@@ -5,6 +5,8 @@
 #ifndef MAC_THREAD_H_
 #define MAC_THREAD_H_
 
+#include <sys/uio.h>
+
 #include <queue>
 
 #include "buffer.h"
@@ -12,6 +14,7 @@
 #include "config.h"
 #include "crc.h"
 #include "gettime.h"
+#include "mac_log.h"
 #include "ran_config.h"
 #include "symbols.h"
 #include "udp_client.h"
@@ -27,13 +30,17 @@
  */
 class MacThreadClient {
  public:
-  // Default log file for MAC layer outputs
+  // Default binary log file for MAC layer outputs, see mac_log_decoder
   static constexpr char kDefaultLogFilename[] = "data/mac_log_client";
 
   // Maximum number of outstanding UDP packets per UE that we allocate recv()
   // buffer space for
   static constexpr size_t kMaxPktsPerUE = 64;
 
+  // Maximum number of PHY events handled per poll of the RX queue. Frames
+  // completed within one poll are sent to the applications together.
+  static constexpr size_t kRxEventBatchSize = 32;
+
   // Length of SNR moving average window
   // TODO: map this to time?
   static constexpr size_t kSNRWindowSize = 100;
@@ -61,6 +68,10 @@ class MacThreadClient {
   // fully-received frames for UE #i to kRemoteHostname::(kBaseRemotePort + i)
   void ProcessCodeblocksFromPhy(EventData event);
 
+  // Send the frames completed since the last call to the applications, then
+  // return the decoded buffers they were gathered from to the PHY
+  void SendFramesToApps();
+
   // Receive SNR report from PHY master thread. Use for RB scheduling.
   // TODO: process CQI report here as well.
   void ProcessSnrReportFromPhy(EventData event);
@@ -91,7 +102,7 @@ class MacThreadClient {
 
   const size_t core_offset_;  // The CPU core on which this thread runs
 
-  FILE* log_file_;  // Log file used to store MAC layer outputs
+  std::unique_ptr<MacLog> log_;  // Binary log of MAC layer outputs
   std::string log_filename_;
 
   // UDP endpoint used for sending messages
@@ -125,8 +136,21 @@ class MacThreadClient {
 
   // Server-only members
   struct {
-    // Staging buffers to accumulate decoded uplink code blocks for each UE
-    std::array<std::vector<uint8_t>, kMaxUEs> frame_data_;
+    // frame_iov_[i][j] points at the payload of MAC packet #j of the frame
+    // being received for UE #i. Payloads stay in decoded_buffer_ and are
+    // gathered by the kernel when the frame is sent.
+    std::array<std::vector<struct iovec>, kMaxUEs> frame_iov_;
+
+    // pinned_tags_[i] holds the kPacketToMac events whose decoded_buffer_
+    // entries are referenced by frame_iov_[i]. They are returned to the PHY
+    // only after the frame is sent, so the PHY cannot reuse those buffers
+    // before that.
+    std::array<std::vector<size_t>, kMaxUEs> pinned_tags_;
+
+    // Frames completed during the current poll and the UEs they belong to
+    std::vector<UDPClient::GatherPacket> tx_frames_;
+    std::vector<size_t> tx_frame_ues_;
+    std::array<bool, kMaxUEs> tx_pending_;
 
     // n_filled_in_frame_[i] is the number of bytes received in the current
     // frame for UE #i
@@ -134,9 +158,6 @@ class MacThreadClient {
 
     // snr_[i] contains a moving window of SNR measurement for UE #i
     std::array<std::queue<float>, kMaxUEs> snr_;
-
-    // Placing at the end because it is variable size based on configuration
-    std::vector<std::vector<size_t>> data_size_;
   } server_;
 
   // TODO: decoded_buffer_ is used by only the server, so it should be moved
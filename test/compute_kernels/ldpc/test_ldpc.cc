@@ -4,7 +4,8 @@
  * @brief Accuracy and performance test for LDPC. The encoder is Agora's
  * avx2enc - unlike FlexRAN's encoder, avx2enc works with AVX2 (i.e., unlike
  * FlexRAN's encoder, avx2enc does not require AVX-512). The decoder is
- * FlexRAN's decoder, which supports AVX2.
+ * FlexRAN's decoder, which supports AVX2, or Agora's avx2dec when built with
+ * USE_AVX2_DECODER.
  */
 
 #include <algorithm>
@@ -112,8 +113,7 @@ int main() {
     for (size_t n = 0; n < kNumCodeBlocks; n++) {
       ldpc_decoder_5gnr_request.varNodes = llrs[n];
       ldpc_decoder_5gnr_response.compactedMessageBytes = decoded[n];
-      bblib_ldpc_decoder_5gnr(&ldpc_decoder_5gnr_request,
-                              &ldpc_decoder_5gnr_response);
+      LdpcDecodeHelper(&ldpc_decoder_5gnr_request, &ldpc_decoder_5gnr_response);
     }
 
     const double decoding_us =
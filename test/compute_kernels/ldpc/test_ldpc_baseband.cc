@@ -347,8 +347,8 @@ int main(int argc, char* argv[]) {
             j * cfg->OfdmDataNum() * 8 * num_symbols_per_cb;
         ldpc_decoder_5gnr_response.compactedMessageBytes =
             decoded_codewords[i * num_cbs_per_ue + j];
-        bblib_ldpc_decoder_5gnr(&ldpc_decoder_5gnr_request,
-                                &ldpc_decoder_5gnr_response);
+        LdpcDecodeHelper(&ldpc_decoder_5gnr_request,
+                         &ldpc_decoder_5gnr_response);
       }
     }
 
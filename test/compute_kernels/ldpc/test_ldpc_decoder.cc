@@ -0,0 +1,185 @@
+/**
+ * @file test_ldpc_decoder.cc
+ * @brief Accuracy and performance of Agora's AVX2 LDPC decoder (avx2dec) for
+ * code blocks sent over an AWGN channel, for both base graphs, expansion
+ * factors from every shift set, and int8 LLR scales up to that of Agora's
+ * QAM demodulators. Unless built with USE_AVX2_DECODER, FlexRAN's decoder
+ * decodes the same LLRs for comparison. Fails if avx2dec leaves any code
+ * block undecoded at the highest SNR, or too many at kCheckSnrDb.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iterator>
+#include <random>
+#include <vector>
+
+#include "decoder.h"
+#include "encoder.h"
+#include "gettime.h"
+#include "memory_manage.h"
+#include "phy_ldpc_decoder_5gnr.h"
+#include "symbols.h"
+#include "utils_ldpc.h"
+
+static constexpr size_t kNumCodeBlocks = 100;
+static constexpr size_t kNumFillerBits = 0;
+static constexpr size_t kMaxDecoderIters = 20;
+// int8 LLRs of a noiseless BPSK bit. Agora's 16/64-QAM demodulators use a
+// scale of 100 (SCALE_BYTE_CONV_QAM16/64).
+static constexpr float kLlrScales[] = {8.0f, 32.0f, 100.0f};
+static constexpr float kSnrDbLevels[] = {0.0f, 1.0f, 2.0f, 10.0f};
+// The block error rate must not exceed kMaxBlerAtCheckSnr at this SNR
+static constexpr float kCheckSnrDb = 2.0f;
+static constexpr double kMaxBlerAtCheckSnr = 0.05;
+// At least one expansion factor of each of the eight shift sets i_LS of
+// TS 38.212 Table 5.3.2-1, in set order, then larger ones
+static const size_t kZcs[] = {16, 24, 20, 56, 36, 22, 52, 60, 104, 208, 384};
+
+struct Result {
+  size_t num_block_errors_ = 0;
+  size_t num_bit_errors_ = 0;
+  size_t total_iters_ = 0;
+  size_t decode_tsc_ = 0;
+};
+
+int main() {
+  const double freq_ghz = GetTime::MeasureRdtscFreq();
+  std::mt19937 gen(42);
+  std::normal_distribution<float> noise_dist(0.0f, 1.0f);
+  bool avx2dec_failed = false;
+
+  for (const size_t base_graph : {1, 2}) {
+    const size_t num_rows = LdpcMaxNumRows(base_graph);
+    for (const size_t zc : kZcs) {
+      if (zc < LdpcGetMinZc() || zc > LdpcGetMaxZc()) {
+        std::fprintf(stderr, "Zc value %zu not supported. Skipping.\n", zc);
+        continue;
+      }
+      const size_t num_input_bits = LdpcNumInputBits(base_graph, zc);
+      const size_t num_encoded_bits =
+          LdpcNumEncodedBits(base_graph, zc, num_rows);
+      std::printf("Base graph %zu, Zc = %zu, %zu code blocks per SNR\n",
+                  base_graph, zc, kNumCodeBlocks);
+
+      std::vector<int8_t> input(LdpcEncodingInputBufSize(base_graph, zc));
+      std::vector<int8_t> parity(LdpcEncodingParityBufSize(base_graph, zc));
+      std::vector<int8_t> encoded(LdpcEncodingEncodedBufSize(base_graph, zc));
+      std::vector<uint8_t> decoded(
+          LdpcEncodingEncodedBufSize(base_graph, zc));
+      auto* llrs = static_cast<int8_t*>(Agora_memory::PaddedAlignedAlloc(
+          Agora_memory::Alignment_t::kAlign64, num_encoded_bits));
+
+      struct bblib_ldpc_decoder_5gnr_request request = {};
+      struct bblib_ldpc_decoder_5gnr_response response = {};
+      request.numChannelLlrs = num_encoded_bits;
+      request.numFillerBits = kNumFillerBits;
+      request.maxIterations = kMaxDecoderIters;
+      request.enableEarlyTermination = true;
+      request.Zc = zc;
+      request.baseGraph = base_graph;
+      request.nRows = num_rows;
+      request.varNodes = llrs;
+      const size_t buffer_len = 1024 * 1024;
+      response.numMsgBits = num_input_bits - kNumFillerBits;
+      response.varNodes =
+          static_cast<int16_t*>(Agora_memory::PaddedAlignedAlloc(
+              Agora_memory::Alignment_t::kAlign32,
+              buffer_len * sizeof(int16_t)));
+      response.compactedMessageBytes = decoded.data();
+
+      auto count_errors = [&](Result& result) {
+        size_t num_errors = 0;
+        for (size_t i = 0; i < num_input_bits; i++) {
+          num_errors += ((static_cast<uint8_t>(input[i / 8]) ^
+                          decoded[i / 8]) >>
+                         (i % 8)) &
+                        1;
+        }
+        result.num_bit_errors_ += num_errors;
+        result.num_block_errors_ += (num_errors > 0) ? 1 : 0;
+        result.total_iters_ += response.iterationAtTermination;
+      };
+
+      for (const float llr_scale : kLlrScales) {
+        std::printf("  LLR scale %.0f:\n", llr_scale);
+        for (const float snr_db : kSnrDbLevels) {
+          const float noise_std = std::sqrt(std::pow(10.0f, -snr_db / 10.0f));
+          Result avx2dec_result;
+          Result flexran_result;
+          for (size_t cb = 0; cb < kNumCodeBlocks; cb++) {
+            for (auto& byte : input) {
+              byte = static_cast<int8_t>(gen());
+            }
+            LdpcEncodeHelper(base_graph, zc, num_rows, encoded.data(),
+                             parity.data(), input.data());
+            for (size_t i = 0; i < num_encoded_bits; i++) {
+              const float bpsk =
+                  ((encoded[i / 8] >> (i % 8)) & 1) ? -1.0f : 1.0f;
+              const float llr =
+                  std::round((bpsk + noise_std * noise_dist(gen)) * llr_scale);
+              llrs[i] =
+                  static_cast<int8_t>(std::clamp(llr, -127.0f, 127.0f));
+            }
+
+            size_t start_tsc = GetTime::Rdtsc();
+            avx2dec::BblibLdpcDecoder5gnr(&request, &response);
+            avx2dec_result.decode_tsc_ += GetTime::Rdtsc() - start_tsc;
+            count_errors(avx2dec_result);
+
+  #ifndef USE_AVX2_DECODER
+            start_tsc = GetTime::Rdtsc();
+            bblib_ldpc_decoder_5gnr(&request, &response);
+            flexran_result.decode_tsc_ += GetTime::Rdtsc() - start_tsc;
+            count_errors(flexran_result);
+  #endif
+          }
+
+          std::printf("    SNR %4.1f dB:\n", snr_db);
+          auto print_result = [&](const char* name, const Result& result) {
+            const double decode_us =
+                GetTime::CyclesToUs(result.decode_tsc_, freq_ghz);
+            std::printf(
+                "      %-8s BER %.2e, BLER %.3f, %.2f iterations and %.2f us "
+                "per code block, %.2f Mbps\n",
+                name,
+                result.num_bit_errors_ * 1.0 /
+                    (num_input_bits * kNumCodeBlocks),
+                result.num_block_errors_ * 1.0 / kNumCodeBlocks,
+                result.total_iters_ * 1.0 / kNumCodeBlocks,
+                decode_us / kNumCodeBlocks,
+                num_input_bits * kNumCodeBlocks / decode_us);
+          };
+          print_result("avx2dec", avx2dec_result);
+  #ifndef USE_AVX2_DECODER
+          print_result("FlexRAN", flexran_result);
+  #endif
+          const double bler =
+              avx2dec_result.num_block_errors_ * 1.0 / kNumCodeBlocks;
+          if ((snr_db == kSnrDbLevels[std::size(kSnrDbLevels) - 1]) &&
+              (avx2dec_result.num_block_errors_ > 0)) {
+            std::fprintf(stderr,
+                         "avx2dec failed to decode code blocks at %.1f dB "
+                         "(base graph %zu, Zc %zu, LLR scale %.0f)\n",
+                         snr_db, base_graph, zc, llr_scale);
+            avx2dec_failed = true;
+          }
+          if ((snr_db == kCheckSnrDb) && (bler > kMaxBlerAtCheckSnr)) {
+            std::fprintf(stderr,
+                         "avx2dec BLER %.3f above %.3f at %.1f dB "
+                         "(base graph %zu, Zc %zu, LLR scale %.0f)\n",
+                         bler, kMaxBlerAtCheckSnr, snr_db, base_graph, zc,
+                         llr_scale);
+            avx2dec_failed = true;
+          }
+        }
+      }
+
+      std::free(llrs);
+      std::free(response.varNodes);
+    }
+  }
+
+  return avx2dec_failed ? 1 : 0;
+}
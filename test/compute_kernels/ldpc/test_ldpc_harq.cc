@@ -0,0 +1,195 @@
+/**
+ * @file test_ldpc_harq.cc
+ * @brief Block error rate and decoding cost of LDPC code blocks sent up to
+ * kMaxTransmissions times over an AWGN channel, decoded independently on
+ * every transmission or chase-combined with the HarqSoftBuffer. The SNRs are
+ * below the decoding threshold of a single transmission, but within the
+ * ~6 dB that combining kMaxTransmissions transmissions gains. Fails unless
+ * combining decodes nearly all code blocks by the last transmission, and
+ * lowers the block error rate by at least kMinBlerGain.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "encoder.h"
+#include "gettime.h"
+#include "harq_buffer.h"
+#include "memory_manage.h"
+#include "phy_ldpc_decoder_5gnr.h"
+#include "symbols.h"
+#include "utils_ldpc.h"
+
+static constexpr size_t kNumCodeBlocks = 200;
+static constexpr size_t kMaxTransmissions = 4;
+static constexpr size_t kBaseGraph = 1;
+static constexpr size_t kZc = 72;
+static constexpr size_t kNumRows = 46;
+static constexpr size_t kNumFillerBits = 0;
+static constexpr size_t kMaxDecoderIters = 20;
+// int8 LLR of a noiseless BPSK bit. Leaves headroom for combining several
+// noisy transmissions before the saturating add clips.
+static constexpr float kLlrScale = 16.0f;
+static constexpr float kSnrDbLevels[] = {-5.0f, -4.0f, -3.0f, -1.0f};
+// Bounds on the block error rate after the last transmission
+static constexpr double kMaxHarqBler = 0.05;
+static constexpr double kMinBlerGain = 0.5;
+
+enum class Scheme { kIndependent, kHarq };
+
+struct Result {
+  // Code blocks decoded correctly by transmission i (cumulative)
+  std::vector<size_t> num_decoded_ = std::vector<size_t>(kMaxTransmissions);
+  size_t num_decodes_ = 0;
+  size_t total_iters_ = 0;
+  size_t decode_tsc_ = 0;
+};
+
+int main() {
+  const double freq_ghz = GetTime::MeasureRdtscFreq();
+  std::mt19937 gen(42);
+  std::normal_distribution<float> noise_dist(0.0f, 1.0f);
+
+  const size_t num_input_bits = LdpcNumInputBits(kBaseGraph, kZc);
+  const size_t num_encoded_bits =
+      LdpcNumEncodedBits(kBaseGraph, kZc, kNumRows);
+  std::printf(
+      "Zc = %zu, code rate %.3f, %zu code blocks per SNR, up to %zu "
+      "transmissions\n",
+      kZc, 22.f / (20 + kNumRows), kNumCodeBlocks, kMaxTransmissions);
+
+  std::vector<int8_t> input(LdpcEncodingInputBufSize(kBaseGraph, kZc));
+  std::vector<int8_t> parity(LdpcEncodingParityBufSize(kBaseGraph, kZc));
+  std::vector<int8_t> encoded(LdpcEncodingEncodedBufSize(kBaseGraph, kZc));
+  std::vector<uint8_t> decoded(LdpcEncodingEncodedBufSize(kBaseGraph, kZc));
+  std::vector<float> rx_signal(num_encoded_bits);
+  auto* llrs = static_cast<int8_t*>(Agora_memory::PaddedAlignedAlloc(
+      Agora_memory::Alignment_t::kAlign64, num_encoded_bits));
+
+  struct bblib_ldpc_decoder_5gnr_request request = {};
+  struct bblib_ldpc_decoder_5gnr_response response = {};
+  request.numChannelLlrs = num_encoded_bits;
+  request.numFillerBits = kNumFillerBits;
+  request.maxIterations = kMaxDecoderIters;
+  request.enableEarlyTermination = true;
+  request.Zc = kZc;
+  request.baseGraph = kBaseGraph;
+  request.nRows = kNumRows;
+  request.varNodes = llrs;
+  const size_t buffer_len = 1024 * 1024;
+  response.numMsgBits = num_input_bits - kNumFillerBits;
+  response.varNodes = static_cast<int16_t*>(Agora_memory::PaddedAlignedAlloc(
+      Agora_memory::Alignment_t::kAlign32, buffer_len * sizeof(int16_t)));
+  response.compactedMessageBytes = decoded.data();
+
+  auto decode_ok = [&]() {
+    for (size_t i = 0; i < num_input_bits; i++) {
+      if (((static_cast<uint8_t>(input[i / 8]) ^ decoded[i / 8]) >> (i % 8)) &
+          1) {
+        return false;
+      }
+    }
+    return true;
+  };
+
+  bool harq_failed = false;
+  for (const float snr_db : kSnrDbLevels) {
+    const float noise_std = std::sqrt(std::pow(10.0f, -snr_db / 10.0f));
+    Result results[2];
+    HarqSoftBuffer harq_buffer(1, 1, 1, num_encoded_bits, kMaxTransmissions);
+    size_t frame_id = 0;
+
+    for (size_t cb = 0; cb < kNumCodeBlocks; cb++) {
+      for (auto& byte : input) {
+        byte = static_cast<int8_t>(gen());
+      }
+      LdpcEncodeHelper(kBaseGraph, kZc, kNumRows, encoded.data(),
+                       parity.data(), input.data());
+
+      bool done[2] = {false, false};
+      for (size_t tx = 0; tx < kMaxTransmissions; tx++, frame_id++) {
+        // Both schemes see the same noisy retransmission
+        for (size_t i = 0; i < num_encoded_bits; i++) {
+          const float bpsk = ((encoded[i / 8] >> (i % 8)) & 1) ? -1.0f : 1.0f;
+          rx_signal[i] = bpsk + noise_std * noise_dist(gen);
+        }
+
+        for (Scheme scheme : {Scheme::kIndependent, Scheme::kHarq}) {
+          Result& result = results[static_cast<size_t>(scheme)];
+          if (done[static_cast<size_t>(scheme)]) {
+            result.num_decoded_[tx]++;
+            continue;
+          }
+          for (size_t i = 0; i < num_encoded_bits; i++) {
+            const float llr = std::round(rx_signal[i] * kLlrScale);
+            llrs[i] = static_cast<int8_t>(std::clamp(llr, -127.0f, 127.0f));
+          }
+
+          const size_t start_tsc = GetTime::Rdtsc();
+          if (scheme == Scheme::kHarq) {
+            harq_buffer.Combine(0, 0, 0, frame_id, tx == 0, llrs);
+          }
+          LdpcDecodeHelper(&request, &response);
+          result.decode_tsc_ += GetTime::Rdtsc() - start_tsc;
+          result.num_decodes_++;
+          result.total_iters_ += response.iterationAtTermination;
+
+          const bool ok = decode_ok();
+          if (scheme == Scheme::kHarq) {
+            if (ok) {
+              harq_buffer.Release(0, 0, 0);
+            } else {
+              harq_buffer.Store(0, 0, 0, frame_id, llrs, tx + 1);
+              harq_buffer.Feedback(0, 0, 0, frame_id, false);
+            }
+          }
+          if (ok) {
+            done[static_cast<size_t>(scheme)] = true;
+            result.num_decoded_[tx]++;
+          }
+        }
+      }
+    }
+
+    std::printf("SNR %.1f dB:\n", snr_db);
+    static const char* kSchemeNames[] = {"independent", "chase combining"};
+    for (size_t s = 0; s < 2; s++) {
+      const Result& result = results[s];
+      const double decode_us =
+          GetTime::CyclesToUs(result.decode_tsc_, freq_ghz);
+      std::printf("  %-16s BLER after tx 1..%zu:", kSchemeNames[s],
+                  kMaxTransmissions);
+      for (size_t tx = 0; tx < kMaxTransmissions; tx++) {
+        std::printf(" %.3f", 1.0 - result.num_decoded_[tx] * 1.0 /
+                                       kNumCodeBlocks);
+      }
+      std::printf(
+          ", %zu decodes, %.2f iterations and %.2f us per decode, %.2f Mbps "
+          "goodput\n",
+          result.num_decodes_,
+          result.total_iters_ * 1.0 / result.num_decodes_,
+          decode_us / result.num_decodes_,
+          result.num_decoded_[kMaxTransmissions - 1] * num_input_bits /
+              decode_us);
+    }
+    const double bler[2] = {
+        1.0 - results[0].num_decoded_[kMaxTransmissions - 1] * 1.0 /
+                  kNumCodeBlocks,
+        1.0 - results[1].num_decoded_[kMaxTransmissions - 1] * 1.0 /
+                  kNumCodeBlocks};
+    if ((bler[1] > kMaxHarqBler) || (bler[0] - bler[1] < kMinBlerGain)) {
+      std::fprintf(stderr,
+                   "Chase combining BLER %.3f (independent %.3f) at %.1f dB "
+                   "after %zu transmissions\n",
+                   bler[1], bler[0], snr_db, kMaxTransmissions);
+      harq_failed = true;
+    }
+  }
+
+  std::free(llrs);
+  std::free(response.varNodes);
+  return harq_failed ? 1 : 0;
+}
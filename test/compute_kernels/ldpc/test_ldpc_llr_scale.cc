@@ -0,0 +1,184 @@
+/**
+ * @file test_ldpc_llr_scale.cc
+ * @brief Sweep of the LLR scale passed to the soft demappers. For each
+ * modulation and SNR, code blocks are modulated, sent over an AWGN channel,
+ * demapped with several multiples of the default LLR scale, and decoded.
+ * Prints BER, BLER, decoder iterations and decode time per scale, and the
+ * scale that decodes with the fewest iterations at the lowest BLER. Used to
+ * pick llr_scale_ref_snr_db for the uplink LLR scaling in DoDemul.
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "comms-lib.h"
+#include "gettime.h"
+#include "memory_manage.h"
+#include "modulation.h"
+#include "phy_ldpc_decoder_5gnr.h"
+#include "symbols.h"
+#include "utils_ldpc.h"
+
+static constexpr size_t kNumCodeBlocks = 100;
+static constexpr size_t kBaseGraph = 1;
+static constexpr size_t kZc = 104;
+static constexpr size_t kMaxDecoderIters = 20;
+// Multiples of the default LLR scale of each demapper
+static constexpr float kScaleFactors[] = {0.25f, 0.5f, 0.75f, 1.0f, 1.5f, 2.0f};
+
+struct SweepPoint {
+  size_t mod_order_bits_;
+  float default_scale_;
+  // SNR per received symbol after equalization
+  std::vector<float> snr_db_levels_;
+};
+
+struct Result {
+  size_t num_block_errors_ = 0;
+  size_t num_bit_errors_ = 0;
+  size_t total_iters_ = 0;
+  size_t decode_tsc_ = 0;
+};
+
+static void Demodulate(size_t mod_order_bits, float* symbols, int8_t* llrs,
+                       int num_symbols, float scale) {
+  switch (mod_order_bits) {
+    case (CommsLib::kQpsk):
+      DemodQpskSoftSse(symbols, llrs, num_symbols * 2, scale);
+      break;
+    case (CommsLib::kQaM16):
+      Demod16qamSoftAvx2(symbols, llrs, num_symbols, scale);
+      break;
+    case (CommsLib::kQaM64):
+      Demod64qamSoftAvx2(symbols, llrs, num_symbols, scale);
+      break;
+    default:
+      std::printf("Demodulation: modulation order %zu not supported!\n",
+                  mod_order_bits);
+  }
+}
+
+int main() {
+  const double freq_ghz = GetTime::MeasureRdtscFreq();
+  std::mt19937 gen(42);
+  std::normal_distribution<float> noise_dist(0.0f, 1.0f);
+
+  const size_t num_rows = LdpcMaxNumRows(kBaseGraph);
+  const size_t num_input_bits = LdpcNumInputBits(kBaseGraph, kZc);
+  const size_t num_encoded_bits =
+      LdpcNumEncodedBits(kBaseGraph, kZc, num_rows);
+  const size_t num_encoded_bytes = BitsToBytes(num_encoded_bits);
+
+  const std::vector<SweepPoint> sweep = {
+      {CommsLib::kQpsk, SCALE_BYTE_CONV_QPSK, {-1.0f, 0.0f, 1.0f, 10.0f}},
+      {CommsLib::kQaM16, SCALE_BYTE_CONV_QAM16, {5.0f, 6.0f, 7.0f, 20.0f}},
+      {CommsLib::kQaM64, SCALE_BYTE_CONV_QAM64, {10.0f, 11.0f, 12.0f, 25.0f}}};
+
+  std::vector<int8_t> input(LdpcEncodingInputBufSize(kBaseGraph, kZc));
+  std::vector<int8_t> parity(LdpcEncodingParityBufSize(kBaseGraph, kZc));
+  std::vector<int8_t> encoded(LdpcEncodingEncodedBufSize(kBaseGraph, kZc));
+  std::vector<uint8_t> decoded(LdpcEncodingEncodedBufSize(kBaseGraph, kZc));
+
+  struct bblib_ldpc_decoder_5gnr_request request = {};
+  struct bblib_ldpc_decoder_5gnr_response response = {};
+  request.numChannelLlrs = num_encoded_bits;
+  request.numFillerBits = 0;
+  request.maxIterations = kMaxDecoderIters;
+  request.enableEarlyTermination = true;
+  request.Zc = kZc;
+  request.baseGraph = kBaseGraph;
+  request.nRows = num_rows;
+  const size_t buffer_len = 1024 * 1024;
+  response.numMsgBits = num_input_bits;
+  response.varNodes = static_cast<int16_t*>(Agora_memory::PaddedAlignedAlloc(
+      Agora_memory::Alignment_t::kAlign32, buffer_len * sizeof(int16_t)));
+  response.compactedMessageBytes = decoded.data();
+
+  for (const SweepPoint& point : sweep) {
+    const size_t mod_bits = point.mod_order_bits_;
+    Table<complex_float> mod_table;
+    InitModulationTable(mod_table, 1 << mod_bits);
+
+    // The AVX2 demappers work on 16 symbols at a time
+    const size_t num_symbols =
+        Roundup<16>((num_encoded_bits + mod_bits - 1) / mod_bits);
+    std::vector<uint8_t> mod_input(num_symbols, 0);
+    auto* rx_symbols = static_cast<complex_float*>(
+        Agora_memory::PaddedAlignedAlloc(Agora_memory::Alignment_t::kAlign64,
+                                         num_symbols * sizeof(complex_float)));
+    auto* llrs = static_cast<int8_t*>(Agora_memory::PaddedAlignedAlloc(
+        Agora_memory::Alignment_t::kAlign64, num_symbols * mod_bits));
+    request.varNodes = llrs;
+
+    for (const float snr_db : point.snr_db_levels_) {
+      // Unit average symbol energy, noise split over I and Q
+      const float noise_std =
+          std::sqrt(std::pow(10.0f, -snr_db / 10.0f) / 2.0f);
+      std::vector<Result> results(std::size(kScaleFactors));
+      for (size_t cb = 0; cb < kNumCodeBlocks; cb++) {
+        for (auto& byte : input) {
+          byte = static_cast<int8_t>(gen());
+        }
+        LdpcEncodeHelper(kBaseGraph, kZc, num_rows, encoded.data(),
+                         parity.data(), input.data());
+        AdaptBitsForMod(reinterpret_cast<const uint8_t*>(encoded.data()),
+                        mod_input.data(), num_encoded_bytes, mod_bits);
+        for (size_t i = 0; i < num_symbols; i++) {
+          const complex_float tx = ModSingleUint8(mod_input[i], mod_table);
+          rx_symbols[i] = {tx.re + noise_std * noise_dist(gen),
+                           tx.im + noise_std * noise_dist(gen)};
+        }
+
+        for (size_t s = 0; s < std::size(kScaleFactors); s++) {
+          Demodulate(mod_bits, reinterpret_cast<float*>(rx_symbols), llrs,
+                     num_symbols, kScaleFactors[s] * point.default_scale_);
+          const size_t start_tsc = GetTime::Rdtsc();
+          LdpcDecodeHelper(&request, &response);
+          results[s].decode_tsc_ += GetTime::Rdtsc() - start_tsc;
+
+          size_t num_errors = 0;
+          for (size_t i = 0; i < num_input_bits; i++) {
+            num_errors += ((static_cast<uint8_t>(input[i / 8]) ^
+                            decoded[i / 8]) >>
+                           (i % 8)) &
+                          1;
+          }
+          results[s].num_bit_errors_ += num_errors;
+          results[s].num_block_errors_ += (num_errors > 0) ? 1 : 0;
+          results[s].total_iters_ += response.iterationAtTermination;
+        }
+      }
+
+      std::printf("%zu bits per symbol, SNR %4.1f dB:\n", mod_bits, snr_db);
+      size_t best = 0;
+      for (size_t s = 0; s < std::size(kScaleFactors); s++) {
+        const Result& result = results[s];
+        const double decode_us =
+            GetTime::CyclesToUs(result.decode_tsc_, freq_ghz);
+        std::printf(
+            "  scale %6.1f (x%.2f): BER %.2e, BLER %.3f, %.2f iterations and "
+            "%.2f us per code block\n",
+            kScaleFactors[s] * point.default_scale_, kScaleFactors[s],
+            result.num_bit_errors_ * 1.0 / (num_input_bits * kNumCodeBlocks),
+            result.num_block_errors_ * 1.0 / kNumCodeBlocks,
+            result.total_iters_ * 1.0 / kNumCodeBlocks,
+            decode_us / kNumCodeBlocks);
+        if ((result.num_block_errors_ < results[best].num_block_errors_) ||
+            ((result.num_block_errors_ == results[best].num_block_errors_) &&
+             (result.total_iters_ < results[best].total_iters_))) {
+          best = s;
+        }
+      }
+      std::printf("  best scale: x%.2f\n", kScaleFactors[best]);
+    }
+
+    std::free(rx_symbols);
+    std::free(llrs);
+    mod_table.Free();
+  }
+
+  std::free(response.varNodes);
+  return 0;
+}
@@ -193,8 +193,7 @@ int main(int argc, char* argv[]) {
     for (size_t i = 0; i < num_codeblocks; i++) {
       ldpc_decoder_5gnr_request.varNodes = demod_data_all_symbols[i];
       ldpc_decoder_5gnr_response.compactedMessageBytes = decoded_codewords[i];
-      bblib_ldpc_decoder_5gnr(&ldpc_decoder_5gnr_request,
-                              &ldpc_decoder_5gnr_response);
+      LdpcDecodeHelper(&ldpc_decoder_5gnr_request, &ldpc_decoder_5gnr_response);
     }
 
     size_t duration = GetTime::WorkerRdtsc() - start_tsc;
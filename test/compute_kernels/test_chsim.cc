@@ -0,0 +1,178 @@
+/**
+ * @file test_chsim.cc
+ * @brief Benchmark of the per-symbol work of the channel simulator workers:
+ * apply a flat MIMO channel, add white Gaussian noise, and convert to int16
+ * samples. Compares the Armadillo path (ApplyChan) with the AVX2 kernels
+ * (ApplyChanSimd) and reports symbols per second per worker thread.
+ */
+#include <armadillo>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <thread>
+#include <vector>
+
+#include "channel_kernels.h"
+#include "cpu_attach.h"
+
+static constexpr size_t kBsAntNum = 64;
+static constexpr size_t kUeAntNum = 16;
+// 2048-point symbol with a 160-sample cyclic prefix
+static constexpr size_t kSampsPerSymbol = 2208;
+static constexpr float kSnrDb = 20.0f;
+static constexpr size_t kFirstCore = 2;
+// Downlink power normalization, 1 / sqrt(kBsAntNum)
+static constexpr float kDlScale = 0.125f;
+
+static double GetTimeSec() {
+  struct timespec tv;
+  clock_gettime(CLOCK_MONOTONIC, &tv);
+  return tv.tv_sec + tv.tv_nsec / 1000000000.0;
+}
+
+enum class Mode { kArmadillo, kSimd };
+
+struct WorkerBuffers {
+  WorkerBuffers(size_t n_in, size_t n_out, uint64_t seed)
+      : src_(arma::randn<arma::cx_fmat>(kSampsPerSymbol, n_in) * 0.1f),
+        dst_(kSampsPerSymbol, n_out),
+        tx_(2 * kSampsPerSymbol * n_out),
+        packed_h_(PackedChannelSize(n_in, n_out)),
+        noise_(2 * kSampsPerSymbol),
+        rng_(seed) {}
+
+  arma::cx_fmat src_;
+  arma::cx_fmat dst_;
+  std::vector<short> tx_;
+  std::vector<float> packed_h_;
+  std::vector<float> noise_;
+  GaussianRng rng_;
+};
+
+// Same steps as Channel::ApplyChan(), Channel::Awgn() and the former
+// ChannelSim::DoTx() conversion
+static void ArmadilloSymbol(const arma::cx_fmat& h, bool is_downlink,
+                            float snr_lin, WorkerBuffers& buf) {
+  if (is_downlink) {
+    buf.dst_ = buf.src_ * h.st() * kDlScale;
+  } else {
+    buf.dst_ = buf.src_ * h;
+  }
+  for (size_t j = 0; j < buf.dst_.n_cols; j++) {
+    const float power = arma::mean(arma::square(arma::abs(buf.dst_.col(j))));
+    const float noise_std = std::sqrt(power / (2.0f * snr_lin));
+    arma::fmat re(buf.dst_.n_rows, 1, arma::fill::randn);
+    arma::fmat im(buf.dst_.n_rows, 1, arma::fill::randn);
+    buf.dst_.col(j) += arma::cx_fmat(re, im) * noise_std;
+  }
+  const auto* in = reinterpret_cast<const float*>(buf.dst_.memptr());
+  for (size_t i = 0; i < buf.tx_.size(); i++) {
+    buf.tx_[i] = static_cast<short>(in[i] * 32768.0f);
+  }
+}
+
+static void SimdSymbol(const arma::cx_fmat& h, bool is_downlink,
+                       float snr_lin, WorkerBuffers& buf) {
+  const size_t n_in = buf.src_.n_cols;
+  const size_t n_out = buf.dst_.n_cols;
+  PackChannelMatrix(reinterpret_cast<const float*>(h.memptr()), n_in, n_out,
+                    is_downlink, is_downlink ? kDlScale : 1.0f,
+                    buf.packed_h_.data());
+  auto* dst = reinterpret_cast<float*>(buf.dst_.memptr());
+  ApplyChannelMatrix(reinterpret_cast<const float*>(buf.src_.memptr()),
+                     kSampsPerSymbol, n_in, buf.packed_h_.data(), n_out, dst);
+  AddAwgn(dst, kSampsPerSymbol, n_out, snr_lin, buf.rng_, buf.noise_.data());
+  ConvertFloatToShortSat(dst, buf.tx_.data(), buf.tx_.size());
+}
+
+static void RunBenchmark(Mode mode, bool is_downlink, const arma::cx_fmat& h,
+                         size_t num_workers, size_t num_symbols) {
+  const size_t n_in = is_downlink ? kBsAntNum : kUeAntNum;
+  const size_t n_out = is_downlink ? kUeAntNum : kBsAntNum;
+  const float snr_lin = std::pow(10.0f, kSnrDb / 10.0f);
+
+  std::vector<double> elapsed(num_workers);
+  std::atomic<size_t> num_ready(0);
+  std::vector<std::thread> workers;
+  for (size_t tid = 0; tid < num_workers; tid++) {
+    workers.emplace_back([&, tid]() {
+      stick_this_thread_to_core(kFirstCore + tid);
+      WorkerBuffers buf(n_in, n_out, tid + 1);
+      num_ready++;
+      while (num_ready.load() < num_workers) {
+      }
+      const double start_time = GetTimeSec();
+      for (size_t i = 0; i < num_symbols; i++) {
+        if (mode == Mode::kSimd) {
+          SimdSymbol(h, is_downlink, snr_lin, buf);
+        } else {
+          ArmadilloSymbol(h, is_downlink, snr_lin, buf);
+        }
+      }
+      elapsed[tid] = GetTimeSec() - start_time;
+    });
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+
+  double total_rate = 0;
+  for (double sec : elapsed) {
+    total_rate += num_symbols / sec;
+  }
+  std::printf("  %-9s %-8s %10.0f symbols/s per worker, %10.0f total\n",
+              is_downlink ? "downlink" : "uplink",
+              mode == Mode::kSimd ? "simd" : "arma", total_rate / num_workers,
+              total_rate);
+}
+
+// Largest difference between the two channel products, without noise
+static float CompareOutputs(const arma::cx_fmat& h, bool is_downlink) {
+  const size_t n_in = is_downlink ? kBsAntNum : kUeAntNum;
+  const size_t n_out = is_downlink ? kUeAntNum : kBsAntNum;
+  WorkerBuffers buf(n_in, n_out, 1);
+  const arma::cx_fmat ref = is_downlink
+                                ? arma::cx_fmat(buf.src_ * h.st() * kDlScale)
+                                : arma::cx_fmat(buf.src_ * h);
+  PackChannelMatrix(reinterpret_cast<const float*>(h.memptr()), n_in, n_out,
+                    is_downlink, is_downlink ? kDlScale : 1.0f,
+                    buf.packed_h_.data());
+  ApplyChannelMatrix(reinterpret_cast<const float*>(buf.src_.memptr()),
+                     kSampsPerSymbol, n_in, buf.packed_h_.data(), n_out,
+                     reinterpret_cast<float*>(buf.dst_.memptr()));
+  return arma::abs(buf.dst_ - ref).max();
+}
+
+int main(int argc, char* argv[]) {
+  if (argc > 3) {
+    std::fprintf(stderr, "Usage: %s [workers] [symbols per worker]\n",
+                 argv[0]);
+    return 1;
+  }
+  const size_t num_workers =
+      (argc >= 2) ? std::strtoul(argv[1], nullptr, 0) : 1;
+  const size_t num_symbols =
+      (argc == 3) ? std::strtoul(argv[2], nullptr, 0) : 2000;
+
+  // Rayleigh channel, UE x BS as in Channel
+  const arma::cx_fmat h =
+      arma::cx_fmat(arma::randn<arma::fmat>(kUeAntNum, kBsAntNum),
+                    arma::randn<arma::fmat>(kUeAntNum, kBsAntNum)) /
+      std::sqrt(2.0f);
+
+  std::printf(
+      "Channel simulator: %zu BS antennas, %zu UE antennas, %zu samples per "
+      "symbol, %zu workers\n",
+      kBsAntNum, kUeAntNum, kSampsPerSymbol, num_workers);
+  for (bool is_downlink : {false, true}) {
+    std::printf("  %-9s max difference without noise: %.2e\n",
+                is_downlink ? "downlink" : "uplink",
+                CompareOutputs(h, is_downlink));
+    for (Mode mode : {Mode::kArmadillo, Mode::kSimd}) {
+      RunBenchmark(mode, is_downlink, h, num_workers, num_symbols);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,172 @@
+/**
+ * @file test_doer_geometry.cc
+ * @brief Benchmark of the per-subcarrier stages of DoDemul and DoPrecode
+ * (partial-transpose gather, equalization, precoding) for every geometry in
+ * SpecializedGeometries, comparing the generic instantiation against the
+ * compile-time specialized one
+ */
+#include <armadillo>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <tuple>
+
+#include "cpu_attach.h"
+#include "doer_geometry.h"
+#include "gettime.h"
+#include "memory_manage.h"
+
+/// Stands in for DynamicGeometry without needing a Config
+struct RuntimeGeometry {
+  static constexpr bool kFixed = false;
+  inline size_t BsAntNum() const { return this->bs_ant_num_; }
+  inline size_t UeAntNum() const { return this->ue_ant_num_; }
+  size_t bs_ant_num_;
+  size_t ue_ant_num_;
+};
+
+struct StageCycles {
+  size_t gather_ = 0;
+  size_t equalize_ = 0;
+  size_t precode_ = 0;
+};
+
+static complex_float* AllocRandom(size_t n, std::mt19937& gen) {
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  auto* buf = static_cast<complex_float*>(Agora_memory::PaddedAlignedAlloc(
+      Agora_memory::Alignment_t::kAlign64, n * sizeof(complex_float)));
+  for (size_t i = 0; i < n; i++) {
+    buf[i] = {dist(gen), dist(gen)};
+  }
+  return buf;
+}
+
+/// Same indexing as the non-SIMD gather in DoDemul and DoZF
+template <typename Geometry>
+static inline void GatherCacheline(const Geometry& geo,
+                                   const complex_float* src, size_t base_sc_id,
+                                   complex_float* dst) {
+  const size_t block_base = (base_sc_id / kTransposeBlockSize) *
+                            (kTransposeBlockSize * geo.BsAntNum());
+  for (size_t j = 0; j < kSCsPerCacheline; j++) {
+    for (size_t ant_i = 0; ant_i < geo.BsAntNum(); ant_i++) {
+      *dst++ = src[block_base + (ant_i * kTransposeBlockSize) +
+                   ((base_sc_id + j) % kTransposeBlockSize)];
+    }
+  }
+}
+
+/// out = mat * vec as in DoDemul and DoPrecode: unrolled for fixed
+/// geometries, armadillo otherwise
+template <typename Geometry, size_t kRows, size_t kCols>
+static inline void MatVec(size_t rows, size_t cols, complex_float* mat,
+                          complex_float* vec, complex_float* out) {
+  if constexpr (Geometry::kFixed) {
+    unused(rows);
+    unused(cols);
+    CxMatVecFixed<kRows, kCols>(mat, vec, out);
+  } else {
+    arma::cx_fmat mat_a(reinterpret_cast<arma::cx_float*>(mat), rows, cols,
+                        false);
+    arma::cx_fmat mat_x(reinterpret_cast<arma::cx_float*>(vec), cols, 1,
+                        false);
+    arma::cx_fmat mat_y(reinterpret_cast<arma::cx_float*>(out), rows, 1, false);
+    mat_y = mat_a * mat_x;
+  }
+}
+
+template <typename Geometry, size_t kBsAntNum, size_t kUeAntNum>
+static StageCycles RunStages(const Geometry& geo, size_t iterations) {
+  static constexpr size_t kNumSCs = 1200;
+  std::mt19937 gen(0);
+  complex_float* data = AllocRandom(kNumSCs * kBsAntNum, gen);
+  complex_float* ul_zf = AllocRandom(kUeAntNum * kBsAntNum, gen);
+  complex_float* dl_zf = AllocRandom(kBsAntNum * kUeAntNum, gen);
+  complex_float* gathered = AllocRandom(kSCsPerCacheline * kBsAntNum, gen);
+  complex_float* equalized = AllocRandom(kSCsPerCacheline * kUeAntNum, gen);
+  complex_float* precoded = AllocRandom(kSCsPerCacheline * kBsAntNum, gen);
+
+  StageCycles cycles;
+  for (size_t i = 0; i < iterations; i++) {
+    const size_t base_sc_id =
+        (i * kSCsPerCacheline) % (kNumSCs - kSCsPerCacheline);
+
+    size_t start_tsc = GetTime::Rdtsc();
+    GatherCacheline(geo, data, base_sc_id, gathered);
+    size_t start_tsc1 = GetTime::Rdtsc();
+    cycles.gather_ += start_tsc1 - start_tsc;
+
+    for (size_t j = 0; j < kSCsPerCacheline; j++) {
+      MatVec<Geometry, kUeAntNum, kBsAntNum>(
+          geo.UeAntNum(), geo.BsAntNum(), ul_zf, gathered + j * kBsAntNum,
+          equalized + j * kUeAntNum);
+    }
+    size_t start_tsc2 = GetTime::Rdtsc();
+    cycles.equalize_ += start_tsc2 - start_tsc1;
+
+    for (size_t j = 0; j < kSCsPerCacheline; j++) {
+      MatVec<Geometry, kBsAntNum, kUeAntNum>(
+          geo.BsAntNum(), geo.UeAntNum(), dl_zf, equalized + j * kUeAntNum,
+          precoded + j * kBsAntNum);
+    }
+    cycles.precode_ += GetTime::Rdtsc() - start_tsc2;
+  }
+
+  std::free(data);
+  std::free(ul_zf);
+  std::free(dl_zf);
+  std::free(gathered);
+  std::free(equalized);
+  std::free(precoded);
+  return cycles;
+}
+
+template <typename FixedGeo>
+static void RunBenchmark(size_t iterations) {
+  static constexpr size_t kBsAntNum = FixedGeo::BsAntNum();
+  static constexpr size_t kUeAntNum = FixedGeo::UeAntNum();
+  const RuntimeGeometry runtime_geo = {kBsAntNum, kUeAntNum};
+  const StageCycles generic =
+      RunStages<RuntimeGeometry, kBsAntNum, kUeAntNum>(runtime_geo,
+                                                       iterations);
+  const StageCycles fixed = RunStages<FixedGeo, kBsAntNum, kUeAntNum>(
+      FixedGeo(nullptr), iterations);
+
+  const double num_scs = static_cast<double>(iterations * kSCsPerCacheline);
+  std::printf("%zu x %zu (cycles per subcarrier)\n", kBsAntNum, kUeAntNum);
+  std::printf("  gather   generic %8.1f  specialized %8.1f  speedup %.2fx\n",
+              generic.gather_ / num_scs, fixed.gather_ / num_scs,
+              1.0 * generic.gather_ / fixed.gather_);
+  std::printf("  equalize generic %8.1f  specialized %8.1f  speedup %.2fx\n",
+              generic.equalize_ / num_scs, fixed.equalize_ / num_scs,
+              1.0 * generic.equalize_ / fixed.equalize_);
+  std::printf("  precode  generic %8.1f  specialized %8.1f  speedup %.2fx\n",
+              generic.precode_ / num_scs, fixed.precode_ / num_scs,
+              1.0 * generic.precode_ / fixed.precode_);
+}
+
+template <size_t... I>
+static void RunAllGeometries(size_t iterations, std::index_sequence<I...>) {
+  (RunBenchmark<std::tuple_element_t<I, SpecializedGeometries>>(iterations),
+   ...);
+}
+
+int main(int argc, char* argv[]) {
+  if (argc > 2) {
+    std::fprintf(stderr, "Usage: %s [iterations]\n", argv[0]);
+    return 1;
+  }
+  const size_t iterations =
+      (argc == 2) ? std::strtoul(argv[1], nullptr, 0) : 100000;
+
+  int main_core_id = 2;
+  if (stick_this_thread_to_core(main_core_id) != 0) {
+    std::printf("Main thread: stitch main thread to core %d failed\n",
+                main_core_id);
+  }
+
+  RunAllGeometries(
+      iterations,
+      std::make_index_sequence<std::tuple_size_v<SpecializedGeometries>>());
+  return 0;
+}
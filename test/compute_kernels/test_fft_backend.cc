@@ -0,0 +1,105 @@
+/**
+ * @file test_fft_backend.cc
+ * @brief Benchmark and cross-check of every FFT backend compiled into this
+ * binary (MKL, FFTW, native) at the FFT sizes Agora uses
+ */
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "cpu_attach.h"
+#include "fft_backend.h"
+#include "memory_manage.h"
+
+static double GetTimeSec() {
+  struct timespec tv;
+  clock_gettime(CLOCK_MONOTONIC, &tv);
+  return tv.tv_sec + tv.tv_nsec / 1000000000.0;
+}
+
+static complex_float* AllocSamples(size_t n) {
+  return static_cast<complex_float*>(Agora_memory::PaddedAlignedAlloc(
+      Agora_memory::Alignment_t::kAlign64, n * sizeof(complex_float)));
+}
+
+static void RunBenchmark(size_t fft_size, size_t iterations) {
+  std::mt19937 gen(0);
+  std::uniform_real_distribution<float> dist(-0.5f, 0.5f);
+  complex_float* in = AllocSamples(fft_size);
+  complex_float* out = AllocSamples(fft_size);
+  complex_float* reference = AllocSamples(fft_size);
+  for (size_t i = 0; i < fft_size; i++) {
+    in[i] = {dist(gen), dist(gen)};
+  }
+
+  // The native backend is always compiled in and serves as the reference
+  auto ref_plan =
+      FftPlan::Create(FftDirection::kForward, fft_size, false,
+                      FftBackendType::kNative);
+  ref_plan->Execute(in, reference);
+
+  std::printf("FFT size %zu\n", fft_size);
+  for (FftBackendType backend :
+       {FftBackendType::kMkl, FftBackendType::kFftw,
+        FftBackendType::kNative}) {
+    if (!FftPlan::IsAvailable(backend)) {
+      continue;
+    }
+    auto fwd = FftPlan::Create(FftDirection::kForward, fft_size, false,
+                               backend);
+    auto bwd = FftPlan::Create(FftDirection::kBackward, fft_size, false,
+                               backend);
+
+    fwd->Execute(in, out);
+    float max_err = 0;
+    for (size_t i = 0; i < fft_size; i++) {
+      max_err = std::max(max_err, std::hypot(out[i].re - reference[i].re,
+                                             out[i].im - reference[i].im));
+    }
+
+    double start_time = GetTimeSec();
+    for (size_t i = 0; i < iterations; i++) {
+      fwd->Execute(in, out);
+    }
+    const double fft_time = GetTimeSec() - start_time;
+    start_time = GetTimeSec();
+    for (size_t i = 0; i < iterations; i++) {
+      bwd->Execute(in, out);
+    }
+    const double ifft_time = GetTimeSec() - start_time;
+
+    std::printf("  %-6s FFT %9.3f us  IFFT %9.3f us  (max error %.2e)\n",
+                FftPlan::ToString(backend).c_str(),
+                1e6 * fft_time / iterations, 1e6 * ifft_time / iterations,
+                max_err);
+  }
+
+  std::free(in);
+  std::free(out);
+  std::free(reference);
+}
+
+int main(int argc, char* argv[]) {
+  if (argc > 2) {
+    std::fprintf(stderr, "Usage: %s [iterations]\n", argv[0]);
+    return 1;
+  }
+  const size_t iterations =
+      (argc == 2) ? std::strtoul(argv[1], nullptr, 0) : 100000;
+
+  int main_core_id = 2;
+  if (stick_this_thread_to_core(main_core_id) != 0) {
+    std::printf("Main thread: stitch main thread to core %d failed\n",
+                main_core_id);
+  }
+
+  for (size_t fft_size : {64, 256, 512, 1024, 2048, 4096}) {
+    RunBenchmark(fft_size, iterations);
+  }
+  return 0;
+}
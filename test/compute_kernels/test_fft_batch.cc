@@ -0,0 +1,99 @@
+/**
+ * @file test_fft_batch.cc
+ * @brief Benchmark of the per-antenna FFT cost of one MKL call per antenna
+ * (DoFFT::Launch) versus one batched MKL call per FFT event
+ * (DoFFT::LaunchBatch), for every FFT block size
+ */
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <random>
+
+#include "cpu_attach.h"
+#include "memory_manage.h"
+#include "mkl_dfti.h"
+
+// Same limit as EventData::kMaxTags
+static constexpr size_t kMaxBlockSize = 7;
+
+static double GetTimeSec() {
+  struct timespec tv;
+  clock_gettime(CLOCK_MONOTONIC, &tv);
+  return tv.tv_sec + tv.tv_nsec / 1000000000.0;
+}
+
+static void RunBenchmark(size_t fft_size, size_t iterations) {
+  auto* buf = static_cast<float*>(Agora_memory::PaddedAlignedAlloc(
+      Agora_memory::Alignment_t::kAlign64,
+      2 * kMaxBlockSize * fft_size * sizeof(float)));
+  std::mt19937 gen(0);
+  std::uniform_real_distribution<float> dist(-0.5f, 0.5f);
+  for (size_t i = 0; i < 2 * kMaxBlockSize * fft_size; i++) {
+    buf[i] = dist(gen);
+  }
+
+  DFTI_DESCRIPTOR_HANDLE single_handle;
+  DftiCreateDescriptor(&single_handle, DFTI_SINGLE, DFTI_COMPLEX, 1,
+                       static_cast<MKL_LONG>(fft_size));
+  DftiCommitDescriptor(single_handle);
+
+  std::printf("FFT size %zu\n", fft_size);
+  for (size_t block_size = 1; block_size <= kMaxBlockSize; block_size++) {
+    DFTI_DESCRIPTOR_HANDLE batch_handle;
+    DftiCreateDescriptor(&batch_handle, DFTI_SINGLE, DFTI_COMPLEX, 1,
+                         static_cast<MKL_LONG>(fft_size));
+    DftiSetValue(batch_handle, DFTI_NUMBER_OF_TRANSFORMS,
+                 static_cast<MKL_LONG>(block_size));
+    DftiSetValue(batch_handle, DFTI_INPUT_DISTANCE,
+                 static_cast<MKL_LONG>(fft_size));
+    DftiSetValue(batch_handle, DFTI_OUTPUT_DISTANCE,
+                 static_cast<MKL_LONG>(fft_size));
+    DftiCommitDescriptor(batch_handle);
+
+    double start_time = GetTimeSec();
+    for (size_t i = 0; i < iterations; i++) {
+      for (size_t j = 0; j < block_size; j++) {
+        DftiComputeForward(single_handle, buf + (2 * j * fft_size));
+      }
+    }
+    const double single_time = GetTimeSec() - start_time;
+
+    start_time = GetTimeSec();
+    for (size_t i = 0; i < iterations; i++) {
+      DftiComputeForward(batch_handle, buf);
+    }
+    const double batch_time = GetTimeSec() - start_time;
+
+    const double num_ffts = static_cast<double>(iterations * block_size);
+    std::printf(
+        "  block size %zu: per-antenna %8.3f us (single), %8.3f us "
+        "(batched), speedup %.2fx\n",
+        block_size, 1e6 * single_time / num_ffts, 1e6 * batch_time / num_ffts,
+        single_time / batch_time);
+    DftiFreeDescriptor(&batch_handle);
+  }
+
+  DftiFreeDescriptor(&single_handle);
+  std::free(buf);
+}
+
+int main(int argc, char* argv[]) {
+  if (argc > 2) {
+    std::fprintf(stderr, "Usage: %s [iterations]\n", argv[0]);
+    return 1;
+  }
+  const size_t iterations =
+      (argc == 2) ? std::strtoul(argv[1], nullptr, 0) : 100000;
+
+  int main_core_id = 2;
+  if (stick_this_thread_to_core(main_core_id) != 0) {
+    std::printf("Main thread: stitch main thread to core %d failed\n",
+                main_core_id);
+  }
+
+  for (size_t fft_size : {1024, 2048, 4096}) {
+    RunBenchmark(fft_size, iterations);
+  }
+  return 0;
+}
@@ -0,0 +1,189 @@
+/**
+ * @file test_mac_tx_path.cc
+ * @brief Benchmark of the MAC thread path that sends reassembled frames to
+ * the applications: staging copy with one sendto() per frame (the former
+ * path), scatter-gather with one sendmsg() per frame, and scatter-gather
+ * with one sendmmsg() for all frames of a poll.
+ */
+#include <sys/uio.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "cpu_attach.h"
+#include "udp_client.h"
+#include "udp_server.h"
+
+static constexpr size_t kNumUEs = 8;
+static constexpr size_t kPacketsPerFrame = 32;
+static constexpr size_t kMaxPayloadLength = 1400;
+// Distance between MAC packets in the stand-in for decoded_buffer_
+static constexpr size_t kPacketStride = 1536;
+static constexpr uint16_t kBasePort = 9300;
+static constexpr char kHostname[] = "127.0.0.1";
+
+static double GetTimeSec() {
+  struct timespec tv;
+  clock_gettime(CLOCK_MONOTONIC, &tv);
+  return tv.tv_sec + tv.tv_nsec / 1000000000.0;
+}
+
+enum class Mode { kCopy, kSendmsg, kSendmmsg };
+
+struct Workload {
+  // Decoded MAC packets of every UE, kPacketStride bytes apart
+  std::vector<uint8_t> decoded_;
+  // Payload length of every packet. 0 marks a packet that failed its CRC.
+  std::vector<size_t> payload_len_;
+  size_t frame_bytes_ = 0;
+};
+
+static Workload MakeWorkload() {
+  Workload workload;
+  workload.decoded_.resize(kNumUEs * kPacketsPerFrame * kPacketStride);
+  workload.payload_len_.resize(kNumUEs * kPacketsPerFrame);
+  std::mt19937 gen(0);
+  std::uniform_int_distribution<size_t> len_dist(kMaxPayloadLength / 2,
+                                                 kMaxPayloadLength);
+  for (auto& byte : workload.decoded_) {
+    byte = static_cast<uint8_t>(gen());
+  }
+  for (size_t i = 0; i < workload.payload_len_.size(); i++) {
+    // Every 16th packet is dropped, and the rest are partially filled, so
+    // the copy path has to compact the frame
+    workload.payload_len_[i] = (i % 16 == 15) ? 0 : len_dist(gen);
+    workload.frame_bytes_ += workload.payload_len_[i];
+  }
+  workload.frame_bytes_ /= kNumUEs;
+  return workload;
+}
+
+static void RunBenchmark(Mode mode, const Workload& workload,
+                         size_t num_frames) {
+  UDPClient udp_client;
+  std::vector<std::unique_ptr<UDPServer>> servers;
+  for (size_t ue_id = 0; ue_id < kNumUEs; ue_id++) {
+    servers.emplace_back(
+        std::make_unique<UDPServer>(kBasePort + ue_id, 8 * 1024 * 1024));
+  }
+
+  std::atomic<bool> running(true);
+  std::atomic<size_t> rx_bytes(0);
+  std::thread receiver([&]() {
+    std::vector<uint8_t> buf(kPacketsPerFrame * kMaxPayloadLength);
+    size_t bytes = 0;
+    while (running.load()) {
+      for (auto& server : servers) {
+        const ssize_t ret = server->Recv(buf.data(), buf.size());
+        if (ret > 0) {
+          bytes += static_cast<size_t>(ret);
+        }
+      }
+    }
+    rx_bytes.store(bytes);
+  });
+
+  std::vector<std::vector<uint8_t>> frame_data(
+      kNumUEs, std::vector<uint8_t>(kPacketsPerFrame * kMaxPayloadLength));
+  std::vector<std::vector<struct iovec>> frame_iov(
+      kNumUEs, std::vector<struct iovec>(kPacketsPerFrame));
+  std::vector<UDPClient::GatherPacket> tx_frames;
+
+  const double start_time = GetTimeSec();
+  for (size_t frame = 0; frame < num_frames; frame++) {
+    tx_frames.clear();
+    for (size_t ue_id = 0; ue_id < kNumUEs; ue_id++) {
+      const uint8_t* ue_packets =
+          &workload.decoded_.at(ue_id * kPacketsPerFrame * kPacketStride);
+      const size_t* ue_len =
+          &workload.payload_len_.at(ue_id * kPacketsPerFrame);
+      const uint16_t port = kBasePort + ue_id;
+
+      if (mode == Mode::kCopy) {
+        for (size_t packet = 0; packet < kPacketsPerFrame; packet++) {
+          std::memcpy(&frame_data[ue_id][packet * kMaxPayloadLength],
+                      ue_packets + packet * kPacketStride, ue_len[packet]);
+        }
+        size_t dest_offset = 0;
+        for (size_t packet = 0; packet < kPacketsPerFrame; packet++) {
+          if (ue_len[packet] > 0) {
+            std::memmove(&frame_data[ue_id][dest_offset],
+                         &frame_data[ue_id][packet * kMaxPayloadLength],
+                         ue_len[packet]);
+          }
+          dest_offset += ue_len[packet];
+        }
+        udp_client.Send(kHostname, port, frame_data[ue_id].data(),
+                        dest_offset);
+        continue;
+      }
+
+      size_t num_iov = 0;
+      for (size_t packet = 0; packet < kPacketsPerFrame; packet++) {
+        if (ue_len[packet] > 0) {
+          frame_iov[ue_id][num_iov] = {
+              const_cast<uint8_t*>(ue_packets + packet * kPacketStride),
+              ue_len[packet]};
+          num_iov++;
+        }
+      }
+      tx_frames.push_back({port, frame_iov[ue_id].data(), num_iov});
+      if (mode == Mode::kSendmsg) {
+        udp_client.SendBatch(kHostname, &tx_frames.back(), 1);
+      }
+    }
+    if (mode == Mode::kSendmmsg) {
+      udp_client.SendBatch(kHostname, tx_frames.data(), tx_frames.size());
+    }
+  }
+  const double elapsed = GetTimeSec() - start_time;
+
+  // Let the receiver drain its sockets
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  running.store(false);
+  receiver.join();
+
+  static const char* kModeNames[] = {"copy + sendto", "gather + sendmsg",
+                                     "gather + sendmmsg"};
+  const double tx_bytes =
+      static_cast<double>(num_frames * kNumUEs * workload.frame_bytes_);
+  std::printf(
+      "  %-18s %8.3f us per frame (%zu UEs), %6.2f Gbps sent, %5.1f%% "
+      "received\n",
+      kModeNames[static_cast<size_t>(mode)], 1e6 * elapsed / num_frames,
+      kNumUEs, 8 * tx_bytes / elapsed / 1e9,
+      100.0 * static_cast<double>(rx_bytes.load()) / tx_bytes);
+}
+
+int main(int argc, char* argv[]) {
+  if (argc > 2) {
+    std::fprintf(stderr, "Usage: %s [frames]\n", argv[0]);
+    return 1;
+  }
+  const size_t num_frames =
+      (argc == 2) ? std::strtoul(argv[1], nullptr, 0) : 20000;
+
+  int main_core_id = 2;
+  if (stick_this_thread_to_core(main_core_id) != 0) {
+    std::printf("Main thread: stitch main thread to core %d failed\n",
+                main_core_id);
+  }
+
+  const Workload workload = MakeWorkload();
+  std::printf(
+      "MAC to app path: %zu UEs, %zu packets per frame, %zu bytes per UE "
+      "frame\n",
+      kNumUEs, kPacketsPerFrame, workload.frame_bytes_);
+  for (Mode mode : {Mode::kCopy, Mode::kSendmsg, Mode::kSendmmsg}) {
+    RunBenchmark(mode, workload, num_frames);
+  }
+  return 0;
+}
@@ -0,0 +1,173 @@
+/**
+ * @file test_pruned_fft.cc
+ * @brief Benchmark of the pruned FFT over the OFDM data subcarriers against
+ * the full-size MKL FFT used by DoFFT and DoIFFT
+ */
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <random>
+#include <vector>
+
+#include "cpu_attach.h"
+#include "memory_manage.h"
+#include "mkl_dfti.h"
+#include "pruned_fft.h"
+
+static double GetTimeSec() {
+  struct timespec tv;
+  clock_gettime(CLOCK_MONOTONIC, &tv);
+  return tv.tv_sec + tv.tv_nsec / 1000000000.0;
+}
+
+static complex_float* AllocSamples(size_t n) {
+  return static_cast<complex_float*>(Agora_memory::PaddedAlignedAlloc(
+      Agora_memory::Alignment_t::kAlign64, n * sizeof(complex_float)));
+}
+
+/// Baseline: the DoFFT path, an in-place full FFT
+static double BenchFullFft(size_t fft_size, size_t iterations,
+                           const complex_float* in) {
+  complex_float* buf = AllocSamples(fft_size);
+  DFTI_DESCRIPTOR_HANDLE handle;
+  DftiCreateDescriptor(&handle, DFTI_SINGLE, DFTI_COMPLEX, 1,
+                       static_cast<MKL_LONG>(fft_size));
+  DftiCommitDescriptor(handle);
+
+  double start_time = GetTimeSec();
+  for (size_t i = 0; i < iterations; i++) {
+    std::memcpy(buf, in, fft_size * sizeof(complex_float));
+    DftiComputeForward(handle, buf);
+  }
+  double duration = GetTimeSec() - start_time;
+
+  DftiFreeDescriptor(&handle);
+  std::free(buf);
+  return duration;
+}
+
+/// Baseline: the DoIFFT path, zero the guard bins and run an in-place IFFT
+static double BenchFullIfft(size_t fft_size, size_t band_start,
+                            size_t band_len, size_t iterations,
+                            const complex_float* in) {
+  complex_float* buf = AllocSamples(fft_size);
+  DFTI_DESCRIPTOR_HANDLE handle;
+  DftiCreateDescriptor(&handle, DFTI_SINGLE, DFTI_COMPLEX, 1,
+                       static_cast<MKL_LONG>(fft_size));
+  DftiCommitDescriptor(handle);
+
+  double start_time = GetTimeSec();
+  for (size_t i = 0; i < iterations; i++) {
+    std::memset(buf, 0, band_start * sizeof(complex_float));
+    std::memcpy(buf + band_start, in, band_len * sizeof(complex_float));
+    std::memset(buf + band_start + band_len, 0,
+                (fft_size - band_start - band_len) * sizeof(complex_float));
+    DftiComputeBackward(handle, buf);
+  }
+  double duration = GetTimeSec() - start_time;
+
+  DftiFreeDescriptor(&handle);
+  std::free(buf);
+  return duration;
+}
+
+static void RunBenchmark(size_t fft_size, size_t band_len, size_t iterations) {
+  const size_t band_start = (fft_size - band_len) / 2;
+  std::mt19937 gen(0);
+  std::uniform_real_distribution<float> dist(-0.5f, 0.5f);
+
+  complex_float* time_in = AllocSamples(fft_size);
+  complex_float* band_in = AllocSamples(band_len);
+  complex_float* reference = AllocSamples(fft_size);
+  complex_float* out = AllocSamples(fft_size);
+  for (size_t i = 0; i < fft_size; i++) {
+    time_in[i] = {dist(gen), dist(gen)};
+  }
+  for (size_t i = 0; i < band_len; i++) {
+    band_in[i] = {dist(gen), dist(gen)};
+  }
+
+  const double fft_time = BenchFullFft(fft_size, iterations, time_in);
+  const double ifft_time =
+      BenchFullIfft(fft_size, band_start, band_len, iterations, band_in);
+  std::printf(
+      "N = %zu, M = %zu, auto Q = %zu\n"
+      "  full      FFT %9.3f us  IFFT %9.3f us\n",
+      fft_size, band_len, PrunedFft::ChooseDecimation(fft_size, band_len),
+      1e6 * fft_time / iterations, 1e6 * ifft_time / iterations);
+
+  for (size_t q = 1; q <= 16; q *= 2) {
+    PrunedFft fwd(PrunedFft::FftDirection::kForward, fft_size, band_start,
+                  band_len, q);
+    PrunedFft bwd(PrunedFft::FftDirection::kBackward, fft_size, band_start,
+                  band_len, q);
+
+    // Check against the full transforms before timing
+    PrunedFft ref_fwd(PrunedFft::FftDirection::kForward, fft_size, 0,
+                      fft_size, 1);
+    ref_fwd.Forward(time_in, reference);
+    fwd.Forward(time_in, out);
+    float fwd_err = 0;
+    for (size_t i = 0; i < band_len; i++) {
+      const complex_float& ref = reference[i + band_start];
+      fwd_err = std::max(
+          fwd_err, std::hypot(out[i].re - ref.re, out[i].im - ref.im));
+    }
+    PrunedFft ref_bwd(PrunedFft::FftDirection::kBackward, fft_size,
+                      band_start, band_len, 1);
+    ref_bwd.Backward(band_in, reference);
+    bwd.Backward(band_in, out);
+    float bwd_err = 0;
+    for (size_t i = 0; i < fft_size; i++) {
+      bwd_err = std::max(bwd_err, std::hypot(out[i].re - reference[i].re,
+                                             out[i].im - reference[i].im));
+    }
+
+    double start_time = GetTimeSec();
+    for (size_t i = 0; i < iterations; i++) {
+      fwd.Forward(time_in, out);
+    }
+    const double pruned_fft_time = GetTimeSec() - start_time;
+    start_time = GetTimeSec();
+    for (size_t i = 0; i < iterations; i++) {
+      bwd.Backward(band_in, out);
+    }
+    const double pruned_ifft_time = GetTimeSec() - start_time;
+
+    std::printf(
+        "  Q = %2zu    FFT %9.3f us  IFFT %9.3f us  (max error %.2e, "
+        "%.2e)\n",
+        q, 1e6 * pruned_fft_time / iterations,
+        1e6 * pruned_ifft_time / iterations, fwd_err, bwd_err);
+  }
+
+  std::free(time_in);
+  std::free(band_in);
+  std::free(reference);
+  std::free(out);
+}
+
+int main(int argc, char* argv[]) {
+  if (argc > 2) {
+    std::fprintf(stderr, "Usage: %s [iterations]\n", argv[0]);
+    return 1;
+  }
+  const size_t iterations =
+      (argc == 2) ? std::strtoul(argv[1], nullptr, 0) : 100000;
+
+  int main_core_id = 2;
+  if (stick_this_thread_to_core(main_core_id) != 0) {
+    std::printf("Main thread: stitch main thread to core %d failed\n",
+                main_core_id);
+  }
+
+  const size_t configs[][2] = {{2048, 1200}, {2048, 512}, {2048, 256},
+                               {4096, 3300}, {4096, 1024}, {4096, 512}};
+  for (const auto& config : configs) {
+    RunBenchmark(config[0], config[1], iterations);
+  }
+  return 0;
+}
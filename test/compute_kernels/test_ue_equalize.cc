@@ -0,0 +1,185 @@
+/**
+ * @file test_ue_equalize.cc
+ * @brief Benchmark of the UE downlink per-symbol processing after the FFT:
+ * the CSI update of a pilot symbol and the equalization and soft demapping
+ * of a data symbol. Compares the former per-subcarrier UeWorker code against
+ * the shared AVX kernels it now uses.
+ */
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <random>
+#include <vector>
+
+#include "comms-lib.h"
+#include "cpu_attach.h"
+#include "memory_manage.h"
+#include "modulation.h"
+
+// The AVX kernels must match the former per-subcarrier code within this
+// relative error, about 80 float epsilons. They reorder and fuse float
+// operations, so they are not bit exact.
+static constexpr float kMaxRelError = 1e-5f;
+
+static double GetTimeSec() {
+  struct timespec tv;
+  clock_gettime(CLOCK_MONOTONIC, &tv);
+  return tv.tv_sec + tv.tv_nsec / 1000000000.0;
+}
+
+static complex_float* AllocSamples(size_t n) {
+  return static_cast<complex_float*>(Agora_memory::PaddedAlignedAlloc(
+      Agora_memory::Alignment_t::kAlign64, n * sizeof(complex_float)));
+}
+
+static inline std::complex<float> Cx(const complex_float& c) {
+  return {c.re, c.im};
+}
+
+/// Baseline: the former UeWorker::DoFftPilot CSI update
+static void CsiLoop(const complex_float* rx, const complex_float* pilot,
+                    complex_float* csi, size_t len) {
+  auto* csi_cx = reinterpret_cast<std::complex<float>*>(csi);
+  for (size_t j = 0; j < len; j++) {
+    csi_cx[j] += Cx(rx[j]) / Cx(pilot[j]);
+  }
+}
+
+/// Baseline: the former UeWorker::DoFftData equalization
+static void EqualizeLoop(const complex_float* rx, const complex_float* csi,
+                         std::complex<float> phc, size_t pilot_spacing,
+                         complex_float* out, size_t len) {
+  auto* out_cx = reinterpret_cast<std::complex<float>*>(out);
+  for (size_t j = 0; j < len; j++) {
+    if (j % pilot_spacing == 0) {
+      out_cx[j] = 0;
+    } else {
+      out_cx[j] = (Cx(rx[j]) / Cx(csi[j])) * phc;
+    }
+  }
+}
+
+/// The UeWorker path: shared AVX kernels
+static void EqualizeAvx(const complex_float* rx, const complex_float* csi,
+                        std::complex<float> phc, size_t pilot_spacing,
+                        complex_float* out, size_t len) {
+  CommsLib::EqualizeAvx(rx, csi, {phc.real(), phc.imag()}, out, len);
+  for (size_t j = 0; j < len; j += pilot_spacing) {
+    out[j] = {0, 0};
+  }
+}
+
+/// Return true if the AVX kernels match the former code within kMaxRelError
+static bool RunBenchmark(size_t num_sc, size_t mod_order_bits,
+                         size_t iterations) {
+  const size_t pilot_spacing = 16;
+  std::mt19937 gen(0);
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+
+  complex_float* rx = AllocSamples(num_sc);
+  complex_float* pilot = AllocSamples(num_sc);
+  complex_float* csi = AllocSamples(num_sc);
+  complex_float* csi_ref = AllocSamples(num_sc);
+  complex_float* equal = AllocSamples(num_sc);
+  complex_float* equal_ref = AllocSamples(num_sc);
+  auto* llr = static_cast<int8_t*>(Agora_memory::PaddedAlignedAlloc(
+      Agora_memory::Alignment_t::kAlign64, num_sc * mod_order_bits));
+  for (size_t i = 0; i < num_sc; i++) {
+    rx[i] = {dist(gen), dist(gen)};
+    pilot[i] = {dist(gen), dist(gen)};
+    csi[i] = {1.0f + dist(gen), dist(gen)};
+    csi_ref[i] = csi[i];
+  }
+  const std::complex<float> phc = std::exp(std::complex<float>(0, 0.1f));
+
+  // Check the kernels against the former code before timing
+  CsiLoop(rx, pilot, csi_ref, num_sc);
+  CommsLib::CsiAccumulateAvx(rx, pilot, csi, num_sc);
+  EqualizeLoop(rx, csi, phc, pilot_spacing, equal_ref, num_sc);
+  EqualizeAvx(rx, csi, phc, pilot_spacing, equal, num_sc);
+  float csi_err = 0;
+  float equal_err = 0;
+  for (size_t i = 0; i < num_sc; i++) {
+    csi_err = std::max(csi_err, std::abs(Cx(csi[i]) - Cx(csi_ref[i])) /
+                                    std::abs(Cx(csi_ref[i])));
+    equal_err = std::max(equal_err, std::abs(Cx(equal[i]) - Cx(equal_ref[i])) /
+                                        std::abs(Cx(equal_ref[i])));
+  }
+
+  double start_time = GetTimeSec();
+  for (size_t i = 0; i < iterations; i++) {
+    CsiLoop(rx, pilot, csi_ref, num_sc);
+  }
+  const double csi_loop_time = GetTimeSec() - start_time;
+  start_time = GetTimeSec();
+  for (size_t i = 0; i < iterations; i++) {
+    CommsLib::CsiAccumulateAvx(rx, pilot, csi, num_sc);
+  }
+  const double csi_avx_time = GetTimeSec() - start_time;
+
+  // A data symbol: equalize, then soft-demap the whole symbol
+  start_time = GetTimeSec();
+  for (size_t i = 0; i < iterations; i++) {
+    EqualizeLoop(rx, csi, phc, pilot_spacing, equal_ref, num_sc);
+    DemodSoftAvx2(reinterpret_cast<float*>(equal_ref), llr, num_sc,
+                  mod_order_bits);
+  }
+  const double data_loop_time = GetTimeSec() - start_time;
+  start_time = GetTimeSec();
+  for (size_t i = 0; i < iterations; i++) {
+    EqualizeAvx(rx, csi, phc, pilot_spacing, equal, num_sc);
+    DemodSoftAvx2(reinterpret_cast<float*>(equal), llr, num_sc,
+                  mod_order_bits);
+  }
+  const double data_avx_time = GetTimeSec() - start_time;
+
+  std::printf(
+      "Subcarriers = %zu, bits per symbol = %zu\n"
+      "  pilot symbol  loop %8.3f us  AVX %8.3f us  (max rel error %.2e)\n"
+      "  data symbol   loop %8.3f us  AVX %8.3f us  (max rel error %.2e)\n",
+      num_sc, mod_order_bits, 1e6 * csi_loop_time / iterations,
+      1e6 * csi_avx_time / iterations, csi_err,
+      1e6 * data_loop_time / iterations, 1e6 * data_avx_time / iterations,
+      equal_err);
+
+  std::free(rx);
+  std::free(pilot);
+  std::free(csi);
+  std::free(csi_ref);
+  std::free(equal);
+  std::free(equal_ref);
+  std::free(llr);
+
+  if ((csi_err > kMaxRelError) || (equal_err > kMaxRelError)) {
+    std::fprintf(stderr,
+                 "  AVX kernels exceed the relative error tolerance %.1e\n",
+                 kMaxRelError);
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char* argv[]) {
+  if (argc > 2) {
+    std::fprintf(stderr, "Usage: %s [iterations]\n", argv[0]);
+    return 1;
+  }
+  const size_t iterations =
+      (argc == 2) ? std::strtoul(argv[1], nullptr, 0) : 100000;
+
+  int main_core_id = 2;
+  if (stick_this_thread_to_core(main_core_id) != 0) {
+    std::printf("Main thread: stitch main thread to core %d failed\n",
+                main_core_id);
+  }
+
+  const size_t configs[][2] = {{1200, 2}, {1200, 4}, {1200, 6}, {3300, 4}};
+  bool passed = true;
+  for (const auto& config : configs) {
+    passed &= RunBenchmark(config[0], config[1], iterations);
+  }
+  return passed ? 0 : 1;
+}
@@ -27,41 +27,31 @@ static void ReadFromFile(const std::string& filename, Table<TableType>& data,
   }
 }
 
-static void ReadFromFileUl(const std::string& filename, Table<uint8_t>& data,
-                           int num_bytes_per_ue, Config const* const cfg) {
-  ReadFromFile(filename, data, cfg->Frame().NumULSyms(),
-               (num_bytes_per_ue * cfg->UeAntNum()), sizeof(uint8_t));
-}
-
 static void ReadFromFileDl(const std::string& filename, Table<short>& data,
                            int ofdm_size, Config const* const cfg) {
   ReadFromFile(filename, data, cfg->Frame().NumDLSyms() * cfg->BsAntNum(),
                (ofdm_size * 2), sizeof(short));
 }
 
-static unsigned int CheckCorrectnessUl(Config const* const cfg) {
+static unsigned int CheckCorrectnessUl(Config* const cfg) {
   int ue_num = cfg->UeAntNum();
   int num_uplink_syms = cfg->Frame().NumULSyms();
   int ofdm_data_num = cfg->OfdmDataNum();
   int ul_pilot_syms = cfg->Frame().ClientUlPilotSymbols();
 
   std::string cur_directory = TOSTRING(PROJECT_DIRECTORY);
-  std::string raw_data_filename = cur_directory + "/data/LDPC_orig_ul_data_" +
-                                  std::to_string(cfg->OfdmCaNum()) + "_ant" +
-                                  std::to_string(cfg->UeAntNum()) + ".bin";
   std::string output_data_filename = cur_directory + "/data/decode_data.bin";
 
-  Table<uint8_t> raw_data;
+  // The reference bits are the ones Config mapped from the data generator's
+  // output, so the reference file is not read again here
   Table<uint8_t> output_data;
-  raw_data.Calloc(num_uplink_syms, (ofdm_data_num * ue_num),
-                  Agora_memory::Alignment_t::kAlign64);
   output_data.Calloc(num_uplink_syms, (ofdm_data_num * ue_num),
                      Agora_memory::Alignment_t::kAlign64);
 
-  int num_bytes_per_ue = (cfg->LdpcConfig().NumCbLen() + 7) >>
-                         3 * cfg->LdpcConfig().NumBlocksInSymbol();
-  ReadFromFileUl(raw_data_filename, raw_data, num_bytes_per_ue, cfg);
-  ReadFromFileUl(output_data_filename, output_data, num_bytes_per_ue, cfg);
+  int num_bytes_per_ue =
+      cfg->NumBytesPerCb() * cfg->LdpcConfig().NumBlocksInSymbol();
+  ReadFromFile(output_data_filename, output_data, num_uplink_syms,
+               num_bytes_per_ue * ue_num, sizeof(uint8_t));
 
   std::printf(
       "check_correctness_ul: ue %d, ul syms %d, ofdm %d, ul pilots %d, bytes "
@@ -75,13 +65,15 @@ static unsigned int CheckCorrectnessUl(Config const* const cfg) {
       for (int ue = 0; ue < ue_num; ue++) {
         for (int j = 0; j < num_bytes_per_ue; j++) {
           total_count++;
-          int offset_in_raw = num_bytes_per_ue * ue + j;
+          const int8_t* cb_bits = cfg->GetInfoBits(
+              cfg->UlBits(), i, ue, j / cfg->NumBytesPerCb());
+          const auto raw =
+              static_cast<uint8_t>(cb_bits[j % cfg->NumBytesPerCb()]);
           int offset_in_output = num_bytes_per_ue * ue + j;
-          if (raw_data[i][offset_in_raw] != output_data[i][offset_in_output]) {
+          if (raw != output_data[i][offset_in_output]) {
             error_cnt++;
             if (kDebugPrintUlCorr) {
-              std::printf("(%d, %d, %u, %u)\n", i, j,
-                          raw_data[i][offset_in_raw],
+              std::printf("(%d, %d, %u, %u)\n", i, j, raw,
                           output_data[i][offset_in_output]);
             }
           }
@@ -90,7 +82,6 @@ static unsigned int CheckCorrectnessUl(Config const* const cfg) {
     }    // if (i >= ul_pilot_syms)
   }      // for (int i = 0; i < num_uplink_syms; i++)
 
-  raw_data.Free();
   output_data.Free();
 
   return error_cnt;
@@ -154,7 +145,7 @@ unsigned int CheckCorrectnessDl(Config const* const cfg) {
   return error_cnt;
 }
 
-static unsigned int CheckCorrectness(Config const* const cfg) {
+static unsigned int CheckCorrectness(Config* const cfg) {
   unsigned int ul_error_count = 0;
   unsigned int dl_error_count = 0;
   ul_error_count = CheckCorrectnessUl(cfg);
@@ -167,6 +158,50 @@ static unsigned int CheckCorrectness(Config const* const cfg) {
 DEFINE_string(conf_file,
               TOSTRING(PROJECT_DIRECTORY) "/data/tddconfig-sim-both.json",
               "Config filename");
+DEFINE_uint64(startup_bench, 0,
+              "If nonzero, time this many startups (Config construction and "
+              "GenData()) with the GenData cache of the config, after one "
+              "without it, and exit");
+
+/// Time Config construction and GenData() without the GenData cache and then
+/// [num_runs] times with it
+static void RunStartupBenchmark(const std::string& conf_file,
+                                size_t num_runs) {
+  auto time_startup = [&]() {
+    const double start_us = GetTime::GetTimeUs();
+    auto cfg = std::make_unique<Config>(conf_file.c_str());
+    const double parsed_us = GetTime::GetTimeUs();
+    cfg->GenData();
+    const double end_us = GetTime::GetTimeUs();
+    std::printf("  Config %.1f ms, GenData %.1f ms, total %.1f ms\n",
+                (parsed_us - start_us) / 1000.0, (end_us - parsed_us) / 1000.0,
+                (end_us - start_us) / 1000.0);
+    return std::make_pair(cfg->GenDataCacheFile(), end_us - start_us);
+  };
+
+  // Find and remove the cache of this config, so that the first timed startup
+  // generates the data
+  std::printf("Startup benchmark: warming up\n");
+  const std::string cache_file = time_startup().first;
+  if (cache_file.empty()) {
+    std::printf("Startup benchmark: GenData cache is disabled\n");
+  } else {
+    std::remove(cache_file.c_str());
+  }
+  std::printf("Startup benchmark: without cache\n");
+  const double cold_us = time_startup().second;
+
+  std::printf("Startup benchmark: with cache, %zu runs\n", num_runs);
+  double warm_us = 0;
+  for (size_t i = 0; i < num_runs; i++) {
+    warm_us += time_startup().second;
+  }
+  warm_us /= num_runs;
+  std::printf(
+      "Startup benchmark: %.1f ms without cache, %.1f ms with cache on "
+      "average (%.1fx)\n",
+      cold_us / 1000.0, warm_us / 1000.0, cold_us / warm_us);
+}
 
 int main(int argc, char* argv[]) {
   std::string conf_file;
@@ -182,6 +217,12 @@ int main(int argc, char* argv[]) {
     conf_file = FLAGS_conf_file;
   }
 
+  if (FLAGS_startup_bench > 0) {
+    RunStartupBenchmark(conf_file, FLAGS_startup_bench);
+    gflags::ShutDownCommandLineFlags();
+    return EXIT_SUCCESS;
+  }
+
   auto cfg = std::make_unique<Config>(conf_file.c_str());
   cfg->GenData();
 
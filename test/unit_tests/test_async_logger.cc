@@ -0,0 +1,101 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "async_logger.h"
+
+static constexpr size_t kNumProducers = 8;
+static constexpr size_t kRecordsPerProducer = (1 << 17);
+
+struct RecordSink {
+  std::array<size_t, kNumProducers> last_seq_;
+  size_t num_records_ = 0;
+  size_t num_errors_ = 0;
+};
+
+// Records hold the producer ID, a sequence number and a pattern derived from
+// the sequence number. Only the drain thread touches the sink.
+static void ConsumeRecord(void* sink, const uint8_t* data, size_t len) {
+  auto* record_sink = static_cast<RecordSink*>(sink);
+  size_t producer_id;
+  size_t seq;
+  std::memcpy(&producer_id, data, sizeof(size_t));
+  std::memcpy(&seq, data + sizeof(size_t), sizeof(size_t));
+  for (size_t i = 2 * sizeof(size_t); i < len; i++) {
+    if (data[i] != static_cast<uint8_t>(seq + i)) {
+      record_sink->num_errors_++;
+    }
+  }
+  if (seq != record_sink->last_seq_.at(producer_id) + 1) {
+    record_sink->num_errors_++;
+  }
+  record_sink->last_seq_.at(producer_id) = seq;
+  record_sink->num_records_++;
+}
+
+// Records of varying size from several threads must be consumed intact and
+// in per-thread order, including across ring wrap-arounds
+TEST(TestAsyncLogger, PerThreadOrder) {
+  RecordSink sink;
+  sink.last_seq_.fill(0);
+  AsyncLogger& logger = AsyncLogger::Instance();
+
+  std::vector<std::thread> producers;
+  for (size_t producer_id = 0; producer_id < kNumProducers; producer_id++) {
+    producers.emplace_back([&logger, &sink, producer_id]() {
+      for (size_t seq = 1; seq <= kRecordsPerProducer; seq++) {
+        const size_t len = 2 * sizeof(size_t) + (seq * 37) % 3000;
+        auto fill = [&](uint8_t* data) {
+          std::memcpy(data, &producer_id, sizeof(size_t));
+          std::memcpy(data + sizeof(size_t), &seq, sizeof(size_t));
+          for (size_t i = 2 * sizeof(size_t); i < len; i++) {
+            data[i] = static_cast<uint8_t>(seq + i);
+          }
+        };
+        // Retry dropped records so that every sequence number arrives
+        while (logger.Log(ConsumeRecord, &sink, len, fill) == false) {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  for (auto& producer : producers) {
+    producer.join();
+  }
+  logger.Flush();
+
+  ASSERT_EQ(sink.num_records_, kNumProducers * kRecordsPerProducer);
+  ASSERT_EQ(sink.num_errors_, 0);
+}
+
+// Threads that exit hand their ring over to new threads
+TEST(TestAsyncLogger, ShortLivedThreads) {
+  static constexpr size_t kNumThreads = 2 * AsyncLogger::kMaxRings;
+  RecordSink sink;
+  sink.last_seq_.fill(0);
+  AsyncLogger& logger = AsyncLogger::Instance();
+  const size_t num_dropped = logger.NumDropped();
+
+  for (size_t i = 0; i < kNumThreads; i++) {
+    std::thread([&logger, &sink, i]() {
+      const size_t producer_id = 0;
+      const size_t seq = i + 1;
+      logger.Log(ConsumeRecord, &sink, 2 * sizeof(size_t), [&](uint8_t* data) {
+        std::memcpy(data, &producer_id, sizeof(size_t));
+        std::memcpy(data + sizeof(size_t), &seq, sizeof(size_t));
+      });
+    }).join();
+  }
+  logger.Flush();
+
+  ASSERT_EQ(logger.NumDropped(), num_dropped);
+  ASSERT_EQ(sink.num_records_, kNumThreads);
+  ASSERT_EQ(sink.num_errors_, 0);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
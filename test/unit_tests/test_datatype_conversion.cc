@@ -6,6 +6,7 @@
 #include <gtest/gtest.h>
 
 #include <bitset>
+#include <chrono>
 
 #include "comms-lib.h"
 #include "datatype_conversion.h"
@@ -86,6 +87,65 @@ TEST(Modulation, adapt_bits_for_mod_stress) {
   }
 }
 
+// Check the SIMD AdaptBitsForMod kernels against the scalar loop, and print
+// their throughput on a code block-sized input
+TEST(Modulation, adapt_bits_for_mod_simd) {
+  using AdaptFunc = void (*)(const uint8_t*, uint8_t*, size_t, size_t);
+  std::vector<std::pair<std::string, AdaptFunc>> kernels = {
+      {"dispatch", AdaptBitsForMod}};
+#ifdef __BMI2__
+  kernels.emplace_back("bmi2", AdaptBitsForModBmi2);
+#endif
+#ifdef __AVX2__
+  kernels.emplace_back("avx2", AdaptBitsForModAvx2);
+#endif
+  static constexpr size_t kBenchBytes = 3000;
+  static constexpr size_t kBenchIters = 10000;
+
+  for (size_t mod_type : {2, 4, 6, 8}) {
+    for (size_t iter = 0; iter < 1000; iter++) {
+      const size_t num_input_bytes = rand() % 2000;
+      std::vector<uint8_t> input(num_input_bytes);
+      for (auto& byte : input) {
+        byte = rand();
+      }
+      const size_t num_output_bytes =
+          std::ceil(num_input_bytes * 8.0 / mod_type);
+      std::vector<uint8_t> expected(num_output_bytes);
+      AdaptBitsForModLoop(input.data(), expected.data(), num_input_bytes,
+                          mod_type);
+      for (const auto& kernel : kernels) {
+        std::vector<uint8_t> output(num_output_bytes);
+        kernel.second(input.data(), output.data(), num_input_bytes, mod_type);
+        ASSERT_EQ(expected, output) << kernel.first << ", mod_type "
+                                    << mod_type << ", " << num_input_bytes
+                                    << " input bytes";
+      }
+    }
+
+    std::vector<uint8_t> input(kBenchBytes);
+    for (auto& byte : input) {
+      byte = rand();
+    }
+    std::vector<uint8_t> output(kBenchBytes * 8 / mod_type + 1);
+    std::vector<std::pair<std::string, AdaptFunc>> bench_kernels = kernels;
+    bench_kernels.emplace_back("loop", AdaptBitsForModLoop);
+    std::printf("adapt_bits_for_mod, mod_type %zu, %zu input bytes:", mod_type,
+                kBenchBytes);
+    for (const auto& kernel : bench_kernels) {
+      const auto start = std::chrono::steady_clock::now();
+      for (size_t i = 0; i < kBenchIters; i++) {
+        kernel.second(input.data(), output.data(), kBenchBytes, mod_type);
+      }
+      const double ns = std::chrono::duration<double, std::nano>(
+                            std::chrono::steady_clock::now() - start)
+                            .count();
+      std::printf(" %s %.1f ns", kernel.first.c_str(), ns / kBenchIters);
+    }
+    std::printf("\n");
+  }
+}
+
 TEST(SIMD, float_32_to_16) {
   constexpr float kAllowedError = 1e-3;
   auto* in_buf = static_cast<float*>(Agora_memory::PaddedAlignedAlloc(
@@ -0,0 +1,125 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "gettime.h"
+#include "shm_transport.h"
+
+static constexpr uint16_t kServerPort = 3195;
+static constexpr size_t kMessageSize = 9000;
+static constexpr size_t kNumProducers = 4;
+static constexpr size_t kNumPacketsPerProducer = 10000;
+
+// Packets from several producers arrive intact and in order per producer
+TEST(ShmTransport, RingMultiProducer) {
+  auto ring = ShmRing::Create(kServerPort, 64, kMessageSize);
+  auto producer_ring = ShmRing::Open(kServerPort);
+  ASSERT_NE(producer_ring, nullptr);
+
+  std::vector<std::thread> producers;
+  for (size_t p = 0; p < kNumProducers; p++) {
+    producers.emplace_back([&, p]() {
+      std::vector<uint8_t> packet(kMessageSize);
+      for (size_t i = 0; i < kNumPacketsPerProducer; i++) {
+        reinterpret_cast<size_t*>(packet.data())[0] = p;
+        reinterpret_cast<size_t*>(packet.data())[1] = i;
+        packet.back() = static_cast<uint8_t>(p + i);
+        // Retry while the ring is full
+        while (!producer_ring->Push(packet.data(), kMessageSize)) {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+
+  const double freq_ghz = GetTime::MeasureRdtscFreq();
+  const size_t start_time = GetTime::Rdtsc();
+  std::vector<size_t> next_index(kNumProducers, 0);
+  std::vector<uint8_t> buf(kMessageSize);
+  size_t num_received = 0;
+  while (num_received < kNumProducers * kNumPacketsPerProducer) {
+    const size_t len = ring->Pop(buf.data(), buf.size());
+    if (len == 0) {
+      std::this_thread::yield();
+      continue;
+    }
+    ASSERT_EQ(len, kMessageSize);
+    const size_t p = reinterpret_cast<size_t*>(buf.data())[0];
+    const size_t i = reinterpret_cast<size_t*>(buf.data())[1];
+    ASSERT_LT(p, kNumProducers);
+    ASSERT_EQ(i, next_index[p]);
+    ASSERT_EQ(buf.back(), static_cast<uint8_t>(p + i));
+    next_index[p]++;
+    num_received++;
+  }
+  for (auto& producer : producers) {
+    producer.join();
+  }
+  std::printf("Bandwidth = %.2f Gbps\n",
+              (num_received * kMessageSize * 8) /
+                  GetTime::CyclesToNs(GetTime::Rdtsc() - start_time, freq_ghz));
+}
+
+// A full ring drops packets like a full socket buffer, and frees slots as
+// they are received
+TEST(ShmTransport, ClientServer) {
+  ShmServer server(kServerPort);
+  ShmClient client;
+  std::vector<uint8_t> packet(kMessageSize, 7);
+  for (size_t i = 0; i < ShmServer::kMinNumSlots + 1; i++) {
+    client.Send("localhost", kServerPort, packet.data(), packet.size());
+  }
+  ASSERT_EQ(client.NumDropped(), 1);
+
+  std::vector<uint8_t> buf(kMessageSize);
+  for (size_t i = 0; i < ShmServer::kMinNumSlots; i++) {
+    ASSERT_EQ(server.Recv(buf.data(), buf.size()),
+              static_cast<ssize_t>(kMessageSize));
+    ASSERT_EQ(buf, packet);
+  }
+  ASSERT_EQ(server.Recv(buf.data(), buf.size()), 0);
+
+  client.Send("localhost", kServerPort, packet.data(), packet.size());
+  ASSERT_EQ(server.Recv(buf.data(), buf.size()),
+            static_cast<ssize_t>(kMessageSize));
+}
+
+// Sending to a port without a server drops the packet without an error
+TEST(ShmTransport, NoServer) {
+  shm_unlink(ShmRing::ObjectName(kServerPort + 1).c_str());
+  ShmClient client;
+  std::vector<uint8_t> packet(kMessageSize);
+  client.Send("localhost", kServerPort + 1, packet.data(), packet.size());
+  ASSERT_EQ(client.NumDropped(), 1);
+}
+
+// A server that comes up later is found once the open retry interval passes
+TEST(ShmTransport, LateServer) {
+  const uint16_t port = kServerPort + 2;
+  shm_unlink(ShmRing::ObjectName(port).c_str());
+  ShmClient client;
+  std::vector<uint8_t> packet(kMessageSize, 3);
+  client.Send("localhost", port, packet.data(), packet.size());
+
+  ShmServer server(port);
+  client.Send("localhost", port, packet.data(), packet.size());
+  ASSERT_EQ(client.NumDropped(), 2);
+
+  std::this_thread::sleep_for(std::chrono::nanoseconds(
+      2 * ShmClient::kOpenRetryIntervalNs));
+  client.Send("localhost", port, packet.data(), packet.size());
+  ASSERT_EQ(client.NumDropped(), 2);
+  std::vector<uint8_t> buf(kMessageSize);
+  ASSERT_EQ(server.Recv(buf.data(), buf.size()),
+            static_cast<ssize_t>(kMessageSize));
+  shm_unlink(ShmRing::ObjectName(port).c_str());
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  const int ret = RUN_ALL_TESTS();
+  shm_unlink(ShmRing::ObjectName(kServerPort).c_str());
+  return ret;
+}
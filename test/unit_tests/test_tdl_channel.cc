@@ -0,0 +1,177 @@
+/**
+ * @file test_tdl_channel.cc
+ * @brief Unit tests for the TDL multipath channel of the channel simulator
+ * and the per-subcarrier channel kernel that applies it
+ */
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <complex>
+#include <random>
+#include <vector>
+
+#include "channel_kernels.h"
+#include "tdl_channel.h"
+
+static constexpr size_t kUeAnt = 16;
+static constexpr size_t kBsAnt = 64;
+static constexpr size_t kFftSize = 256;
+static constexpr double kSampleRate = 30.72e6;
+static constexpr double kDelaySpreadNs = 300.0;
+// The mean channel power over kUeAnt * kBsAnt independent antenna pairs is
+// within a few standard deviations (about 3%) of its expected value 1
+static constexpr double kMaxPowerError = 0.15;
+
+using Cd = std::complex<double>;
+
+static Cd ResponseAt(const std::vector<float>& response, size_t pair,
+                     size_t k) {
+  const size_t idx = 2 * (pair * kFftSize + k);
+  // Undo the 1 / fft_size scaling of Response()
+  return Cd(response[idx], response[idx + 1]) * static_cast<double>(kFftSize);
+}
+
+// Taps at zero delay spread all sit at delay 0, so every antenna pair sees a
+// flat channel whose power is the total (normalized) tap power
+TEST(TestTdlChannel, ZeroDelaySpreadIsFlatWithUnitPower) {
+  for (const auto profile :
+       {TdlChannel::Profile::kTdlA, TdlChannel::Profile::kTdlB,
+        TdlChannel::Profile::kTdlC}) {
+    TdlChannel channel(profile, kUeAnt, kBsAnt, kFftSize, kSampleRate, 0.0,
+                       0.0, 1e-3, 7);
+    const std::vector<float>& response = *channel.Response();
+    ASSERT_EQ(response.size(), 2 * kFftSize * kUeAnt * kBsAnt);
+
+    double total_power = 0;
+    for (size_t pair = 0; pair < kUeAnt * kBsAnt; pair++) {
+      const Cd h0 = ResponseAt(response, pair, 0);
+      for (size_t k = 1; k < kFftSize; k++) {
+        ASSERT_LE(std::abs(ResponseAt(response, pair, k) - h0),
+                  1e-5 * (1.0 + std::abs(h0)));
+      }
+      total_power += std::norm(h0);
+    }
+    EXPECT_NEAR(total_power / (kUeAnt * kBsAnt), 1.0, kMaxPowerError);
+  }
+}
+
+// With a delay spread, every subcarrier still has unit mean power, but the
+// response of each antenna pair fades across the subcarriers
+TEST(TestTdlChannel, DelaySpreadIsFrequencySelectiveWithUnitPower) {
+  for (const auto profile :
+       {TdlChannel::Profile::kTdlA, TdlChannel::Profile::kTdlB,
+        TdlChannel::Profile::kTdlC}) {
+    TdlChannel channel(profile, kUeAnt, kBsAnt, kFftSize, kSampleRate,
+                       kDelaySpreadNs, 0.0, 1e-3, 7);
+    const std::vector<float>& response = *channel.Response();
+
+    double total_power = 0;
+    double total_spread = 0;
+    for (size_t pair = 0; pair < kUeAnt * kBsAnt; pair++) {
+      double sum = 0;
+      double sum_sq = 0;
+      for (size_t k = 0; k < kFftSize; k++) {
+        const double power = std::norm(ResponseAt(response, pair, k));
+        sum += power;
+        sum_sq += power * power;
+      }
+      const double mean = sum / kFftSize;
+      total_power += mean;
+      total_spread +=
+          std::sqrt(std::max(0.0, sum_sq / kFftSize - mean * mean)) / mean;
+    }
+    EXPECT_NEAR(total_power / (kUeAnt * kBsAnt), 1.0, kMaxPowerError);
+    // Rayleigh fading across many resolvable taps makes the power per
+    // subcarrier close to exponential, whose deviation equals its mean
+    EXPECT_GT(total_spread / (kUeAnt * kBsAnt), 0.5);
+  }
+}
+
+// Applying the frequency response of a known tap set on every subcarrier
+// must equal the DFT of the circular convolution with those taps. 70
+// subcarriers span two kernel blocks and leave a scalar tail.
+TEST(TestTdlChannel, ApplySubcarrierMatricesMatchesConvolution) {
+  constexpr size_t kNumSc = 70;
+  constexpr size_t kNumIn = 2;
+  constexpr size_t kNumOut = 3;
+  constexpr float kScale = 0.5f;
+  const size_t tap_delays[] = {0, 3, 7};
+  constexpr size_t kNumTaps = sizeof(tap_delays) / sizeof(tap_delays[0]);
+
+  auto tap = [](size_t i, size_t j, size_t l) {
+    return Cd(0.3 + 0.1 * i - 0.05 * l, 0.2 * j - 0.1 * l);
+  };
+  auto dft = [](const std::vector<Cd>& x) {
+    std::vector<Cd> y(kNumSc);
+    for (size_t k = 0; k < kNumSc; k++) {
+      for (size_t n = 0; n < kNumSc; n++) {
+        y[k] += x[n] * std::polar(1.0, -2.0 * M_PI * k * n / kNumSc);
+      }
+    }
+    return y;
+  };
+
+  std::mt19937 gen(1);
+  std::uniform_real_distribution<double> dist(-1.0, 1.0);
+  std::vector<std::vector<Cd>> x(kNumIn, std::vector<Cd>(kNumSc));
+  for (auto& col : x) {
+    for (auto& sample : col) {
+      sample = Cd(dist(gen), dist(gen));
+    }
+  }
+
+  // Inputs, frequency responses (input stride 1, output stride kNumIn, as
+  // TdlChannel lays them out) and the expected outputs
+  std::vector<float> in(2 * kNumSc * kNumIn);
+  std::vector<float> hf(2 * kNumSc * kNumIn * kNumOut);
+  std::vector<std::vector<Cd>> expected(kNumOut);
+  for (size_t i = 0; i < kNumIn; i++) {
+    const std::vector<Cd> x_freq = dft(x[i]);
+    for (size_t k = 0; k < kNumSc; k++) {
+      in[2 * (i * kNumSc + k)] = static_cast<float>(x_freq[k].real());
+      in[2 * (i * kNumSc + k) + 1] = static_cast<float>(x_freq[k].imag());
+    }
+  }
+  for (size_t j = 0; j < kNumOut; j++) {
+    std::vector<Cd> y(kNumSc);
+    for (size_t i = 0; i < kNumIn; i++) {
+      for (size_t l = 0; l < kNumTaps; l++) {
+        for (size_t n = 0; n < kNumSc; n++) {
+          y[n] += tap(i, j, l) *
+                  x[i][(n + kNumSc - tap_delays[l]) % kNumSc];
+        }
+      }
+      float* hf_ij = &hf[2 * kNumSc * (i + j * kNumIn)];
+      for (size_t k = 0; k < kNumSc; k++) {
+        Cd h_k = 0;
+        for (size_t l = 0; l < kNumTaps; l++) {
+          h_k += tap(i, j, l) *
+                 std::polar(1.0, -2.0 * M_PI * k * tap_delays[l] / kNumSc);
+        }
+        hf_ij[2 * k] = static_cast<float>(h_k.real());
+        hf_ij[2 * k + 1] = static_cast<float>(h_k.imag());
+      }
+    }
+    expected[j] = dft(y);
+  }
+
+  std::vector<float> out(2 * kNumSc * kNumOut);
+  ApplySubcarrierMatrices(in.data(), kNumSc, kNumIn, hf.data(), 1, kNumIn,
+                          kNumOut, kScale, out.data());
+
+  for (size_t j = 0; j < kNumOut; j++) {
+    for (size_t k = 0; k < kNumSc; k++) {
+      const Cd result(out[2 * (j * kNumSc + k)],
+                      out[2 * (j * kNumSc + k) + 1]);
+      ASSERT_LE(std::abs(result - static_cast<double>(kScale) * expected[j][k]),
+                1e-4 * (1.0 + std::abs(expected[j][k])))
+          << "output " << j << ", subcarrier " << k;
+    }
+  }
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}